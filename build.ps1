@@ -1,7 +1,7 @@
 Param(
   [ValidateSet('MSVC','Clang')]
   [string]$Compiler = 'Clang',
-  [ValidateSet('Raygui')]
+  [ValidateSet('Raygui','Cli')]
   [string]$UI = 'Raygui',
   [string]$RaylibInclude,
   [string]$RaylibLibs,
@@ -91,9 +91,10 @@ if ($Compiler -eq 'MSVC' -or $Compiler -eq 'Clang') {
     # Source files: C modules + main_raygui.c
     $files = $files | Where-Object { $_ -notmatch "\\src\\main.c$" }
     $files = $files | Where-Object { $_ -notmatch "\\src\\main_gacui.cpp$" }
+    $files = $files | Where-Object { $_ -notmatch "\\src\\main_cli.c$" }
     $files += Join-Path $PWD "src/main_raygui.c"
-    # Compile as C (MSVC does not use /std, use /TC)
-    $cxxflags = '/TC /utf-8 /MD'
+    # Compile as C11 (<stdatomic.h> is used by the scan pipeline)
+    $cxxflags = '/TC /std:c11 /utf-8 /MD'
     $linkopts = '/link /SUBSYSTEM:CONSOLE'
 
     # Force fallback: build raylib from source to ensure predictable binary
@@ -133,6 +134,15 @@ if ($Compiler -eq 'MSVC' -or $Compiler -eq 'Clang') {
       $defines += ' /D PLATFORM_DESKTOP_RGFW /D GRAPHICS_API_OPENGL_33'
       Write-Host "Using local build of raylib modules (PLATFORM_DESKTOP_RGFW) and raygui.h"
   }
+  elseif ($UI -eq 'Cli') {
+    # Headless build: project modules + main_cli.c, no raylib
+    $out = (Join-Path $PWD.Path 'bin\catnet_cli.exe')
+    $libs = 'Ws2_32.lib Iphlpapi.lib kernel32.lib advapi32.lib'
+    $files = $files | Where-Object { $_ -notmatch "\\src\\main_raygui.c$" }
+    $cxxflags = '/TC /std:c11 /utf-8 /MD'
+    $linkopts = '/link /SUBSYSTEM:CONSOLE'
+    $useLocalRaylib = $false
+  }
 
   $cc = if ($isClang) { 'clang-cl' } else { 'cl' }
   if ($isClang) {
@@ -145,6 +155,8 @@ if ($Compiler -eq 'MSVC' -or $Compiler -eq 'Clang') {
     $cc = 'cl'
     $linker = 'link'
   }
+  # MSVC still gates <stdatomic.h> behind an experimental switch; clang-cl has it.
+  if (-not $isClang) { $cxxflags += ' /experimental:c11atomics' }
   $ccCmd = "$cc /nologo /W3 /O2 $defines $cxxflags /Fe`"$out`" $($files -join ' ') $includes $linkopts $libs"
 
   if ($ccExists) {
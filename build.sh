@@ -0,0 +1,36 @@
+#!/bin/sh
+# Builds the headless CLI (bin/catnet_cli) on Linux and other POSIX systems,
+# and the unit tests (bin/test_*); "./build.sh test" also runs the tests.
+# The GUI is Windows-only; use build.ps1 for it.
+set -e
+cd "$(dirname "$0")"
+CC=${CC:-cc}
+CFLAGS=${CFLAGS:--O2 -Wall}
+mkdir -p bin/obj
+# Everything but the front ends is compiled once and linked into each program.
+OBJS=
+for f in $(ls src/*.c | grep -v 'src/main_'); do
+    o=bin/obj/$(basename "$f" .c).o
+    echo "$CC $CFLAGS -std=c11 -D_GNU_SOURCE -c -o $o $f"
+    $CC $CFLAGS -std=c11 -D_GNU_SOURCE -c -o "$o" "$f"
+    OBJS="$OBJS $o"
+done
+echo "$CC $CFLAGS -std=c11 -D_GNU_SOURCE -o bin/catnet_cli src/main_cli.c$OBJS -lpthread"
+$CC $CFLAGS -std=c11 -D_GNU_SOURCE -o bin/catnet_cli src/main_cli.c $OBJS -lpthread
+echo "Executable created: bin/catnet_cli"
+
+# Unit tests: one program per module, no network needed.
+TESTS=
+for t in tests/test_*.c; do
+    name=bin/$(basename "$t" .c)
+    $CC $CFLAGS -std=c11 -D_GNU_SOURCE -Isrc -o "$name" "$t" $OBJS -lpthread
+    TESTS="$TESTS $name"
+done
+echo "Tests built:$TESTS"
+if [ "$1" = "test" ]; then
+    failed=0
+    for t in $TESTS; do
+        if "$t"; then echo "PASS $t"; else echo "FAIL $t"; failed=1; fi
+    done
+    exit $failed
+fi
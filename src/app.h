@@ -3,13 +3,26 @@
 
 /* app.h não depende de headers do Windows; evitar conflitos com Raylib */
 
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEVICE_INLINE_PORTS 16 // open ports stored in the record itself
+#define DEVICE_IP_STRLEN 16    // "255.255.255.255"
+#define DEVICE_MAC_STRLEN 18   // "AA-BB-CC-DD-EE-FF"
+
+// Compact host record (60 bytes): binary address and MAC, host name and
+// identified services as string arena handles, open ports as uint16. Text
+// is produced only for display and export, through the device_* helpers.
 typedef struct {
-    char ip[64];
-    char hostname[256];
-    char mac[32];
-    int is_alive; // ping OK
-    int open_ports[32];
-    int open_ports_count;
+    uint32_t ip;           // IPv4, host order
+    uint32_t hostname;     // string_arena handle, 0 = unnamed
+    uint32_t more_ports;   // string_arena blob of uint16 ports past the inline ones
+    uint32_t services;     // string_arena handle of "port/service[/product],...", 0 = none
+    uint8_t mac[6];
+    uint8_t has_mac;
+    uint8_t is_alive;      // ping OK
+    uint16_t open_ports_count;
+    uint16_t open_ports[DEVICE_INLINE_PORTS]; // first open ports, in probe order
 } DeviceInfo;
 
 typedef struct {
@@ -26,8 +39,30 @@ extern "C" {
 void device_list_init(DeviceList* list);
 void device_list_clear(DeviceList* list);
 void device_list_push(DeviceList* list, const DeviceInfo* info);
+
+// DeviceInfo accessors (src/device.c)
+void device_init(DeviceInfo* di, unsigned long ip);
+void device_ip_str(const DeviceInfo* di, char* buf, size_t bufsz);
+const char* device_hostname(const DeviceInfo* di); // "" when unnamed
+void device_set_hostname(DeviceInfo* di, const char* name);
+void device_mac_str(const DeviceInfo* di, char* buf, size_t bufsz); // "" when unknown
+// Accepts "AA-BB-CC-DD-EE-FF" or "aa:bb:cc:dd:ee:ff". Returns 1 on success.
+int device_set_mac_str(DeviceInfo* di, const char* mac);
+int device_port(const DeviceInfo* di, int i); // i < open_ports_count
+int device_has_port(const DeviceInfo* di, int port);
+// Both return 0 when the list cannot be stored (out of memory, or more than
+// 65535 ports): device_set_ports then keeps the inline ports only,
+// device_add_port the list as it was.
+int device_add_port(DeviceInfo* di, int port);
+int device_set_ports(DeviceInfo* di, const int* ports, int count);
+// "22/ssh/OpenSSH,80/http" for the open ports whose service was identified
+// (see service.h); "" when none was.
+const char* device_services(const DeviceInfo* di);
+struct ServiceSignature;
+// sigs[i] names the service on ports[i]; NULL entries are skipped.
+void device_set_services(DeviceInfo* di, const int* ports, const struct ServiceSignature* const* sigs, int count);
 #ifdef __cplusplus
 }
 #endif
 
-#endif // APP_H
\ No newline at end of file
+#endif // APP_H
@@ -0,0 +1,102 @@
+#include "checkpoint.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CHECKPOINT_MAGIC "CATNETK\0"
+// Bumped whenever the layout or ScanConfig changes; the size check below
+// alone misses a reordered or retyped field of the same size.
+#define CHECKPOINT_VERSION 2 // 2: port spec, target order, shard and service fields
+
+// Followed by the ScanConfig, then 'words' words of 'done' and of 'alive'.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t config_size; // sizeof(ScanConfig), a second guard against other builds
+    uint32_t start_ip, end_ip;
+    uint64_t words;
+    int64_t saved;        // Unix time
+} CheckpointHeader;
+
+size_t checkpoint_words(unsigned long start_ip, unsigned long end_ip) {
+    if (end_ip < start_ip) return 0;
+    unsigned long long n = (unsigned long long)end_ip - start_ip + 1;
+    if (n > CHECKPOINT_MAX_ADDRESSES) return 0;
+    return (size_t)((n + 63) / 64);
+}
+
+int checkpoint_init(ScanCheckpoint* cp, unsigned long start_ip, unsigned long end_ip, const ScanConfig* cfg) {
+    memset(cp, 0, sizeof(*cp));
+    size_t words = checkpoint_words(start_ip, end_ip);
+    if (!words) return 0;
+    cp->done = (uint64_t*)calloc(words, sizeof(uint64_t));
+    cp->alive = (uint64_t*)calloc(words, sizeof(uint64_t));
+    if (!cp->done || !cp->alive) { checkpoint_free(cp); return 0; }
+    cp->start_ip = start_ip;
+    cp->end_ip = end_ip;
+    cp->words = words;
+    if (cfg) cp->cfg = *cfg; else scan_config_init(&cp->cfg);
+    return 1;
+}
+
+void checkpoint_free(ScanCheckpoint* cp) {
+    free(cp->done);
+    free(cp->alive);
+    cp->done = cp->alive = NULL;
+    cp->words = 0;
+}
+
+int checkpoint_save(const char* path, const ScanCheckpoint* cp) {
+    char tmp[1024];
+    if ((size_t)snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= sizeof(tmp)) return 0;
+    CheckpointHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic));
+    h.version = CHECKPOINT_VERSION;
+    h.config_size = (uint32_t)sizeof(ScanConfig);
+    h.start_ip = (uint32_t)cp->start_ip;
+    h.end_ip = (uint32_t)cp->end_ip;
+    h.words = cp->words;
+    h.saved = (int64_t)time(NULL);
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return 0;
+    int ok = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(&cp->cfg, sizeof(cp->cfg), 1, f) == 1 &&
+             fwrite(cp->done, sizeof(uint64_t), cp->words, f) == cp->words &&
+             fwrite(cp->alive, sizeof(uint64_t), cp->words, f) == cp->words;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) { remove(tmp); return 0; }
+    if (rename(tmp, path) != 0) {
+        remove(path); // Windows will not replace
+        if (rename(tmp, path) != 0) { remove(tmp); return 0; }
+    }
+    return 1;
+}
+
+int checkpoint_load(const char* path, ScanCheckpoint* cp) {
+    memset(cp, 0, sizeof(*cp));
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    CheckpointHeader h;
+    ScanConfig cfg;
+    int ok = fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) == 0 &&
+             h.version == CHECKPOINT_VERSION && h.config_size == sizeof(ScanConfig) &&
+             h.words == checkpoint_words(h.start_ip, h.end_ip) && h.words != 0 &&
+             fread(&cfg, sizeof(cfg), 1, f) == 1 && checkpoint_init(cp, h.start_ip, h.end_ip, &cfg);
+    if (ok) {
+        ok = fread(cp->done, sizeof(uint64_t), cp->words, f) == cp->words &&
+             fread(cp->alive, sizeof(uint64_t), cp->words, f) == cp->words;
+        if (!ok) checkpoint_free(cp);
+    }
+    fclose(f);
+    return ok;
+}
+
+uint64_t checkpoint_count(const uint64_t* bits, size_t words) {
+    uint64_t n = 0;
+    for (size_t i = 0; i < words; ++i) {
+        uint64_t v = bits[i];
+        while (v) { v &= v - 1; n++; }
+    }
+    return n;
+}
@@ -0,0 +1,50 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+// Saved progress of a range scan: its range and configuration plus two
+// bitmaps over the range, one bit per address. 'done' marks addresses whose
+// result was published; 'alive' marks hosts that answered, so alive and not
+// done is the work that was still in the pipeline.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include "scan.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Larger ranges are not checkpointed (two 32 MiB bitmaps at this size).
+#define CHECKPOINT_MAX_ADDRESSES (1ull << 28)
+
+typedef struct {
+    unsigned long start_ip, end_ip; // host order, inclusive
+    ScanConfig cfg;
+    size_t words;                   // per bitmap: (addresses + 63) / 64
+    uint64_t* done;
+    uint64_t* alive;
+} ScanCheckpoint;
+
+// Number of 64-bit words for a range, 0 if it is too large to checkpoint.
+size_t checkpoint_words(unsigned long start_ip, unsigned long end_ip);
+
+// Allocates zeroed bitmaps for the range. Returns 0 if it is too large or
+// out of memory.
+int checkpoint_init(ScanCheckpoint* cp, unsigned long start_ip, unsigned long end_ip, const ScanConfig* cfg);
+void checkpoint_free(ScanCheckpoint* cp);
+
+// Writes 'cp' to a temporary file and renames it over 'path', so a crash
+// mid-write leaves the previous checkpoint intact. Returns 0 on failure.
+int checkpoint_save(const char* path, const ScanCheckpoint* cp);
+// Returns 0 if the file is missing, truncated or from another build.
+int checkpoint_load(const char* path, ScanCheckpoint* cp);
+
+// Set bits in a bitmap of 'words' words.
+uint64_t checkpoint_count(const uint64_t* bits, size_t words);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,413 @@
+#include "conn_engine.h"
+
+#if defined(__linux__)
+
+#include "metrics.h"
+#include "service.h"
+#include "thread.h"
+#include "timer_wheel.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+typedef struct {
+    int fd;              // -1 when the slot is free
+    unsigned int gen;    // bumped on each connect so stale events and timers are ignored
+    unsigned long ip;
+    int port;
+    int tries;           // connects sent for this probe
+    int timeout_ms;      // first connect's deadline; 0 = the retry policy's
+    int expired;         // timed out, waiting on the expired list
+    TimerId timer;
+    uint64_t sent_ns;    // connect() time, for the RTT histogram
+    uint32_t win_seq;    // timing window ticket
+    int win_held;        // win_seq not yet released
+    int reading;         // banner mode: connected, reading what the service says
+    int probed;          // service_probe() sent
+    int got;             // banner bytes read
+    ConnResultFn fn;
+    void* user;
+    int next;            // free list / expired list
+} ConnSlot;
+
+struct ConnEngine {
+    int epfd;
+    int window;
+    int inflight;
+    ConnSlot* slots;
+    int free_head;
+    int expired_head;         // timed out, not yet retried or finished
+    TimerWheel* wheel;        // connect deadlines
+    RetryPolicy retry;
+    struct epoll_event* events;
+    TimingWindow* twin;       // shared probe window, may be NULL
+    ConnBannerFn banner_fn;   // banner mode when set
+    int banner_wait_ms;
+    unsigned char* banners;   // SERVICE_BANNER_MAX bytes per slot
+};
+
+// Once a service has spoken, how long to wait for the rest of its banner.
+#define BANNER_SETTLE_MS 100
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Each probe holds one descriptor; keep the window under RLIMIT_NOFILE.
+void conn_engine_raise_fd_limit(void) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur >= rl.rlim_max) return;
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+}
+
+static int clamp_window_to_fd_limit(int window) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) != 0 || rl.rlim_cur == RLIM_INFINITY) return window;
+    long avail = (long)rl.rlim_cur - 64; // leave room for the rest of the process
+    if (avail < 1) avail = 1;
+    return (window > avail) ? (int)avail : window;
+}
+
+static void close_abortive(int fd) {
+    // RST instead of FIN: avoids piling up TIME_WAIT sockets on large sweeps.
+    struct linger lg; lg.l_onoff = 1; lg.l_linger = 0;
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    close(fd);
+}
+
+// 'outcome' is for the timing window: TIMING_REPLY unless the probe timed out.
+static void finish_slot(ConnEngine* ce, int i, int open, TimingOutcome outcome) {
+    ConnSlot* s = &ce->slots[i];
+    ConnResultFn fn = s->fn; void* user = s->user;
+    unsigned long ip = s->ip; int port = s->port;
+    // Copied out: the callbacks may reuse the slot.
+    unsigned char banner[SERVICE_BANNER_MAX];
+    int reading = s->reading;
+    size_t got = (size_t)s->got;
+    if (reading && got) memcpy(banner, ce->banners + (size_t)i * SERVICE_BANNER_MAX, got);
+    if (s->win_held) timing_window_release(ce->twin, s->win_seq, outcome);
+    s->win_held = 0;
+    s->reading = 0;
+    timer_wheel_cancel(ce->wheel, s->timer);
+    s->timer = 0;
+    if (s->fd >= 0) close_abortive(s->fd); // closing also removes it from the epoll set
+    s->fd = -1;
+    s->gen++;
+    s->next = ce->free_head;
+    ce->free_head = i;
+    ce->inflight--;
+    if (reading && ce->banner_fn) ce->banner_fn(user, ip, port, banner, got);
+    if (fn) fn(user, ip, port, open);
+}
+
+// (Re)arms the deadline of slot 'i'; 0 if the wheel is out of memory.
+static int arm_timer(ConnEngine* ce, int i, int ms) {
+    ConnSlot* s = &ce->slots[i];
+    timer_wheel_cancel(ce->wheel, s->timer);
+    s->timer = timer_wheel_add(ce->wheel, (unsigned long long)now_ms(), ms, ((uint64_t)s->gen << 32) | (unsigned int)i);
+    return s->timer != 0;
+}
+
+// Banner mode, after a handshake: frees the window slot and waits for the
+// service to speak. 'registered' says whether the socket is in the epoll
+// set yet. Returns 0 if it finished the probe instead.
+static int start_reading(ConnEngine* ce, int i, int registered) {
+    ConnSlot* s = &ce->slots[i];
+    timing_window_release(ce->twin, s->win_seq, TIMING_REPLY);
+    s->win_held = 0;
+    s->reading = 1;
+    s->probed = 0;
+    s->got = 0;
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u64 = ((uint64_t)s->gen << 32) | (unsigned int)i;
+    if (!arm_timer(ce, i, ce->banner_wait_ms) ||
+        epoll_ctl(ce->epfd, registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, s->fd, &ev) != 0) {
+        finish_slot(ce, i, 1, TIMING_NEUTRAL);
+        return 0;
+    }
+    return 1;
+}
+
+// Reads what is waiting on a reading slot. Returns 1 if that finished it
+// (end of stream, error or a full buffer).
+static int read_banner(ConnEngine* ce, int i) {
+    ConnSlot* s = &ce->slots[i];
+    unsigned char* buf = ce->banners + (size_t)i * SERVICE_BANNER_MAX;
+    ssize_t r = recv(s->fd, buf + s->got, (size_t)(SERVICE_BANNER_MAX - s->got), MSG_DONTWAIT);
+    if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+    if (r > 0) {
+        if (s->got == 0) metrics_inc(METRIC_TCP_BANNERS);
+        s->got += (int)r;
+        if (s->got < SERVICE_BANNER_MAX && arm_timer(ce, i, BANNER_SETTLE_MS)) return 0;
+    }
+    finish_slot(ce, i, 1, TIMING_NEUTRAL);
+    return 1;
+}
+
+// Wheel callback: the probe is retried or finished once the wheel is done
+// firing, since finishing runs user callbacks that may poll again.
+static void on_deadline(void* user, uint64_t data) {
+    ConnEngine* ce = (ConnEngine*)user;
+    int i = (int)(data & 0xFFFFFFFFu);
+    ConnSlot* s = &ce->slots[i];
+    if (s->fd < 0 || s->gen != (unsigned int)(data >> 32)) return;
+    s->timer = 0;
+    s->expired = 1;
+    s->next = ce->expired_head;
+    ce->expired_head = i;
+}
+
+ConnEngine* conn_engine_create(int window, int timeout_ms) {
+    if (window < 1) window = 1;
+    window = clamp_window_to_fd_limit(window);
+    ConnEngine* ce = (ConnEngine*)calloc(1, sizeof(ConnEngine));
+    if (!ce) return NULL;
+    ce->epfd = epoll_create1(EPOLL_CLOEXEC);
+    ce->slots = (ConnSlot*)calloc((size_t)window, sizeof(ConnSlot));
+    ce->events = (struct epoll_event*)calloc((size_t)window, sizeof(struct epoll_event));
+    ce->wheel = timer_wheel_create(1, (unsigned long long)now_ms(), on_deadline, ce);
+    if (ce->epfd < 0 || !ce->slots || !ce->events || !ce->wheel) {
+        if (ce->epfd >= 0) close(ce->epfd);
+        timer_wheel_destroy(ce->wheel);
+        free(ce->slots); free(ce->events); free(ce);
+        return NULL;
+    }
+    ce->window = window;
+    retry_policy_init(&ce->retry, 1, timeout_ms, 100, 0);
+    ce->expired_head = -1;
+    for (int i = 0; i < window; ++i) {
+        ce->slots[i].fd = -1;
+        ce->slots[i].next = (i + 1 < window) ? i + 1 : -1;
+    }
+    ce->free_head = 0;
+    return ce;
+}
+
+void conn_engine_destroy(ConnEngine* ce) {
+    if (!ce) return;
+    for (int i = 0; i < ce->window; ++i) {
+        if (ce->slots[i].fd < 0) continue;
+        close_abortive(ce->slots[i].fd);
+        if (ce->slots[i].win_held) timing_window_release(ce->twin, ce->slots[i].win_seq, TIMING_NEUTRAL);
+    }
+    close(ce->epfd);
+    timer_wheel_destroy(ce->wheel);
+    free(ce->banners);
+    free(ce->slots);
+    free(ce->events);
+    free(ce);
+}
+
+void conn_engine_set_window(ConnEngine* ce, TimingWindow* window) { if (ce) ce->twin = window; }
+
+void conn_engine_set_retry(ConnEngine* ce, const RetryPolicy* policy) {
+    if (ce && policy) retry_policy_init(&ce->retry, policy->tries, policy->timeout_ms, policy->backoff_pct, policy->max_timeout_ms);
+}
+
+int conn_engine_set_banner(ConnEngine* ce, int wait_ms, ConnBannerFn fn) {
+    if (!ce || ce->inflight > 0) return 0;
+    ce->banner_fn = fn;
+    ce->banner_wait_ms = wait_ms > 0 ? wait_ms : SERVICE_DEFAULT_WAIT_MS;
+    if (!fn || ce->banners) return 1;
+    ce->banners = (unsigned char*)malloc((size_t)ce->window * SERVICE_BANNER_MAX);
+    if (!ce->banners) { ce->banner_fn = NULL; return 0; }
+    return 1;
+}
+
+// Sends the next connect of slot 'i'. Returns 0, leaving the slot as it
+// was, if no socket could be opened; otherwise the probe is in flight or,
+// if the connect completed at once, finished.
+static int launch(ConnEngine* ce, int i) {
+    ConnSlot* s = &ce->slots[i];
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (fd < 0) return 0;
+
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons((unsigned short)s->port);
+    sa.sin_addr.s_addr = htonl((uint32_t)s->ip);
+
+    metrics_inc(METRIC_TCP_PROBES);
+    if (s->tries > 0) metrics_inc(METRIC_TCP_RETRIES);
+    s->fd = fd;
+    s->gen++;
+    s->expired = 0;
+    s->tries++;
+    s->sent_ns = clock_monotonic_ns();
+    int r = connect(fd, (struct sockaddr*)&sa, sizeof(sa));
+    int cerr = (r == 0) ? 0 : errno;
+    if (r == 0 || cerr != EINPROGRESS) {
+        // Completed (or refused) synchronously, typical on loopback.
+        int open = (r == 0);
+        uint64_t rtt_us = (clock_monotonic_ns() - s->sent_ns) / 1000;
+        metrics_inc(open ? METRIC_TCP_OPEN : METRIC_TCP_CLOSED);
+        metrics_record_us(METRIC_LAT_TCP, rtt_us);
+        // Local errors (no route, out of ports) say nothing about the path.
+        int answered = open || cerr == ECONNREFUSED;
+        if (answered) timing_observe(s->ip, (uint32_t)rtt_us);
+        if (open && ce->banner_fn) { start_reading(ce, i, 0); return 1; }
+        finish_slot(ce, i, open, answered ? TIMING_REPLY : TIMING_NEUTRAL);
+        return 1;
+    }
+
+    RetryPolicy policy = ce->retry;
+    if (s->timeout_ms > 0) policy.timeout_ms = s->timeout_ms;
+    uint64_t key = ((uint64_t)s->gen << 32) | (unsigned int)i;
+    s->timer = timer_wheel_add(ce->wheel, (unsigned long long)now_ms(), retry_policy_timeout_ms(&policy, s->tries - 1), key);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLOUT | EPOLLERR | EPOLLHUP;
+    ev.data.u64 = key;
+    if (!s->timer || epoll_ctl(ce->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) finish_slot(ce, i, 0, TIMING_NEUTRAL);
+    return 1;
+}
+
+// Retries or finishes the probes whose deadline passed. Returns how many finished.
+static int handle_expired(ConnEngine* ce) {
+    int done = 0;
+    while (ce->expired_head >= 0) {
+        int i = ce->expired_head;
+        ConnSlot* s = &ce->slots[i];
+        ce->expired_head = s->next;
+        s->expired = 0;
+        if (s->reading) {
+            // Silent so far: ask once, in the service's own protocol.
+            size_t plen = 0;
+            const unsigned char* probe = service_probe(s->port, &plen);
+            if (s->got == 0 && !s->probed && send(s->fd, probe, plen, MSG_DONTWAIT | MSG_NOSIGNAL) == (ssize_t)plen &&
+                arm_timer(ce, i, ce->banner_wait_ms)) {
+                s->probed = 1;
+                metrics_inc(METRIC_TCP_SERVICE_PROBES);
+                continue;
+            }
+            finish_slot(ce, i, 1, TIMING_NEUTRAL);
+            done++;
+            continue;
+        }
+        if (s->tries < ce->retry.tries) {
+            // A fresh connect: the kernel's own SYN retransmits follow its
+            // schedule (1 s, 3 s, ...), not the policy's.
+            close_abortive(s->fd);
+            s->fd = -1;
+            if (launch(ce, i)) continue;
+            finish_slot(ce, i, 0, TIMING_NEUTRAL);
+            done++;
+            continue;
+        }
+        metrics_inc(METRIC_TCP_TIMEOUTS);
+        finish_slot(ce, i, 0, timing_responsive(s->ip) ? TIMING_LOSS : TIMING_NEUTRAL);
+        done++;
+    }
+    return done;
+}
+
+int conn_engine_submit(ConnEngine* ce, unsigned long ip, int port, ConnResultFn fn, void* user) {
+    return conn_engine_submit_timeout(ce, ip, port, 0, fn, user);
+}
+
+int conn_engine_submit_timeout(ConnEngine* ce, unsigned long ip, int port, int timeout_ms, ConnResultFn fn, void* user) {
+    if (!ce) return 0;
+    while (ce->free_head < 0) conn_engine_poll(ce, ce->retry.timeout_ms);
+    // Waiting on the shared window must not stall our own completions,
+    // which may be what frees it.
+    uint32_t seq = 0;
+    int got;
+    while ((got = timing_window_acquire(ce->twin, ce->inflight > 0 ? 0 : 20, &seq)) == 0) {
+        if (ce->inflight > 0) conn_engine_poll(ce, 5);
+    }
+    if (got < 0) return 0; // window closed: scan cancelled
+
+    int i = ce->free_head;
+    ConnSlot* s = &ce->slots[i];
+    ce->free_head = s->next;
+    s->ip = ip;
+    s->port = port;
+    s->fn = fn;
+    s->user = user;
+    s->win_seq = seq;
+    s->win_held = 1;
+    s->tries = 0;
+    s->timeout_ms = timeout_ms;
+    s->timer = 0;
+    ce->inflight++;
+    if (!launch(ce, i)) {
+        timing_window_release(ce->twin, seq, TIMING_NEUTRAL);
+        s->next = ce->free_head;
+        ce->free_head = i;
+        ce->inflight--;
+        return 0;
+    }
+    return 1;
+}
+
+int conn_engine_poll(ConnEngine* ce, int wait_ms) {
+    if (!ce || ce->inflight == 0) return 0;
+    wait_ms = timer_wheel_next_ms(ce->wheel, (unsigned long long)now_ms(), wait_ms < 0 ? 0x7FFFFFFF : wait_ms);
+
+    int done = 0;
+    int n = epoll_wait(ce->epfd, ce->events, ce->window, wait_ms);
+    for (int k = 0; k < n; ++k) {
+        int i = (int)(ce->events[k].data.u64 & 0xFFFFFFFFu);
+        unsigned int gen = (unsigned int)(ce->events[k].data.u64 >> 32);
+        ConnSlot* s = &ce->slots[i];
+        if (s->fd < 0 || s->gen != gen || s->expired) continue; // recycled by a callback, or timed out
+        if (s->reading) { done += read_banner(ce, i); continue; }
+        int err = 0; socklen_t len = sizeof(err);
+        if (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) err = errno;
+        int open = err == 0 && !(ce->events[k].events & EPOLLERR);
+        uint64_t rtt_us = (clock_monotonic_ns() - s->sent_ns) / 1000;
+        metrics_inc(open ? METRIC_TCP_OPEN : METRIC_TCP_CLOSED);
+        metrics_record_us(METRIC_LAT_TCP, rtt_us);
+        if (open || err == ECONNREFUSED) timing_observe(s->ip, (uint32_t)rtt_us);
+        if (open && ce->banner_fn) { done += !start_reading(ce, i, 1); continue; }
+        finish_slot(ce, i, open, TIMING_REPLY);
+        done++;
+    }
+
+    timer_wheel_advance(ce->wheel, (unsigned long long)now_ms());
+    return done + handle_expired(ce);
+}
+
+void conn_engine_drain(ConnEngine* ce) {
+    while (ce && ce->inflight > 0) conn_engine_poll(ce, -1);
+}
+
+int conn_engine_inflight(const ConnEngine* ce) { return ce ? ce->inflight : 0; }
+int conn_engine_window(const ConnEngine* ce) { return ce ? ce->window : 0; }
+
+#else // !__linux__
+
+// No asynchronous backend yet; callers use net_scan_ports' blocking path.
+void conn_engine_raise_fd_limit(void) {}
+ConnEngine* conn_engine_create(int window, int timeout_ms) { (void)window; (void)timeout_ms; return 0; }
+void conn_engine_destroy(ConnEngine* ce) { (void)ce; }
+int conn_engine_submit(ConnEngine* ce, unsigned long ip, int port, ConnResultFn fn, void* user) {
+    (void)ce; (void)ip; (void)port; (void)fn; (void)user; return 0;
+}
+int conn_engine_submit_timeout(ConnEngine* ce, unsigned long ip, int port, int timeout_ms, ConnResultFn fn, void* user) {
+    (void)ce; (void)ip; (void)port; (void)timeout_ms; (void)fn; (void)user; return 0;
+}
+int conn_engine_poll(ConnEngine* ce, int wait_ms) { (void)ce; (void)wait_ms; return 0; }
+void conn_engine_drain(ConnEngine* ce) { (void)ce; }
+void conn_engine_set_window(ConnEngine* ce, TimingWindow* window) { (void)ce; (void)window; }
+void conn_engine_set_retry(ConnEngine* ce, const RetryPolicy* policy) { (void)ce; (void)policy; }
+int conn_engine_set_banner(ConnEngine* ce, int wait_ms, ConnBannerFn fn) { (void)ce; (void)wait_ms; (void)fn; return 0; }
+int conn_engine_inflight(const ConnEngine* ce) { (void)ce; return 0; }
+int conn_engine_window(const ConnEngine* ce) { (void)ce; return 0; }
+
+#endif
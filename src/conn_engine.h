@@ -0,0 +1,78 @@
+#ifndef CONN_ENGINE_H
+#define CONN_ENGINE_H
+
+// Asynchronous TCP connect engine: keeps a bounded window of non-blocking
+// connects in flight and reports each (ip, port) as it completes.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include <stddef.h>
+#include "timing.h"
+#include "timer_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ConnEngine ConnEngine;
+
+// 'ip' is a host-order IPv4 address; 'open' is 1 when the handshake completed.
+typedef void (*ConnResultFn)(void* user, unsigned long ip, int port, int open);
+
+// Banner mode (conn_engine_set_banner): called for every open port just
+// before its ConnResultFn, with what the service sent (len may be 0).
+typedef void (*ConnBannerFn)(void* user, unsigned long ip, int port, const unsigned char* data, size_t len);
+
+// Raises the soft descriptor limit to the hard one. Call once at start-up:
+// engines only clamp their window to the limit in force.
+void conn_engine_raise_fd_limit(void);
+
+// Returns NULL when no asynchronous backend exists on this platform
+// (callers fall back to the blocking net_* functions).
+ConnEngine* conn_engine_create(int window, int timeout_ms);
+void conn_engine_destroy(ConnEngine* ce);
+
+// Queues one probe. If the window is full, drives the event loop until a
+// slot frees up. Callbacks may submit further probes.
+// Returns 1 on success, 0 on failure.
+int conn_engine_submit(ConnEngine* ce, unsigned long ip, int port, ConnResultFn fn, void* user);
+// Same, with its own first-connect deadline (0 = the engine's), so one
+// engine can serve hosts with different round-trip estimates. Retries
+// back off from it as the retry policy says.
+int conn_engine_submit_timeout(ConnEngine* ce, unsigned long ip, int port, int timeout_ms, ConnResultFn fn, void* user);
+
+// Waits up to 'wait_ms' for completions and dispatches them.
+// Returns the number of probes completed.
+int conn_engine_poll(ConnEngine* ce, int wait_ms);
+
+// Runs the event loop until no probe is in flight.
+void conn_engine_drain(ConnEngine* ce);
+
+// Probes also take a slot of 'window' (shared with other engines; NULL =
+// none) from submit until they complete. A timeout on a host that answered
+// before counts as loss. Every handshake or refusal is fed to
+// timing_observe either way.
+void conn_engine_set_window(ConnEngine* ce, TimingWindow* window);
+
+// Deadlines and retries (timer_wheel.h). By default each probe is one
+// connect with the timeout given to conn_engine_create; with more tries a
+// timed-out probe is sent again with a fresh socket, waiting as the policy
+// says, and reported as closed only after the last try.
+void conn_engine_set_retry(ConnEngine* ce, const RetryPolicy* policy);
+
+// Keeps each socket that completes a handshake open to read what the
+// service says, up to SERVICE_BANNER_MAX bytes (service.h). A service that
+// stays silent for 'wait_ms' gets service_probe() for its port and another
+// 'wait_ms' to answer. The probe gives back its timing window slot at the
+// handshake, so reads do not hold up the rate; they do keep an engine slot.
+// Call before the first submit; 'fn' NULL turns banner mode off.
+// Returns 1 on success, 0 on failure.
+int conn_engine_set_banner(ConnEngine* ce, int wait_ms, ConnBannerFn fn);
+
+int conn_engine_inflight(const ConnEngine* ce);
+int conn_engine_window(const ConnEngine* ce);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONN_ENGINE_H
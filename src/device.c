@@ -0,0 +1,122 @@
+#include "app.h"
+#include "service.h"
+#include "string_arena.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void device_init(DeviceInfo* di, unsigned long ip) {
+    memset(di, 0, sizeof(*di));
+    di->ip = (uint32_t)ip;
+}
+
+void device_ip_str(const DeviceInfo* di, char* buf, size_t bufsz) {
+    uint_to_ip(di->ip, buf, bufsz);
+}
+
+const char* device_hostname(const DeviceInfo* di) {
+    return string_arena_get(di->hostname);
+}
+
+void device_set_hostname(DeviceInfo* di, const char* name) {
+    di->hostname = string_arena_intern(name);
+}
+
+void device_mac_str(const DeviceInfo* di, char* buf, size_t bufsz) {
+    if (!di->has_mac) { if (bufsz) buf[0] = '\0'; return; }
+    const uint8_t* m = di->mac;
+    snprintf(buf, bufsz, "%02X-%02X-%02X-%02X-%02X-%02X", m[0], m[1], m[2], m[3], m[4], m[5]);
+}
+
+int device_set_mac_str(DeviceInfo* di, const char* mac) {
+    unsigned int m[6];
+    char sep[5];
+    if (!mac || sscanf(mac, "%2x%c%2x%c%2x%c%2x%c%2x%c%2x", &m[0], &sep[0], &m[1], &sep[1], &m[2], &sep[2],
+                       &m[3], &sep[3], &m[4], &sep[4], &m[5]) != 11) return 0;
+    for (int i = 0; i < 5; ++i) { if (sep[i] != '-' && sep[i] != ':') return 0; }
+    for (int i = 0; i < 6; ++i) di->mac[i] = (uint8_t)m[i];
+    di->has_mac = 1;
+    return 1;
+}
+
+int device_port(const DeviceInfo* di, int i) {
+    if (i < DEVICE_INLINE_PORTS) return di->open_ports[i];
+    uint16_t p;
+    // A store record's list must lie inside the mounted table; 0 when the
+    // table is not mounted or is cut short.
+    size_t len = (size_t)(di->open_ports_count - DEVICE_INLINE_PORTS) * sizeof(p);
+    const uint8_t* more = (const uint8_t*)string_arena_data(di->more_ports, len);
+    if (!more || i >= di->open_ports_count) return 0;
+    memcpy(&p, more + (size_t)(i - DEVICE_INLINE_PORTS) * sizeof(p), sizeof(p));
+    return p;
+}
+
+int device_has_port(const DeviceInfo* di, int port) {
+    for (int i = 0; i < di->open_ports_count; ++i) { if (device_port(di, i) == port) return 1; }
+    return 0;
+}
+
+// Ports past the inline ones live in one arena blob; adding to it stores a
+// new blob. That only happens for hosts with more than 16 open ports.
+int device_add_port(DeviceInfo* di, int port) {
+    int n = di->open_ports_count;
+    if (n == UINT16_MAX) return 0; // open_ports_count is full
+    if (n < DEVICE_INLINE_PORTS) { di->open_ports[n] = (uint16_t)port; di->open_ports_count++; return 1; }
+    int extra = n - DEVICE_INLINE_PORTS;
+    uint16_t* buf = (uint16_t*)malloc(sizeof(uint16_t) * (size_t)(extra + 1));
+    if (!buf) return 0;
+    const void* more = extra ? string_arena_data(di->more_ports, sizeof(uint16_t) * (size_t)extra) : NULL;
+    if (extra && !more) { free(buf); return 0; }
+    if (extra) memcpy(buf, more, sizeof(uint16_t) * (size_t)extra);
+    buf[extra] = (uint16_t)port;
+    uint32_t h = string_arena_put(buf, sizeof(uint16_t) * (size_t)(extra + 1));
+    free(buf);
+    if (!h) return 0;
+    di->more_ports = h;
+    di->open_ports_count++;
+    return 1;
+}
+
+int device_set_ports(DeviceInfo* di, const int* ports, int count) {
+    di->open_ports_count = 0;
+    di->more_ports = 0;
+    if (count > UINT16_MAX) return 0;
+    int inl = count < DEVICE_INLINE_PORTS ? count : DEVICE_INLINE_PORTS;
+    for (int i = 0; i < inl; ++i) di->open_ports[i] = (uint16_t)ports[i];
+    di->open_ports_count = (uint16_t)inl;
+    if (count <= inl) return 1;
+    int extra = count - inl;
+    uint16_t* buf = (uint16_t*)malloc(sizeof(uint16_t) * (size_t)extra);
+    if (!buf) return 0;
+    for (int i = 0; i < extra; ++i) buf[i] = (uint16_t)ports[inl + i];
+    di->more_ports = string_arena_put(buf, sizeof(uint16_t) * (size_t)extra);
+    free(buf);
+    if (!di->more_ports) return 0;
+    di->open_ports_count = (uint16_t)count;
+    return 1;
+}
+
+const char* device_services(const DeviceInfo* di) {
+    return string_arena_get(di->services);
+}
+
+void device_set_services(DeviceInfo* di, const int* ports, const struct ServiceSignature* const* sigs, int count) {
+    di->services = 0;
+    size_t cap = 1;
+    for (int i = 0; i < count; ++i) {
+        if (sigs[i]) cap += 8 + strlen(sigs[i]->service) + strlen(sigs[i]->product) + 2;
+    }
+    if (cap == 1) return;
+    char* buf = (char*)malloc(cap);
+    if (!buf) return;
+    size_t len = 0;
+    for (int i = 0; i < count; ++i) {
+        const ServiceSignature* sig = sigs[i];
+        if (!sig) continue;
+        len += (size_t)snprintf(buf + len, cap - len, "%s%d/%s%s%s", len ? "," : "", ports[i], sig->service,
+                                sig->product[0] ? "/" : "", sig->product);
+    }
+    di->services = string_arena_intern(buf);
+    free(buf);
+}
@@ -0,0 +1,559 @@
+#include "dns_resolver.h"
+#include "metrics.h"
+#include "string_arena.h"
+#include "thread.h"
+#include "pacer.h"
+#include "timer_wheel.h"
+#include "utils.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <iphlpapi.h>
+typedef SOCKET DnsSocket;
+#define DNS_BAD_SOCKET INVALID_SOCKET
+#define dns_close_socket closesocket
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+typedef int DnsSocket;
+#define DNS_BAD_SOCKET (-1)
+#define dns_close_socket close
+#endif
+
+#define DNS_TRIES 2            // sends per query, first one included
+#define DNS_MAX_TTL 86400u     // cap for positive answers
+#define DNS_NEG_TTL 300u       // negative answers without an SOA
+#define DNS_NEG_MAX_TTL 3600u
+#define DNS_CACHE_MAX (1u << 20)
+#define DNS_TYPE_CNAME 5
+#define DNS_TYPE_SOA 6
+#define DNS_TYPE_PTR 12
+
+// The low bits of a transaction ID are the slot index; the high bits are
+// random, and the echoed question must match too.
+#define SLOT_MASK (DNS_MAX_INFLIGHT - 1)
+typedef char inflight_is_pow2[((DNS_MAX_INFLIGHT & SLOT_MASK) == 0 && DNS_MAX_INFLIGHT <= 0x8000) ? 1 : -1];
+
+typedef struct {
+    unsigned long ip;
+    DnsResultFn fn;
+    void* user;
+} DnsRequest;
+
+typedef struct {
+    int busy;
+    int tries;
+    uint16_t id;
+    TimerId timer;              // resend or give up
+    unsigned long long sent_ns; // latest send, for the RTT histogram
+    DnsRequest req;
+} DnsSlot;
+
+struct DnsResolver {
+    DnsSocket sock;
+    struct sockaddr_in server;
+    Pacer* pacer;
+    RetryPolicy retry;
+    Mutex lock;        // guards the request queue and 'closing'
+    CondVar cv;
+    DnsRequest* queue; // ring buffer of lookups waiting for a slot
+    int qcap, qhead, qcount;
+    int closing;
+    atomic_int stop;
+    Thread thread;
+    // Owned by the I/O thread.
+    DnsSlot slots[DNS_MAX_INFLIGHT];
+    int free_slots[DNS_MAX_INFLIGHT];
+    int nfree;
+    uint32_t rng;
+    TimerWheel* wheel; // query deadlines, room for every slot
+    int paced;         // a resend waited for the send budget
+};
+
+// ---- Cache ----------------------------------------------------------------
+
+typedef struct {
+    uint32_t ip;
+    uint32_t name;                 // string_arena handle, 0 = no PTR record
+    unsigned long long expires_ms; // 0 = empty slot
+} DnsCacheEntry;
+
+static Mutex g_cache_lock = MUTEX_INITIALIZER;
+static DnsCacheEntry* g_cache; // open addressing, power-of-two capacity
+static size_t g_cache_cap, g_cache_count;
+
+static size_t cache_index(uint32_t ip, size_t cap) {
+    uint32_t h = ip;
+    h ^= h >> 16; h *= 0x45d9f3bu; h ^= h >> 16;
+    return h & (cap - 1);
+}
+
+// Caller holds g_cache_lock.
+static int cache_grow(void) {
+    size_t ncap = g_cache_cap ? g_cache_cap * 2 : 4096;
+    DnsCacheEntry* nt = (DnsCacheEntry*)calloc(ncap, sizeof(DnsCacheEntry));
+    if (!nt) return 0;
+    for (size_t i = 0; i < g_cache_cap; ++i) {
+        if (!g_cache[i].expires_ms) continue;
+        size_t k = cache_index(g_cache[i].ip, ncap);
+        while (nt[k].expires_ms) k = (k + 1) & (ncap - 1);
+        nt[k] = g_cache[i];
+    }
+    free(g_cache);
+    g_cache = nt;
+    g_cache_cap = ncap;
+    return 1;
+}
+
+static void cache_put(unsigned long ip, uint32_t name, uint32_t ttl) {
+    if (ttl == 0) return;
+    unsigned long long expires = clock_monotonic_ms() + (unsigned long long)ttl * 1000ull;
+    mutex_lock(&g_cache_lock);
+    if ((g_cache_count + 1) * 10 > g_cache_cap * 7 && (g_cache_cap >= DNS_CACHE_MAX || !cache_grow())) {
+        mutex_unlock(&g_cache_lock); // full: keep what we have
+        return;
+    }
+    size_t k = cache_index((uint32_t)ip, g_cache_cap);
+    while (g_cache[k].expires_ms && g_cache[k].ip != (uint32_t)ip) k = (k + 1) & (g_cache_cap - 1);
+    if (!g_cache[k].expires_ms) g_cache_count++;
+    g_cache[k].ip = (uint32_t)ip;
+    g_cache[k].name = name;
+    g_cache[k].expires_ms = expires;
+    mutex_unlock(&g_cache_lock);
+}
+
+int dns_cache_get(unsigned long ip, uint32_t* name) {
+    int hit = 0;
+    unsigned long long now = clock_monotonic_ms();
+    mutex_lock(&g_cache_lock);
+    if (g_cache_cap) {
+        size_t k = cache_index((uint32_t)ip, g_cache_cap);
+        for (; g_cache[k].expires_ms; k = (k + 1) & (g_cache_cap - 1)) {
+            if (g_cache[k].ip != (uint32_t)ip) continue;
+            if (g_cache[k].expires_ms > now) { *name = g_cache[k].name; hit = 1; }
+            break;
+        }
+    }
+    mutex_unlock(&g_cache_lock);
+    return hit;
+}
+
+void dns_cache_clear(void) {
+    mutex_lock(&g_cache_lock);
+    free(g_cache);
+    g_cache = NULL;
+    g_cache_cap = g_cache_count = 0;
+    mutex_unlock(&g_cache_lock);
+}
+
+// ---- Wire format ----------------------------------------------------------
+
+static unsigned int be16(const unsigned char* p) { return ((unsigned int)p[0] << 8) | p[1]; }
+static uint32_t be32(const unsigned char* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+// Encodes D.C.B.A.in-addr.arpa as DNS labels. Returns the length (<= 30).
+static int encode_ptr_name(unsigned char* out, unsigned long ip) {
+    char text[32];
+    snprintf(text, sizeof(text), "%lu.%lu.%lu.%lu.in-addr.arpa", ip & 0xFF, (ip >> 8) & 0xFF, (ip >> 16) & 0xFF, (ip >> 24) & 0xFF);
+    int n = 0;
+    for (const char* p = text; *p;) {
+        const char* dot = strchr(p, '.');
+        int len = dot ? (int)(dot - p) : (int)strlen(p);
+        out[n++] = (unsigned char)len;
+        memcpy(out + n, p, (size_t)len);
+        n += len;
+        p += len + (dot ? 1 : 0);
+    }
+    out[n++] = 0;
+    return n;
+}
+
+static int build_query(unsigned char* buf, uint16_t id, unsigned long ip) {
+    memset(buf, 0, 12);
+    buf[0] = (unsigned char)(id >> 8);
+    buf[1] = (unsigned char)id;
+    buf[2] = 0x01; // RD
+    buf[5] = 1;    // QDCOUNT
+    int n = 12 + encode_ptr_name(buf + 12, ip);
+    buf[n++] = 0; buf[n++] = DNS_TYPE_PTR;
+    buf[n++] = 0; buf[n++] = 1; // IN
+    return n;
+}
+
+// Decodes the (possibly compressed) name at 'off' into dotted text without
+// the root dot; 'out' may be NULL to skip it. Returns the offset just past
+// the name as stored at 'off', or -1 if malformed.
+static int read_name(const unsigned char* msg, int len, int off, char* out, size_t outsz) {
+    int end = -1, jumps = 0;
+    size_t n = 0;
+    for (;;) {
+        if (off >= len) return -1;
+        unsigned int c = msg[off];
+        if ((c & 0xC0) == 0xC0) {
+            if (off + 1 >= len || ++jumps > 16) return -1;
+            if (end < 0) end = off + 2;
+            off = (int)(((c & 0x3F) << 8) | msg[off + 1]);
+            continue;
+        }
+        if (c & 0xC0) return -1;
+        if (c == 0) { if (end < 0) end = off + 1; break; }
+        if (off + 1 + (int)c > len) return -1;
+        if (out) {
+            if (n + c + 2 > outsz) return -1;
+            if (n) out[n++] = '.';
+            memcpy(out + n, msg + off + 1, c);
+            n += c;
+        }
+        off += 1 + (int)c;
+    }
+    if (out && outsz) out[n] = '\0';
+    return end;
+}
+
+static int printable_name(const char* s) {
+    if (!*s) return 0;
+    for (; *s; ++s) { if ((unsigned char)*s <= 0x20 || (unsigned char)*s >= 0x7F) return 0; }
+    return 1;
+}
+
+// Returns 1 with '*name' (0 = no PTR record) and '*ttl' for a cacheable
+// answer, 0 for a server failure, -1 if 'msg' does not answer 'qname'.
+static int parse_response(const unsigned char* msg, int len, const unsigned char* qname, int qlen,
+                          uint32_t* name, uint32_t* ttl) {
+    if (len < 12 || !(msg[2] & 0x80) || be16(msg + 4) != 1) return -1;
+    int off = 12;
+    if (off + qlen + 4 > len) return -1;
+    for (int i = 0; i < qlen; ++i) {
+        if (tolower(msg[off + i]) != tolower(qname[i])) return -1;
+    }
+    off += qlen;
+    if (be16(msg + off) != DNS_TYPE_PTR || be16(msg + off + 2) != 1) return -1;
+    off += 4;
+    unsigned int rcode = msg[3] & 0x0F;
+    if (rcode != 0 && rcode != 3) return 0; // SERVFAIL, REFUSED, ...: not an answer
+
+    unsigned int an = be16(msg + 6), ns = be16(msg + 8);
+    uint32_t min_ttl = DNS_MAX_TTL;
+    char host[256];
+    int found = 0;
+    for (unsigned int i = 0; i < an; ++i) {
+        off = read_name(msg, len, off, NULL, 0);
+        if (off < 0 || off + 10 > len) return -1;
+        unsigned int type = be16(msg + off), cls = be16(msg + off + 2), rdlen = be16(msg + off + 8);
+        uint32_t rttl = be32(msg + off + 4);
+        if (off + 10 + (int)rdlen > len) return -1;
+        if (cls == 1 && (type == DNS_TYPE_CNAME || (type == DNS_TYPE_PTR && !found))) {
+            if (rttl < min_ttl) min_ttl = rttl; // RFC 2317 delegations answer via a CNAME
+            if (type == DNS_TYPE_PTR) {
+                if (read_name(msg, len, off + 10, host, sizeof(host)) < 0) return -1;
+                found = 1;
+            }
+        }
+        off += 10 + (int)rdlen;
+    }
+    if (found) {
+        *name = printable_name(host) ? string_arena_intern(host) : 0;
+        *ttl = min_ttl;
+        return 1;
+    }
+    // Negative answer: cached for the SOA minimum (RFC 2308).
+    uint32_t neg = DNS_NEG_TTL;
+    for (unsigned int i = 0; i < ns; ++i) {
+        off = read_name(msg, len, off, NULL, 0);
+        if (off < 0 || off + 10 > len) break;
+        unsigned int type = be16(msg + off), rdlen = be16(msg + off + 8);
+        uint32_t rttl = be32(msg + off + 4);
+        if (off + 10 + (int)rdlen > len) break;
+        if (type == DNS_TYPE_SOA && rdlen >= 22) {
+            uint32_t minimum = be32(msg + off + 10 + rdlen - 4);
+            neg = rttl < minimum ? rttl : minimum;
+            break;
+        }
+        off += 10 + (int)rdlen;
+    }
+    *name = 0;
+    *ttl = neg < DNS_NEG_MAX_TTL ? neg : DNS_NEG_MAX_TTL;
+    return 1;
+}
+
+// ---- Resolver -------------------------------------------------------------
+
+static uint32_t next_rand(DnsResolver* r) {
+    uint32_t x = r->rng; // xorshift32
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    return r->rng = x;
+}
+
+static void send_slot(DnsResolver* r, int i) {
+    DnsSlot* s = &r->slots[i];
+    unsigned char pkt[64];
+    int n = build_query(pkt, s->id, s->req.ip);
+    // A failed send is treated like a lost datagram: the timeout retries it.
+    sendto(r->sock, (const char*)pkt, n, 0, (const struct sockaddr*)&r->server, sizeof(r->server));
+    metrics_inc(METRIC_DNS_QUERIES);
+    if (s->tries > 0) metrics_inc(METRIC_DNS_RETRIES);
+    s->sent_ns = clock_monotonic_ns();
+    s->tries++;
+    s->timer = timer_wheel_add(r->wheel, clock_monotonic_ms(), retry_policy_timeout_ms(&r->retry, s->tries - 1), (uint64_t)i);
+}
+
+// Frees slot 'i' and returns its request, to be completed by the caller.
+static DnsRequest release_slot(DnsResolver* r, int i) {
+    r->slots[i].busy = 0;
+    timer_wheel_cancel(r->wheel, r->slots[i].timer);
+    r->slots[i].timer = 0;
+    r->free_slots[r->nfree++] = i;
+    return r->slots[i].req;
+}
+
+static void handle_datagram(DnsResolver* r, const unsigned char* msg, int len) {
+    if (len < 12) return;
+    uint16_t id = (uint16_t)be16(msg);
+    int i = id & SLOT_MASK;
+    DnsSlot* s = &r->slots[i];
+    if (!s->busy || s->id != id) return;
+    unsigned char qname[32];
+    int qlen = encode_ptr_name(qname, s->req.ip);
+    uint32_t name = 0, ttl = 0;
+    int rc = parse_response(msg, len, qname, qlen, &name, &ttl);
+    if (rc < 0) return; // not our answer: keep waiting
+    metrics_inc(METRIC_DNS_ANSWERS);
+    metrics_record_us(METRIC_LAT_DNS, (clock_monotonic_ns() - s->sent_ns) / 1000);
+    DnsRequest req = release_slot(r, i);
+    if (rc > 0) cache_put(req.ip, name, ttl);
+    req.fn(req.user, req.ip, rc > 0 ? name : 0);
+}
+
+// Wheel callback on the I/O thread: resend the query, or give up on it.
+static void on_query_deadline(void* user, uint64_t data) {
+    DnsResolver* r = (DnsResolver*)user;
+    int i = (int)data;
+    DnsSlot* s = &r->slots[i];
+    if (!s->busy) return;
+    s->timer = 0;
+    if (s->tries < r->retry.tries) {
+        if (pacer_try_acquire(r->pacer, 1)) { send_slot(r, i); return; }
+        s->timer = timer_wheel_add(r->wheel, clock_monotonic_ms(), 1, data); // room reserved at create
+        r->paced = 1;
+        return;
+    }
+    metrics_inc(METRIC_DNS_TIMEOUTS);
+    DnsRequest req = release_slot(r, i);
+    req.fn(req.user, req.ip, 0);
+}
+
+static void io_proc(void* arg) {
+    DnsResolver* r = (DnsResolver*)arg;
+    unsigned char buf[1500];
+    int fresh[DNS_MAX_INFLIGHT];
+    while (!atomic_load(&r->stop)) {
+        // Resends and timeouts that are due.
+        r->paced = 0;
+        timer_wheel_advance(r->wheel, clock_monotonic_ms());
+        int paced = r->paced;
+
+        // Move queued lookups into free slots, as the send budget allows.
+        int nfresh = 0;
+        mutex_lock(&r->lock);
+        if (r->qcount == 0 && r->nfree == DNS_MAX_INFLIGHT) {
+            cond_timedwait(&r->cv, &r->lock, 100);
+            mutex_unlock(&r->lock);
+            continue;
+        }
+        while (r->qcount > 0 && r->nfree > 0 && !paced) {
+            if (!pacer_try_acquire(r->pacer, 1)) { paced = 1; break; }
+            int i = r->free_slots[--r->nfree];
+            DnsSlot* s = &r->slots[i];
+            s->req = r->queue[r->qhead];
+            r->qhead = (r->qhead + 1) % r->qcap;
+            r->qcount--;
+            s->busy = 1;
+            s->tries = 0;
+            s->id = (uint16_t)(((next_rand(r) << 9) & 0xFFFFu & ~(uint32_t)SLOT_MASK) | (uint32_t)i);
+            fresh[nfresh++] = i;
+        }
+        mutex_unlock(&r->lock);
+        for (int k = 0; k < nfresh; ++k) send_slot(r, fresh[k]);
+
+        // 10 ms at most: also how soon new lookups are noticed.
+        int wait_ms = paced ? 1 : timer_wheel_next_ms(r->wheel, clock_monotonic_ms(), 10);
+        fd_set rd;
+        FD_ZERO(&rd);
+        FD_SET(r->sock, &rd);
+        struct timeval tv;
+        tv.tv_sec = wait_ms / 1000;
+        tv.tv_usec = (wait_ms % 1000) * 1000;
+        if (select((int)r->sock + 1, &rd, NULL, NULL, &tv) <= 0) continue;
+        for (;;) {
+            struct sockaddr_in from;
+#ifdef _WIN32
+            int fl = sizeof(from);
+#else
+            socklen_t fl = sizeof(from);
+#endif
+            int n = (int)recvfrom(r->sock, (char*)buf, (int)sizeof(buf), 0, (struct sockaddr*)&from, &fl);
+            if (n < 0) break;
+            if (from.sin_addr.s_addr != r->server.sin_addr.s_addr || from.sin_port != r->server.sin_port) continue;
+            handle_datagram(r, buf, n);
+        }
+    }
+}
+
+static int system_nameserver(unsigned long* ip) {
+    int found = 0;
+#ifdef _WIN32
+    ULONG sz = 0;
+    if (GetNetworkParams(NULL, &sz) != ERROR_BUFFER_OVERFLOW) return 0;
+    FIXED_INFO* fi = (FIXED_INFO*)malloc(sz);
+    if (!fi) return 0;
+    if (GetNetworkParams(fi, &sz) == NO_ERROR) {
+        for (IP_ADDR_STRING* a = &fi->DnsServerList; a && !found; a = a->Next) {
+            found = ip_to_uint(a->IpAddress.String, ip) && *ip != 0;
+        }
+    }
+    free(fi);
+#else
+    FILE* f = fopen("/etc/resolv.conf", "r");
+    if (!f) return 0;
+    char line[256];
+    while (!found && fgets(line, sizeof(line), f)) {
+        char addr[64];
+        if (sscanf(line, " nameserver %63s", addr) == 1) found = ip_to_uint(addr, ip) && *ip != 0; // skips IPv6
+    }
+    fclose(f);
+#endif
+    return found;
+}
+
+static int parse_server(const char* spec, unsigned long* ip, int* port) {
+    char host[64];
+    safe_strcpy(host, sizeof(host), spec);
+    char* colon = strchr(host, ':');
+    *port = 53;
+    if (colon) {
+        char* stop = NULL;
+        long p = strtol(colon + 1, &stop, 10);
+        if (stop == colon + 1 || *stop || p < 1 || p > 65535) return 0;
+        *port = (int)p;
+        *colon = '\0';
+    }
+    return ip_to_uint(host, ip);
+}
+
+static int set_nonblocking(DnsSocket s) {
+#ifdef _WIN32
+    u_long on = 1;
+    return ioctlsocket(s, FIONBIO, &on) == 0;
+#else
+    int fl = fcntl(s, F_GETFL, 0);
+    return fl >= 0 && fcntl(s, F_SETFL, fl | O_NONBLOCK) == 0;
+#endif
+}
+
+DnsResolver* dns_resolver_create(const char* server, int rate_pps, int timeout_ms) {
+    unsigned long ip = 0;
+    int port = 53;
+    if (server && *server) { if (!parse_server(server, &ip, &port)) return NULL; }
+    else if (!system_nameserver(&ip)) return NULL;
+
+    DnsSocket s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == DNS_BAD_SOCKET) return NULL;
+    if (!set_nonblocking(s)) { dns_close_socket(s); return NULL; }
+    int rcvbuf = 1024 * 1024;
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char*)&rcvbuf, sizeof(rcvbuf));
+
+    DnsResolver* r = (DnsResolver*)calloc(1, sizeof(DnsResolver));
+    if (!r) { dns_close_socket(s); return NULL; }
+    r->pacer = pacer_create(rate_pps, PACER_DEFAULT_BURST);
+    r->wheel = timer_wheel_create(1, clock_monotonic_ms(), on_query_deadline, r);
+    if (!r->pacer || !r->wheel || !timer_wheel_reserve(r->wheel, DNS_MAX_INFLIGHT)) {
+        pacer_destroy(r->pacer); timer_wheel_destroy(r->wheel); free(r); dns_close_socket(s);
+        return NULL;
+    }
+    r->sock = s;
+    r->server.sin_family = AF_INET;
+    r->server.sin_addr.s_addr = htonl((uint32_t)ip);
+    r->server.sin_port = htons((unsigned short)port);
+    retry_policy_init(&r->retry, DNS_TRIES, timeout_ms > 0 ? timeout_ms : DNS_DEFAULT_TIMEOUT_MS, 100, 0);
+    unsigned long long seed = clock_monotonic_ns() ^ (unsigned long long)(uintptr_t)r;
+    r->rng = (uint32_t)(seed ^ (seed >> 32)) | 1u;
+    for (int i = 0; i < DNS_MAX_INFLIGHT; ++i) r->free_slots[i] = DNS_MAX_INFLIGHT - 1 - i;
+    r->nfree = DNS_MAX_INFLIGHT;
+    atomic_init(&r->stop, 0);
+    mutex_init(&r->lock);
+    cond_init(&r->cv);
+    if (!thread_create(&r->thread, io_proc, r)) {
+        mutex_destroy(&r->lock); cond_destroy(&r->cv);
+        pacer_destroy(r->pacer); timer_wheel_destroy(r->wheel); free(r); dns_close_socket(s);
+        return NULL;
+    }
+    return r;
+}
+
+int dns_resolver_lookup(DnsResolver* r, unsigned long ip, DnsResultFn fn, void* user) {
+    if (!r || !fn) return 0;
+    uint32_t name;
+    if (dns_cache_get(ip, &name)) { metrics_inc(METRIC_DNS_CACHE_HITS); fn(user, ip, name); return 1; }
+    mutex_lock(&r->lock);
+    if (r->closing) { mutex_unlock(&r->lock); return 0; }
+    if (r->qcount == r->qcap) {
+        int ncap = r->qcap ? r->qcap * 2 : 256;
+        DnsRequest* nq = (DnsRequest*)malloc(sizeof(DnsRequest) * (size_t)ncap);
+        if (!nq) { mutex_unlock(&r->lock); return 0; }
+        for (int i = 0; i < r->qcount; ++i) nq[i] = r->queue[(r->qhead + i) % r->qcap];
+        free(r->queue);
+        r->queue = nq; r->qcap = ncap; r->qhead = 0;
+    }
+    DnsRequest* q = &r->queue[(r->qhead + r->qcount) % r->qcap];
+    q->ip = ip; q->fn = fn; q->user = user;
+    r->qcount++;
+    cond_signal(&r->cv);
+    mutex_unlock(&r->lock);
+    return 1;
+}
+
+void dns_resolver_set_rate(DnsResolver* r, int rate_pps) { if (r) pacer_set_rate(r->pacer, rate_pps); }
+
+void dns_resolver_destroy(DnsResolver* r) {
+    if (!r) return;
+    mutex_lock(&r->lock);
+    r->closing = 1;
+    atomic_store(&r->stop, 1);
+    cond_broadcast(&r->cv);
+    mutex_unlock(&r->lock);
+    thread_join(&r->thread);
+    // Only this thread touches the resolver now.
+    for (int i = 0; i < DNS_MAX_INFLIGHT; ++i) {
+        if (!r->slots[i].busy) continue;
+        DnsRequest req = release_slot(r, i);
+        req.fn(req.user, req.ip, 0);
+    }
+    for (; r->qcount > 0; r->qcount--) {
+        DnsRequest req = r->queue[r->qhead];
+        r->qhead = (r->qhead + 1) % r->qcap;
+        req.fn(req.user, req.ip, 0);
+    }
+    dns_close_socket(r->sock);
+    mutex_destroy(&r->lock);
+    cond_destroy(&r->cv);
+    pacer_destroy(r->pacer);
+    timer_wheel_destroy(r->wheel);
+    free(r->queue);
+    free(r);
+}
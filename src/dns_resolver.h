@@ -0,0 +1,54 @@
+#ifndef DNS_RESOLVER_H
+#define DNS_RESOLVER_H
+
+// Asynchronous reverse-DNS resolver: one UDP socket and one I/O thread keep
+// hundreds of PTR queries in flight, matching answers by transaction ID.
+// Answers go into a process-wide cache that honors record TTLs and outlives
+// the resolver, so later scans reuse them. Names are string_arena handles.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct DnsResolver DnsResolver;
+
+#define DNS_MAX_INFLIGHT 512
+#define DNS_DEFAULT_TIMEOUT_MS 2000
+
+// Called once per lookup with the name's string_arena handle (0 = no PTR
+// record, timeout or server error). Runs on the resolver thread, or on the
+// caller's thread for a cache hit.
+typedef void (*DnsResultFn)(void* user, unsigned long ip, uint32_t name);
+
+// 'server' is "A.B.C.D" or "A.B.C.D:port"; NULL or "" uses the system's
+// first IPv4 name server. 'rate_pps' <= 0 is unlimited; 'timeout_ms' <= 0
+// uses DNS_DEFAULT_TIMEOUT_MS (each query is sent at most twice). Returns
+// NULL if no server is known or the socket cannot be opened; callers then
+// fall back to net_reverse_dns. Needs net_init() on Windows.
+DnsResolver* dns_resolver_create(const char* server, int rate_pps, int timeout_ms);
+
+// Queues a PTR lookup for 'ip' (host order). A cached answer is delivered
+// before this returns. Returns 0, without calling 'fn', if the resolver is
+// shutting down or out of memory.
+int dns_resolver_lookup(DnsResolver* r, unsigned long ip, DnsResultFn fn, void* user);
+
+void dns_resolver_set_rate(DnsResolver* r, int rate_pps);
+
+// Completes every queued and in-flight lookup with name 0, joins the thread
+// and frees the resolver. No callback runs after it returns.
+void dns_resolver_destroy(DnsResolver* r);
+
+// Process-wide cache. Returns 1 and sets '*name' (0 for a cached negative
+// answer) if 'ip' has an unexpired entry.
+int dns_cache_get(unsigned long ip, uint32_t* name);
+void dns_cache_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DNS_RESOLVER_H
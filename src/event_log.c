@@ -0,0 +1,174 @@
+#include "event_log.h"
+#include "string_arena.h"
+#include "thread.h"
+#include "utils.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Rings live in a registry list and are never freed. A thread claims a free
+// one on its first event and hands it back when it exits (thread_key_create
+// exit hook); events it left behind are still drained, and the next owner
+// continues from the same head.
+#define EVENT_RING_SIZE 512 // events per ring, power of two
+
+typedef struct EventRing {
+    atomic_uint head;        // written by the owning thread
+    char pad0[60];
+    atomic_uint tail;        // written by the consumer
+    char pad1[60];
+    atomic_int owned;
+    struct EventRing* next;  // registry link
+    LogEvent ev[EVENT_RING_SIZE];
+} EventRing;
+
+static _Atomic(EventRing*) g_rings;
+static atomic_int g_level = EVENT_LEVEL_INFO;
+static atomic_ullong g_dropped;
+static THREAD_LOCAL EventRing* t_ring;
+static Mutex g_key_lock = MUTEX_INITIALIZER;
+static ThreadKey g_key;
+static int g_key_state; // under g_key_lock: 0 = not yet, 1 = ok, -1 = failed
+
+static void ring_release(void* p) {
+    if (p) atomic_store_explicit(&((EventRing*)p)->owned, 0, memory_order_release);
+}
+
+static void tls_register(EventRing* r) {
+    mutex_lock(&g_key_lock);
+    if (g_key_state == 0) g_key_state = thread_key_create(&g_key, ring_release) ? 1 : -1;
+    if (g_key_state > 0) thread_key_set(g_key, r);
+    mutex_unlock(&g_key_lock);
+}
+
+// Slow path, once per thread: reuse a released ring or add a new one.
+static EventRing* ring_claim(void) {
+    EventRing* r;
+    for (r = atomic_load(&g_rings); r; r = r->next) {
+        int expected = 0;
+        if (atomic_load_explicit(&r->owned, memory_order_relaxed) == 0 &&
+            atomic_compare_exchange_strong(&r->owned, &expected, 1)) break;
+    }
+    if (!r) {
+        r = (EventRing*)calloc(1, sizeof(EventRing));
+        if (!r) return NULL;
+        atomic_init(&r->owned, 1);
+        r->next = atomic_load(&g_rings);
+        while (!atomic_compare_exchange_weak(&g_rings, &r->next, r)) {}
+    }
+    tls_register(r);
+    t_ring = r;
+    return r;
+}
+
+static void ring_put(const LogEvent* ev) {
+    EventRing* r = t_ring;
+    if (!r && !(r = ring_claim())) { atomic_fetch_add_explicit(&g_dropped, 1, memory_order_relaxed); return; }
+    unsigned h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (h - atomic_load_explicit(&r->tail, memory_order_acquire) == EVENT_RING_SIZE) {
+        atomic_fetch_add_explicit(&g_dropped, 1, memory_order_relaxed);
+        return;
+    }
+    r->ev[h & (EVENT_RING_SIZE - 1)] = *ev;
+    atomic_store_explicit(&r->head, h + 1, memory_order_release);
+}
+
+static int level_enabled(EventLevel level) {
+    return (int)level <= atomic_load_explicit(&g_level, memory_order_relaxed);
+}
+
+void event_log_set_level(EventLevel level) { atomic_store(&g_level, (int)level); }
+EventLevel event_log_level(void) { return (EventLevel)atomic_load(&g_level); }
+
+void event_log_emit(EventLevel level, EventId id, unsigned long ip, uint32_t a0, uint32_t a1) {
+    if (!level_enabled(level)) return;
+    LogEvent ev = { clock_monotonic_ns(), (uint32_t)ip, { a0, a1 }, (uint16_t)id, (uint8_t)level, 0, { 0 }, NULL };
+    ring_put(&ev);
+}
+
+void event_log_text(EventLevel level, const char* literal) {
+    if (!level_enabled(level)) return;
+    LogEvent ev = { clock_monotonic_ns(), 0, { 0, 0 }, EVENT_TEXT, (uint8_t)level, 0, { 0 }, literal };
+    ring_put(&ev);
+}
+
+void event_log_host(EventLevel level, const DeviceInfo* di) {
+    if (!level_enabled(level)) return;
+    LogEvent ev = { clock_monotonic_ns(), di->ip, { di->hostname, di->open_ports_count }, EVENT_HOST_DONE, (uint8_t)level,
+                    di->has_mac, { 0 }, NULL };
+    memcpy(ev.mac, di->mac, sizeof(ev.mac));
+    ring_put(&ev);
+}
+
+// Consumer side: a min-heap of ring cursors keyed by their oldest event, so
+// the rings are merged in timestamp order. Only the draining thread uses it.
+typedef struct { EventRing* r; unsigned tail, head; } RingCursor;
+static RingCursor* g_cur;
+static size_t g_cur_cap;
+
+static uint64_t cursor_ts(const RingCursor* c) { return c->r->ev[c->tail & (EVENT_RING_SIZE - 1)].ts_ns; }
+
+static void heap_down(size_t n, size_t i) {
+    for (;;) {
+        size_t m = i, l = 2 * i + 1, r = l + 1;
+        if (l < n && cursor_ts(&g_cur[l]) < cursor_ts(&g_cur[m])) m = l;
+        if (r < n && cursor_ts(&g_cur[r]) < cursor_ts(&g_cur[m])) m = r;
+        if (m == i) return;
+        RingCursor t = g_cur[i]; g_cur[i] = g_cur[m]; g_cur[m] = t;
+        i = m;
+    }
+}
+
+size_t event_log_drain(LogEvent* out, size_t max) {
+    size_t nc = 0, n = 0;
+    for (EventRing* r = atomic_load(&g_rings); r; r = r->next) {
+        unsigned t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        unsigned h = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (t == h) continue;
+        if (nc == g_cur_cap) {
+            size_t ncap = g_cur_cap ? g_cur_cap * 2 : 64;
+            RingCursor* nb = (RingCursor*)realloc(g_cur, ncap * sizeof(RingCursor));
+            if (!nb) break;
+            g_cur = nb; g_cur_cap = ncap;
+        }
+        g_cur[nc].r = r; g_cur[nc].tail = t; g_cur[nc].head = h;
+        nc++;
+    }
+    for (size_t i = nc / 2; i-- > 0;) heap_down(nc, i);
+    while (n < max && nc > 0) {
+        RingCursor* c = &g_cur[0];
+        out[n++] = c->r->ev[c->tail & (EVENT_RING_SIZE - 1)];
+        if (++c->tail == c->head) {
+            atomic_store_explicit(&c->r->tail, c->tail, memory_order_release);
+            g_cur[0] = g_cur[--nc];
+        }
+        heap_down(nc, 0);
+    }
+    for (size_t i = 0; i < nc; ++i) atomic_store_explicit(&g_cur[i].r->tail, g_cur[i].tail, memory_order_release);
+    return n;
+}
+
+int event_log_format(const LogEvent* ev, char* buf, size_t bufsz) {
+    char ip[DEVICE_IP_STRLEN];
+    uint_to_ip(ev->ip, ip, sizeof(ip));
+    switch (ev->id) {
+        case EVENT_TEXT: return snprintf(buf, bufsz, "%s", ev->text ? ev->text : "");
+        case EVENT_PING: return snprintf(buf, bufsz, "Ping %s...", ip);
+        case EVENT_PORTS: return snprintf(buf, bufsz, "Ports %s...", ip);
+        case EVENT_HOST_DONE: {
+            DeviceInfo di; device_init(&di, ev->ip);
+            memcpy(di.mac, ev->mac, sizeof(di.mac));
+            di.has_mac = ev->has_mac;
+            char mac[DEVICE_MAC_STRLEN];
+            device_mac_str(&di, mac, sizeof(mac));
+            const char* name = string_arena_get(ev->arg[0]);
+            return snprintf(buf, bufsz, "Completed %s: %s, %s, %u ports", ip, (name[0]?name:"(unnamed)"), (mac[0]?mac:"MAC --"), (unsigned)ev->arg[1]);
+        }
+        case EVENT_NEIGHBORS:
+            return snprintf(buf, bufsz, "ARP sweep: %u replies; neighbor table: %u entries", (unsigned)ev->arg[0], (unsigned)ev->arg[1]);
+        default: return snprintf(buf, bufsz, "Event %u %s", (unsigned)ev->id, ip);
+    }
+}
+
+unsigned long long event_log_dropped(void) { return atomic_load(&g_dropped); }
@@ -0,0 +1,64 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+// Structured, lock-free event log for scan progress. Each producing thread
+// writes fixed-size binary events into its own single-producer ring; one
+// consumer thread drains all rings and formats only what it shows. Emitting
+// never blocks or formats: a full ring drops the event and counts it.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include "app.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    EVENT_LEVEL_ERROR = 0,
+    EVENT_LEVEL_INFO = 1,  // default
+    EVENT_LEVEL_DEBUG = 2
+} EventLevel;
+
+typedef enum {
+    EVENT_TEXT = 0,  // 'text' is a string literal
+    EVENT_PING,      // ping sent to 'ip'
+    EVENT_PORTS,     // port probes started for 'ip'
+    EVENT_HOST_DONE, // arg[0] = hostname handle, arg[1] = open ports, mac
+    EVENT_NEIGHBORS  // arg[0] = ARP replies, arg[1] = neighbor table entries
+} EventId;
+
+typedef struct {
+    uint64_t ts_ns;   // clock_monotonic_ns
+    uint32_t ip;      // host order, 0 if none
+    uint32_t arg[2];
+    uint16_t id;      // EventId
+    uint8_t level;    // EventLevel
+    uint8_t has_mac;
+    uint8_t mac[6];
+    const char* text; // EVENT_TEXT only; must outlive the event
+} LogEvent;
+
+// Events above the level are discarded at the call site. Any thread.
+void event_log_set_level(EventLevel level);
+EventLevel event_log_level(void);
+
+void event_log_emit(EventLevel level, EventId id, unsigned long ip, uint32_t a0, uint32_t a1);
+void event_log_text(EventLevel level, const char* literal);
+// EVENT_HOST_DONE for a finished host.
+void event_log_host(EventLevel level, const DeviceInfo* di);
+
+// Moves up to 'max' pending events from all rings into 'out', oldest first.
+// Only one thread may drain.
+size_t event_log_drain(LogEvent* out, size_t max);
+// Renders an event as one log line; returns its length (snprintf rules).
+int event_log_format(const LogEvent* ev, char* buf, size_t bufsz);
+// Events lost to full rings since startup.
+unsigned long long event_log_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENT_LOG_H
@@ -1,18 +1,103 @@
 #include "export.h"
+#include "utils.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void export_write_csv_header(FILE* f) {
+    fprintf(f, "IP;Hostname;MAC;Status;Ports;Services\n");
+}
+
+void export_write_csv_row(FILE* f, const DeviceInfo* di) {
+    char ip[DEVICE_IP_STRLEN], mac[DEVICE_MAC_STRLEN];
+    device_ip_str(di, ip, sizeof(ip));
+    device_mac_str(di, mac, sizeof(mac));
+    fprintf(f, "%s;%s;%s;%s;", ip, device_hostname(di), mac, di->is_alive?"UP":"DOWN");
+    for (int p=0; p<di->open_ports_count; ++p) {
+        fprintf(f, "%d%s", device_port(di, p), (p<di->open_ports_count-1?",":""));
+    }
+    fprintf(f, ";%s\n", device_services(di));
+}
+
+static void write_json_chars(FILE* f, const char* s, size_t len) {
+    fputc('"', f);
+    for (const unsigned char* p = (const unsigned char*)s; len--; ++p) {
+        if (*p == '"' || *p == '\\') { fputc('\\', f); fputc(*p, f); }
+        else if (*p < 0x20) fprintf(f, "\\u%04x", *p);
+        else fputc(*p, f);
+    }
+    fputc('"', f);
+}
+
+static void write_json_string(FILE* f, const char* s) { write_json_chars(f, s, strlen(s)); }
+
+// device_services() text "22/ssh/OpenSSH,80/http" as
+// [{"port":22,"service":"ssh","product":"OpenSSH"},{"port":80,"service":"http"}].
+static void write_json_services(FILE* f, const char* s) {
+    fputc('[', f);
+    for (int first = 1; *s; ) {
+        size_t n = strcspn(s, ",");
+        const char* svc = memchr(s, '/', n);
+        if (svc) {
+            ++svc;
+            size_t svc_len = n - (size_t)(svc - s);
+            const char* prod = memchr(svc, '/', svc_len);
+            fprintf(f, "%s{\"port\":%d,\"service\":", first ? "" : ",", atoi(s));
+            write_json_chars(f, svc, prod ? (size_t)(prod - svc) : svc_len);
+            if (prod) {
+                fputs(",\"product\":", f);
+                write_json_chars(f, prod + 1, svc_len - (size_t)(prod + 1 - svc));
+            }
+            fputc('}', f);
+            first = 0;
+        }
+        s += n;
+        if (*s) ++s;
+    }
+    fputc(']', f);
+}
+
+void export_write_ndjson_row(FILE* f, const DeviceInfo* di) {
+    char ip[DEVICE_IP_STRLEN], mac[DEVICE_MAC_STRLEN];
+    device_ip_str(di, ip, sizeof(ip));
+    device_mac_str(di, mac, sizeof(mac));
+    fprintf(f, "{\"ip\":\"%s\",\"hostname\":", ip);
+    write_json_string(f, device_hostname(di));
+    fprintf(f, ",\"mac\":\"%s\",\"alive\":%s,\"ports\":[", mac, di->is_alive ? "true" : "false");
+    for (int p=0; p<di->open_ports_count; ++p) {
+        fprintf(f, "%s%d", p ? "," : "", device_port(di, p));
+    }
+    fputc(']', f);
+    if (di->services) {
+        fputs(",\"services\":", f);
+        write_json_services(f, device_services(di));
+    }
+    fputs("}\n", f);
+}
+
+void export_write_udp_csv_header(FILE* f) {
+    fprintf(f, "IP;Port;State\n");
+}
+
+void export_write_udp_csv_row(FILE* f, unsigned long ip, int port, const char* state) {
+    char text[DEVICE_IP_STRLEN];
+    uint_to_ip(ip, text, sizeof(text));
+    fprintf(f, "%s;%d;%s\n", text, port, state);
+}
+
+void export_write_udp_ndjson_row(FILE* f, unsigned long ip, int port, const char* state) {
+    char text[DEVICE_IP_STRLEN];
+    uint_to_ip(ip, text, sizeof(text));
+    fprintf(f, "{\"ip\":\"%s\",\"proto\":\"udp\",\"port\":%d,\"state\":\"%s\"}\n", text, port, state);
+}
 
 int export_results_to_file(const char* path, const DeviceList* list) {
     FILE* f = fopen(path, "w");
     if (!f) return 0;
-    fprintf(f, "IP;Hostname;MAC;Status;Ports\n");
+    export_write_csv_header(f);
     for (size_t i=0; i<list->count; ++i) {
-        const DeviceInfo* di = &list->items[i];
-        fprintf(f, "%s;%s;%s;%s;", di->ip, di->hostname[0]?di->hostname:"", di->mac[0]?di->mac:"", di->is_alive?"UP":"DOWN");
-        for (int p=0; p<di->open_ports_count; ++p) {
-            fprintf(f, "%d%s", di->open_ports[p], (p<di->open_ports_count-1?",":""));
-        }
-        fprintf(f, "\n");
+        export_write_csv_row(f, &list->items[i]);
     }
     fclose(f);
     return 1;
-}
\ No newline at end of file
+}
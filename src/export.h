@@ -2,13 +2,24 @@
 #define EXPORT_H
 
 #include "app.h"
+#include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 int export_results_to_file(const char* path, const DeviceList* list);
+
+// Row writers shared by the file export and streaming output (one host per line).
+void export_write_csv_header(FILE* f);
+void export_write_csv_row(FILE* f, const DeviceInfo* di);
+void export_write_ndjson_row(FILE* f, const DeviceInfo* di);
+
+// UDP scan rows, one probe per line; 'state' is a udp_state_name().
+void export_write_udp_csv_header(FILE* f);
+void export_write_udp_csv_row(FILE* f, unsigned long ip, int port, const char* state);
+void export_write_udp_ndjson_row(FILE* f, unsigned long ip, int port, const char* state);
 #ifdef __cplusplus
 }
 #endif
 
-#endif // EXPORT_H
\ No newline at end of file
+#endif // EXPORT_H
@@ -0,0 +1,285 @@
+#include "icmp_sweep.h"
+
+#if defined(__linux__)
+
+#include "metrics.h"
+#include "thread.h"
+#include "pacer.h"
+#include "timing.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <arpa/inet.h>
+
+// Echo payload: lets the receiver reject stray replies and recover the full
+// address offset (the 16-bit sequence only carries its low bits).
+typedef struct {
+    uint32_t key;
+    uint32_t offset;
+    uint64_t sent_ns;
+} EchoPayload;
+
+struct IcmpSweep {
+    int sock;
+    int raw;               // raw sockets see the IP header and foreign echoes
+    uint16_t ident;
+    uint32_t key;
+    unsigned long start_ip;
+    unsigned long count;
+    Pacer* pacer;          // echoes per second
+    int timeout_ms;
+    atomic_int adaptive_min_ms; // 0 = always wait the full timeout
+    IcmpReplyFn fn;
+    void* user;
+    TargetOrder order;     // echo order
+    IcmpSkipFn skip;
+    void* skip_user;
+    atomic_uchar* alive;   // one bit per address
+    atomic_ulong alive_count;
+    atomic_int cancel;
+    atomic_int sending_done;
+    atomic_int stop_recv;
+    atomic_int done;       // set by the receive thread: no callback runs after it
+    Thread send_thread, recv_thread;
+    Mutex lock;
+    CondVar done_cv;
+};
+
+static unsigned short icmp_checksum(const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    unsigned long sum = 0;
+    while (len > 1) { sum += (unsigned long)((p[0] << 8) | p[1]); p += 2; len -= 2; }
+    if (len) sum += (unsigned long)(p[0] << 8);
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return htons((unsigned short)~sum);
+}
+
+static void mark_done(IcmpSweep* sw) {
+    mutex_lock(&sw->lock);
+    atomic_store(&sw->done, 1);
+    cond_broadcast(&sw->done_cv);
+    mutex_unlock(&sw->lock);
+}
+
+static void send_proc(void* arg) {
+    IcmpSweep* sw = (IcmpSweep*)arg;
+    unsigned char pkt[sizeof(struct icmphdr) + sizeof(EchoPayload)];
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    unsigned long sent_total = 0;
+    unsigned long last_ip = sw->start_ip;
+
+    TargetCursor cur;
+    target_order_seek(&sw->order, 0, sw->order.positions, &cur);
+    uint64_t off;
+    while (!atomic_load(&sw->cancel) && target_order_next(&sw->order, &cur, &off)) {
+        unsigned long k = (unsigned long)off;
+        if (sw->skip && sw->skip(sw->skip_user, sw->start_ip + k)) continue;
+        if (!pacer_acquire(sw->pacer, 1)) break;
+        memset(pkt, 0, sizeof(pkt));
+        struct icmphdr* h = (struct icmphdr*)pkt;
+        h->type = ICMP_ECHO;
+        h->un.echo.id = htons(sw->ident);
+        h->un.echo.sequence = htons((uint16_t)(k & 0xFFFF));
+        EchoPayload pl;
+        pl.key = sw->key;
+        pl.offset = (uint32_t)k;
+        pl.sent_ns = clock_monotonic_ns();
+        memcpy(pkt + sizeof(struct icmphdr), &pl, sizeof(pl));
+        h->checksum = icmp_checksum(pkt, sizeof(pkt));
+        sa.sin_addr.s_addr = htonl((uint32_t)(sw->start_ip + k));
+        ssize_t sent;
+        while ((sent = sendto(sw->sock, pkt, sizeof(pkt), 0, (struct sockaddr*)&sa, sizeof(sa))) < 0) {
+            if ((errno != ENOBUFS && errno != EAGAIN) || atomic_load(&sw->cancel)) break; // unreachable etc.: skip address
+            thread_sleep_ns(100000); // queue full, back off briefly
+        }
+        if (sent >= 0) { metrics_inc(METRIC_ICMP_SENT); sent_total++; }
+        last_ip = sw->start_ip + k;
+    }
+    atomic_store(&sw->sending_done, 1);
+
+    // Give the last echo its timeout: the full one, or what the replies so
+    // far say this part of the network needs.
+    int wait_ms = sw->timeout_ms;
+    int min_ms = atomic_load(&sw->adaptive_min_ms);
+    if (min_ms > 0 && sw->count > 0) wait_ms = timing_timeout_ms(last_ip, wait_ms, min_ms, wait_ms);
+    uint64_t until = clock_monotonic_ns() + (uint64_t)wait_ms * 1000000ull;
+    while (!atomic_load(&sw->cancel)) {
+        uint64_t now = clock_monotonic_ns();
+        if (now >= until) break;
+        uint64_t left = until - now;
+        thread_sleep_ns(left > 20000000ull ? 20000000ull : left);
+    }
+    // Echoes still unanswered once the last one had its full timeout.
+    unsigned long replies = atomic_load_explicit(&sw->alive_count, memory_order_relaxed);
+    if (!atomic_load(&sw->cancel) && sent_total > replies) metrics_add(METRIC_ICMP_TIMEOUTS, sent_total - replies);
+    atomic_store(&sw->stop_recv, 1);
+}
+
+static void handle_reply(IcmpSweep* sw, const unsigned char* icmp, size_t len, uint32_t from) {
+    if (len < sizeof(struct icmphdr) + sizeof(EchoPayload)) return;
+    const struct icmphdr* h = (const struct icmphdr*)icmp;
+    if (h->type != ICMP_ECHOREPLY) return;
+    // Datagram sockets rewrite the identifier and only deliver our own replies.
+    if (sw->raw && ntohs(h->un.echo.id) != sw->ident) return;
+    EchoPayload pl;
+    memcpy(&pl, icmp + sizeof(struct icmphdr), sizeof(pl));
+    if (pl.key != sw->key || pl.offset >= sw->count) return;
+    if ((uint16_t)(pl.offset & 0xFFFF) != ntohs(h->un.echo.sequence)) return;
+    if ((unsigned long)from != sw->start_ip + pl.offset) return;
+
+    unsigned char bit = (unsigned char)(1u << (pl.offset & 7));
+    unsigned char prev = atomic_fetch_or_explicit(&sw->alive[pl.offset >> 3], bit, memory_order_relaxed);
+    if (prev & bit) return; // duplicate reply
+    atomic_fetch_add_explicit(&sw->alive_count, 1, memory_order_relaxed);
+    uint64_t now = clock_monotonic_ns();
+    uint64_t rtt_ns = (now > pl.sent_ns) ? now - pl.sent_ns : 0;
+    metrics_inc(METRIC_ICMP_REPLIES);
+    metrics_record_us(METRIC_LAT_ICMP, rtt_ns / 1000);
+    timing_observe((unsigned long)from, (uint32_t)(rtt_ns / 1000));
+    if (sw->fn) sw->fn(sw->user, (unsigned long)from, (int)(rtt_ns / 1000000ull));
+}
+
+static void recv_proc(void* arg) {
+    IcmpSweep* sw = (IcmpSweep*)arg;
+    unsigned char buf[2048];
+    while (!atomic_load(&sw->stop_recv)) {
+        struct pollfd pfd; pfd.fd = sw->sock; pfd.events = POLLIN; pfd.revents = 0;
+        if (poll(&pfd, 1, 50) <= 0) continue;
+        for (;;) {
+            struct sockaddr_in from; socklen_t fl = sizeof(from);
+            ssize_t n = recvfrom(sw->sock, buf, sizeof(buf), MSG_DONTWAIT, (struct sockaddr*)&from, &fl);
+            if (n <= 0) break;
+            const unsigned char* icmp = buf;
+            size_t len = (size_t)n;
+            if (sw->raw) {
+                size_t ihl = (size_t)(buf[0] & 0x0F) * 4;
+                if (len < ihl) continue;
+                icmp += ihl; len -= ihl;
+            }
+            handle_reply(sw, icmp, len, ntohl(from.sin_addr.s_addr));
+        }
+    }
+    mark_done(sw);
+}
+
+IcmpSweep* icmp_sweep_start(unsigned long start_ip, unsigned long end_ip, int rate_pps, int timeout_ms,
+                            IcmpReplyFn fn, void* user) {
+    return icmp_sweep_start_opts(start_ip, end_ip, rate_pps, timeout_ms, fn, user, NULL);
+}
+
+IcmpSweep* icmp_sweep_start_opts(unsigned long start_ip, unsigned long end_ip, int rate_pps, int timeout_ms,
+                                 IcmpReplyFn fn, void* user, const IcmpSweepOptions* opts) {
+    if (end_ip < start_ip) return NULL;
+    int raw = 0;
+    int s = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_ICMP);
+    if (s < 0) { s = socket(AF_INET, SOCK_RAW | SOCK_CLOEXEC, IPPROTO_ICMP); raw = 1; }
+    if (s < 0) return NULL;
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    IcmpSweep* sw = (IcmpSweep*)calloc(1, sizeof(IcmpSweep));
+    if (!sw) { close(s); return NULL; }
+    sw->count = end_ip - start_ip + 1;
+    sw->alive = (atomic_uchar*)calloc((sw->count + 7) / 8, sizeof(atomic_uchar));
+    sw->pacer = pacer_create(rate_pps, PACER_DEFAULT_BURST);
+    if (!sw->alive || !sw->pacer) { free(sw->alive); pacer_destroy(sw->pacer); free(sw); close(s); return NULL; }
+    uint64_t seed = clock_monotonic_ns() ^ ((uint64_t)getpid() << 32) ^ (uint64_t)(uintptr_t)sw;
+    sw->sock = s;
+    sw->raw = raw;
+    sw->ident = (uint16_t)(seed ^ (seed >> 16));
+    sw->key = (uint32_t)(seed ^ (seed >> 32)) | 1u;
+    sw->start_ip = start_ip;
+    sw->timeout_ms = timeout_ms > 0 ? timeout_ms : 1000;
+    sw->fn = fn;
+    sw->user = user;
+    if (opts && opts->order) sw->order = *opts->order;
+    else target_order_init_sequential(&sw->order, sw->count);
+    if (opts) { sw->skip = opts->skip; sw->skip_user = opts->skip_user; }
+    mutex_init(&sw->lock);
+    cond_init(&sw->done_cv);
+
+    if (!thread_create(&sw->recv_thread, recv_proc, sw)) {
+        mutex_destroy(&sw->lock); cond_destroy(&sw->done_cv);
+        pacer_destroy(sw->pacer); free(sw->alive); free(sw); close(s);
+        return NULL;
+    }
+    if (!thread_create(&sw->send_thread, send_proc, sw)) {
+        atomic_store(&sw->stop_recv, 1);
+        thread_join(&sw->recv_thread);
+        mutex_destroy(&sw->lock); cond_destroy(&sw->done_cv);
+        pacer_destroy(sw->pacer); free(sw->alive); free(sw); close(s);
+        return NULL;
+    }
+    return sw;
+}
+
+void icmp_sweep_wait(IcmpSweep* sw) {
+    if (!sw) return;
+    mutex_lock(&sw->lock);
+    while (!atomic_load(&sw->done)) cond_wait(&sw->done_cv, &sw->lock);
+    mutex_unlock(&sw->lock);
+}
+
+int icmp_sweep_done(const IcmpSweep* sw) { return sw ? atomic_load(&sw->done) : 1; }
+
+void icmp_sweep_cancel(IcmpSweep* sw) { if (sw) { atomic_store(&sw->cancel, 1); pacer_close(sw->pacer); } }
+
+void icmp_sweep_set_rate(IcmpSweep* sw, int rate_pps) { if (sw) pacer_set_rate(sw->pacer, rate_pps); }
+
+void icmp_sweep_set_adaptive_wait(IcmpSweep* sw, int min_ms) { if (sw) atomic_store(&sw->adaptive_min_ms, min_ms > 0 ? min_ms : 0); }
+
+int icmp_sweep_is_alive(const IcmpSweep* sw, unsigned long ip) {
+    if (!sw || ip < sw->start_ip || ip - sw->start_ip >= sw->count) return 0;
+    unsigned long off = ip - sw->start_ip;
+    return (atomic_load_explicit(&sw->alive[off >> 3], memory_order_relaxed) >> (off & 7)) & 1;
+}
+
+unsigned long icmp_sweep_alive_count(const IcmpSweep* sw) {
+    return sw ? atomic_load_explicit(&sw->alive_count, memory_order_relaxed) : 0;
+}
+
+void icmp_sweep_destroy(IcmpSweep* sw) {
+    if (!sw) return;
+    icmp_sweep_cancel(sw);
+    thread_join(&sw->send_thread);
+    thread_join(&sw->recv_thread);
+    mutex_destroy(&sw->lock);
+    cond_destroy(&sw->done_cv);
+    close(sw->sock);
+    pacer_destroy(sw->pacer);
+    free(sw->alive);
+    free(sw);
+}
+
+#else // !__linux__
+
+// No sweep backend yet; callers ping each host with net_ping_ipv4.
+IcmpSweep* icmp_sweep_start(unsigned long start_ip, unsigned long end_ip, int rate_pps, int timeout_ms,
+                            IcmpReplyFn fn, void* user) {
+    (void)start_ip; (void)end_ip; (void)rate_pps; (void)timeout_ms; (void)fn; (void)user;
+    return 0;
+}
+IcmpSweep* icmp_sweep_start_opts(unsigned long start_ip, unsigned long end_ip, int rate_pps, int timeout_ms,
+                                 IcmpReplyFn fn, void* user, const IcmpSweepOptions* opts) {
+    (void)opts;
+    return icmp_sweep_start(start_ip, end_ip, rate_pps, timeout_ms, fn, user);
+}
+void icmp_sweep_wait(IcmpSweep* sw) { (void)sw; }
+int icmp_sweep_done(const IcmpSweep* sw) { (void)sw; return 1; }
+void icmp_sweep_cancel(IcmpSweep* sw) { (void)sw; }
+void icmp_sweep_set_rate(IcmpSweep* sw, int rate_pps) { (void)sw; (void)rate_pps; }
+void icmp_sweep_set_adaptive_wait(IcmpSweep* sw, int min_ms) { (void)sw; (void)min_ms; }
+int icmp_sweep_is_alive(const IcmpSweep* sw, unsigned long ip) { (void)sw; (void)ip; return 0; }
+unsigned long icmp_sweep_alive_count(const IcmpSweep* sw) { (void)sw; return 0; }
+void icmp_sweep_destroy(IcmpSweep* sw) { (void)sw; }
+
+#endif
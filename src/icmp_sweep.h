@@ -0,0 +1,63 @@
+#ifndef ICMP_SWEEP_H
+#define ICMP_SWEEP_H
+
+// ICMP echo sweep over an address range from a single socket: a paced send
+// thread and a receive thread that matches replies by identifier/sequence.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include "target_order.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct IcmpSweep IcmpSweep;
+
+// Called from the receive thread, once per address, on its first reply.
+typedef void (*IcmpReplyFn)(void* user, unsigned long ip, int rtt_ms);
+
+// Starts sweeping [start_ip, end_ip] (host order) at 'rate_pps' echoes per
+// second; an address is dead if no reply arrives within 'timeout_ms' of its
+// echo. Returns NULL if no sweep backend is available (e.g. no ICMP socket
+// permission); callers then fall back to net_ping_ipv4.
+IcmpSweep* icmp_sweep_start(unsigned long start_ip, unsigned long end_ip, int rate_pps, int timeout_ms,
+                            IcmpReplyFn fn, void* user);
+
+// Called from the send thread before each echo; nonzero skips the address
+// (it gets no echo and stays not alive).
+typedef int (*IcmpSkipFn)(void* user, unsigned long ip);
+
+typedef struct {
+    const TargetOrder* order; // echo order over the range; NULL = ascending
+    IcmpSkipFn skip;          // NULL = echo every address
+    void* skip_user;
+} IcmpSweepOptions;
+
+// As icmp_sweep_start with the options above; 'opts' is copied.
+IcmpSweep* icmp_sweep_start_opts(unsigned long start_ip, unsigned long end_ip, int rate_pps, int timeout_ms,
+                                 IcmpReplyFn fn, void* user, const IcmpSweepOptions* opts);
+
+// Blocks until every echo was sent and the last timeout elapsed (or cancel).
+void icmp_sweep_wait(IcmpSweep* sw);
+int icmp_sweep_done(const IcmpSweep* sw);
+void icmp_sweep_cancel(IcmpSweep* sw);
+// Changes the send rate of a running sweep.
+void icmp_sweep_set_rate(IcmpSweep* sw, int rate_pps);
+// With 'min_ms' > 0, the wait after the last echo is the timing estimate for
+// the last address (timing_timeout_ms) clamped to [min_ms, timeout_ms]
+// instead of the full timeout. Replies feed timing_observe either way.
+void icmp_sweep_set_adaptive_wait(IcmpSweep* sw, int min_ms);
+
+// Valid for any address once icmp_sweep_done() is true; before that a 0 may
+// still turn into 1.
+int icmp_sweep_is_alive(const IcmpSweep* sw, unsigned long ip);
+unsigned long icmp_sweep_alive_count(const IcmpSweep* sw);
+
+// Cancels if still running, joins the threads and frees the sweep.
+void icmp_sweep_destroy(IcmpSweep* sw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ICMP_SWEEP_H
@@ -0,0 +1,493 @@
+// Headless front end: scans ranges with the parallel pipeline and streams
+// each finished host to stdout as NDJSON or CSV. Nothing is buffered, so
+// memory stays flat however large the range.
+#include "parallel_scan.h"
+#include "checkpoint.h"
+#include "conn_engine.h"
+#include "scan.h"
+#include "net.h"
+#include "export.h"
+#include "event_log.h"
+#include "result_store.h"
+#include "target_order.h"
+#include "thread.h"
+#include "udp_engine.h"
+#include "utils.h"
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum { FORMAT_NDJSON, FORMAT_CSV, FORMAT_NONE };
+
+#define UDP_WINDOW 4096 // UDP probes in flight
+
+typedef struct {
+    int format;
+    int all;               // also print hosts that did not answer
+    ResultWriter* store;   // --write: the same hosts, in a binary result store
+    unsigned long printed;
+    unsigned long alive;   // hosts up, or open UDP ports with --udp
+} CliOutput;
+
+static volatile sig_atomic_t g_interrupted = 0;
+static atomic_int g_write_failed; // set by workers, read by the main loop
+static int g_verbose = 0;
+static const char* g_metrics_path = NULL; // --metrics
+static const char* g_checkpoint_path = NULL; // --checkpoint, or the --resume file
+static int g_checkpoint_failed = 0;
+
+static void on_sigint(int sig) { (void)sig; g_interrupted = 1; }
+
+static void cli_logger(const char* msg) {
+    if (g_verbose && msg) fprintf(stderr, "%s\n", msg);
+}
+
+// Prints the scan workers' progress events (-v only; otherwise the level
+// filter keeps them from being recorded at all).
+static void drain_events(void) {
+    LogEvent events[256];
+    size_t n;
+    while ((n = event_log_drain(events, sizeof(events) / sizeof(events[0]))) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            char msg[256];
+            event_log_format(&events[i], msg, sizeof(msg));
+            cli_logger(msg);
+        }
+    }
+}
+
+// Rewrites the --metrics file: counters and latencies for the whole run so
+// far plus the current scan's gauges. Written to a temporary file and
+// renamed, so a scraper never reads half a dump.
+static void write_metrics(void) {
+    if (!g_metrics_path) return;
+    ScanStats st;
+    parallel_scan_stats(&st);
+    metrics_snapshot(&st.m); // process-wide, so it spans every target
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", g_metrics_path);
+    FILE* f = fopen(tmp, "w");
+    if (!f) return;
+    parallel_scan_write_prometheus(f, &st);
+    if (fclose(f) != 0) { remove(tmp); return; }
+    if (rename(tmp, g_metrics_path) != 0) { remove(g_metrics_path); rename(tmp, g_metrics_path); } // Windows will not replace
+}
+
+// Saves the scan's progress to the checkpoint file; complains once if that
+// fails (e.g. a range larger than CHECKPOINT_MAX_ADDRESSES). A host the
+// checkpoint calls done must already be on disk in the --write store, or
+// --resume would skip it: the store is synced between snapshot and save.
+static void write_checkpoint(ResultWriter* store) {
+    if (!g_checkpoint_path || g_checkpoint_failed) return;
+    ScanCheckpoint cp;
+    int ok = parallel_scan_progress(&cp);
+    if (ok && store && !result_writer_sync(store)) {
+        checkpoint_free(&cp);
+        atomic_store(&g_write_failed, 1); // reported when the store is closed
+        return;
+    }
+    if (ok) {
+        ok = checkpoint_save(g_checkpoint_path, &cp);
+        checkpoint_free(&cp);
+    }
+    if (!ok) {
+        fprintf(stderr, "catnet_cli: cannot write checkpoint '%s'\n", g_checkpoint_path);
+        g_checkpoint_failed = 1;
+    }
+}
+
+static void usage(FILE* f) {
+    fprintf(f,
+        "Usage: catnet_cli [options] [TARGET...]\n"
+        "Targets: A.B.C.D, A.B.C.D-E, A.B.C.D-E.F.G.H or A.B.C.D/nn.\n"
+        "Without a target the primary local subnet is scanned.\n"
+        "Options:\n"
+        "  -p, --ports LIST    TCP ports, e.g. 22,80,8000-8010, top-N (N <= 1000, most common first) or all\n"
+        "  -V, --service       name the service on each open TCP port from its banner\n"
+        "      --service-wait MS  how long a banner may take (again after a probe)\n"
+        "      --syn           probe TCP ports with raw SYNs (root or CAP_NET_RAW; no -V)\n"
+        "  -U, --udp LIST      scan these UDP ports instead: one row per open port (-a: every probe)\n"
+        "      --udp-rate PPS  UDP datagrams per second\n"
+        "  -f, --format FMT    ndjson (default), csv or none\n"
+        "  -a, --all           also print hosts that did not answer\n"
+        "  -t, --timeout MS    per-port connect timeout until RTTs are measured\n"
+        "      --fixed-timeouts            always use the -t and ping timeouts\n"
+        "      --min-rtt-timeout MS        floor for measured timeouts\n"
+        "      --max-rtt-timeout MS        ceiling for measured timeouts\n"
+        "  -r, --rate PPS      ICMP echo requests per second\n"
+        "      --tcp-rate PPS  TCP connect probes (or SYNs) per second\n"
+        "      --dns-rate PPS  reverse DNS queries per second\n"
+        "      --dns-server A.B.C.D[:PORT]  name server for reverse lookups\n"
+        "      --sequential    probe addresses in ascending order instead of shuffled\n"
+        "      --seed N        shuffle with seed N (same seed, same order)\n"
+        "      --shard I/N     scan only shard I (0..N-1) of N; run N processes to cover the range\n"
+        "      --metrics FILE  keep FILE updated with Prometheus-format scan metrics\n"
+        "  -w, --write FILE    also save the hosts to a binary result store\n"
+        "      --read FILE     print a saved result store instead of scanning\n"
+        "      --merge FILE    combine the result stores given as arguments into FILE\n"
+        "      --checkpoint FILE  save progress to FILE every few seconds (one target)\n"
+        "      --resume FILE   continue the scan saved in FILE instead of scanning targets;\n"
+        "                      -w then adds to the store the interrupted run wrote\n"
+        "  -v, --verbose       progress messages on stderr\n"
+        "  -h, --help          show this help\n");
+}
+
+// Checks a port_set.h spec and stores it in cfg->ports. Returns 0 on bad input.
+static int parse_ports(const char* spec, ScanConfig* cfg) {
+    PortSet ps;
+    if (strlen(spec) >= sizeof(cfg->ports) || !port_set_compile(&ps, spec)) return 0;
+    port_set_free(&ps);
+    safe_strcpy(cfg->ports, sizeof(cfg->ports), spec);
+    return 1;
+}
+
+static void print_row(CliOutput* out, const DeviceInfo* di) {
+    if (out->format == FORMAT_CSV) export_write_csv_row(stdout, di);
+    else if (out->format == FORMAT_NDJSON) export_write_ndjson_row(stdout, di);
+}
+
+// Called by the scan workers, one host at a time.
+static void on_result(void* user, const DeviceInfo* di) {
+    CliOutput* out = (CliOutput*)user;
+    if (di->is_alive) out->alive++;
+    if (!di->is_alive && !out->all) return;
+    // Queued for the store's write-behind thread; no I/O on the worker.
+    if (out->store && !result_writer_append(out->store, di)) atomic_store(&g_write_failed, 1);
+    print_row(out, di);
+    // Flush per host so a downstream reader sees it immediately.
+    if (out->format != FORMAT_NONE && (fflush(stdout) != 0 || ferror(stdout))) atomic_store(&g_write_failed, 1);
+    out->printed++;
+}
+
+// --udp: called on the main thread as each probe finishes.
+static void on_udp_result(void* user, unsigned long ip, int port, int state) {
+    CliOutput* out = (CliOutput*)user;
+    if (state == UDP_OPEN) out->alive++;
+    if (state != UDP_OPEN && !out->all) return;
+    if (out->format == FORMAT_CSV) export_write_udp_csv_row(stdout, ip, port, udp_state_name(state));
+    else if (out->format == FORMAT_NDJSON) export_write_udp_ndjson_row(stdout, ip, port, udp_state_name(state));
+    if (out->format != FORMAT_NONE && (fflush(stdout) != 0 || ferror(stdout))) atomic_store(&g_write_failed, 1);
+    out->printed++;
+}
+
+// --udp: probes every port of [start, end] from this thread, in the same
+// address order (shuffle, seed, shard) as a TCP scan.
+static int udp_scan_one(unsigned long start, unsigned long end, const ScanConfig* cfg, const PortSet* ports,
+                        Pacer* pacer, CliOutput* out) {
+    UdpEngine* ue = udp_engine_create(UDP_WINDOW, cfg->port_timeout_ms);
+    if (!ue) { fprintf(stderr, "catnet_cli: UDP scans are not supported on this platform\n"); return 0; }
+    udp_engine_set_pacer(ue, pacer);
+    TargetOrder order;
+    uint64_t addresses = (uint64_t)end - start + 1;
+    unsigned long long seed = cfg->shuffle_seed;
+    if (!seed && cfg->shard_count > 1) seed = (((unsigned long long)start << 32) ^ end) | 1; // as parallel_scan
+    if (!seed) seed = clock_monotonic_ns() | 1;
+    if (cfg->shuffle_targets) target_order_init_shuffled(&order, addresses, seed);
+    else target_order_init_sequential(&order, addresses);
+    if (cfg->shard_count > 1) target_order_shard(&order, (uint64_t)cfg->shard_index, (uint64_t)cfg->shard_count);
+    TargetCursor cur;
+    target_order_seek(&order, 0, order.positions, &cur);
+    uint64_t off;
+    unsigned long long last_ms = clock_monotonic_ms();
+    while (!g_interrupted && !atomic_load(&g_write_failed) && target_order_next(&order, &cur, &off)) {
+        for (int k = 0; k < ports->count; ++k) udp_engine_submit(ue, start + (unsigned long)off, ports->order[k], on_udp_result, out);
+        if (clock_monotonic_ms() - last_ms >= 1000) { last_ms = clock_monotonic_ms(); write_metrics(); }
+    }
+    udp_engine_drain(ue);
+    udp_engine_destroy(ue);
+    write_metrics();
+    return 1;
+}
+
+// --read: the records are used in place from the mapping.
+static int print_store(const char* path, CliOutput* out) {
+    ResultStore* rs = result_store_open(path);
+    if (!rs) { fprintf(stderr, "catnet_cli: cannot open result store '%s'\n", path); return 0; }
+    result_store_mount(rs);
+    const DeviceInfo* recs = result_store_records(rs);
+    size_t n = result_store_count(rs);
+    for (size_t i = 0; i < n && !g_interrupted; ++i) {
+        if (recs[i].is_alive) out->alive++;
+        if (!recs[i].is_alive && !out->all) continue;
+        print_row(out, &recs[i]);
+        out->printed++;
+    }
+    result_store_close(rs);
+    return fflush(stdout) == 0 && !ferror(stdout);
+}
+
+// Scans [start, end], or continues the scan saved in 'resume' if not NULL.
+static int scan_one(unsigned long start, unsigned long end, const ScanConfig* cfg, const char* resume, CliOutput* out) {
+    int started = resume ? parallel_scan_resume(resume, cli_logger, on_result, out)
+                         : parallel_scan_start_streaming(start, end, cfg, cli_logger, on_result, out);
+    if (!started) {
+        fprintf(stderr, "catnet_cli: failed to start scan\n");
+        return 0;
+    }
+    unsigned ticks = 0;
+    while (parallel_scan_is_running() && !g_interrupted && !atomic_load(&g_write_failed)) {
+        thread_sleep_ms(100);
+        drain_events();
+        if (++ticks % 10 == 0) write_metrics();
+        if (ticks % 20 == 0) write_checkpoint(out->store);
+    }
+    parallel_scan_stop();
+    drain_events();
+    write_metrics();
+    write_checkpoint(out->store); // exact now that the workers are gone
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    conn_engine_raise_fd_limit();
+    ScanConfig cfg;
+    scan_config_init(&cfg);
+    CliOutput out;
+    memset(&out, 0, sizeof(out));
+    const char** targets = (const char**)calloc((size_t)argc, sizeof(char*));
+    int ntargets = 0;
+    const char* store_path = NULL; // --write
+    const char* read_path = NULL;  // --read
+    const char* resume_path = NULL; // --resume
+    const char* merge_path = NULL;  // --merge
+    const char* udp_spec = NULL;    // --udp
+    int udp_rate_pps = 5000;
+    if (!targets) return 1;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (a[0] != '-') { targets[ntargets++] = a; continue; }
+        if (!strcmp(a, "-h") || !strcmp(a, "--help")) { usage(stdout); return 0; }
+        else if (!strcmp(a, "-a") || !strcmp(a, "--all")) out.all = 1;
+        else if (!strcmp(a, "-v") || !strcmp(a, "--verbose")) g_verbose = 1;
+        else if (!strcmp(a, "--fixed-timeouts")) cfg.adaptive_timing = 0;
+        else if (!strcmp(a, "--sequential")) cfg.shuffle_targets = 0;
+        else if (!strcmp(a, "-V") || !strcmp(a, "--service")) cfg.service_detect = 1;
+        else if (!strcmp(a, "--syn")) cfg.probe_strategy = SCAN_PROBE_SYN;
+        else if (!strcmp(a, "--")) { while (++i < argc) targets[ntargets++] = argv[i]; }
+        else if (!val) { fprintf(stderr, "catnet_cli: %s needs a value\n", a); return 2; }
+        else if (!strcmp(a, "-p") || !strcmp(a, "--ports")) {
+            if (!parse_ports(val, &cfg)) { fprintf(stderr, "catnet_cli: bad port list '%s'\n", val); return 2; }
+            i++;
+        } else if (!strcmp(a, "--service-wait")) {
+            cfg.service_wait_ms = atoi(val);
+            if (cfg.service_wait_ms <= 0) { fprintf(stderr, "catnet_cli: bad wait '%s'\n", val); return 2; }
+            i++;
+        } else if (!strcmp(a, "-U") || !strcmp(a, "--udp")) {
+            PortSet ps;
+            if (!port_set_compile(&ps, val)) { fprintf(stderr, "catnet_cli: bad UDP port list '%s'\n", val); return 2; }
+            port_set_free(&ps);
+            udp_spec = val;
+            i++;
+        } else if (!strcmp(a, "--udp-rate")) {
+            udp_rate_pps = atoi(val);
+            if (udp_rate_pps <= 0) { fprintf(stderr, "catnet_cli: bad rate '%s'\n", val); return 2; }
+            i++;
+        } else if (!strcmp(a, "-f") || !strcmp(a, "--format")) {
+            if (!strcmp(val, "ndjson")) out.format = FORMAT_NDJSON;
+            else if (!strcmp(val, "csv")) out.format = FORMAT_CSV;
+            else if (!strcmp(val, "none")) out.format = FORMAT_NONE;
+            else { fprintf(stderr, "catnet_cli: unknown format '%s'\n", val); return 2; }
+            i++;
+        } else if (!strcmp(a, "-t") || !strcmp(a, "--timeout")) {
+            cfg.port_timeout_ms = atoi(val);
+            if (cfg.port_timeout_ms <= 0) { fprintf(stderr, "catnet_cli: bad timeout '%s'\n", val); return 2; }
+            i++;
+        } else if (!strcmp(a, "--min-rtt-timeout")) {
+            cfg.min_rtt_timeout_ms = atoi(val);
+            if (cfg.min_rtt_timeout_ms <= 0) { fprintf(stderr, "catnet_cli: bad timeout '%s'\n", val); return 2; }
+            i++;
+        } else if (!strcmp(a, "--max-rtt-timeout")) {
+            cfg.max_rtt_timeout_ms = atoi(val);
+            if (cfg.max_rtt_timeout_ms <= 0) { fprintf(stderr, "catnet_cli: bad timeout '%s'\n", val); return 2; }
+            i++;
+        } else if (!strcmp(a, "-r") || !strcmp(a, "--rate")) {
+            cfg.icmp_rate_pps = atoi(val);
+            if (cfg.icmp_rate_pps <= 0) { fprintf(stderr, "catnet_cli: bad rate '%s'\n", val); return 2; }
+            i++;
+        } else if (!strcmp(a, "--tcp-rate")) {
+            cfg.tcp_rate_pps = atoi(val);
+            if (cfg.tcp_rate_pps <= 0) { fprintf(stderr, "catnet_cli: bad rate '%s'\n", val); return 2; }
+            i++;
+        } else if (!strcmp(a, "--dns-rate")) {
+            cfg.dns_rate_pps = atoi(val);
+            if (cfg.dns_rate_pps <= 0) { fprintf(stderr, "catnet_cli: bad rate '%s'\n", val); return 2; }
+            i++;
+        } else if (!strcmp(a, "--dns-server")) {
+            unsigned long ip;
+            char host[sizeof(cfg.dns_server)];
+            safe_strcpy(host, sizeof(host), val);
+            char* colon = strchr(host, ':');
+            if (colon) *colon = '\0';
+            if (strlen(val) >= sizeof(cfg.dns_server) || !ip_to_uint(host, &ip)) { fprintf(stderr, "catnet_cli: bad DNS server '%s'\n", val); return 2; }
+            safe_strcpy(cfg.dns_server, sizeof(cfg.dns_server), val);
+            i++;
+        } else if (!strcmp(a, "--seed")) {
+            char* stop = NULL;
+            cfg.shuffle_seed = strtoull(val, &stop, 0);
+            if (stop == val || *stop || cfg.shuffle_seed == 0) { fprintf(stderr, "catnet_cli: bad seed '%s'\n", val); return 2; }
+            i++;
+        } else if (!strcmp(a, "--shard")) {
+            char* stop = NULL;
+            long idx = strtol(val, &stop, 10), n = 0;
+            if (stop != val && *stop == '/') { char* s2 = stop + 1; n = strtol(s2, &stop, 10); if (stop == s2) n = 0; }
+            if (*stop || n < 1 || n > 65536 || idx < 0 || idx >= n) { fprintf(stderr, "catnet_cli: bad shard '%s' (want I/N, 0 <= I < N)\n", val); return 2; }
+            cfg.shard_index = (int)idx;
+            cfg.shard_count = (int)n;
+            i++;
+        } else if (!strcmp(a, "--merge")) {
+            merge_path = val;
+            i++;
+        } else if (!strcmp(a, "--metrics")) {
+            g_metrics_path = val;
+            i++;
+        } else if (!strcmp(a, "-w") || !strcmp(a, "--write")) {
+            store_path = val;
+            i++;
+        } else if (!strcmp(a, "--read")) {
+            read_path = val;
+            i++;
+        } else if (!strcmp(a, "--checkpoint")) {
+            g_checkpoint_path = val;
+            i++;
+        } else if (!strcmp(a, "--resume")) {
+            resume_path = val;
+            i++;
+        } else { fprintf(stderr, "catnet_cli: unknown option '%s'\n", a); usage(stderr); return 2; }
+    }
+
+    if (cfg.min_rtt_timeout_ms > cfg.max_rtt_timeout_ms) {
+        fprintf(stderr, "catnet_cli: --min-rtt-timeout exceeds --max-rtt-timeout\n");
+        return 2;
+    }
+    // Validate every target before scanning any of them.
+    for (int i = 0; i < ntargets && !merge_path; ++i) {
+        unsigned long s, e;
+        if (!parse_ip_range(targets[i], &s, &e)) { fprintf(stderr, "catnet_cli: bad target '%s'\n", targets[i]); return 2; }
+    }
+
+    if (read_path && (ntargets > 0 || store_path || g_checkpoint_path || resume_path)) {
+        fprintf(stderr, "catnet_cli: --read takes no targets, --write, --checkpoint or --resume\n");
+        return 2;
+    }
+    if (merge_path && (ntargets == 0 || store_path || read_path || g_checkpoint_path || resume_path)) {
+        fprintf(stderr, "catnet_cli: --merge takes result stores as arguments and no --write, --read, --checkpoint or --resume\n");
+        return 2;
+    }
+    if (udp_spec && cfg.service_detect) {
+        fprintf(stderr, "catnet_cli: --service names TCP services; it does not apply to --udp\n");
+        return 2;
+    }
+    if (udp_spec && (store_path || read_path || merge_path || g_checkpoint_path || resume_path)) {
+        fprintf(stderr, "catnet_cli: --udp takes no --write, --read, --merge, --checkpoint or --resume\n");
+        return 2;
+    }
+    if (resume_path && ntargets > 0) {
+        fprintf(stderr, "catnet_cli: --resume takes no targets\n");
+        return 2;
+    }
+    if (g_checkpoint_path && ntargets > 1) {
+        fprintf(stderr, "catnet_cli: --checkpoint takes one target\n");
+        return 2;
+    }
+    // The range and configuration come from the checkpoint, which keeps
+    // being updated unless --checkpoint names another file.
+    ScanCheckpoint saved;
+    if (resume_path) {
+        if (!checkpoint_load(resume_path, &saved)) { fprintf(stderr, "catnet_cli: cannot read checkpoint '%s'\n", resume_path); return 1; }
+        checkpoint_free(&saved);
+        if (!g_checkpoint_path) g_checkpoint_path = resume_path;
+    }
+
+    event_log_set_level(g_verbose ? EVENT_LEVEL_DEBUG : EVENT_LEVEL_ERROR);
+    signal(SIGINT, on_sigint);
+    if (out.format == FORMAT_CSV) {
+        if (udp_spec) export_write_udp_csv_header(stdout);
+        else export_write_csv_header(stdout);
+    }
+    if (merge_path) {
+        ResultMergeStats ms;
+        int ok = result_store_merge(merge_path, targets, ntargets, &ms);
+        if (ms.bad_input >= 0) fprintf(stderr, "catnet_cli: cannot open result store '%s'\n", targets[ms.bad_input]);
+        else if (!ok) fprintf(stderr, "catnet_cli: writing '%s' failed\n", merge_path);
+        if (g_verbose) {
+            fprintf(stderr, "%llu records read, %llu written, %llu duplicates dropped\n", (unsigned long long)ms.read,
+                    (unsigned long long)ms.written, (unsigned long long)ms.duplicates);
+        }
+        free(targets);
+        return ok ? 0 : 1;
+    }
+    if (read_path) {
+        free(targets);
+        int ok = print_store(read_path, &out);
+        if (g_verbose) fprintf(stderr, "%lu hosts up, %lu printed\n", out.alive, out.printed);
+        if (g_interrupted) return 130;
+        return ok ? 0 : 1;
+    }
+    if (udp_spec) {
+        PortSet ports;
+        int ok = port_set_compile(&ports, udp_spec);
+        // The engine takes tokens about once a millisecond; a burst of a few
+        // milliseconds' worth keeps high rates reachable.
+        Pacer* pacer = pacer_create(udp_rate_pps, udp_rate_pps / 250 > PACER_DEFAULT_BURST ? udp_rate_pps / 250 : PACER_DEFAULT_BURST);
+        int have_net = net_init();
+        if (!ok || !pacer || !have_net) { fprintf(stderr, "catnet_cli: cannot start UDP scan\n"); ok = 0; }
+        SubnetV4 sn;
+        if (ok && ntargets == 0) {
+            ok = net_get_primary_subnet(&sn);
+            if (ok) ok = udp_scan_one(sn.start_ip, sn.end_ip, &cfg, &ports, pacer, &out);
+            else fprintf(stderr, "catnet_cli: no primary subnet; give a target\n");
+        }
+        for (int i = 0; i < ntargets && ok && !g_interrupted && !atomic_load(&g_write_failed); ++i) {
+            unsigned long s, e;
+            parse_ip_range(targets[i], &s, &e);
+            ok = udp_scan_one(s, e, &cfg, &ports, pacer, &out);
+        }
+        if (have_net) net_cleanup();
+        pacer_destroy(pacer);
+        port_set_free(&ports);
+        free(targets);
+        if (g_verbose) fprintf(stderr, "%lu UDP ports open, %lu printed\n", out.alive, out.printed);
+        if (g_interrupted) return 130;
+        return (ok && !atomic_load(&g_write_failed)) ? 0 : 1;
+    }
+    if (store_path) {
+        // The header range covers every target; widened as each one starts.
+        // A resumed scan continues the store of the interrupted run.
+        out.store = resume_path ? result_writer_reopen(store_path, 0xFFFFFFFFul, 0)
+                                : result_writer_create(store_path, 0xFFFFFFFFul, 0);
+        if (!out.store) { fprintf(stderr, "catnet_cli: cannot create '%s'\n", store_path); return 1; }
+    }
+
+    int ok = 1;
+    if (resume_path) {
+        result_writer_extend_range(out.store, saved.start_ip, saved.end_ip);
+        ok = scan_one(saved.start_ip, saved.end_ip, &saved.cfg, resume_path, &out);
+    } else if (ntargets == 0) {
+        if (!net_init()) { fprintf(stderr, "catnet_cli: network init failed\n"); return 1; }
+        SubnetV4 sn;
+        int have = net_get_primary_subnet(&sn);
+        net_cleanup();
+        if (!have) { fprintf(stderr, "catnet_cli: no primary subnet; give a target\n"); result_writer_close(out.store); return 2; }
+        result_writer_extend_range(out.store, sn.start_ip, sn.end_ip);
+        ok = scan_one(sn.start_ip, sn.end_ip, &cfg, NULL, &out);
+    }
+    for (int i = 0; i < ntargets && ok && !g_interrupted && !atomic_load(&g_write_failed); ++i) {
+        unsigned long s, e;
+        parse_ip_range(targets[i], &s, &e);
+        result_writer_extend_range(out.store, s, e);
+        ok = scan_one(s, e, &cfg, NULL, &out);
+    }
+    free(targets);
+    if (out.store && !result_writer_close(out.store)) {
+        fprintf(stderr, "catnet_cli: writing '%s' failed\n", store_path);
+        ok = 0;
+    }
+
+    if (g_verbose) fprintf(stderr, "%lu hosts up, %lu printed\n", out.alive, out.printed);
+    if (g_interrupted) return 130;
+    return (ok && !atomic_load(&g_write_failed)) ? 0 : 1;
+}
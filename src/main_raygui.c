@@ -11,10 +11,15 @@
 #include "raygui.h"
 
 #include "app.h"
+#include "conn_engine.h"
 #include "scan.h"
 #include "utils.h"
 #include "net.h"
 #include "parallel_scan.h"
+#include "result_index.h"
+#include "result_store.h"
+#include "event_log.h"
+#include <stdlib.h>
 #include <string.h>
 
 static Color g_bgColor = {24,24,24,255};
@@ -40,6 +45,7 @@ static int sortColumn = -1; // 0=Status,1=Hostname,2=IP,3=Open Ports,4=MAC Addre
 static bool sortAscending = true;
 static float splitterRatio = 0.65f; // vertical space for results in content area
 static bool draggingSplitter = false;
+static bool showStats = false; // bottom panel: scan stats instead of the debug log
 static void apply_theme(bool dark)
 {
     Color bg = dark ? (Color){24,24,24,255} : RAYWHITE;
@@ -70,83 +76,173 @@ static void gui_logger(const char* msg)
     g_logCount++;
 }
 
-static bool parse_range(const char* in, char* outStart, size_t szStart, char* outEnd, size_t szEnd)
+// Scan workers log binary events; drain them on the UI thread and format
+// only the lines the log panel can still show.
+static void drain_events(void)
 {
-    // Accepts formats:
-    // 1) "A.B.C.D-E" (end last octet only)
-    // 2) "A.B.C.D-E.F.G.H" (full range)
-    // 3) "A.B.C.D/nn" (CIDR prefix length)
-    const char* slash = NULL; for (const char* p = in; *p; ++p) { if (*p == '/') { slash = p; break; } }
-    if (slash) {
-        // CIDR: compute start/end from mask length
-        size_t ipLen = (size_t)(slash - in);
-        if (ipLen >= szStart) ipLen = szStart - 1;
-        strncpy(outStart, in, ipLen); outStart[ipLen] = '\0';
-        int prefix = atoi(slash + 1);
-        if (prefix < 0 || prefix > 32) return false;
-        unsigned long base = 0; if (!ip_to_uint(outStart, &base)) return false;
-        unsigned long mask = (prefix == 0) ? 0 : (0xFFFFFFFFul << (32 - prefix));
-        unsigned long network = base & mask;
-        unsigned long broadcast = network | (~mask);
-        char sBuf[64] = {0}, eBuf[64] = {0};
-        uint_to_ip(network, sBuf, sizeof(sBuf));
-        uint_to_ip(broadcast, eBuf, sizeof(eBuf));
-        safe_strcpy(outStart, szStart, sBuf);
-        safe_strcpy(outEnd, szEnd, eBuf);
-        return true;
+    static LogEvent events[1024];
+    size_t n = event_log_drain(events, sizeof(events) / sizeof(events[0]));
+    for (size_t i = (n > 256 ? n - 256 : 0); i < n; ++i) {
+        char msg[160];
+        event_log_format(&events[i], msg, sizeof(msg));
+        gui_logger(msg);
     }
+}
 
-    const char* dash = NULL; for (const char* p = in; *p; ++p) { if (*p == '-') { dash = p; break; } }
-    if (!dash) return false;
-    size_t leftLen = (size_t)(dash - in);
-    if (leftLen >= szStart) leftLen = szStart - 1;
-    strncpy(outStart, in, leftLen); outStart[leftLen] = '\0';
-    const char* right = dash + 1;
-    // If the right side has no '.', assume only end last octet
-    bool rightHasDot = false; for (const char* p = right; *p; ++p) { if (*p == '.') { rightHasDot = true; break; } }
-    if (!rightHasDot) {
-        const char* lastDot = NULL; for (const char* p = outStart; *p; ++p) { if (*p == '.') lastDot = p; }
-        if (!lastDot) return false;
-        size_t prefixLen = (size_t)(lastDot - outStart) + 1; // includes '.'
-        char buf[64]; if (prefixLen >= sizeof(buf)) return false;
-        strncpy(buf, outStart, prefixLen); buf[prefixLen] = '\0';
-        strncat(buf, right, sizeof(buf) - strlen(buf) - 1);
-        safe_strcpy(outEnd, szEnd, buf);
-    } else {
-        safe_strcpy(outEnd, szEnd, right);
-    }
-    return true;
+// Scan stats panel: refreshed a few times per second from
+// parallel_scan_stats, which never blocks the workers.
+#define STATS_LINES 12
+static char g_statsLines[STATS_LINES][160];
+static int g_statsCount = 0;
+
+static void format_latency(char* buf, size_t n, const LatencyHist* h)
+{
+    if (h->count == 0) { snprintf(buf, n, "rtt --"); return; }
+    snprintf(buf, n, "rtt p50 %.2f / p90 %.2f / p99 %.2f ms",
+             metrics_percentile(h, 0.50) / 1000.0, metrics_percentile(h, 0.90) / 1000.0, metrics_percentile(h, 0.99) / 1000.0);
+}
+
+static void refresh_stats(void)
+{
+    static ScanStats st; // large; keep it off the stack
+    parallel_scan_stats(&st);
+    const uint64_t* c = st.m.counters;
+    char lat[80];
+    int k = 0;
+    if (st.addresses == 0) { snprintf(g_statsLines[k++], sizeof(g_statsLines[0]), "No scan yet"); g_statsCount = k; return; }
+    snprintf(g_statsLines[k++], sizeof(g_statsLines[0]), "%s %.1f s: %llu of %llu hosts done, %llu alive, %d in flight, %d workers",
+             st.running ? "Running" : "Finished", st.elapsed_s, (unsigned long long)c[METRIC_HOSTS_DONE], st.addresses,
+             (unsigned long long)c[METRIC_HOSTS_ALIVE], st.hosts_in_flight, st.workers);
+    char* line = g_statsLines[k++];
+    int len = snprintf(line, sizeof(g_statsLines[0]), "Stages (queued/active):");
+    for (int i = 0; i < SCAN_STAGE_COUNT && len < (int)sizeof(g_statsLines[0]); ++i)
+        len += snprintf(line + len, sizeof(g_statsLines[0]) - (size_t)len, " %s %lld/%d", parallel_scan_stage_name(i), st.queued[i], st.active[i]);
+    format_latency(lat, sizeof(lat), &st.m.latency[METRIC_LAT_ICMP]);
+    snprintf(g_statsLines[k++], sizeof(g_statsLines[0]), "ICMP: %llu sent, %llu replies, %llu timeouts; %s",
+             (unsigned long long)c[METRIC_ICMP_SENT], (unsigned long long)c[METRIC_ICMP_REPLIES], (unsigned long long)c[METRIC_ICMP_TIMEOUTS], lat);
+    format_latency(lat, sizeof(lat), &st.m.latency[METRIC_LAT_ARP]);
+    snprintf(g_statsLines[k++], sizeof(g_statsLines[0]), "ARP: %llu sent, %llu replies, %llu timeouts; %s",
+             (unsigned long long)c[METRIC_ARP_SENT], (unsigned long long)c[METRIC_ARP_REPLIES], (unsigned long long)c[METRIC_ARP_TIMEOUTS], lat);
+    format_latency(lat, sizeof(lat), &st.m.latency[METRIC_LAT_TCP]);
+    char win[32];
+    if (st.tcp_window > 0) snprintf(win, sizeof(win), "window %d", st.tcp_window);
+    else snprintf(win, sizeof(win), "fixed timeouts");
+    snprintf(g_statsLines[k++], sizeof(g_statsLines[0]), "TCP: %llu probes, %llu open, %llu closed, %llu timeouts, %s; %s",
+             (unsigned long long)c[METRIC_TCP_PROBES], (unsigned long long)c[METRIC_TCP_OPEN], (unsigned long long)c[METRIC_TCP_CLOSED],
+             (unsigned long long)c[METRIC_TCP_TIMEOUTS], win, lat);
+    format_latency(lat, sizeof(lat), &st.m.latency[METRIC_LAT_DNS]);
+    snprintf(g_statsLines[k++], sizeof(g_statsLines[0]), "DNS: %llu queries (%llu retries), %llu answers, %llu timeouts, %llu cached; %s",
+             (unsigned long long)c[METRIC_DNS_QUERIES], (unsigned long long)c[METRIC_DNS_RETRIES], (unsigned long long)c[METRIC_DNS_ANSWERS],
+             (unsigned long long)c[METRIC_DNS_TIMEOUTS], (unsigned long long)c[METRIC_DNS_CACHE_HITS], lat);
+    snprintf(g_statsLines[k++], sizeof(g_statsLines[0]), "Pacer wait %.2f s, worker idle %.2f s, log events dropped %llu",
+             c[METRIC_PACER_WAIT_NS] / 1e9, c[METRIC_WORKER_IDLE_NS] / 1e9, event_log_dropped());
+    g_statsCount = k;
 }
 
-// Sorting helpers for Scan Results
-static int device_compare(const void* a, const void* b)
+// Results table view: one sorted index per column, all fed as results arrive,
+// so switching columns is instant and the records themselves never move.
+// 'g_viewCount' rows of the results list are in the view.
+static ResultIndex* g_views[RESULT_KEY_COUNT];
+static size_t g_viewCount = 0;
+
+// Formatted text of recently drawn rows, direct-mapped by results index.
+// Entries never change once published, so a slot stays valid until reused.
+#define ROW_CACHE_SIZE 512 // power of two, more than one page of rows
+typedef struct {
+    uint32_t row; // results index + 1, 0 = empty
+    char ip[DEVICE_IP_STRLEN];
+    char mac[DEVICE_MAC_STRLEN];
+    char ports[128];
+} RowText;
+static RowText g_rowCache[ROW_CACHE_SIZE];
+
+static void view_reset(void)
+{
+    for (int k = 0; k < RESULT_KEY_COUNT; ++k) { if (g_views[k]) result_index_clear(g_views[k]); }
+    g_viewCount = 0;
+    memset(g_rowCache, 0, sizeof(g_rowCache));
+}
+
+// Adds results [g_viewCount, list->count) to every column index, O(log n) each.
+static void view_append(const DeviceList* list)
 {
-    const DeviceInfo* da = (const DeviceInfo*)a;
-    const DeviceInfo* db = (const DeviceInfo*)b;
-    int c = 0;
-    switch (sortColumn) {
-        case 0: c = (da->is_alive - db->is_alive); break;
-        case 1: c = strcmp(da->hostname, db->hostname); break;
-        case 2: {
-            unsigned long ua=0, ub=0; ip_to_uint(da->ip, &ua); ip_to_uint(db->ip, &ub);
-            if (ua < ub) c = -1; else if (ua > ub) c = 1; else c = 0; break;
+    for (; g_viewCount < list->count; ++g_viewCount) {
+        for (int k = 0; k < RESULT_KEY_COUNT; ++k) {
+            if (!g_views[k]) g_views[k] = result_index_create(list, (ResultKey)k);
+            if (g_views[k]) result_index_insert(g_views[k], (uint32_t)g_viewCount);
         }
-        case 3: c = (da->open_ports_count - db->open_ports_count); break;
-        case 4: c = strcmp(da->mac, db->mac); break;
-        default: c = 0; break;
     }
-    if (!sortAscending) c = -c;
-    if (c < 0) return -1; if (c > 0) return 1; return 0;
 }
 
-static void sort_results(DeviceList* list)
+// Rows of an opened store are indexed only for the column being sorted, a
+// slice per frame, so opening is instant and the table stays responsive.
+#define VIEW_FILL_PER_FRAME 100000
+static void view_fill(const DeviceList* list)
+{
+    if (sortColumn < 0) return;
+    ResultIndex** ix = &g_views[sortColumn];
+    if (!*ix) *ix = result_index_create(list, (ResultKey)sortColumn);
+    if (!*ix) return;
+    size_t n = result_index_count(*ix);
+    size_t end = n + VIEW_FILL_PER_FRAME < g_viewCount ? n + VIEW_FILL_PER_FRAME : g_viewCount;
+    for (; n < end; ++n) { if (!result_index_insert(*ix, (uint32_t)n)) break; }
+}
+
+// Results index of display row 'r': arrival order until a column is picked
+// (or while its index is still being filled).
+static uint32_t view_row(size_t r)
+{
+    if (sortColumn < 0 || !g_views[sortColumn] || result_index_count(g_views[sortColumn]) != g_viewCount) return (uint32_t)r;
+    return result_index_at(g_views[sortColumn], sortAscending ? r : g_viewCount - 1 - r);
+}
+
+static const RowText* row_text(const DeviceList* list, uint32_t idx)
+{
+    RowText* rt = &g_rowCache[idx & (ROW_CACHE_SIZE - 1)];
+    if (rt->row == idx + 1) return rt;
+    const DeviceInfo* di = &list->items[idx];
+    device_ip_str(di, rt->ip, sizeof(rt->ip));
+    device_mac_str(di, rt->mac, sizeof(rt->mac));
+    size_t len = 0; rt->ports[0] = '\0';
+    for (int p = 0; p < di->open_ports_count && len < sizeof(rt->ports); ++p) {
+        int w = snprintf(rt->ports + len, sizeof(rt->ports) - len, "%d%s", device_port(di, p), (p<di->open_ports_count-1?",":""));
+        if (w < 0) break;
+        len += (size_t)w;
+    }
+    rt->row = idx + 1;
+    return rt;
+}
+
+// Result store dropped on the window: 'results' points at its records in
+// place (read-only; nothing is pushed while a store is open).
+static ResultStore* g_store = NULL;
+
+static void store_detach(DeviceList* results)
+{
+    if (!g_store) return;
+    device_list_init(results); // the records belong to the mapping
+    result_store_close(g_store);
+    g_store = NULL;
+}
+
+static bool store_open(const char* path, DeviceList* results)
 {
-    if (sortColumn < 0 || list->count == 0) return;
-    qsort(list->items, list->count, sizeof(DeviceInfo), device_compare);
+    ResultStore* rs = result_store_open(path);
+    if (!rs) return false;
+    store_detach(results);
+    device_list_clear(results);
+    view_reset();
+    g_store = rs;
+    result_store_mount(rs);
+    results->items = (DeviceInfo*)result_store_records(rs);
+    results->count = result_store_count(rs);
+    g_viewCount = results->count;
+    return true;
 }
 
 int main(void)
 {
+    conn_engine_raise_fd_limit();
     // --- Window Configuration ---
     const int initialWidth = 1100;
     const int initialHeight = 700;
@@ -164,6 +260,7 @@ const int splitBarH = padding;  // Vertical gap equals global padding
 
     // --- Application state ---
     DeviceList results; device_list_init(&results);
+    unsigned long long resultsGen = 0; // parallel_scan_poll position
     ScanConfig cfg; scan_config_init(&cfg);
     bool isScanning = false;
     apply_theme(true);
@@ -175,6 +272,7 @@ const int splitBarH = padding;  // Vertical gap equals global padding
     int selectedIndex = -1;
     Vector2 scroll = (Vector2){0,0};
     Vector2 dbgScroll = (Vector2){0,0};
+    double statsRefreshAt = 0.0;
     scan_set_logger(gui_logger);
     // Shared IP range buffer used by toolbar TextBox and scan action
     static char ipRangeText[64] = "192.168.1.1-254";
@@ -209,16 +307,19 @@ const int splitBarH = padding;  // Vertical gap equals global padding
             if (!isScanning) {
                 isScanning = true;
                 g_statusText[0] = '\0'; strncat(g_statusText, "Scanning...", sizeof(g_statusText)-1);
+                // Each scan gets a fresh string arena: show the last scan's
+                // events, drop its results, then free them.
+                parallel_scan_stop();
+                drain_events();
+                store_detach(&results);
                 device_list_clear(&results);
-                char startBuf[64] = {0}, endBuf[64] = {0};
-                if (parse_range(ipRangeText, startBuf, sizeof(startBuf), endBuf, sizeof(endBuf))) {
-                    unsigned long s = 0, e = 0;
-                    if (ip_to_uint(startBuf, &s) && ip_to_uint(endBuf, &e) && e >= s) {
-                        parallel_scan_start(s, e, &cfg, gui_logger);
-                    } else {
-                        SubnetV4 sn; if (net_get_primary_subnet(&sn)) { parallel_scan_start(sn.start_ip, sn.end_ip, &cfg, gui_logger); }
-                        else { isScanning = false; gui_logger("Invalid IP range"); }
-                    }
+                view_reset();
+                parallel_scan_clear();
+                selectedIndex = -1;
+                resultsGen = 0;
+                unsigned long s = 0, e = 0;
+                if (parse_ip_range(ipRangeText, &s, &e)) {
+                    parallel_scan_start(s, e, &cfg, gui_logger);
                 } else {
                     SubnetV4 sn; if (net_get_primary_subnet(&sn)) { parallel_scan_start(sn.start_ip, sn.end_ip, &cfg, gui_logger); } else { isScanning = false; gui_logger("Invalid IP range"); }
                 }
@@ -229,6 +330,8 @@ const int splitBarH = padding;  // Vertical gap equals global padding
         currentX += 90 + itemSpacing;
         if (GuiButton((Rectangle){ currentX, padding, 110, 26 }, "Clear Log")) { g_logCount = 0; }
         currentX += 110 + itemSpacing;
+        if (GuiButton((Rectangle){ currentX, padding, 90, 26 }, showStats ? "Log" : "Stats")) { showStats = !showStats; statsRefreshAt = 0.0; }
+        currentX += 90 + itemSpacing;
         Vector2 tQuick = MeasureTextEx(GetFontDefault(), "Quick Tools", (float)GuiGetStyle(DEFAULT, TEXT_SIZE), (float)GuiGetStyle(DEFAULT, TEXT_SPACING));
         float quickW = tQuick.x + 24; // extra padding to avoid truncation
         if (GuiButton((Rectangle){ currentX, padding, quickW, 26 }, "Quick Tools")) {
@@ -360,8 +463,10 @@ const int splitBarH = padding;  // Vertical gap equals global padding
         float portW = tPort.x + 24;
         if (GuiButton((Rectangle){ qx, qy, portW, 26 }, "Port Scan")) {
             if (quickToolsActiveMode) { g_logCount = 0; }
-            int open[64]; int openCount = 0;
-            int ok = net_scan_ports(quickIpText, cfg.default_ports, cfg.default_ports_count, cfg.port_timeout_ms, open, &openCount);
+            PortSet ports;
+            int* open = NULL; int openCount = 0, ok = 0;
+            if (port_set_compile(&ports, cfg.ports)) open = (int*)malloc(sizeof(int) * (size_t)ports.count);
+            if (open) ok = net_scan_ports(quickIpText, ports.order, ports.count, cfg.port_timeout_ms, open, &openCount);
             char msg[256] = {0};
             if (ok && openCount > 0) {
                 char buf[160] = {0};
@@ -374,20 +479,42 @@ const int splitBarH = padding;  // Vertical gap equals global padding
                 snprintf(msg, sizeof(msg), "Open ports %s: none", quickIpText);
             }
             gui_logger(msg);
+            free(open);
+            port_set_free(&ports);
         }
         } // end Quick Tools expanded
 
         // Navigation sidebar removed (not needed for current functionality)
 
         // --- 3. Main panel (ListView with columns) ---
-        // Refresh results snapshot each frame
+        drain_events();
+        if (IsFileDropped()) {
+            FilePathList dropped = LoadDroppedFiles();
+            if (isScanning) gui_logger("Stop the scan before opening saved results");
+            else if (dropped.count > 0 && store_open(dropped.paths[0], &results)) {
+                selectedIndex = -1;
+                scroll = (Vector2){0,0};
+                char msg[160]; snprintf(msg, sizeof(msg), "Opened %s: %zu hosts", GetFileName(dropped.paths[0]), g_viewCount);
+                gui_logger(msg);
+            } else gui_logger("Not a catnet result store");
+            UnloadDroppedFiles(dropped);
+        }
+        if (g_store) view_fill(&results);
+        // Pull only the results published since the last frame
         if (isScanning) {
-            parallel_scan_snapshot(&results);
-            if (!parallel_scan_is_running()) {
+            bool finished = !parallel_scan_is_running(); // checked first: nothing is published after it
+            size_t before = results.count;
+            resultsGen = parallel_scan_poll(resultsGen, &results, 0);
+            // Only alive devices are listed; drop the rest as they arrive.
+            size_t kept = before;
+            for (size_t i = before; i < results.count; ++i) {
+                if (results.items[i].is_alive) results.items[kept++] = results.items[i];
+            }
+            results.count = kept;
+            view_append(&results);
+            if (finished) {
                 isScanning = false;
-                // Contar apenas dispositivos encontrados (alive)
-                size_t found = 0; for (size_t i = 0; i < results.count; ++i) { if (results.items[i].is_alive) ++found; }
-                snprintf(g_statusText, sizeof(g_statusText), "Done. Devices: %zu", found);
+                snprintf(g_statusText, sizeof(g_statusText), "Done. Devices: %zu", g_viewCount);
             }
         }
         // ---- 4. Main content area with vertical splitter ----
@@ -444,7 +571,6 @@ const int splitBarH = padding;  // Vertical gap equals global padding
             if (GuiButton(hrec, title)) {
                 if (sortColumn != i) { sortColumn = i; sortAscending = true; }
                 else { sortAscending = !sortAscending; }
-                sort_results(&results);
             }
         }
         GuiLine((Rectangle){ mainArea.x, mainArea.y + padding + 28, mainArea.width, 1 }, NULL);
@@ -453,17 +579,20 @@ const int splitBarH = padding;  // Vertical gap equals global padding
         // Scrollable area for results
         Rectangle panelRec = { mainArea.x, mainArea.y + padding + 32, mainArea.width, mainArea.height - padding - 32 };
         Rectangle view = { 0 };
-        // Mostrar apenas dispositivos com ping OK (is_alive)
-        size_t visibleCount = 0; for (size_t i = 0; i < results.count; ++i) { if (results.items[i].is_alive) ++visibleCount; }
-        GuiScrollPanel(panelRec, NULL, (Rectangle){ 0, 0, panelRec.width - 20, (float)visibleCount * rowHeight }, &scroll, &view);
+        GuiScrollPanel(panelRec, NULL, (Rectangle){ 0, 0, panelRec.width - 20, (float)g_viewCount * rowHeight }, &scroll, &view);
         
         BeginScissorMode((int)view.x, (int)view.y, (int)view.width, (int)view.height);
 
-        int displayIndex = 0;
-        for (int i = 0; i < (int)results.count; i++)
+        // Only the rows inside the viewport are visited
+        size_t firstRow = (scroll.y < 0) ? (size_t)(-scroll.y / rowHeight) : 0;
+        size_t endRow = firstRow + (size_t)(view.height / rowHeight) + 2;
+        if (endRow > g_viewCount) endRow = g_viewCount;
+        for (size_t r = firstRow; r < endRow; r++)
         {
-            const DeviceInfo* di = &results.items[i];
-            if (!di->is_alive) continue; // filtrar apenas encontrados
+            uint32_t row = view_row(r);
+            const DeviceInfo* di = &results.items[row];
+            const RowText* rt = row_text(&results, row);
+            int displayIndex = (int)r;
             float yPos = panelRec.y + (float)(displayIndex * rowHeight) + scroll.y;
 
             // "Zebra Stripes" para melhor leitura
@@ -479,17 +608,12 @@ const int splitBarH = padding;  // Vertical gap equals global padding
             }
 
             // Desenhar dados por coluna
-            DrawCircle(columnOffsets[0] + 15, yPos + rowHeight/2, 5, LIME);
-            GuiLabel((Rectangle){ columnOffsets[1], yPos, columnWidths[1], (float)rowHeight }, di->hostname[0] ? di->hostname : "(unnamed)");
-            GuiLabel((Rectangle){ columnOffsets[2], yPos, columnWidths[2], (float)rowHeight }, di->ip);
-            char portsBuf[128] = {0};
-            for (int p = 0; p < di->open_ports_count; ++p) {
-                char tmp[16]; snprintf(tmp, sizeof(tmp), "%d%s", di->open_ports[p], (p<di->open_ports_count-1?",":""));
-                strncat(portsBuf, tmp, sizeof(portsBuf)-strlen(portsBuf)-1);
-            }
-            GuiLabel((Rectangle){ columnOffsets[3], yPos, columnWidths[3], (float)rowHeight }, portsBuf);
-            GuiLabel((Rectangle){ columnOffsets[4], yPos, columnWidths[4], (float)rowHeight }, di->mac);
-            displayIndex++;
+            DrawCircle(columnOffsets[0] + 15, yPos + rowHeight/2, 5, di->is_alive ? LIME : RED); // stores may hold dead hosts
+            const char* hostname = device_hostname(di);
+            GuiLabel((Rectangle){ columnOffsets[1], yPos, columnWidths[1], (float)rowHeight }, hostname[0] ? hostname : "(unnamed)");
+            GuiLabel((Rectangle){ columnOffsets[2], yPos, columnWidths[2], (float)rowHeight }, rt->ip);
+            GuiLabel((Rectangle){ columnOffsets[3], yPos, columnWidths[3], (float)rowHeight }, rt->ports);
+            GuiLabel((Rectangle){ columnOffsets[4], yPos, columnWidths[4], (float)rowHeight }, rt->mac);
         }
 
         EndScissorMode();
@@ -510,24 +634,26 @@ const int splitBarH = padding;  // Vertical gap equals global padding
             if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) draggingSplitter = false;
         }
 
-        // --- 6. Debug Terminal ---
+        // --- 6. Debug Terminal (or scan stats) ---
         Rectangle dbgBox = (Rectangle){ mainArea.x, splitBar.y + splitBar.height, mainArea.width, debugH };
         // Desenha apenas a borda do GroupBox e escreve o título abaixo da borda
         GuiGroupBox(dbgBox, "");
-        DrawTextEx(df, "Debug Log", (Vector2){ dbgBox.x + padding, dbgBox.y + padding + 2 }, fontSize, fontSpacing, GetColor(GuiGetStyle(DEFAULT, TEXT_COLOR_NORMAL)));
+        if (showStats && GetTime() >= statsRefreshAt) { refresh_stats(); statsRefreshAt = GetTime() + 0.25; }
+        char (*panelLines)[160] = showStats ? g_statsLines : g_logLines;
+        int panelCount = showStats ? g_statsCount : (g_logCount < 256 ? g_logCount : 256);
+        DrawTextEx(df, showStats ? "Scan Stats" : "Debug Log", (Vector2){ dbgBox.x + padding, dbgBox.y + padding + 2 }, fontSize, fontSpacing, GetColor(GuiGetStyle(DEFAULT, TEXT_COLOR_NORMAL)));
         // Área interna começa abaixo do título para evitar sobreposição
         Rectangle dbgPanelRec = { dbgBox.x + padding, dbgBox.y + padding + (fontSize + 8), dbgBox.width - padding*2, dbgBox.height - padding*2 - (fontSize + 8) };
         Rectangle dbgView = { 0 };
         int lineH = GuiGetStyle(DEFAULT, TEXT_SIZE) + 10;
-        float contentH = (float)((g_logCount < 256 ? g_logCount : 256) * lineH);
+        float contentH = (float)(panelCount * lineH);
         GuiScrollPanel(dbgPanelRec, NULL, (Rectangle){ 0, 0, dbgPanelRec.width - 20, contentH }, &dbgScroll, &dbgView);
         BeginScissorMode((int)dbgView.x, (int)dbgView.y, (int)dbgView.width, (int)dbgView.height);
-        int linesToShow = (g_logCount < 256 ? g_logCount : 256);
-        for (int i = 0; i < linesToShow; ++i) {
+        for (int i = 0; i < panelCount; ++i) {
             float y = dbgPanelRec.y + (float)(i * lineH) + dbgScroll.y;
             float dbgSize = (float)GuiGetStyle(DEFAULT, TEXT_SIZE) + 2.0f;
             Color dbgColor = (Color){ 235, 235, 235, 255 };
-            DrawTextEx(GetFontDefault(), g_logLines[i], (Vector2){ dbgPanelRec.x + 5, y + 2 }, dbgSize, (float)GuiGetStyle(DEFAULT, TEXT_SPACING), dbgColor);
+            DrawTextEx(GetFontDefault(), panelLines[i], (Vector2){ dbgPanelRec.x + 5, y + 2 }, dbgSize, (float)GuiGetStyle(DEFAULT, TEXT_SPACING), dbgColor);
         }
         EndScissorMode();
 
@@ -541,8 +667,7 @@ const int splitBarH = padding;  // Vertical gap equals global padding
         float sy = statusRect.y + (statusH - sFontSize)/2.0f;
         DrawTextEx(sFont, g_statusText, (Vector2){ statusRect.x + padding, sy }, sFontSize, sFontSpacing, GetColor(GuiGetStyle(DEFAULT, TEXT_COLOR_NORMAL)));
         // Right: device count and scan state
-        size_t foundStatus = 0; for (size_t i = 0; i < results.count; ++i) { if (results.items[i].is_alive) ++foundStatus; }
-        char rightText[96]; snprintf(rightText, sizeof(rightText), "Devices: %zu%s", foundStatus, (isScanning?" (scanning)":""));
+        char rightText[96]; snprintf(rightText, sizeof(rightText), "Devices: %zu%s", g_viewCount, (isScanning?" (scanning)":""));
         Vector2 tRight = MeasureTextEx(sFont, rightText, sFontSize, sFontSpacing);
         float rx = statusRect.x + statusRect.width - (padding*3) - tRight.x;
         DrawTextEx(sFont, rightText, (Vector2){ rx, sy }, sFontSize, sFontSpacing, GetColor(GuiGetStyle(DEFAULT, TEXT_COLOR_NORMAL)));
@@ -551,7 +676,9 @@ const int splitBarH = padding;  // Vertical gap equals global padding
     }
 
     // --- Shutdown ---
+    store_detach(&results);
     device_list_clear(&results);
+    for (int k = 0; k < RESULT_KEY_COUNT; ++k) result_index_destroy(g_views[k]);
     CloseWindow();
     return 0;
 }
\ No newline at end of file
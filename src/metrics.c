@@ -0,0 +1,205 @@
+#include "metrics.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// One slot per live thread, claimed and recycled like the event rings. The
+// owning thread is the only writer, so an update is a relaxed load and store
+// (no locked instruction); readers may see a count a few events stale.
+typedef struct {
+    atomic_ullong counts[METRIC_HIST_BUCKETS];
+    atomic_ullong count, sum_us;
+} HistSlot;
+
+typedef struct MetricSlot {
+    atomic_ullong counters[METRIC_COUNTER_COUNT];
+    HistSlot latency[METRIC_LAT_COUNT];
+    atomic_int owned;
+    struct MetricSlot* next; // registry link
+} MetricSlot;
+
+static _Atomic(MetricSlot*) g_slots;
+static THREAD_LOCAL MetricSlot* t_slot;
+static Mutex g_key_lock = MUTEX_INITIALIZER;
+static ThreadKey g_key;
+static int g_key_state; // under g_key_lock: 0 = not yet, 1 = ok, -1 = failed
+// Used when a slot cannot be allocated; shared, so updates there may race.
+static MetricSlot g_fallback;
+
+static void slot_release(void* p) {
+    if (p) atomic_store_explicit(&((MetricSlot*)p)->owned, 0, memory_order_release);
+}
+
+static MetricSlot* slot_claim(void) {
+    MetricSlot* s;
+    for (s = atomic_load(&g_slots); s; s = s->next) {
+        int expected = 0;
+        if (atomic_load_explicit(&s->owned, memory_order_relaxed) == 0 &&
+            atomic_compare_exchange_strong(&s->owned, &expected, 1)) break;
+    }
+    if (!s) {
+        s = (MetricSlot*)calloc(1, sizeof(MetricSlot));
+        if (!s) return &g_fallback;
+        atomic_init(&s->owned, 1);
+        s->next = atomic_load(&g_slots);
+        while (!atomic_compare_exchange_weak(&g_slots, &s->next, s)) {}
+    }
+    mutex_lock(&g_key_lock);
+    if (g_key_state == 0) g_key_state = thread_key_create(&g_key, slot_release) ? 1 : -1;
+    if (g_key_state > 0) thread_key_set(g_key, s);
+    mutex_unlock(&g_key_lock);
+    t_slot = s;
+    return s;
+}
+
+static void bump(atomic_ullong* v, uint64_t n) {
+    atomic_store_explicit(v, atomic_load_explicit(v, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+static MetricSlot* my_slot(void) {
+    MetricSlot* s = t_slot;
+    return s ? s : slot_claim();
+}
+
+void metrics_add(MetricCounter c, uint64_t n) {
+    if ((unsigned)c >= METRIC_COUNTER_COUNT) return;
+    bump(&my_slot()->counters[c], n);
+}
+
+static int msb64(uint64_t v) {
+    int b = 0;
+    if (v >> 32) { v >>= 32; b += 32; }
+    if (v >> 16) { v >>= 16; b += 16; }
+    if (v >> 8) { v >>= 8; b += 8; }
+    if (v >> 4) { v >>= 4; b += 4; }
+    if (v >> 2) { v >>= 2; b += 2; }
+    if (v >> 1) b += 1;
+    return b;
+}
+
+// Values below 16 get a bucket each; above, each power of two is split into
+// 16 equal sub-buckets.
+#define SUB (1 << METRIC_HIST_SUB_BITS)
+
+static int bucket_of(uint64_t us) {
+    if (us < SUB) return (int)us;
+    int msb = msb64(us);
+    int i = (msb - METRIC_HIST_SUB_BITS + 1) * SUB + (int)((us >> (msb - METRIC_HIST_SUB_BITS)) - SUB);
+    return i < METRIC_HIST_BUCKETS ? i : METRIC_HIST_BUCKETS - 1;
+}
+
+uint64_t metrics_bucket_upper_us(int i) {
+    if (i < SUB) return (uint64_t)i;
+    int shift = i / SUB - 1;
+    uint64_t lower = (uint64_t)(SUB + i % SUB) << shift;
+    return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void metrics_record_us(MetricLatency h, uint64_t us) {
+    if ((unsigned)h >= METRIC_LAT_COUNT) return;
+    HistSlot* hs = &my_slot()->latency[h];
+    bump(&hs->counts[bucket_of(us)], 1);
+    bump(&hs->count, 1);
+    bump(&hs->sum_us, us);
+}
+
+static void slot_sum(const MetricSlot* s, MetricsSnapshot* out) {
+    for (int c = 0; c < METRIC_COUNTER_COUNT; ++c)
+        out->counters[c] += atomic_load_explicit(&s->counters[c], memory_order_relaxed);
+    for (int h = 0; h < METRIC_LAT_COUNT; ++h) {
+        const HistSlot* hs = &s->latency[h];
+        LatencyHist* o = &out->latency[h];
+        for (int i = 0; i < METRIC_HIST_BUCKETS; ++i) o->counts[i] += atomic_load_explicit(&hs->counts[i], memory_order_relaxed);
+        o->count += atomic_load_explicit(&hs->count, memory_order_relaxed);
+        o->sum_us += atomic_load_explicit(&hs->sum_us, memory_order_relaxed);
+    }
+}
+
+void metrics_snapshot(MetricsSnapshot* out) {
+    memset(out, 0, sizeof(*out));
+    for (MetricSlot* s = atomic_load(&g_slots); s; s = s->next) slot_sum(s, out);
+    slot_sum(&g_fallback, out);
+}
+
+void metrics_diff(const MetricsSnapshot* now, const MetricsSnapshot* base, MetricsSnapshot* out) {
+    for (int c = 0; c < METRIC_COUNTER_COUNT; ++c) out->counters[c] = now->counters[c] - base->counters[c];
+    for (int h = 0; h < METRIC_LAT_COUNT; ++h) {
+        const LatencyHist* a = &now->latency[h];
+        const LatencyHist* b = &base->latency[h];
+        LatencyHist* o = &out->latency[h];
+        for (int i = 0; i < METRIC_HIST_BUCKETS; ++i) o->counts[i] = a->counts[i] - b->counts[i];
+        o->count = a->count - b->count;
+        o->sum_us = a->sum_us - b->sum_us;
+    }
+}
+
+uint64_t metrics_percentile(const LatencyHist* h, double q) {
+    uint64_t total = 0;
+    for (int i = 0; i < METRIC_HIST_BUCKETS; ++i) total += h->counts[i];
+    if (total == 0) return 0;
+    if (q < 0) q = 0;
+    if (q > 1) q = 1;
+    uint64_t rank = (uint64_t)(q * (double)total + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < METRIC_HIST_BUCKETS; ++i) {
+        seen += h->counts[i];
+        if (seen >= rank) return metrics_bucket_upper_us(i);
+    }
+    return metrics_bucket_upper_us(METRIC_HIST_BUCKETS - 1);
+}
+
+static const char* const k_counter_names[METRIC_COUNTER_COUNT] = {
+    "icmp_sent", "icmp_replies", "icmp_timeouts",
+    "arp_sent", "arp_replies", "arp_timeouts",
+    "tcp_probes", "tcp_open", "tcp_closed", "tcp_timeouts", "tcp_retries",
+    "tcp_banners", "tcp_service_probes", "services_matched",
+    "udp_probes", "udp_open", "udp_closed", "udp_timeouts", "udp_retries",
+    "dns_queries", "dns_retries", "dns_answers", "dns_timeouts", "dns_cache_hits",
+    "hosts_done", "hosts_alive",
+    "pacer_wait_ns", "worker_idle_ns",
+};
+
+static const char* const k_latency_names[METRIC_LAT_COUNT] = { "icmp", "tcp", "dns", "arp", "udp" };
+
+const char* metrics_counter_name(MetricCounter c) {
+    return (unsigned)c < METRIC_COUNTER_COUNT ? k_counter_names[c] : "unknown";
+}
+
+const char* metrics_latency_name(MetricLatency h) {
+    return (unsigned)h < METRIC_LAT_COUNT ? k_latency_names[h] : "unknown";
+}
+
+void metrics_write_prometheus(FILE* f, const MetricsSnapshot* m) {
+    for (int c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+        const char* name = k_counter_names[c];
+        size_t len = strlen(name);
+        if (len > 3 && strcmp(name + len - 3, "_ns") == 0) {
+            fprintf(f, "# TYPE catnet_%.*s_seconds_total counter\n", (int)(len - 3), name);
+            fprintf(f, "catnet_%.*s_seconds_total %.6f\n", (int)(len - 3), name, (double)m->counters[c] / 1e9);
+        } else {
+            fprintf(f, "# TYPE catnet_%s_total counter\n", name);
+            fprintf(f, "catnet_%s_total %llu\n", name, (unsigned long long)m->counters[c]);
+        }
+    }
+    // Only non-empty buckets are written; cumulative counts make the
+    // skipped ones implicit.
+    for (int h = 0; h < METRIC_LAT_COUNT; ++h) {
+        const LatencyHist* lh = &m->latency[h];
+        const char* name = k_latency_names[h];
+        fprintf(f, "# TYPE catnet_%s_rtt_seconds histogram\n", name);
+        uint64_t cum = 0;
+        for (int i = 0; i < METRIC_HIST_BUCKETS; ++i) {
+            if (lh->counts[i] == 0) continue;
+            cum += lh->counts[i];
+            fprintf(f, "catnet_%s_rtt_seconds_bucket{le=\"%.6f\"} %llu\n", name,
+                    (double)(metrics_bucket_upper_us(i) + 1) / 1e6, (unsigned long long)cum);
+        }
+        // The bucket total, not lh->count: the two are read separately and
+        // the exposition must stay consistent.
+        fprintf(f, "catnet_%s_rtt_seconds_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cum);
+        fprintf(f, "catnet_%s_rtt_seconds_sum %.6f\n", name, (double)lh->sum_us / 1e6);
+        fprintf(f, "catnet_%s_rtt_seconds_count %llu\n", name, (unsigned long long)cum);
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+// Process-wide scan instrumentation: event counters and latency histograms.
+// Every thread writes its own slot without atomic read-modify-write or
+// locks; a reader sums the slots into a snapshot. Counts only grow, so
+// per-scan figures are the difference of two snapshots.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    METRIC_ICMP_SENT,
+    METRIC_ICMP_REPLIES,
+    METRIC_ICMP_TIMEOUTS,
+    METRIC_ARP_SENT,
+    METRIC_ARP_REPLIES,
+    METRIC_ARP_TIMEOUTS,
+    METRIC_TCP_PROBES,
+    METRIC_TCP_OPEN,
+    METRIC_TCP_CLOSED,   // refused or unreachable
+    METRIC_TCP_TIMEOUTS,
+    METRIC_TCP_RETRIES,  // connects sent again after a timeout
+    METRIC_TCP_BANNERS,  // open ports that sent anything back (service detection)
+    METRIC_TCP_SERVICE_PROBES, // probes sent to services that stayed silent
+    METRIC_SERVICES_MATCHED,   // banners the signature database recognised
+    METRIC_UDP_PROBES,   // datagrams sent, retries included
+    METRIC_UDP_OPEN,
+    METRIC_UDP_CLOSED,   // port, host or network unreachable
+    METRIC_UDP_TIMEOUTS, // no answer after the last try (open|filtered)
+    METRIC_UDP_RETRIES,
+    METRIC_DNS_QUERIES,  // datagrams sent, retries included
+    METRIC_DNS_RETRIES,
+    METRIC_DNS_ANSWERS,  // any parsed answer, NXDOMAIN included
+    METRIC_DNS_TIMEOUTS, // lookups that gave up
+    METRIC_DNS_CACHE_HITS,
+    METRIC_HOSTS_DONE,
+    METRIC_HOSTS_ALIVE,
+    METRIC_PACER_WAIT_NS,  // time senders slept for their rate budget
+    METRIC_WORKER_IDLE_NS, // time scan workers slept waiting for work
+    METRIC_COUNTER_COUNT
+} MetricCounter;
+
+typedef enum {
+    METRIC_LAT_ICMP, // echo round trip
+    METRIC_LAT_TCP,  // connect until SYN-ACK or RST
+    METRIC_LAT_DNS,  // query until answer
+    METRIC_LAT_ARP,  // request until reply
+    METRIC_LAT_UDP,  // datagram until answer or ICMP error
+    METRIC_LAT_COUNT
+} MetricLatency;
+
+// Log-linear (HDR-style) buckets in microseconds: 16 linear sub-buckets per
+// power of two, so any value is within 1/16 of its bucket's bounds. Values
+// above about 134 s land in the last bucket.
+#define METRIC_HIST_SUB_BITS 4
+#define METRIC_HIST_BUCKETS 384
+
+typedef struct {
+    uint64_t counts[METRIC_HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum_us;
+} LatencyHist;
+
+typedef struct {
+    uint64_t counters[METRIC_COUNTER_COUNT];
+    LatencyHist latency[METRIC_LAT_COUNT];
+} MetricsSnapshot;
+
+void metrics_add(MetricCounter c, uint64_t n);
+static inline void metrics_inc(MetricCounter c) { metrics_add(c, 1); }
+void metrics_record_us(MetricLatency h, uint64_t us);
+
+// Sums every thread's slot; safe while they keep writing.
+void metrics_snapshot(MetricsSnapshot* out);
+// out = now - base, bucket by bucket.
+void metrics_diff(const MetricsSnapshot* now, const MetricsSnapshot* base, MetricsSnapshot* out);
+
+// Value (microseconds) below which fraction 'q' (0..1) of samples fall;
+// 0 for an empty histogram.
+uint64_t metrics_percentile(const LatencyHist* h, double q);
+// Upper bound of bucket 'i' in microseconds.
+uint64_t metrics_bucket_upper_us(int i);
+
+const char* metrics_counter_name(MetricCounter c); // "icmp_sent", ...
+const char* metrics_latency_name(MetricLatency h); // "icmp", ...
+
+// Prometheus text exposition: counters as catnet_<name>_total (seconds for
+// the *_ns ones) and histograms as catnet_<kind>_rtt_seconds.
+void metrics_write_prometheus(FILE* f, const MetricsSnapshot* m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
@@ -0,0 +1,441 @@
+#include "neighbor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int entry_cmp(const void* a, const void* b) {
+    uint32_t x = ((const NeighborEntry*)a)->ip, y = ((const NeighborEntry*)b)->ip;
+    return (x > y) - (x < y);
+}
+
+// Appends to a growing table; returns 0 when out of memory.
+static int table_push(NeighborTable* t, size_t* cap, const NeighborEntry* e) {
+    if (t->count == *cap) {
+        size_t ncap = *cap ? *cap * 2 : 64;
+        NeighborEntry* n = (NeighborEntry*)realloc(t->items, ncap * sizeof(NeighborEntry));
+        if (!n) return 0;
+        t->items = n;
+        *cap = ncap;
+    }
+    t->items[t->count++] = *e;
+    return 1;
+}
+
+static void table_finish(NeighborTable* t) {
+    if (t->count > 1) qsort(t->items, t->count, sizeof(NeighborEntry), entry_cmp);
+}
+
+const NeighborEntry* neighbor_table_find(const NeighborTable* t, unsigned long ip) {
+    if (!t || !t->count) return NULL;
+    NeighborEntry key;
+    key.ip = (uint32_t)ip;
+    return (const NeighborEntry*)bsearch(&key, t->items, t->count, sizeof(NeighborEntry), entry_cmp);
+}
+
+void neighbor_table_free(NeighborTable* t) {
+    if (!t) return;
+    free(t->items);
+    t->items = NULL;
+    t->count = 0;
+}
+
+#if defined(__linux__)
+
+#include "metrics.h"
+#include "thread.h"
+#include "pacer.h"
+#include "timing.h"
+#include <stdatomic.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/neighbour.h>
+
+#define ARP_MAX_ADDRS 65536ul
+#define ARP_PKT_LEN 28 // Ethernet/IPv4 ARP body; the kernel adds the link header
+#define NL_BUF_SIZE 32768
+
+struct ArpSweep {
+    int sock;
+    int ifindex;
+    uint8_t our_mac[6];
+    uint32_t our_ip;
+    unsigned long start_ip;
+    unsigned long count;
+    Pacer* pacer;
+    int timeout_ms;
+    ArpReplyFn fn;
+    void* user;
+    atomic_uchar* alive;    // one bit per address; set after its MAC is stored
+    uint8_t (*macs)[6];
+    atomic_uint* sent_us;   // per address: send time in µs after t0, plus 1; 0 = not sent
+    unsigned long long t0_ns;
+    atomic_ulong found;
+    atomic_int cancel;
+    atomic_int stop_recv;
+    atomic_int done;        // set by the receive thread: no callback runs after it
+    Thread send_thread, recv_thread;
+    Mutex lock;
+    CondVar done_cv;
+};
+
+// Picks the Ethernet-like interface whose subnet covers most of
+// [*start, *end] and clips the range to its usable addresses.
+static int find_onlink_interface(unsigned long* start, unsigned long* end, char* ifname, size_t ifsz, uint32_t* our_ip) {
+    struct ifaddrs* ifs = NULL;
+    if (getifaddrs(&ifs) != 0) return 0;
+    unsigned long best = 0, best_lo = 0, best_hi = 0;
+    for (struct ifaddrs* cur = ifs; cur; cur = cur->ifa_next) {
+        if (!cur->ifa_addr || cur->ifa_addr->sa_family != AF_INET || !cur->ifa_netmask) continue;
+        if (!(cur->ifa_flags & IFF_UP) || (cur->ifa_flags & (IFF_LOOPBACK | IFF_NOARP | IFF_POINTOPOINT))) continue;
+        unsigned long ip = ntohl(((struct sockaddr_in*)cur->ifa_addr)->sin_addr.s_addr);
+        unsigned long mask = ntohl(((struct sockaddr_in*)cur->ifa_netmask)->sin_addr.s_addr);
+        unsigned long host_bits = ~mask & 0xFFFFFFFFul;
+        if (host_bits == 0) continue; // /32: no neighbors
+        unsigned long net = ip & mask, bcast = net | host_bits;
+        if (host_bits > 1) { net++; bcast--; } // /31 has no network or broadcast address
+        unsigned long lo = *start > net ? *start : net, hi = *end < bcast ? *end : bcast;
+        if (lo > hi || hi - lo + 1 <= best) continue;
+        best = hi - lo + 1; best_lo = lo; best_hi = hi;
+        snprintf(ifname, ifsz, "%s", cur->ifa_name);
+        *our_ip = (uint32_t)ip;
+    }
+    freeifaddrs(ifs);
+    if (!best) return 0;
+    *start = best_lo;
+    *end = best_hi;
+    return 1;
+}
+
+static void mark_done(ArpSweep* sw) {
+    mutex_lock(&sw->lock);
+    atomic_store(&sw->done, 1);
+    cond_broadcast(&sw->done_cv);
+    mutex_unlock(&sw->lock);
+}
+
+static void put32(uint8_t* p, uint32_t v) { p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16); p[2] = (uint8_t)(v >> 8); p[3] = (uint8_t)v; }
+static uint32_t get32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+
+static void send_proc(void* arg) {
+    ArpSweep* sw = (ArpSweep*)arg;
+    uint8_t pkt[ARP_PKT_LEN];
+    memset(pkt, 0, sizeof(pkt));
+    pkt[1] = ARPHRD_ETHER;
+    pkt[2] = 0x08; // IPv4
+    pkt[4] = 6; pkt[5] = 4;
+    pkt[7] = ARPOP_REQUEST;
+    memcpy(pkt + 8, sw->our_mac, 6);
+    put32(pkt + 14, sw->our_ip);
+    struct sockaddr_ll dst;
+    memset(&dst, 0, sizeof(dst));
+    dst.sll_family = AF_PACKET;
+    dst.sll_protocol = htons(ETH_P_ARP);
+    dst.sll_ifindex = sw->ifindex;
+    dst.sll_halen = 6;
+    memset(dst.sll_addr, 0xFF, 6);
+
+    unsigned long sent_total = 0;
+    for (unsigned long k = 0; k < sw->count && !atomic_load(&sw->cancel); ++k) {
+        uint32_t target = (uint32_t)(sw->start_ip + k);
+        if (target == sw->our_ip) continue;
+        if (!pacer_acquire(sw->pacer, 1)) break;
+        put32(pkt + 24, target);
+        atomic_store_explicit(&sw->sent_us[k], (unsigned)((clock_monotonic_ns() - sw->t0_ns) / 1000) + 1, memory_order_relaxed);
+        ssize_t sent;
+        while ((sent = sendto(sw->sock, pkt, sizeof(pkt), 0, (struct sockaddr*)&dst, sizeof(dst))) < 0) {
+            if ((errno != ENOBUFS && errno != EAGAIN) || atomic_load(&sw->cancel)) break;
+            thread_sleep_ns(100000); // queue full, back off briefly
+        }
+        if (sent >= 0) { metrics_inc(METRIC_ARP_SENT); sent_total++; }
+    }
+
+    // Give the last request its full timeout.
+    unsigned long long until = clock_monotonic_ns() + (unsigned long long)sw->timeout_ms * 1000000ull;
+    while (!atomic_load(&sw->cancel)) {
+        unsigned long long now = clock_monotonic_ns();
+        if (now >= until) break;
+        unsigned long long left = until - now;
+        thread_sleep_ns(left > 20000000ull ? 20000000ull : left);
+    }
+    unsigned long replies = atomic_load_explicit(&sw->found, memory_order_relaxed);
+    if (!atomic_load(&sw->cancel) && sent_total > replies) metrics_add(METRIC_ARP_TIMEOUTS, sent_total - replies);
+    atomic_store(&sw->stop_recv, 1);
+}
+
+static void handle_arp(ArpSweep* sw, const uint8_t* p, size_t len) {
+    static const uint8_t zero[6] = {0}, bcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    if (len < ARP_PKT_LEN) return;
+    if (p[0] != 0 || p[1] != ARPHRD_ETHER || p[2] != 0x08 || p[3] != 0 || p[4] != 6 || p[5] != 4) return;
+    if (p[6] != 0 || p[7] != ARPOP_REPLY) return;
+    if (get32(p + 24) != sw->our_ip) return;
+    const uint8_t* mac = p + 8;
+    if (!memcmp(mac, zero, 6) || !memcmp(mac, bcast, 6)) return;
+    unsigned long ip = get32(p + 14);
+    if (ip < sw->start_ip || ip - sw->start_ip >= sw->count) return;
+    unsigned long off = ip - sw->start_ip;
+
+    unsigned char bit = (unsigned char)(1u << (off & 7));
+    if (atomic_load_explicit(&sw->alive[off >> 3], memory_order_relaxed) & bit) return; // duplicate reply
+    memcpy(sw->macs[off], mac, 6); // only this thread writes
+    atomic_fetch_or_explicit(&sw->alive[off >> 3], bit, memory_order_release);
+    atomic_fetch_add_explicit(&sw->found, 1, memory_order_relaxed);
+    metrics_inc(METRIC_ARP_REPLIES);
+    unsigned sent = atomic_load_explicit(&sw->sent_us[off], memory_order_relaxed);
+    unsigned long long now_us = (clock_monotonic_ns() - sw->t0_ns) / 1000;
+    if (sent && now_us + 1 >= sent) {
+        metrics_record_us(METRIC_LAT_ARP, now_us + 1 - sent);
+        timing_observe(ip, (uint32_t)(now_us + 1 - sent));
+    }
+    if (sw->fn) sw->fn(sw->user, ip, sw->macs[off]);
+}
+
+static void recv_proc(void* arg) {
+    ArpSweep* sw = (ArpSweep*)arg;
+    uint8_t buf[256];
+    while (!atomic_load(&sw->stop_recv)) {
+        struct pollfd pfd; pfd.fd = sw->sock; pfd.events = POLLIN; pfd.revents = 0;
+        if (poll(&pfd, 1, 50) <= 0) continue;
+        for (;;) {
+            ssize_t n = recv(sw->sock, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n <= 0) break;
+            handle_arp(sw, buf, (size_t)n);
+        }
+    }
+    mark_done(sw);
+}
+
+static void free_sweep(ArpSweep* sw) {
+    close(sw->sock);
+    pacer_destroy(sw->pacer);
+    free(sw->alive);
+    free(sw->macs);
+    free(sw->sent_us);
+    free(sw);
+}
+
+ArpSweep* arp_sweep_start(unsigned long start_ip, unsigned long end_ip, int rate_pps, int timeout_ms,
+                          ArpReplyFn fn, void* user) {
+    if (end_ip < start_ip) return NULL;
+    char ifname[IF_NAMESIZE];
+    uint32_t our_ip = 0;
+    if (!find_onlink_interface(&start_ip, &end_ip, ifname, sizeof(ifname), &our_ip)) return NULL;
+    if (end_ip - start_ip >= ARP_MAX_ADDRS) return NULL;
+
+    int s = socket(AF_PACKET, SOCK_DGRAM | SOCK_CLOEXEC, htons(ETH_P_ARP));
+    if (s < 0) return NULL; // needs CAP_NET_RAW
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", ifname);
+    if (ioctl(s, SIOCGIFHWADDR, &ifr) != 0 || ifr.ifr_hwaddr.sa_family != ARPHRD_ETHER) { close(s); return NULL; }
+    struct sockaddr_ll sll;
+    memset(&sll, 0, sizeof(sll));
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_ARP);
+    sll.sll_ifindex = (int)if_nametoindex(ifname);
+    if (sll.sll_ifindex == 0 || bind(s, (struct sockaddr*)&sll, sizeof(sll)) != 0) { close(s); return NULL; }
+
+    ArpSweep* sw = (ArpSweep*)calloc(1, sizeof(ArpSweep));
+    if (!sw) { close(s); return NULL; }
+    sw->sock = s;
+    sw->count = end_ip - start_ip + 1;
+    sw->alive = (atomic_uchar*)calloc((sw->count + 7) / 8, sizeof(atomic_uchar));
+    sw->macs = (uint8_t(*)[6])calloc(sw->count, 6);
+    sw->sent_us = (atomic_uint*)calloc(sw->count, sizeof(atomic_uint));
+    sw->pacer = pacer_create(rate_pps, PACER_DEFAULT_BURST);
+    if (!sw->alive || !sw->macs || !sw->sent_us || !sw->pacer) { free_sweep(sw); return NULL; }
+    sw->t0_ns = clock_monotonic_ns();
+    sw->ifindex = sll.sll_ifindex;
+    memcpy(sw->our_mac, ifr.ifr_hwaddr.sa_data, 6);
+    sw->our_ip = our_ip;
+    sw->start_ip = start_ip;
+    sw->timeout_ms = timeout_ms > 0 ? timeout_ms : 500;
+    sw->fn = fn;
+    sw->user = user;
+    mutex_init(&sw->lock);
+    cond_init(&sw->done_cv);
+
+    if (!thread_create(&sw->recv_thread, recv_proc, sw)) {
+        mutex_destroy(&sw->lock); cond_destroy(&sw->done_cv);
+        free_sweep(sw);
+        return NULL;
+    }
+    if (!thread_create(&sw->send_thread, send_proc, sw)) {
+        atomic_store(&sw->stop_recv, 1);
+        thread_join(&sw->recv_thread);
+        mutex_destroy(&sw->lock); cond_destroy(&sw->done_cv);
+        free_sweep(sw);
+        return NULL;
+    }
+    return sw;
+}
+
+void arp_sweep_range(const ArpSweep* sw, unsigned long* first, unsigned long* last) {
+    *first = sw ? sw->start_ip : 1;
+    *last = sw ? sw->start_ip + sw->count - 1 : 0;
+}
+
+void arp_sweep_wait(ArpSweep* sw) {
+    if (!sw) return;
+    mutex_lock(&sw->lock);
+    while (!atomic_load(&sw->done)) cond_wait(&sw->done_cv, &sw->lock);
+    mutex_unlock(&sw->lock);
+}
+
+int arp_sweep_done(const ArpSweep* sw) { return sw ? atomic_load(&sw->done) : 1; }
+
+void arp_sweep_cancel(ArpSweep* sw) { if (sw) { atomic_store(&sw->cancel, 1); pacer_close(sw->pacer); } }
+
+void arp_sweep_set_rate(ArpSweep* sw, int rate_pps) { if (sw) pacer_set_rate(sw->pacer, rate_pps); }
+
+int arp_sweep_get_mac(const ArpSweep* sw, unsigned long ip, uint8_t mac[6]) {
+    if (!sw || ip < sw->start_ip || ip - sw->start_ip >= sw->count) return 0;
+    unsigned long off = ip - sw->start_ip;
+    if (!((atomic_load_explicit(&sw->alive[off >> 3], memory_order_acquire) >> (off & 7)) & 1)) return 0;
+    if (mac) memcpy(mac, sw->macs[off], 6);
+    return 1;
+}
+
+unsigned long arp_sweep_found_count(const ArpSweep* sw) {
+    return sw ? atomic_load_explicit(&sw->found, memory_order_relaxed) : 0;
+}
+
+void arp_sweep_destroy(ArpSweep* sw) {
+    if (!sw) return;
+    arp_sweep_cancel(sw);
+    thread_join(&sw->send_thread);
+    thread_join(&sw->recv_thread);
+    mutex_destroy(&sw->lock);
+    cond_destroy(&sw->done_cv);
+    free_sweep(sw);
+}
+
+// Parses one RTM_NEWNEIGH message; returns 1 for an IPv4 entry with a MAC.
+static int parse_neigh(const struct nlmsghdr* nh, NeighborEntry* e) {
+    const struct ndmsg* nd = (const struct ndmsg*)NLMSG_DATA(nh);
+    if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(*nd)) || nd->ndm_family != AF_INET) return 0;
+    if (nd->ndm_state == NUD_NONE) return 0; // NUD_NONE is 0: no bit to mask
+    if (nd->ndm_state & (NUD_INCOMPLETE | NUD_FAILED | NUD_NOARP)) return 0;
+    int have_ip = 0, have_mac = 0;
+    int len = (int)(nh->nlmsg_len - NLMSG_LENGTH(sizeof(*nd)));
+    for (const struct rtattr* a = (const struct rtattr*)((const char*)nd + NLMSG_ALIGN(sizeof(*nd)));
+         RTA_OK(a, len); a = RTA_NEXT(a, len)) {
+        if (a->rta_type == NDA_DST && RTA_PAYLOAD(a) == 4) {
+            uint32_t be; memcpy(&be, RTA_DATA(a), 4);
+            e->ip = ntohl(be);
+            have_ip = 1;
+        } else if (a->rta_type == NDA_LLADDR && RTA_PAYLOAD(a) == 6) {
+            memcpy(e->mac, RTA_DATA(a), 6);
+            have_mac = 1;
+        }
+    }
+    e->reachable = (nd->ndm_state & NUD_REACHABLE) ? 1 : 0;
+    return have_ip && have_mac;
+}
+
+int neighbor_table_load(NeighborTable* t) {
+    t->items = NULL;
+    t->count = 0;
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) return 0;
+    struct { struct nlmsghdr nh; struct ndmsg nd; } req;
+    memset(&req, 0, sizeof(req));
+    req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(struct ndmsg));
+    req.nh.nlmsg_type = RTM_GETNEIGH;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nh.nlmsg_seq = 1;
+    req.nd.ndm_family = AF_INET;
+    if (send(fd, &req, req.nh.nlmsg_len, 0) < 0) { close(fd); return 0; }
+
+    char* msgbuf = (char*)malloc(NL_BUF_SIZE); // malloc alignment suits nlmsghdr
+    size_t cap = 0;
+    int ok = 0, done = 0;
+    while (msgbuf && !done) {
+        ssize_t n = recv(fd, msgbuf, NL_BUF_SIZE, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        int len = (int)n;
+        for (const struct nlmsghdr* nh = (const struct nlmsghdr*)msgbuf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_type == NLMSG_DONE) { ok = 1; done = 1; break; }
+            if (nh->nlmsg_type == NLMSG_ERROR) { done = 1; break; }
+            NeighborEntry e;
+            memset(&e, 0, sizeof(e));
+            if (nh->nlmsg_type == RTM_NEWNEIGH && parse_neigh(nh, &e) && !table_push(t, &cap, &e)) { done = 1; break; }
+        }
+    }
+    free(msgbuf);
+    close(fd);
+    if (!ok) { neighbor_table_free(t); return 0; }
+    table_finish(t);
+    return 1;
+}
+
+#else // !__linux__
+
+// No packet-socket backend: callers rely on the neighbor table and net_get_mac.
+ArpSweep* arp_sweep_start(unsigned long start_ip, unsigned long end_ip, int rate_pps, int timeout_ms,
+                          ArpReplyFn fn, void* user) {
+    (void)start_ip; (void)end_ip; (void)rate_pps; (void)timeout_ms; (void)fn; (void)user;
+    return 0;
+}
+void arp_sweep_range(const ArpSweep* sw, unsigned long* first, unsigned long* last) { (void)sw; *first = 1; *last = 0; }
+void arp_sweep_wait(ArpSweep* sw) { (void)sw; }
+int arp_sweep_done(const ArpSweep* sw) { (void)sw; return 1; }
+void arp_sweep_cancel(ArpSweep* sw) { (void)sw; }
+void arp_sweep_set_rate(ArpSweep* sw, int rate_pps) { (void)sw; (void)rate_pps; }
+int arp_sweep_get_mac(const ArpSweep* sw, unsigned long ip, uint8_t mac[6]) { (void)sw; (void)ip; (void)mac; return 0; }
+unsigned long arp_sweep_found_count(const ArpSweep* sw) { (void)sw; return 0; }
+void arp_sweep_destroy(ArpSweep* sw) { (void)sw; }
+
+#ifdef _WIN32
+
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
+#include <winsock2.h>
+#include <ws2ipdef.h>
+#include <windows.h>
+#include <iphlpapi.h>
+
+int neighbor_table_load(NeighborTable* t) {
+    t->items = NULL;
+    t->count = 0;
+    PMIB_IPNET_TABLE2 table = NULL;
+    if (GetIpNetTable2(AF_INET, &table) != NO_ERROR) return 0;
+    size_t cap = 0;
+    int ok = 1;
+    for (ULONG i = 0; i < table->NumEntries && ok; ++i) {
+        const MIB_IPNET_ROW2* row = &table->Table[i];
+        if (row->PhysicalAddressLength != 6) continue;
+        if (row->State == NlnsUnreachable || row->State == NlnsIncomplete) continue;
+        NeighborEntry e;
+        memset(&e, 0, sizeof(e));
+        e.ip = ntohl(row->Address.Ipv4.sin_addr.s_addr);
+        memcpy(e.mac, row->PhysicalAddress, 6);
+        e.reachable = (row->State == NlnsReachable) ? 1 : 0;
+        ok = table_push(t, &cap, &e);
+    }
+    FreeMibTable(table);
+    if (!ok) { neighbor_table_free(t); return 0; }
+    table_finish(t);
+    return 1;
+}
+
+#else
+
+int neighbor_table_load(NeighborTable* t) { t->items = NULL; t->count = 0; return 0; }
+
+#endif // _WIN32
+
+#endif
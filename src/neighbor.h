@@ -0,0 +1,64 @@
+#ifndef NEIGHBOR_H
+#define NEIGHBOR_H
+
+// Neighbor discovery: an ARP sweep of the on-link part of a range from one
+// packet socket, and a one-shot dump of the kernel's neighbor table.
+// Hosts that answer ARP are alive even when they drop ICMP.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ArpSweep ArpSweep;
+
+// Called from the receive thread, once per address, on its first reply.
+typedef void (*ArpReplyFn)(void* user, unsigned long ip, const uint8_t mac[6]);
+
+// Sends one ARP request per address of [start_ip, end_ip] that lies on a
+// directly attached Ethernet subnet, at 'rate_pps', and collects replies for
+// 'timeout_ms' after the last one. Returns NULL if the range is not on-link
+// (or spans more than 65536 addresses) or packet sockets are unavailable
+// (Linux, root or CAP_NET_RAW).
+ArpSweep* arp_sweep_start(unsigned long start_ip, unsigned long end_ip, int rate_pps, int timeout_ms,
+                          ArpReplyFn fn, void* user);
+
+// The addresses actually swept, a sub-range of the requested one.
+void arp_sweep_range(const ArpSweep* sw, unsigned long* first, unsigned long* last);
+void arp_sweep_wait(ArpSweep* sw);
+int arp_sweep_done(const ArpSweep* sw);
+void arp_sweep_cancel(ArpSweep* sw);
+void arp_sweep_set_rate(ArpSweep* sw, int rate_pps);
+
+// 1 if 'ip' answered; copies its MAC when 'mac' is not NULL. As with
+// icmp_sweep_is_alive, a 0 may still turn into 1 until the sweep is done.
+int arp_sweep_get_mac(const ArpSweep* sw, unsigned long ip, uint8_t mac[6]);
+unsigned long arp_sweep_found_count(const ArpSweep* sw);
+void arp_sweep_destroy(ArpSweep* sw);
+
+typedef struct {
+    uint32_t ip;       // host order
+    uint8_t mac[6];
+    uint8_t reachable; // confirmed recently, so the host is alive
+} NeighborEntry;
+
+typedef struct {
+    NeighborEntry* items; // sorted by ip
+    size_t count;
+} NeighborTable;
+
+// Snapshot of the kernel's IPv4 neighbor (ARP) entries that have a MAC:
+// rtnetlink on Linux, GetIpNetTable2 on Windows. Returns 0 on failure, with
+// 't' left empty. Free with neighbor_table_free.
+int neighbor_table_load(NeighborTable* t);
+const NeighborEntry* neighbor_table_find(const NeighborTable* t, unsigned long ip);
+void neighbor_table_free(NeighborTable* t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NEIGHBOR_H
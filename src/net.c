@@ -1,7 +1,12 @@
+#ifdef _WIN32
+
 #include "net.h"
+#include "metrics.h"
+#include "thread.h"
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #ifndef _WIN32_WINNT
 #define _WIN32_WINNT 0x0600
 #endif
@@ -20,37 +25,49 @@ void net_cleanup(void) {
     WSACleanup();
 }
 
-int net_ping_ipv4(const char* ip) {
+typedef HANDLE (WINAPI *IcmpCreateFile_t)(void);
+typedef DWORD  (WINAPI *IcmpSendEcho_t)(HANDLE, IPAddr, LPVOID, WORD, PIP_OPTION_INFORMATION, LPVOID, DWORD, DWORD);
+typedef BOOL   (WINAPI *IcmpCloseHandle_t)(HANDLE);
+
+// Icmp.dll is resolved once per process instead of on every ping.
+static INIT_ONCE g_icmpOnce = INIT_ONCE_STATIC_INIT;
+static IcmpCreateFile_t g_pIcmpCreateFile = NULL;
+static IcmpSendEcho_t g_pIcmpSendEcho = NULL;
+static IcmpCloseHandle_t g_pIcmpCloseHandle = NULL;
+
+static BOOL CALLBACK icmp_load_once(PINIT_ONCE once, PVOID param, PVOID* ctx) {
+    (void)once; (void)param; (void)ctx;
     HMODULE hIcmpMod = LoadLibraryA("Icmp.dll");
-    if (!hIcmpMod) return 0;
-    typedef HANDLE (WINAPI *IcmpCreateFile_t)(void);
-    typedef DWORD  (WINAPI *IcmpSendEcho_t)(HANDLE, IPAddr, LPVOID, WORD, PIP_OPTION_INFORMATION, LPVOID, DWORD, DWORD);
-    typedef BOOL   (WINAPI *IcmpCloseHandle_t)(HANDLE);
-    IcmpCreateFile_t pIcmpCreateFile = (IcmpCreateFile_t)GetProcAddress(hIcmpMod, "IcmpCreateFile");
-    IcmpSendEcho_t   pIcmpSendEcho   = (IcmpSendEcho_t)  GetProcAddress(hIcmpMod, "IcmpSendEcho");
-    IcmpCloseHandle_t pIcmpCloseHandle = (IcmpCloseHandle_t)GetProcAddress(hIcmpMod, "IcmpCloseHandle");
-    if (!pIcmpCreateFile || !pIcmpSendEcho || !pIcmpCloseHandle) { FreeLibrary(hIcmpMod); return 0; }
-
-    HANDLE hIcmp = pIcmpCreateFile();
-    if (hIcmp == INVALID_HANDLE_VALUE) { FreeLibrary(hIcmpMod); return 0; }
+    if (!hIcmpMod) return TRUE;
+    g_pIcmpCreateFile = (IcmpCreateFile_t)GetProcAddress(hIcmpMod, "IcmpCreateFile");
+    g_pIcmpSendEcho   = (IcmpSendEcho_t)  GetProcAddress(hIcmpMod, "IcmpSendEcho");
+    g_pIcmpCloseHandle = (IcmpCloseHandle_t)GetProcAddress(hIcmpMod, "IcmpCloseHandle");
+    if (!g_pIcmpCreateFile || !g_pIcmpSendEcho || !g_pIcmpCloseHandle) {
+        g_pIcmpCreateFile = NULL; g_pIcmpSendEcho = NULL; g_pIcmpCloseHandle = NULL;
+        FreeLibrary(hIcmpMod);
+    }
+    return TRUE; // module stays loaded for the life of the process
+}
 
-    char SendData[] = "ping";
-    DWORD ReplySize = sizeof(ICMP_ECHO_REPLY) + sizeof(SendData);
-    char* ReplyBuffer = (char*)malloc(ReplySize);
-    if (!ReplyBuffer) { pIcmpCloseHandle(hIcmp); FreeLibrary(hIcmpMod); return 0; }
+int net_ping_ipv4(const char* ip) { return net_ping_ipv4_timeout(ip, 1000); }
+
+int net_ping_ipv4_timeout(const char* ip, int timeout_ms) {
+    InitOnceExecuteOnce(&g_icmpOnce, icmp_load_once, NULL, NULL);
+    if (!g_pIcmpCreateFile) return 0;
 
-    IPAddr addr = 0;
     struct in_addr inaddr;
     inaddr.S_un.S_addr = inet_addr(ip);
-    if (inaddr.S_un.S_addr == INADDR_NONE && strcmp(ip, "255.255.255.255") != 0) { free(ReplyBuffer); IcmpCloseHandle(hIcmp); return 0; }
-    addr = inaddr.S_un.S_addr;
-
-    DWORD dwRet = pIcmpSendEcho(hIcmp, addr, SendData, sizeof(SendData), NULL, ReplyBuffer, ReplySize, 1000);
-    int ok = (dwRet != 0);
-    free(ReplyBuffer);
-    pIcmpCloseHandle(hIcmp);
-    FreeLibrary(hIcmpMod);
-    return ok;
+    if (inaddr.S_un.S_addr == INADDR_NONE && strcmp(ip, "255.255.255.255") != 0) return 0;
+    IPAddr addr = inaddr.S_un.S_addr;
+
+    HANDLE hIcmp = g_pIcmpCreateFile();
+    if (hIcmp == INVALID_HANDLE_VALUE) return 0;
+
+    char SendData[] = "ping";
+    char ReplyBuffer[sizeof(ICMP_ECHO_REPLY) + sizeof(SendData) + 8];
+    DWORD dwRet = g_pIcmpSendEcho(hIcmp, addr, SendData, sizeof(SendData), NULL, ReplyBuffer, sizeof(ReplyBuffer), (DWORD)(timeout_ms > 0 ? timeout_ms : 1000));
+    g_pIcmpCloseHandle(hIcmp);
+    return dwRet != 0;
 }
 
 int net_reverse_dns(const char* ip, char* hostname, size_t hostsz) {
@@ -94,8 +111,15 @@ static int connect_with_timeout(const char* ip, int port, int timeout_ms) {
     sa.sin_port = htons(port);
     sa.sin_addr.S_un.S_addr = inet_addr(ip);
 
+    metrics_inc(METRIC_TCP_PROBES);
+    unsigned long long t0 = clock_monotonic_ns();
     int r = connect(s, (struct sockaddr*)&sa, sizeof(sa));
-    if (r == 0) { closesocket(s); return 1; }
+    if (r == 0) {
+        metrics_inc(METRIC_TCP_OPEN);
+        metrics_record_us(METRIC_LAT_TCP, (clock_monotonic_ns() - t0) / 1000);
+        closesocket(s);
+        return 1;
+    }
 
     if (WSAGetLastError() == WSAEWOULDBLOCK) {
         fd_set wfds; FD_ZERO(&wfds); FD_SET(s, &wfds);
@@ -105,18 +129,42 @@ static int connect_with_timeout(const char* ip, int port, int timeout_ms) {
             int err = 0; int len = sizeof(err);
             getsockopt(s, SOL_SOCKET, SO_ERROR, (char*)&err, &len);
             closesocket(s);
+            unsigned long long rtt_us = (clock_monotonic_ns() - t0) / 1000;
+            metrics_inc(err == 0 ? METRIC_TCP_OPEN : METRIC_TCP_CLOSED);
+            metrics_record_us(METRIC_LAT_TCP, rtt_us);
+            if (err == 0 || err == WSAECONNREFUSED) timing_observe(ntohl(sa.sin_addr.S_un.S_addr), (uint32_t)rtt_us);
             return err == 0;
         }
+        if (r == 0) metrics_inc(METRIC_TCP_TIMEOUTS);
+        else metrics_inc(METRIC_TCP_CLOSED);
+    } else {
+        metrics_inc(METRIC_TCP_CLOSED);
     }
     closesocket(s);
     return 0;
 }
 
 int net_scan_ports(const char* ip, const int* ports, int ports_count, int timeout_ms, int* open_ports, int* open_count) {
+    return net_scan_ports_paced(ip, ports, ports_count, timeout_ms, NULL, NULL, open_ports, open_count);
+}
+
+// Probes are serial here, so there is no window to share.
+int net_scan_ports_paced(const char* ip, const int* ports, int ports_count, int timeout_ms, Pacer* pacer,
+                         TimingWindow* window, int* open_ports, int* open_count) {
+    return net_scan_services_paced(ip, ports, ports_count, timeout_ms, 0, pacer, window, open_ports, NULL, open_count);
+}
+
+// The serial path does not read banners yet: every service is reported unknown.
+int net_scan_services_paced(const char* ip, const int* ports, int ports_count, int timeout_ms, int wait_ms,
+                            Pacer* pacer, TimingWindow* window, int* open_ports,
+                            const struct ServiceSignature** services, int* open_count) {
+    (void)window; (void)wait_ms;
     int found = 0;
     for (int i = 0; i < ports_count; ++i) {
+        if (!pacer_acquire(pacer, 1)) break;
         if (connect_with_timeout(ip, ports[i], timeout_ms)) {
             if (open_ports && open_count) {
+                if (services) services[*open_count] = NULL;
                 open_ports[*open_count] = ports[i];
                 (*open_count)++;
             }
@@ -126,6 +174,24 @@ int net_scan_ports(const char* ip, const int* ports, int ports_count, int timeou
     return found;
 }
 
+// No asynchronous connect backend on Windows yet: probe serially.
+int net_scan_range_ports(unsigned long start_ip, unsigned long end_ip, const int* ports, int ports_count,
+                         int timeout_ms, int window, NetPortResultFn fn, void* user) {
+    (void)window;
+    int found = 0;
+    char ipbuf[64];
+    for (unsigned long ip = start_ip; ip <= end_ip && ip >= start_ip; ++ip) {
+        uint_to_ip(ip, ipbuf, sizeof(ipbuf));
+        for (int i = 0; i < ports_count; ++i) {
+            int open = connect_with_timeout(ipbuf, ports[i], timeout_ms);
+            if (open) found++;
+            if (fn) fn(user, ip, ports[i], open);
+        }
+        if (ip == 0xFFFFFFFFul) break;
+    }
+    return found;
+}
+
 int net_get_primary_subnet(SubnetV4* out) {
     ULONG flags = GAA_FLAG_INCLUDE_PREFIX;
     ULONG size = 0;
@@ -161,4 +227,6 @@ int net_get_primary_subnet(SubnetV4* out) {
     }
     free(addrs);
     return 0;
-}
\ No newline at end of file
+}
+
+#endif // _WIN32
@@ -2,6 +2,8 @@
 #define NET_H
 
 #include "app.h"
+#include "pacer.h"
+#include "timing.h"
 // Avoid including Windows SDK headers here; keep this header lightweight
 // to prevent symbol conflicts in UI translation units.
 
@@ -19,10 +21,34 @@ extern "C" {
 int net_init(void);
 void net_cleanup(void);
 
-int net_ping_ipv4(const char* ip);
+int net_ping_ipv4(const char* ip); // waits up to 1 s
+int net_ping_ipv4_timeout(const char* ip, int timeout_ms);
 int net_reverse_dns(const char* ip, char* hostname, size_t hostsz);
 int net_get_mac(const char* ip, char* macbuf, size_t macsz);
+// Appends each open port to open_ports[*open_count] in the order of
+// 'ports', so 'open_ports' needs room for 'ports_count' more entries.
 int net_scan_ports(const char* ip, const int* ports, int ports_count, int timeout_ms, int* open_ports, int* open_count);
+// Same, taking one token from 'pacer' before each connect (NULL = unpaced)
+// and holding a slot of 'window' while it is in flight (NULL = none; see
+// conn_engine_set_window). Stops early, reporting what was found so far, if
+// the pacer or window is closed.
+int net_scan_ports_paced(const char* ip, const int* ports, int ports_count, int timeout_ms, Pacer* pacer,
+                         TimingWindow* window, int* open_ports, int* open_count);
+// Same, and names what listens on each open port: services[k] is the
+// service.h signature its banner matched (NULL = unknown) for open_ports[k],
+// so 'services' needs the same room. Each open socket is read for up to
+// 'wait_ms', and as long again after a probe if the service stays silent.
+struct ServiceSignature;
+int net_scan_services_paced(const char* ip, const int* ports, int ports_count, int timeout_ms, int wait_ms,
+                            Pacer* pacer, TimingWindow* window, int* open_ports,
+                            const struct ServiceSignature** services, int* open_count);
+
+// Probes every (ip, port) pair of [start_ip, end_ip] x ports (host-order IPs),
+// keeping up to 'window' connects in flight. 'fn' is called once per probe as
+// it completes, in completion order. Returns the number of open ports found.
+typedef void (*NetPortResultFn)(void* user, unsigned long ip, int port, int open);
+int net_scan_range_ports(unsigned long start_ip, unsigned long end_ip, const int* ports, int ports_count,
+                         int timeout_ms, int window, NetPortResultFn fn, void* user);
 
 int net_get_primary_subnet(SubnetV4* out);
 #ifdef __cplusplus
@@ -0,0 +1,294 @@
+// POSIX/Linux implementation of net.h. The Windows build uses net.c.
+#ifndef _WIN32
+
+#include "net.h"
+#include "utils.h"
+#include "conn_engine.h"
+#include "metrics.h"
+#include "service.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+
+int net_init(void) {
+    // A peer resetting a probe socket must not kill the process.
+    signal(SIGPIPE, SIG_IGN);
+    return 1;
+}
+
+void net_cleanup(void) {
+}
+
+static long long mono_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static unsigned short icmp_checksum(const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    unsigned long sum = 0;
+    while (len > 1) { sum += (unsigned long)((p[0] << 8) | p[1]); p += 2; len -= 2; }
+    if (len) sum += (unsigned long)(p[0] << 8);
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return htons((unsigned short)~sum);
+}
+
+// Single echo over an unprivileged ICMP datagram socket
+// (net.ipv4.ping_group_range), falling back to a raw socket.
+int net_ping_ipv4(const char* ip) { return net_ping_ipv4_timeout(ip, 1000); }
+
+int net_ping_ipv4_timeout(const char* ip, int timeout_ms) {
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    if (inet_pton(AF_INET, ip, &sa.sin_addr) != 1) return 0;
+
+    int raw = 0;
+    int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+    if (s < 0) { s = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP); raw = 1; }
+    if (s < 0) return 0;
+
+    unsigned short id = (unsigned short)(getpid() & 0xFFFF);
+    unsigned char pkt[sizeof(struct icmphdr) + 4];
+    memset(pkt, 0, sizeof(pkt));
+    struct icmphdr* h = (struct icmphdr*)pkt;
+    h->type = ICMP_ECHO;
+    h->un.echo.id = htons(id);
+    h->un.echo.sequence = htons(1);
+    memcpy(pkt + sizeof(struct icmphdr), "ping", 4);
+    h->checksum = icmp_checksum(pkt, sizeof(pkt));
+
+    if (sendto(s, pkt, sizeof(pkt), 0, (struct sockaddr*)&sa, sizeof(sa)) < 0) { close(s); return 0; }
+
+    int ok = 0;
+    long long deadline = mono_ms() + (timeout_ms > 0 ? timeout_ms : 1000);
+    while (!ok) {
+        long long remaining = deadline - mono_ms();
+        if (remaining <= 0) break;
+        struct pollfd pfd; pfd.fd = s; pfd.events = POLLIN; pfd.revents = 0;
+        int r = poll(&pfd, 1, (int)remaining);
+        if (r <= 0) break;
+        unsigned char buf[1500];
+        struct sockaddr_in from; socklen_t fl = sizeof(from);
+        ssize_t n = recvfrom(s, buf, sizeof(buf), 0, (struct sockaddr*)&from, &fl);
+        if (n <= 0) break;
+        if (from.sin_addr.s_addr != sa.sin_addr.s_addr) continue;
+        const unsigned char* icmp = buf;
+        if (raw) {
+            size_t ihl = (size_t)(buf[0] & 0x0F) * 4;
+            if ((size_t)n < ihl + sizeof(struct icmphdr)) continue;
+            icmp = buf + ihl;
+            const struct icmphdr* rh = (const struct icmphdr*)icmp;
+            if (rh->type == ICMP_ECHOREPLY && ntohs(rh->un.echo.id) == id) ok = 1;
+        } else {
+            // The kernel rewrites the identifier for datagram sockets.
+            const struct icmphdr* rh = (const struct icmphdr*)icmp;
+            if ((size_t)n >= sizeof(struct icmphdr) && rh->type == ICMP_ECHOREPLY) ok = 1;
+        }
+    }
+    close(s);
+    return ok;
+}
+
+int net_reverse_dns(const char* ip, char* hostname, size_t hostsz) {
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    if (inet_pton(AF_INET, ip, &sa.sin_addr) != 1) { hostname[0] = '\0'; return 0; }
+    char host[NI_MAXHOST];
+    if (getnameinfo((struct sockaddr*)&sa, sizeof(sa), host, sizeof(host), NULL, 0, NI_NAMEREQD) == 0) {
+        safe_strcpy(hostname, hostsz, host);
+        return 1;
+    }
+    hostname[0] = '\0';
+    return 0;
+}
+
+// Reads the kernel ARP cache; entries exist for hosts we recently talked to
+// (the ping that precedes this call populates it on-link).
+int net_get_mac(const char* ip, char* macbuf, size_t macsz) {
+    FILE* f = fopen("/proc/net/arp", "r");
+    if (!f) return 0;
+    char line[256];
+    int found = 0;
+    if (!fgets(line, sizeof(line), f)) { fclose(f); return 0; } // header
+    while (fgets(line, sizeof(line), f)) {
+        char addr[64], hw[64];
+        unsigned int type = 0, flags = 0;
+        if (sscanf(line, "%63s 0x%x 0x%x %63s", addr, &type, &flags, hw) != 4) continue;
+        if (strcmp(addr, ip) != 0 || !(flags & 0x2)) continue; // ATF_COM: resolved
+        unsigned int m[6];
+        if (sscanf(hw, "%x:%x:%x:%x:%x:%x", &m[0], &m[1], &m[2], &m[3], &m[4], &m[5]) != 6) continue;
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%02X-%02X-%02X-%02X-%02X-%02X", m[0], m[1], m[2], m[3], m[4], m[5]);
+        safe_strcpy(macbuf, macsz, buf);
+        found = 1;
+        break;
+    }
+    fclose(f);
+    return found;
+}
+
+// Connects in flight per host: a full-range scan of one host must not take
+// 65535 descriptors.
+#define HOST_PORT_WINDOW 256
+
+typedef struct {
+    int port;
+    const ServiceSignature* sig;
+} PortService;
+
+typedef struct {
+    uint64_t open_bits[65536 / 64]; // by port number
+    int found;
+    PortService* ids;               // identified services, in completion order
+    int ids_count, ids_cap;
+} HostPortsCtx;
+
+static void on_host_banner(void* user, unsigned long ip, int port, const unsigned char* data, size_t len) {
+    (void)ip;
+    HostPortsCtx* ctx = (HostPortsCtx*)user;
+    const ServiceSignature* sig = service_identify(data, len);
+    if (!sig) return;
+    metrics_inc(METRIC_SERVICES_MATCHED);
+    if (ctx->ids_count == ctx->ids_cap) {
+        int ncap = ctx->ids_cap ? ctx->ids_cap * 2 : 16;
+        PortService* n = (PortService*)realloc(ctx->ids, sizeof(PortService) * (size_t)ncap);
+        if (!n) return;
+        ctx->ids = n;
+        ctx->ids_cap = ncap;
+    }
+    ctx->ids[ctx->ids_count].port = port;
+    ctx->ids[ctx->ids_count].sig = sig;
+    ctx->ids_count++;
+}
+
+static const ServiceSignature* host_port_service(const HostPortsCtx* ctx, int port) {
+    for (int i = 0; i < ctx->ids_count; ++i) {
+        if (ctx->ids[i].port == port) return ctx->ids[i].sig;
+    }
+    return NULL;
+}
+
+static void on_host_port(void* user, unsigned long ip, int port, int open) {
+    (void)ip;
+    HostPortsCtx* ctx = (HostPortsCtx*)user;
+    if (!open || port < 0 || port > 65535) return;
+    uint64_t bit = 1ull << (port & 63);
+    if (ctx->open_bits[port >> 6] & bit) return;
+    ctx->open_bits[port >> 6] |= bit;
+    ctx->found++;
+}
+
+// All ports of the host are probed concurrently; results keep the order of 'ports'.
+int net_scan_ports(const char* ip, const int* ports, int ports_count, int timeout_ms, int* open_ports, int* open_count) {
+    return net_scan_ports_paced(ip, ports, ports_count, timeout_ms, NULL, NULL, open_ports, open_count);
+}
+
+int net_scan_ports_paced(const char* ip, const int* ports, int ports_count, int timeout_ms, Pacer* pacer,
+                         TimingWindow* window, int* open_ports, int* open_count) {
+    return net_scan_services_paced(ip, ports, ports_count, timeout_ms, 0, pacer, window, open_ports, NULL, open_count);
+}
+
+// 'services' NULL skips the banners.
+int net_scan_services_paced(const char* ip, const int* ports, int ports_count, int timeout_ms, int wait_ms,
+                            Pacer* pacer, TimingWindow* window, int* open_ports,
+                            const ServiceSignature** services, int* open_count) {
+    unsigned long addr = 0;
+    if (ports_count <= 0 || !ip_to_uint(ip, &addr)) return 0;
+    ConnEngine* ce = conn_engine_create(ports_count < HOST_PORT_WINDOW ? ports_count : HOST_PORT_WINDOW, timeout_ms);
+    if (!ce) return 0;
+    HostPortsCtx* ctx = (HostPortsCtx*)calloc(1, sizeof(HostPortsCtx));
+    if (!ctx) { conn_engine_destroy(ce); return 0; }
+    conn_engine_set_window(ce, window);
+    // Without a banner buffer the ports are still scanned, just not named.
+    if (services) conn_engine_set_banner(ce, wait_ms, on_host_banner);
+    for (int i = 0; i < ports_count; ++i) {
+        if (!pacer_acquire(pacer, 1)) break;
+        conn_engine_submit(ce, addr, ports[i], on_host_port, ctx);
+    }
+    conn_engine_drain(ce);
+    conn_engine_destroy(ce);
+    if (open_ports && open_count) {
+        for (int i = 0; i < ports_count; ++i) {
+            int port = ports[i];
+            if (port < 0 || port > 65535) continue;
+            uint64_t bit = 1ull << (port & 63);
+            if (!(ctx->open_bits[port >> 6] & bit)) continue;
+            ctx->open_bits[port >> 6] &= ~bit; // a port listed twice is reported once
+            if (services) services[*open_count] = host_port_service(ctx, port);
+            open_ports[*open_count] = port;
+            (*open_count)++;
+        }
+    }
+    int found = ctx->found;
+    free(ctx->ids);
+    free(ctx);
+    return found;
+}
+
+typedef struct {
+    NetPortResultFn fn;
+    void* user;
+    int found;
+} RangePortsCtx;
+
+static void on_range_port(void* user, unsigned long ip, int port, int open) {
+    RangePortsCtx* ctx = (RangePortsCtx*)user;
+    if (open) ctx->found++;
+    if (ctx->fn) ctx->fn(ctx->user, ip, port, open);
+}
+
+int net_scan_range_ports(unsigned long start_ip, unsigned long end_ip, const int* ports, int ports_count,
+                         int timeout_ms, int window, NetPortResultFn fn, void* user) {
+    if (ports_count <= 0 || end_ip < start_ip) return 0;
+    ConnEngine* ce = conn_engine_create(window, timeout_ms);
+    if (!ce) return 0;
+    RangePortsCtx ctx; ctx.fn = fn; ctx.user = user; ctx.found = 0;
+    // Port-major order spreads consecutive probes across hosts.
+    for (int i = 0; i < ports_count; ++i) {
+        for (unsigned long ip = start_ip; ip <= end_ip; ++ip) {
+            conn_engine_submit(ce, ip, ports[i], on_range_port, &ctx);
+            if (ip == 0xFFFFFFFFul) break;
+        }
+    }
+    conn_engine_drain(ce);
+    conn_engine_destroy(ce);
+    return ctx.found;
+}
+
+int net_get_primary_subnet(SubnetV4* out) {
+    struct ifaddrs* ifs = NULL;
+    if (getifaddrs(&ifs) != 0) return 0;
+    int ok = 0;
+    for (struct ifaddrs* cur = ifs; cur && !ok; cur = cur->ifa_next) {
+        if (!cur->ifa_addr || cur->ifa_addr->sa_family != AF_INET || !cur->ifa_netmask) continue;
+        if (!(cur->ifa_flags & IFF_UP) || (cur->ifa_flags & IFF_LOOPBACK)) continue;
+        unsigned long ip = ntohl(((struct sockaddr_in*)cur->ifa_addr)->sin_addr.s_addr);
+        unsigned long mask = ntohl(((struct sockaddr_in*)cur->ifa_netmask)->sin_addr.s_addr);
+        unsigned long network = ip & mask;
+        out->network = network;
+        out->mask = mask;
+        out->start_ip = network + 1;
+        out->end_ip = (network | (~mask & 0xFFFFFFFFul)) - 1;
+        ok = 1;
+    }
+    freeifaddrs(ifs);
+    return ok;
+}
+
+#endif // !_WIN32
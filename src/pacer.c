@@ -0,0 +1,88 @@
+#include "pacer.h"
+#include "metrics.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+// GCRA form of the token bucket: 'tat' is the virtual time at which the
+// bucket is empty again. A reservation of n packets starts at
+// max(tat, now - burst * interval) and moves tat forward by n intervals; it
+// is a single CAS, so no lock and no reset race.
+struct Pacer {
+    atomic_ullong tat;         // theoretical arrival time (monotonic ns)
+    atomic_ullong interval_ns; // 0 = unlimited
+    atomic_int rate_pps;
+    atomic_int closed;
+    int burst;
+};
+
+#define SLEEP_SLICE_NS 20000000ull // bounds how long pacer_close takes to be seen
+
+static unsigned long long rate_to_interval(int rate_pps) {
+    return rate_pps > 0 ? 1000000000ull / (unsigned long long)rate_pps : 0;
+}
+
+Pacer* pacer_create(int rate_pps, int burst) {
+    Pacer* p = (Pacer*)calloc(1, sizeof(Pacer));
+    if (!p) return NULL;
+    atomic_init(&p->tat, 0);
+    atomic_init(&p->interval_ns, rate_to_interval(rate_pps));
+    atomic_init(&p->rate_pps, rate_pps > 0 ? rate_pps : 0);
+    atomic_init(&p->closed, 0);
+    p->burst = burst > 0 ? burst : 1;
+    return p;
+}
+
+void pacer_destroy(Pacer* p) { free(p); }
+
+void pacer_set_rate(Pacer* p, int rate_pps) {
+    if (!p) return;
+    atomic_store(&p->rate_pps, rate_pps > 0 ? rate_pps : 0);
+    atomic_store(&p->interval_ns, rate_to_interval(rate_pps));
+}
+
+int pacer_rate(const Pacer* p) { return p ? atomic_load(&((Pacer*)p)->rate_pps) : 0; }
+
+// Reserves n packets; returns the time they may be sent. With 'now_only' set,
+// fails (returns 0) instead of reserving a slot in the future.
+static unsigned long long reserve(Pacer* p, int n, int now_only) {
+    unsigned long long now = clock_monotonic_ns();
+    unsigned long long interval = atomic_load_explicit(&p->interval_ns, memory_order_relaxed);
+    if (interval == 0) return now;
+    unsigned long long slack = interval * (unsigned long long)p->burst;
+    unsigned long long floor = now > slack ? now - slack : 0;
+    unsigned long long tat = atomic_load_explicit(&p->tat, memory_order_relaxed);
+    for (;;) {
+        unsigned long long start = tat > floor ? tat : floor;
+        if (now_only && start > now) return 0;
+        unsigned long long next = start + interval * (unsigned long long)n;
+        if (atomic_compare_exchange_weak_explicit(&p->tat, &tat, next, memory_order_relaxed, memory_order_relaxed)) {
+            return start > now ? start : now;
+        }
+    }
+}
+
+int pacer_acquire(Pacer* p, int n) {
+    if (!p) return 1;
+    if (atomic_load(&p->closed)) return 0;
+    unsigned long long at = reserve(p, n > 0 ? n : 1, 0);
+    unsigned long long t0 = 0;
+    for (;;) {
+        unsigned long long now = clock_monotonic_ns();
+        if (t0 == 0) t0 = now;
+        if (now >= at || atomic_load(&p->closed)) {
+            if (now > t0) metrics_add(METRIC_PACER_WAIT_NS, now - t0);
+            return now >= at;
+        }
+        unsigned long long left = at - now;
+        thread_sleep_ns(left > SLEEP_SLICE_NS ? SLEEP_SLICE_NS : left);
+    }
+}
+
+int pacer_try_acquire(Pacer* p, int n) {
+    if (!p) return 1;
+    if (atomic_load(&p->closed)) return 0;
+    return reserve(p, n > 0 ? n : 1, 1) != 0;
+}
+
+void pacer_close(Pacer* p) { if (p) atomic_store(&p->closed, 1); }
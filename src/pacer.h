@@ -0,0 +1,43 @@
+#ifndef PACER_H
+#define PACER_H
+
+// Packet pacer: a lock-free token bucket shared by any number of threads.
+// Senders reserve a slot on a virtual clock and sleep until it comes up, so
+// traffic leaves evenly spaced at the configured rate with no spinning.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Pacer Pacer;
+
+// Enough slack to absorb sleep overshoot at typical scan rates.
+#define PACER_DEFAULT_BURST 16
+
+// 'rate_pps' <= 0 means unlimited. 'burst' packets may go back to back after
+// an idle period (at least 1).
+Pacer* pacer_create(int rate_pps, int burst);
+void pacer_destroy(Pacer* p);
+
+// Takes effect for the next reservation; may be called while others wait.
+void pacer_set_rate(Pacer* p, int rate_pps);
+int pacer_rate(const Pacer* p);
+
+// Blocks until 'n' packets may be sent. Returns 1 when they may go, 0 if the
+// pacer was closed meanwhile. A NULL pacer never blocks.
+int pacer_acquire(Pacer* p, int n);
+
+// Non-blocking variant for event loops: returns 1 and takes the tokens if
+// they are available now, otherwise 0.
+int pacer_try_acquire(Pacer* p, int n);
+
+// Makes waiters return 0 within a few milliseconds and later calls return 0
+// at once. Used to cancel a scan without waiting out its budget.
+void pacer_close(Pacer* p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PACER_H
@@ -1,124 +1,1236 @@
 #include "parallel_scan.h"
+#include "checkpoint.h"
+#include "conn_engine.h"
 #include "net.h"
+#include "icmp_sweep.h"
+#include "syn_scan.h"
+#include "dns_resolver.h"
+#include "neighbor.h"
+#include "event_log.h"
+#include "metrics.h"
 #include "utils.h"
+#include "thread.h"
+#include "pacer.h"
+#include "timing.h"
+#include "target_order.h"
+#include "port_set.h"
+#include "service.h"
+#include "string_arena.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#ifndef _WIN32_WINNT
-#define _WIN32_WINNT 0x0600
-#endif
-#include <windows.h>
+
+// The scan is a pipeline of stages. Liveness draws addresses from a shared
+// counter over the target order (or from the ICMP and ARP sweeps); hosts that answer fan out into DNS, MAC
+// and port tasks that run in parallel. Dead hosts leave after liveness.
+// A DNS task only queues a query on the asynchronous resolver; its answer
+// completes the task from the resolver thread. A port worker keeps one
+// connect engine for the whole scan and feeds it the ports of as many hosts
+// as its window holds, finishing each host as its last probe reports.
+// Each stage has per-worker deques and a concurrency limit; an idle worker
+// steals from the other workers' deques of the same stage.
+// Every scan is a session; the worker threads belong to a pool shared by all
+// sessions, and each worker takes a turn at every running session in each
+// round. The parallel_scan_* calls drive one default session.
+enum {
+    STAGE_LIVENESS = SCAN_STAGE_LIVENESS,
+    STAGE_DNS = SCAN_STAGE_DNS,
+    STAGE_MAC = SCAN_STAGE_MAC,
+    STAGE_PORTS = SCAN_STAGE_PORTS,
+    STAGE_COUNT = SCAN_STAGE_COUNT
+};
+#define QUEUED_STAGES (STAGE_COUNT - 1) // liveness is fed by the address counter
+
+#define MAX_WORKERS 256
+#define MAX_SESSIONS 64 // running at once
+#define ADDR_BATCH 64 // order positions claimed per counter bump
+#define LOG_CHUNK 4096 // results per log chunk
+#define ARP_REPLY_WAIT_MS 300 // on-link hosts answer ARP within milliseconds
+#define TCP_WINDOW_INITIAL 64 // connect probes in flight before any reply (adaptive timing)
+#define TCP_WINDOW_MIN 8
+#define PORT_ENGINE_WINDOW 256 // connects in flight per port worker
+
+typedef struct {
+    DeviceInfo info;
+    struct ScanSession* session;
+    atomic_int remaining; // queued stages left; the last one publishes
+} HostJob;
 
 typedef struct {
+    Mutex lock;
+    HostJob** items; // ring buffer
+    int cap, head;
+    atomic_int count; // written under 'lock'; read unlocked by thieves peeking
+} TaskDeque;
+
+// Append-only result log. Entries never move or change once written, so
+// readers copy [since, published) without taking the writers' lock. The
+// chunk directory is sized for the whole range up front and never grows.
+typedef struct {
+    DeviceInfo** chunks;
+    size_t max_chunks;
+    size_t count;            // entries written, under results_lock
+    atomic_size_t published; // entries readers may copy; the generation
+} ResultLog;
+
+struct ScanSession {
+    int initialized; // locks and the result log exist from a previous scan
+    int started;     // registered with the pool until stop
     unsigned long start_ip;
     unsigned long end_ip;
-    volatile LONG next_ip; // atomic counter
-    volatile LONG cancel;
+    TargetOrder order;       // address order, shared with the ICMP sweep
+    atomic_ullong next_pos;  // position in 'order' feeding the liveness stage
+    atomic_int cancel;
+    atomic_int finished; // set once, by the worker that sees the scan complete or by stop
+    atomic_int users;    // pool workers inside this session right now
     ScanConfig cfg;
-    DeviceList results;
-    CRITICAL_SECTION results_lock;
-    ScanLogFn logger;
+    PortSet ports;          // cfg.ports, compiled at start
+    ResultLog log;
+    Mutex results_lock;     // serializes writers only
+    ScanResultFn result_fn; // streaming mode: replaces the log
+    void* result_user;
+    ScanLogFn logger;       // start-up messages only; workers use the event log
+    IcmpSweep* sweep; // range-wide liveness, NULL if unsupported
+    ArpSweep* arp;    // on-link part of the range, NULL if unsupported
+    // SYN mode: one SYN scan covers the ports of the whole range. A reply
+    // proves its host alive; port tasks wait for the scan and read the
+    // open ports it found. NULL with connect probes.
+    SynScan* syn;
+    Mutex syn_lock;          // the receive thread's appends vs. the sort
+    atomic_uchar* syn_seen;  // one bit per address: answered a SYN
+    uint64_t* syn_hits;      // open ports as offset << 16 | port
+    size_t syn_hits_count, syn_hits_cap;
+    atomic_int syn_state;    // 0 scanning, 1 sorting, 2 hits sorted
+    NeighborTable neigh;   // kernel ARP cache, loaded once the sweeps are done
+    atomic_int neigh_state; // 0 not loaded, 1 loading, 2 loaded
+    DnsResolver* dns; // NULL: DNS tasks block in net_reverse_dns
+    int pool_workers; // pool size when the scan started
+    ConnEngine** port_engines; // [pool_workers], each created by its worker on first use
+    // Deques: one row per pool worker plus one injection row for the sweep thread.
+    TaskDeque* queues; // [num_queues][QUEUED_STAGES]
+    int num_queues;
+    atomic_int active[STAGE_COUNT];
+    int limit[STAGE_COUNT];
+    atomic_int hosts_in_flight; // alive hosts not yet published
+    // Progress for checkpoints, one bit per address of the range; NULL if
+    // the range is larger than CHECKPOINT_MAX_ADDRESSES. Kept until the
+    // next start so a stopped scan can still be saved.
+    atomic_ullong* done_bits;  // result published
+    atomic_ullong* alive_bits; // entered the DNS/MAC/port stages
+    size_t bit_words;
+    // Packet budgets shared by all workers (the sweep paces its own echoes).
+    Pacer* icmp_pacer; // per-host pings when there is no sweep
+    Pacer* tcp_pacer;  // connect probes
+    Pacer* dns_pacer;  // reverse lookups without the resolver
+    TimingWindow* tcp_window; // connect probes in flight; NULL with fixed timing
+    int tcp_window_final;     // its size when the scan was reaped
+    // Instrumentation: process-wide metrics at start, subtracted by stats.
+    MetricsSnapshot metrics_base;
+    unsigned long long start_ns;
+    atomic_ullong end_ns; // set with 'finished'
+};
+
+// Worker threads shared by every session: started with the first session
+// and stopped when the last one is. 'life' serializes starting and stopping
+// sessions; 'lock' guards the session list the workers read.
+typedef struct {
+    Mutex life;
+    Mutex lock;
+    ScanSession* sessions[MAX_SESSIONS];
+    int count;
+    Thread threads[MAX_WORKERS];
     int num_threads;
-    HANDLE threads[64];
-    // Simple rate limiter: devices per second
-    volatile LONG rate_count;
-    ULONGLONG rate_window_start;
-    LONG rate_limit;
-} ScanState;
+    atomic_int stop;
+    Mutex idle_lock; // initialized with the threads
+    CondVar work_cv;
+} WorkerPool;
+
+static WorkerPool g_pool = { .life = MUTEX_INITIALIZER, .lock = MUTEX_INITIALIZER };
+static ScanSession* g_default; // the parallel_scan_* session
+
+static TaskDeque* queue_at(ScanSession* st, int row, int stage) {
+    return &st->queues[row * QUEUED_STAGES + (stage - 1)];
+}
+
+static int deque_push(TaskDeque* q, HostJob* job) {
+    mutex_lock(&q->lock);
+    int count = atomic_load_explicit(&q->count, memory_order_relaxed);
+    if (count == q->cap) {
+        int ncap = q->cap ? q->cap * 2 : 64;
+        HostJob** nitems = (HostJob**)malloc(sizeof(HostJob*) * (size_t)ncap);
+        if (!nitems) { mutex_unlock(&q->lock); return 0; }
+        for (int i = 0; i < count; ++i) nitems[i] = q->items[(q->head + i) % q->cap];
+        free(q->items);
+        q->items = nitems; q->cap = ncap; q->head = 0;
+    }
+    q->items[(q->head + count) % q->cap] = job;
+    atomic_store_explicit(&q->count, count + 1, memory_order_relaxed);
+    mutex_unlock(&q->lock);
+    return 1;
+}
+
+// Owner end: newest first, keeps a host's data warm on the thread that made it.
+static HostJob* deque_pop(TaskDeque* q) {
+    HostJob* job = NULL;
+    if (atomic_load_explicit(&q->count, memory_order_relaxed) == 0) return NULL;
+    mutex_lock(&q->lock);
+    int count = atomic_load_explicit(&q->count, memory_order_relaxed);
+    if (count > 0) {
+        job = q->items[(q->head + count - 1) % q->cap];
+        atomic_store_explicit(&q->count, count - 1, memory_order_relaxed);
+    }
+    mutex_unlock(&q->lock);
+    return job;
+}
+
+// Thief end: oldest first.
+static HostJob* deque_steal(TaskDeque* q) {
+    HostJob* job = NULL;
+    if (atomic_load_explicit(&q->count, memory_order_relaxed) == 0) return NULL; // rechecked under the lock
+    mutex_lock(&q->lock);
+    int count = atomic_load_explicit(&q->count, memory_order_relaxed);
+    if (count > 0) {
+        job = q->items[q->head];
+        q->head = (q->head + 1) % q->cap;
+        atomic_store_explicit(&q->count, count - 1, memory_order_relaxed);
+    }
+    mutex_unlock(&q->lock);
+    return job;
+}
+
+static void wake_workers(void) {
+    mutex_lock(&g_pool.idle_lock);
+    cond_broadcast(&g_pool.work_cv);
+    mutex_unlock(&g_pool.idle_lock);
+}
+
+static int stage_acquire(ScanSession* st, int stage) {
+    if (atomic_fetch_add(&st->active[stage], 1) < st->limit[stage]) return 1;
+    atomic_fetch_sub(&st->active[stage], 1);
+    return 0;
+}
+
+static void stage_release(ScanSession* st, int stage) {
+    atomic_fetch_sub(&st->active[stage], 1);
+}
+
+static int log_init(ResultLog* log, unsigned long long entries) {
+    log->max_chunks = (size_t)((entries + LOG_CHUNK - 1) / LOG_CHUNK);
+    log->chunks = (DeviceInfo**)calloc(log->max_chunks, sizeof(DeviceInfo*));
+    log->count = 0;
+    atomic_init(&log->published, 0);
+    return log->chunks != NULL;
+}
 
-static ScanState g_state = {0};
+static void log_free(ResultLog* log) {
+    for (size_t c = 0; log->chunks && c < log->max_chunks; ++c) free(log->chunks[c]);
+    free(log->chunks);
+    log->chunks = NULL;
+    log->max_chunks = 0;
+}
+
+// Caller holds results_lock.
+static void log_append(ResultLog* log, const DeviceInfo* di) {
+    size_t c = log->count / LOG_CHUNK;
+    if (c >= log->max_chunks) return;
+    if (!log->chunks[c]) {
+        log->chunks[c] = (DeviceInfo*)malloc(sizeof(DeviceInfo) * LOG_CHUNK);
+        if (!log->chunks[c]) return;
+    }
+    log->chunks[c][log->count % LOG_CHUNK] = *di;
+    log->count++;
+    atomic_store_explicit(&log->published, log->count, memory_order_release);
+}
+
+// Release: whoever reads a done bit with acquire (scan_session_progress)
+// also sees what result_fn did with the host.
+static void bit_set(atomic_ullong* bits, unsigned long off) {
+    atomic_fetch_or_explicit(&bits[off >> 6], 1ull << (off & 63), memory_order_release);
+}
+
+static int bit_get(atomic_ullong* bits, unsigned long off) {
+    return (int)((atomic_load_explicit(&bits[off >> 6], memory_order_relaxed) >> (off & 63)) & 1);
+}
+
+// Published, or already in the DNS/MAC/port stages: liveness has nothing to do.
+static int address_known(ScanSession* st, unsigned long ip) {
+    if (!st->done_bits || ip < st->start_ip || ip > st->end_ip) return 0;
+    unsigned long off = ip - st->start_ip;
+    return bit_get(st->done_bits, off) || bit_get(st->alive_bits, off);
+}
+
+static int sweep_skip(void* user, unsigned long ip) {
+    return address_known((ScanSession*)user, ip);
+}
+
+static void push_result(ScanSession* st, const DeviceInfo* di) {
+    metrics_inc(METRIC_HOSTS_DONE);
+    if (di->is_alive) metrics_inc(METRIC_HOSTS_ALIVE);
+    mutex_lock(&st->results_lock);
+    if (st->result_fn) st->result_fn(st->result_user, di);
+    else log_append(&st->log, di);
+    mutex_unlock(&st->results_lock);
+    if (st->done_bits && di->ip >= st->start_ip && di->ip <= st->end_ip) bit_set(st->done_bits, di->ip - st->start_ip);
+}
+
+// Queues DNS, MAC and port work for a host that answered.
+static void enqueue_live_host(ScanSession* st, int row, unsigned long ip) {
+    HostJob* job = (HostJob*)calloc(1, sizeof(HostJob));
+    if (!job) return;
+    if (st->alive_bits && ip >= st->start_ip && ip <= st->end_ip) bit_set(st->alive_bits, ip - st->start_ip);
+    device_init(&job->info, ip);
+    job->info.is_alive = 1;
+    job->session = st;
+    atomic_init(&job->remaining, QUEUED_STAGES);
+    atomic_fetch_add(&st->hosts_in_flight, 1);
+    for (int stage = STAGE_DNS; stage < STAGE_COUNT; ++stage) {
+        if (!deque_push(queue_at(st, row, stage), job)) {
+            if (atomic_fetch_sub(&job->remaining, 1) == 1) { free(job); atomic_fetch_sub(&st->hosts_in_flight, 1); }
+        }
+    }
+    wake_workers();
+}
+
+// Sweep receive thread: live hosts enter the pipeline without a liveness task.
+static void on_sweep_reply(void* user, unsigned long ip, int rtt_ms) {
+    (void)rtt_ms;
+    ScanSession* st = (ScanSession*)user;
+    if (atomic_load(&st->cancel) || address_known(st, ip)) return;
+    enqueue_live_host(st, st->num_queues - 1, ip);
+}
+
+// Hosts that drop ICMP still answer ARP: the ARP sweep or a recently
+// confirmed kernel neighbor entry proves them alive.
+static int alive_on_link(ScanSession* st, unsigned long ip) {
+    if (arp_sweep_get_mac(st->arp, ip, NULL)) return 1;
+    const NeighborEntry* ne = neighbor_table_find(&st->neigh, ip);
+    return ne && ne->reachable;
+}
+
+// SYN receive thread. Replies after the hits were sorted are dropped, as if
+// they had come after the scan's wait.
+static void on_syn_reply(void* user, unsigned long ip, int port, int open) {
+    ScanSession* st = (ScanSession*)user;
+    if (ip < st->start_ip || ip > st->end_ip) return;
+    unsigned long off = ip - st->start_ip;
+    atomic_fetch_or_explicit(&st->syn_seen[off >> 3], (unsigned char)(1u << (off & 7)), memory_order_relaxed);
+    if (!open) return;
+    mutex_lock(&st->syn_lock);
+    if (atomic_load(&st->syn_state) == 0 && st->syn_hits_count == st->syn_hits_cap) {
+        size_t ncap = st->syn_hits_cap ? st->syn_hits_cap * 2 : 256;
+        uint64_t* n = (uint64_t*)realloc(st->syn_hits, sizeof(uint64_t) * ncap);
+        if (n) { st->syn_hits = n; st->syn_hits_cap = ncap; }
+    }
+    if (atomic_load(&st->syn_state) == 0 && st->syn_hits_count < st->syn_hits_cap) {
+        st->syn_hits[st->syn_hits_count++] = ((uint64_t)off << 16) | (uint16_t)port;
+    }
+    mutex_unlock(&st->syn_lock);
+}
+
+static int syn_seen(ScanSession* st, unsigned long ip) {
+    unsigned long off = ip - st->start_ip;
+    return (atomic_load_explicit(&st->syn_seen[off >> 3], memory_order_relaxed) >> (off & 7)) & 1;
+}
+
+// Addresses published by an earlier run get no SYNs. Hosts it left pending
+// do: their port tasks read this scan's hits.
+static int syn_skip(void* user, unsigned long ip) {
+    ScanSession* st = (ScanSession*)user;
+    return st->done_bits && bit_get(st->done_bits, ip - st->start_ip);
+}
 
-static DWORD WINAPI worker_proc(LPVOID lpParam) {
-    ScanState* st = (ScanState*)lpParam;
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// One worker sorts the hits once the SYN scan is done; the others wait for
+// it. Returns 1 once port tasks may read them.
+static int syn_ready(ScanSession* st) {
+    int expected = 0;
+    if (atomic_load(&st->syn_state) == 2) return 1;
+    if (!syn_scan_done(st->syn) || !atomic_compare_exchange_strong(&st->syn_state, &expected, 1)) return 0;
+    mutex_lock(&st->syn_lock); // the receive thread may be mid-append
+    mutex_unlock(&st->syn_lock);
+    if (st->syn_hits_count) qsort(st->syn_hits, st->syn_hits_count, sizeof(uint64_t), cmp_u64);
+    atomic_store(&st->syn_state, 2);
+    wake_workers();
+    return 1;
+}
+
+// Timeout for a probe to 'ip': measured when adaptive timing is on and
+// something nearby has answered, 'fixed_ms' otherwise.
+static int probe_timeout_ms(const ScanSession* st, unsigned long ip, int fixed_ms) {
+    if (!st->cfg.adaptive_timing) return fixed_ms;
+    return timing_timeout_ms(ip, fixed_ms, st->cfg.min_rtt_timeout_ms, st->cfg.max_rtt_timeout_ms);
+}
+
+static void run_liveness(ScanSession* st, int self, unsigned long ip) {
+    if (address_known(st, ip)) return; // resumed, or queued by the sweep
+    if (st->sweep) {
+        // Live hosts were already queued by the sweep callback.
+        if (icmp_sweep_is_alive(st->sweep, ip)) return;
+        if (alive_on_link(st, ip)) { enqueue_live_host(st, self, ip); return; }
+        if (st->syn && syn_seen(st, ip)) { enqueue_live_host(st, self, ip); return; }
+    } else {
+        if (alive_on_link(st, ip)) { enqueue_live_host(st, self, ip); return; }
+        if (st->syn && syn_seen(st, ip)) { enqueue_live_host(st, self, ip); return; }
+        if (!pacer_acquire(st->icmp_pacer, 1)) return; // cancelled
+        char ipbuf[64]; uint_to_ip(ip, ipbuf, sizeof(ipbuf));
+        event_log_emit(EVENT_LEVEL_DEBUG, EVENT_PING, ip, 0, 0);
+        metrics_inc(METRIC_ICMP_SENT);
+        unsigned long long t0 = clock_monotonic_ns();
+        if (net_ping_ipv4_timeout(ipbuf, probe_timeout_ms(st, ip, st->cfg.ping_timeout_ms))) {
+            uint32_t rtt_us = (uint32_t)((clock_monotonic_ns() - t0) / 1000);
+            metrics_inc(METRIC_ICMP_REPLIES);
+            metrics_record_us(METRIC_LAT_ICMP, rtt_us);
+            timing_observe(ip, rtt_us);
+            enqueue_live_host(st, self, ip);
+            return;
+        }
+        metrics_inc(METRIC_ICMP_TIMEOUTS);
+    }
+    DeviceInfo di; device_init(&di, ip);
+    push_result(st, &di);
+}
+
+static void finish_stage(ScanSession* st, HostJob* job) {
+    if (atomic_fetch_sub(&job->remaining, 1) != 1) return;
+    const DeviceInfo* di = &job->info;
+    event_log_host(EVENT_LEVEL_INFO, di);
+    push_result(st, di);
+    free(job);
+    atomic_fetch_sub(&st->hosts_in_flight, 1);
+    wake_workers(); // completion may be what idle workers wait for
+}
+
+static void on_dns_answer(void* user, unsigned long ip, uint32_t name) {
+    (void)ip;
+    HostJob* job = (HostJob*)user;
+    job->info.hostname = name;
+    finish_stage(job->session, job);
+}
+
+static void run_stage(ScanSession* st, int stage, HostJob* job) {
+    DeviceInfo* di = &job->info;
+    if (stage == STAGE_DNS && st->dns && !atomic_load(&st->cancel)) {
+        if (dns_resolver_lookup(st->dns, di->ip, on_dns_answer, job)) return;
+    }
+    if (!atomic_load(&st->cancel)) {
+        char ip[DEVICE_IP_STRLEN];
+        device_ip_str(di, ip, sizeof(ip));
+        switch (stage) {
+            case STAGE_DNS: {
+                char name[256];
+                if (pacer_acquire(st->dns_pacer, 1) && net_reverse_dns(ip, name, sizeof(name))) device_set_hostname(di, name);
+                break;
+            }
+            case STAGE_MAC: {
+                if (arp_sweep_get_mac(st->arp, di->ip, di->mac)) { di->has_mac = 1; break; }
+                const NeighborEntry* ne = NULL;
+                if (atomic_load(&st->neigh_state) == 2) ne = neighbor_table_find(&st->neigh, di->ip);
+                if (ne) { memcpy(di->mac, ne->mac, sizeof(di->mac)); di->has_mac = 1; break; }
+                char mac[32];
+                if (net_get_mac(ip, mac, sizeof(mac))) device_set_mac_str(di, mac);
+                break;
+            }
+            case STAGE_PORTS: {
+                event_log_emit(EVENT_LEVEL_DEBUG, EVENT_PORTS, di->ip, 0, 0);
+                int* open = (int*)malloc(sizeof(int) * (size_t)st->ports.count);
+                const ServiceSignature** sigs = NULL;
+                int n = 0;
+                if (open && st->cfg.service_detect) sigs = (const ServiceSignature**)malloc(sizeof(*sigs) * (size_t)st->ports.count);
+                if (open) {
+                    net_scan_services_paced(ip, st->ports.order, st->ports.count,
+                                            probe_timeout_ms(st, di->ip, st->cfg.port_timeout_ms),
+                                            st->cfg.service_wait_ms, st->tcp_pacer, st->tcp_window, open, sigs, &n);
+                }
+                if (!device_set_ports(di, open, n)) event_log_text(EVENT_LEVEL_ERROR, "Out of memory storing open ports");
+                if (sigs) device_set_services(di, open, sigs, n);
+                free(sigs);
+                free(open);
+                break;
+            }
+        }
+    }
+    finish_stage(st, job);
+}
+
+static HostJob* take_task(ScanSession* st, int self, int stage) {
+    HostJob* job = deque_pop(queue_at(st, self, stage));
+    for (int k = 1; !job && k < st->num_queues; ++k) {
+        job = deque_steal(queue_at(st, (self + k) % st->num_queues, stage));
+    }
+    return job;
+}
+
+// Port task in SYN mode: the host's open ports are a run of the sorted hits.
+static void run_syn_ports(ScanSession* st, HostJob* job) {
+    DeviceInfo* di = &job->info;
+    uint64_t off = di->ip - st->start_ip;
+    size_t lo = 0, hi = st->syn_hits_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (st->syn_hits[mid] >> 16 < off) lo = mid + 1;
+        else hi = mid;
+    }
+    size_t end = lo;
+    while (end < st->syn_hits_count && st->syn_hits[end] >> 16 == off) ++end;
+    int* open = end > lo ? (int*)malloc(sizeof(int) * (end - lo)) : NULL;
+    int n = 0;
+    for (size_t i = lo; open && i < end; ++i) {
+        int port = (int)(st->syn_hits[i] & 0xFFFFu);
+        if (n == 0 || open[n - 1] != port) open[n++] = port; // retransmitted SYN-ACKs
+    }
+    if ((end > lo && !open) || !device_set_ports(di, open, n)) event_log_text(EVENT_LEVEL_ERROR, "Out of memory storing open ports");
+    free(open);
+    finish_stage(st, job);
+}
+
+typedef struct {
+    int port;
+    const ServiceSignature* sig;
+} PortHit;
+
+// A host of the ports stage while its probes are in a worker's engine.
+typedef struct {
+    HostJob* job;
+    int pending;    // probes submitted and not yet reported
+    int submitting; // more to come: 'pending' reaching 0 does not finish it
+    PortHit* hits;  // open ports, in completion order
+    int hits_count, hits_cap;
+    const ServiceSignature* banner_sig; // for the result that follows the banner
+} PortTask;
+
+static int hit_cmp(const void* a, const void* b) {
+    int x = ((const PortHit*)a)->port, y = ((const PortHit*)b)->port;
+    return (x > y) - (x < y);
+}
+
+// Stores the open ports in probe order, as the blocking path reports them.
+static void finish_ports(PortTask* pt) {
+    HostJob* job = pt->job;
+    ScanSession* st = job->session;
+    DeviceInfo* di = &job->info;
+    int* open = NULL;
+    const ServiceSignature** sigs = NULL;
+    int n = 0, ok = 1;
+    if (pt->hits_count > 0) {
+        qsort(pt->hits, (size_t)pt->hits_count, sizeof(PortHit), hit_cmp);
+        open = (int*)malloc(sizeof(int) * (size_t)pt->hits_count);
+        sigs = (const ServiceSignature**)malloc(sizeof(*sigs) * (size_t)pt->hits_count);
+        ok = open && sigs;
+        for (int i = 0; ok && i < st->ports.count && n < pt->hits_count; ++i) {
+            PortHit key; key.port = st->ports.order[i];
+            const PortHit* h = (const PortHit*)bsearch(&key, pt->hits, (size_t)pt->hits_count, sizeof(PortHit), hit_cmp);
+            if (!h) continue;
+            open[n] = h->port;
+            sigs[n] = h->sig;
+            n++;
+        }
+    }
+    if (!ok || !device_set_ports(di, open, n)) event_log_text(EVENT_LEVEL_ERROR, "Out of memory storing open ports");
+    if (ok && st->cfg.service_detect) device_set_services(di, open, sigs, n);
+    free(sigs);
+    free(open);
+    free(pt->hits);
+    free(pt);
+    finish_stage(st, job);
+}
+
+static void on_port_banner(void* user, unsigned long ip, int port, const unsigned char* data, size_t len) {
+    (void)ip; (void)port;
+    PortTask* pt = (PortTask*)user;
+    pt->banner_sig = service_identify(data, len);
+    if (pt->banner_sig) metrics_inc(METRIC_SERVICES_MATCHED);
+}
+
+static void on_port_result(void* user, unsigned long ip, int port, int open) {
+    (void)ip;
+    PortTask* pt = (PortTask*)user;
+    const ServiceSignature* sig = pt->banner_sig;
+    pt->banner_sig = NULL;
+    if (open && pt->hits_count == pt->hits_cap) {
+        int ncap = pt->hits_cap ? pt->hits_cap * 2 : 16;
+        PortHit* n = (PortHit*)realloc(pt->hits, sizeof(PortHit) * (size_t)ncap);
+        if (n) { pt->hits = n; pt->hits_cap = ncap; }
+    }
+    if (open && pt->hits_count < pt->hits_cap) {
+        pt->hits[pt->hits_count].port = port;
+        pt->hits[pt->hits_count].sig = sig;
+        pt->hits_count++;
+    }
+    if (--pt->pending == 0 && !pt->submitting) finish_ports(pt);
+}
+
+// NULL without an asynchronous connect backend.
+static ConnEngine* port_engine(ScanSession* st, int self) {
+    if (!st->port_engines) return NULL;
+    if (st->port_engines[self]) return st->port_engines[self];
+    ConnEngine* ce = conn_engine_create(PORT_ENGINE_WINDOW, st->cfg.port_timeout_ms);
+    if (!ce) return NULL;
+    conn_engine_set_window(ce, st->tcp_window);
+    // Without a banner buffer the ports are still scanned, just not named.
+    if (st->cfg.service_detect) conn_engine_set_banner(ce, st->cfg.service_wait_ms, on_port_banner);
+    st->port_engines[self] = ce;
+    return ce;
+}
+
+// Takes a probe token, serving the engine's completions while it waits.
+static int port_token(ScanSession* st, ConnEngine* ce) {
     for (;;) {
-        if (st->cancel) break;
-        LONG ip = InterlockedIncrement(&st->next_ip) - 1;
-        if ((unsigned long)ip > st->end_ip) break;
-        // Rate limiting: allow up to rate_limit devices per second
-        for (;;) {
-            ULONGLONG now = GetTickCount64();
-            if (now - st->rate_window_start >= 1000) {
-                st->rate_window_start = now;
-                InterlockedExchange(&st->rate_count, 0);
+        if (atomic_load(&st->cancel)) return 0;
+        if (conn_engine_inflight(ce) == 0) return pacer_acquire(st->tcp_pacer, 1);
+        if (pacer_try_acquire(st->tcp_pacer, 1)) return 1;
+        conn_engine_poll(ce, 1);
+    }
+}
+
+static void submit_ports(ScanSession* st, ConnEngine* ce, HostJob* job) {
+    DeviceInfo* di = &job->info;
+    event_log_emit(EVENT_LEVEL_DEBUG, EVENT_PORTS, di->ip, 0, 0);
+    PortTask* pt = (PortTask*)calloc(1, sizeof(PortTask));
+    if (!pt) {
+        event_log_text(EVENT_LEVEL_ERROR, "Out of memory storing open ports");
+        finish_stage(st, job);
+        return;
+    }
+    pt->job = job;
+    pt->submitting = 1;
+    int timeout_ms = probe_timeout_ms(st, di->ip, st->cfg.port_timeout_ms);
+    for (int i = 0; i < st->ports.count && port_token(st, ce); ++i) {
+        pt->pending++; // before the submit: loopback connects complete inside it
+        if (conn_engine_submit_timeout(ce, di->ip, st->ports.order[i], timeout_ms, on_port_result, pt)) continue;
+        pt->pending--;
+    }
+    pt->submitting = 0;
+    if (pt->pending == 0) finish_ports(pt);
+}
+
+// The ports stage for worker 'self': keeps taking hosts while its engine has
+// room and returns once every host it took is finished.
+static void run_ports(ScanSession* st, int self, HostJob* job) {
+    if (st->syn) { run_syn_ports(st, job); return; }
+    ConnEngine* ce = port_engine(st, self);
+    if (!ce) { run_stage(st, STAGE_PORTS, job); return; }
+    while (job) {
+        submit_ports(st, ce, job);
+        job = NULL;
+        while (!job && conn_engine_inflight(ce) > 0) {
+            if (conn_engine_inflight(ce) < conn_engine_window(ce) && !atomic_load(&st->cancel)) {
+                job = take_task(st, self, STAGE_PORTS);
             }
-            LONG cur = st->rate_count;
-            if (cur < st->rate_limit) { InterlockedIncrement(&st->rate_count); break; }
-            Sleep(1);
-            if (st->cancel) break;
+            if (!job) conn_engine_poll(ce, 10);
         }
-        DeviceInfo di; memset(&di, 0, sizeof(di));
-        uint_to_ip((unsigned long)ip, di.ip, sizeof(di.ip));
-        if (st->logger) {
-            char msg[96]; snprintf(msg, sizeof(msg), "Scanning %s", di.ip);
-            st->logger(msg);
+    }
+}
+
+// One worker snapshots the kernel neighbor table once the sweeps are done;
+// the others wait for it. Returns 1 once it is loaded.
+static int load_neighbors(ScanSession* st) {
+    int expected = 0;
+    if (atomic_load(&st->neigh_state) == 2) return 1;
+    if (!atomic_compare_exchange_strong(&st->neigh_state, &expected, 1)) return 0;
+    neighbor_table_load(&st->neigh);
+    atomic_store(&st->neigh_state, 2);
+    event_log_emit(EVENT_LEVEL_INFO, EVENT_NEIGHBORS, 0, (uint32_t)arp_sweep_found_count(st->arp), (uint32_t)st->neigh.count);
+    wake_workers();
+    return 1;
+}
+
+// Claims a batch of positions in the target order for the liveness stage.
+// With a sweep running, nothing is handed out until it is done: live hosts
+// arrive via the callback. Likewise with a SYN scan, whose replies the
+// liveness stage then reads.
+static int claim_addresses(ScanSession* st, TargetCursor* cur) {
+    if (st->sweep && !icmp_sweep_done(st->sweep)) return 0;
+    if (st->syn && !syn_scan_done(st->syn)) return 0;
+    if (!arp_sweep_done(st->arp) || !load_neighbors(st)) return 0;
+    unsigned long long base = atomic_fetch_add(&st->next_pos, ADDR_BATCH);
+    if (base >= st->order.positions) return 0;
+    target_order_seek(&st->order, base, ADDR_BATCH, cur);
+    return 1;
+}
+
+static int scan_complete(ScanSession* st) {
+    if (atomic_load(&st->cancel)) return 1;
+    if (st->sweep && !icmp_sweep_done(st->sweep)) return 0;
+    if (st->syn && !syn_scan_done(st->syn)) return 0;
+    if (!arp_sweep_done(st->arp)) return 0;
+    if (atomic_load(&st->next_pos) < st->order.positions) return 0;
+    // Liveness enqueues a host before releasing its slot, so check in this order.
+    if (atomic_load(&st->active[STAGE_LIVENESS]) != 0) return 0;
+    return atomic_load(&st->hosts_in_flight) == 0;
+}
+
+// One round of work in session 'st' for pool worker 'self': a task from the
+// latest stage that has one, else a batch of liveness checks. Returns 1 if
+// it did anything.
+static int session_work(ScanSession* st, int self) {
+    // Later stages first: finishing hosts bounds the number in flight.
+    for (int stage = STAGE_PORTS; stage >= STAGE_DNS; --stage) {
+        if (stage == STAGE_PORTS && st->syn && !syn_ready(st)) continue;
+        if (!stage_acquire(st, stage)) continue;
+        HostJob* job = take_task(st, self, stage);
+        if (job && stage == STAGE_PORTS) run_ports(st, self, job);
+        else if (job) run_stage(st, stage, job);
+        stage_release(st, stage);
+        if (job) return 1;
+    }
+    int did = 0;
+    if (stage_acquire(st, STAGE_LIVENESS)) {
+        TargetCursor cur;
+        if (claim_addresses(st, &cur)) {
+            uint64_t off;
+            while (!atomic_load(&st->cancel) && target_order_next(&st->order, &cur, &off)) {
+                run_liveness(st, self, st->start_ip + (unsigned long)off);
+            }
+            did = 1;
         }
-        identify_device(&di, &st->cfg);
-        EnterCriticalSection(&st->results_lock);
-        device_list_push(&st->results, &di);
-        LeaveCriticalSection(&st->results_lock);
+        stage_release(st, STAGE_LIVENESS);
     }
-    return 0;
+    return did;
 }
 
-int parallel_scan_start(unsigned long start_ip_uint,
-                        unsigned long end_ip_uint,
-                        const ScanConfig* cfg,
-                        ScanLogFn logger) {
-    if (g_state.cancel == 0 && g_state.num_threads > 0) return 0; // already running
-    memset(&g_state, 0, sizeof(g_state));
-    g_state.start_ip = start_ip_uint;
-    g_state.end_ip = end_ip_uint;
-    g_state.next_ip = (LONG)start_ip_uint;
-    g_state.cancel = 0;
-    if (cfg) g_state.cfg = *cfg; else scan_config_init(&g_state.cfg);
-    g_state.logger = logger;
-    device_list_init(&g_state.results);
-    InitializeCriticalSection(&g_state.results_lock);
-    g_state.rate_count = 0;
-    g_state.rate_window_start = GetTickCount64();
-    g_state.rate_limit = 200; // devices per second (coarse)
+static void check_complete(ScanSession* st) {
+    int expected = 0;
+    if (!scan_complete(st) || !atomic_compare_exchange_strong(&st->finished, &expected, 1)) return;
+    atomic_store(&st->end_ns, clock_monotonic_ns());
+    event_log_text(EVENT_LEVEL_INFO, "Scan finished");
+}
+
+static void worker_proc(void* arg) {
+    int self = (int)(intptr_t)arg;
+    ScanSession* mine[MAX_SESSIONS];
+    unsigned turn = (unsigned)self; // spreads the workers' first pick over the sessions
+    while (!atomic_load(&g_pool.stop)) {
+        // Sessions stay allocated while 'users' counts this worker.
+        int n = 0;
+        mutex_lock(&g_pool.lock);
+        for (int i = 0; i < g_pool.count; ++i) {
+            ScanSession* st = g_pool.sessions[(turn + (unsigned)i) % (unsigned)g_pool.count];
+            if (atomic_load(&st->cancel) || atomic_load(&st->finished)) continue;
+            atomic_fetch_add(&st->users, 1);
+            mine[n++] = st;
+        }
+        mutex_unlock(&g_pool.lock);
+        turn++;
+        int did = 0;
+        for (int i = 0; i < n; ++i) {
+            if (session_work(mine[i], self)) did = 1;
+            else check_complete(mine[i]);
+            atomic_fetch_sub(&mine[i]->users, 1);
+        }
+        if (did) continue;
+        unsigned long long t0 = clock_monotonic_ns();
+        mutex_lock(&g_pool.idle_lock);
+        cond_timedwait(&g_pool.work_cv, &g_pool.idle_lock, 50);
+        mutex_unlock(&g_pool.idle_lock);
+        metrics_add(METRIC_WORKER_IDLE_NS, clock_monotonic_ns() - t0);
+    }
+}
+
+// Caller holds g_pool.life. Returns 0 if no worker thread could be started.
+static int pool_start(void) {
+    if (g_pool.num_threads > 0) return 1;
+    // Workers mostly block on network I/O, so oversubscribe the cores.
+    int desired = cpu_count() * 8;
+    if (desired < 16) desired = 16;
+    if (desired > MAX_WORKERS) desired = MAX_WORKERS;
+    mutex_init(&g_pool.idle_lock);
+    cond_init(&g_pool.work_cv);
+    atomic_store(&g_pool.stop, 0);
+    int n = 0;
+    for (int i = 0; i < desired; ++i) {
+        if (thread_create(&g_pool.threads[n], worker_proc, (void*)(intptr_t)n)) n++;
+    }
+    g_pool.num_threads = n;
+    if (n == 0) { mutex_destroy(&g_pool.idle_lock); cond_destroy(&g_pool.work_cv); }
+    return n > 0;
+}
+
+// Caller holds g_pool.life and no session is registered.
+static void pool_stop(void) {
+    if (g_pool.num_threads <= 0) return;
+    atomic_store(&g_pool.stop, 1);
+    wake_workers();
+    for (int i = 0; i < g_pool.num_threads; ++i) thread_join(&g_pool.threads[i]);
+    g_pool.num_threads = 0;
+    mutex_destroy(&g_pool.idle_lock);
+    cond_destroy(&g_pool.work_cv);
+}
+
+static void free_pacers(ScanSession* st) {
+    pacer_destroy(st->icmp_pacer); st->icmp_pacer = NULL;
+    pacer_destroy(st->tcp_pacer); st->tcp_pacer = NULL;
+    pacer_destroy(st->dns_pacer); st->dns_pacer = NULL;
+    if (st->tcp_window) st->tcp_window_final = timing_window_size(st->tcp_window);
+    timing_window_destroy(st->tcp_window); st->tcp_window = NULL;
+}
+
+static void free_pipeline(ScanSession* st) {
+    if (st->port_engines) {
+        for (int i = 0; i < st->pool_workers; ++i) conn_engine_destroy(st->port_engines[i]);
+        free(st->port_engines);
+        st->port_engines = NULL;
+    }
+    if (st->queues) {
+        for (int i = 0; i < st->num_queues * QUEUED_STAGES; ++i) {
+            TaskDeque* q = &st->queues[i];
+            // Jobs still queued after a cancel are shared by several stages.
+            int count = atomic_load(&q->count);
+            for (int k = 0; k < count; ++k) {
+                HostJob* job = q->items[(q->head + k) % q->cap];
+                if (atomic_fetch_sub(&job->remaining, 1) == 1) free(job);
+            }
+            free(q->items);
+            mutex_destroy(&q->lock);
+        }
+        free(st->queues);
+        st->queues = NULL;
+    }
+    free_pacers(st);
+    neighbor_table_free(&st->neigh);
+    port_set_free(&st->ports);
+}
+
+static void free_progress(ScanSession* st) {
+    free(st->done_bits); st->done_bits = NULL;
+    free(st->alive_bits); st->alive_bits = NULL;
+    st->bit_words = 0;
+}
+
+// Frees what a finished scan keeps for polls, stats and checkpoints.
+static void free_results(ScanSession* st) {
+    if (!st->initialized) return;
+    free_progress(st);
+    log_free(&st->log);
+    mutex_destroy(&st->results_lock);
+    st->initialized = 0;
+}
+
+ScanSession* scan_session_create(void) {
+    return (ScanSession*)calloc(1, sizeof(ScanSession));
+}
+
+void scan_session_destroy(ScanSession* st) {
+    if (!st) return;
+    scan_session_stop(st);
+    free_results(st);
+    if (g_default == st) g_default = NULL;
+    free(st);
+}
+
+// 'resume' (may be NULL) holds the progress of an earlier run of this range.
+// SYN mode falls back to connect probes when raw sockets are unavailable.
+static void start_syn(ScanSession* st, int resume) {
+    atomic_init(&st->syn_state, 0);
+    st->syn_hits = NULL;
+    st->syn_hits_count = st->syn_hits_cap = 0;
+    st->syn_seen = (atomic_uchar*)calloc((st->end_ip - st->start_ip) / 8 + 1, sizeof(atomic_uchar));
+    mutex_init(&st->syn_lock);
+    SynScanOptions opts = { &st->order, resume ? syn_skip : NULL, st };
+    if (st->syn_seen) {
+        st->syn = syn_scan_start_opts(st->start_ip, st->end_ip, st->ports.order, st->ports.count, st->cfg.tcp_rate_pps,
+                                      st->cfg.port_timeout_ms, on_syn_reply, st, &opts);
+    }
+    if (st->syn) return;
+    mutex_destroy(&st->syn_lock);
+    free(st->syn_seen);
+    st->syn_seen = NULL;
+    if (st->logger) st->logger("SYN scan unavailable (needs raw sockets); using connect probes");
+}
+
+static void stop_syn(ScanSession* st) {
+    if (!st->syn) return;
+    syn_scan_destroy(st->syn);
+    st->syn = NULL;
+    mutex_destroy(&st->syn_lock);
+    free(st->syn_seen);
+    st->syn_seen = NULL;
+    free(st->syn_hits);
+    st->syn_hits = NULL;
+}
+
+static int start_scan(ScanSession* st,
+                      unsigned long start_ip_uint,
+                      unsigned long end_ip_uint,
+                      const ScanConfig* cfg,
+                      ScanLogFn logger,
+                      ScanResultFn fn,
+                      void* user,
+                      const ScanCheckpoint* resume) {
+    if (!st || scan_session_is_running(st)) return 0; // already running
+    if (st->started) scan_session_stop(st); // reap a finished scan
+    free_results(st);
+    memset(st, 0, sizeof(*st));
+    st->start_ip = start_ip_uint;
+    st->end_ip = end_ip_uint;
+    atomic_init(&st->next_pos, 0);
+    atomic_init(&st->cancel, 0);
+    atomic_init(&st->finished, 0);
+    atomic_init(&st->users, 0);
+    atomic_init(&st->neigh_state, 0);
+    if (cfg) st->cfg = *cfg; else scan_config_init(&st->cfg);
+    unsigned long long addresses = (unsigned long long)end_ip_uint - start_ip_uint + 1;
+    int sharded = st->cfg.shard_count > 1;
+    if (st->cfg.shuffle_targets) {
+        // Recorded in the config so a checkpoint or log names the order used.
+        // Shards must agree on the order without talking to each other, so
+        // theirs follows from the range alone.
+        if (!st->cfg.shuffle_seed && sharded) st->cfg.shuffle_seed = (((unsigned long long)start_ip_uint << 32) ^ end_ip_uint) | 1;
+        if (!st->cfg.shuffle_seed) st->cfg.shuffle_seed = (clock_monotonic_ns() ^ (uintptr_t)st) | 1;
+        target_order_init_shuffled(&st->order, addresses, st->cfg.shuffle_seed);
+    } else {
+        target_order_init_sequential(&st->order, addresses);
+    }
+    if (sharded) {
+        if (st->cfg.shard_index < 0 || st->cfg.shard_index >= st->cfg.shard_count) {
+            if (logger) logger("Shard index out of range");
+            return 0;
+        }
+        target_order_shard(&st->order, (uint64_t)st->cfg.shard_index, (uint64_t)st->cfg.shard_count);
+    }
+    if (!port_set_compile(&st->ports, st->cfg.ports)) {
+        if (logger) logger("Bad port list");
+        return 0;
+    }
+    st->logger = logger;
+    st->result_fn = fn;
+    st->result_user = user;
+    mutex_init(&st->results_lock);
     if (!net_init()) {
-        if (g_state.logger) g_state.logger("Network init failed");
-        DeleteCriticalSection(&g_state.results_lock);
+        if (st->logger) st->logger("Network init failed");
+        mutex_destroy(&st->results_lock);
+        port_set_free(&st->ports);
         return 0;
     }
-    int desired = 16; // default thread count
-    SYSTEM_INFO si; GetSystemInfo(&si);
-    int hw = (int)si.dwNumberOfProcessors;
-    if (hw > 0) desired = (hw * 2);
-    if (desired > 64) desired = 64;
-    g_state.num_threads = desired;
-    for (int i = 0; i < g_state.num_threads; ++i) {
-        g_state.threads[i] = CreateThread(NULL, 0, worker_proc, &g_state, 0, NULL);
+    mutex_lock(&g_pool.life);
+    if (g_pool.count == MAX_SESSIONS || !pool_start()) {
+        mutex_unlock(&g_pool.life);
+        if (st->logger) st->logger(g_pool.count == MAX_SESSIONS ? "Too many scans running" : "Cannot start workers");
+        mutex_destroy(&st->results_lock);
+        port_set_free(&st->ports);
+        net_cleanup();
+        return 0;
     }
-    if (g_state.logger) {
-        char msg[96]; snprintf(msg, sizeof(msg), "Workers started: %d", g_state.num_threads);
-        g_state.logger(msg);
+    int workers = g_pool.num_threads;
+    st->pool_workers = workers;
+    st->num_queues = workers + 1;
+    st->queues = (TaskDeque*)calloc((size_t)st->num_queues * QUEUED_STAGES, sizeof(TaskDeque));
+    st->port_engines = (ConnEngine**)calloc((size_t)workers, sizeof(ConnEngine*));
+    st->icmp_pacer = pacer_create(st->cfg.icmp_rate_pps, PACER_DEFAULT_BURST);
+    st->tcp_pacer = pacer_create(st->cfg.tcp_rate_pps, PACER_DEFAULT_BURST);
+    st->dns_pacer = pacer_create(st->cfg.dns_rate_pps, PACER_DEFAULT_BURST);
+    int log_ok = fn ? 1 : log_init(&st->log, addresses);
+    st->bit_words = checkpoint_words(start_ip_uint, end_ip_uint);
+    if (st->bit_words) {
+        st->done_bits = (atomic_ullong*)calloc(st->bit_words, sizeof(atomic_ullong));
+        st->alive_bits = (atomic_ullong*)calloc(st->bit_words, sizeof(atomic_ullong));
+        if (!st->done_bits || !st->alive_bits) free_progress(st); // scan without checkpoints
     }
+    int progress_ok = !resume || st->done_bits;
+    if (!st->queues || !st->port_engines || !st->icmp_pacer || !st->tcp_pacer || !st->dns_pacer || !log_ok || !progress_ok) {
+        free(st->queues);
+        st->queues = NULL;
+        free(st->port_engines);
+        st->port_engines = NULL;
+        free_pacers(st);
+        free_progress(st);
+        log_free(&st->log);
+        mutex_destroy(&st->results_lock);
+        port_set_free(&st->ports);
+        if (g_pool.count == 0) pool_stop();
+        mutex_unlock(&g_pool.life);
+        net_cleanup();
+        return 0;
+    }
+    for (int i = 0; i < st->num_queues * QUEUED_STAGES; ++i) mutex_init(&st->queues[i].lock);
+    st->initialized = 1;
+    st->limit[STAGE_LIVENESS] = workers / 2;
+    st->limit[STAGE_DNS] = workers / 4 > 0 ? workers / 4 : 1;
+    st->limit[STAGE_MAC] = workers / 4 > 0 ? workers / 4 : 1;
+    st->limit[STAGE_PORTS] = workers / 2 > 0 ? workers / 2 : 1;
+    if (st->limit[STAGE_LIVENESS] < 1) st->limit[STAGE_LIVENESS] = 1;
+    if (st->cfg.adaptive_timing) {
+        // Estimates from an earlier scan may be stale; those of a scan
+        // still running are kept.
+        if (g_pool.count == 0) timing_clear();
+        // Without the window probes are bounded by the port workers' engines alone.
+        st->tcp_window = timing_window_create(TCP_WINDOW_INITIAL, TCP_WINDOW_MIN,
+                                              st->limit[STAGE_PORTS] * PORT_ENGINE_WINDOW);
+    }
+
+    if (resume) {
+        // Hosts that were in the pipeline skip liveness; everything else
+        // already published is skipped by the sweep and the liveness stage.
+        unsigned long long done = 0, pending = 0;
+        for (size_t i = 0; i < st->bit_words; ++i) {
+            uint64_t d = resume->done[i], a = resume->alive[i] & ~d;
+            atomic_init(&st->done_bits[i], d);
+            done += (unsigned long long)checkpoint_count(&d, 1);
+            for (int b = 0; a && b < 64; ++b) {
+                if (!((a >> b) & 1)) continue;
+                enqueue_live_host(st, st->num_queues - 1, start_ip_uint + (unsigned long)(i * 64 + (size_t)b));
+                pending++;
+            }
+        }
+        if (st->logger) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "Resuming: %llu of %llu addresses done, %llu hosts pending", done, addresses, pending);
+            st->logger(msg);
+        }
+    }
+
+    metrics_snapshot(&st->metrics_base);
+    st->start_ns = clock_monotonic_ns();
+    st->dns = dns_resolver_create(st->cfg.dns_server, st->cfg.dns_rate_pps, 0);
+    if (!st->dns && st->logger) st->logger("DNS resolver unavailable; using blocking lookups");
+    IcmpSweepOptions sweep_opts = { &st->order, resume ? sweep_skip : NULL, st };
+    st->sweep = icmp_sweep_start_opts(start_ip_uint, end_ip_uint, st->cfg.icmp_rate_pps, st->cfg.ping_timeout_ms,
+                                      on_sweep_reply, st, &sweep_opts);
+    // ARP-only hosts are picked up by the liveness stage once the sweep is done.
+    if (st->cfg.adaptive_timing) icmp_sweep_set_adaptive_wait(st->sweep, st->cfg.min_rtt_timeout_ms);
+    st->arp = arp_sweep_start(start_ip_uint, end_ip_uint, st->cfg.icmp_rate_pps, ARP_REPLY_WAIT_MS, NULL, NULL);
+    if (st->cfg.probe_strategy == SCAN_PROBE_SYN) start_syn(st, resume != NULL);
+    mutex_lock(&g_pool.lock);
+    g_pool.sessions[g_pool.count++] = st;
+    mutex_unlock(&g_pool.lock);
+    st->started = 1;
+    mutex_unlock(&g_pool.life);
+    wake_workers();
+    if (st->logger) {
+        char msg[96]; snprintf(msg, sizeof(msg), "Workers started: %d", workers);
+        st->logger(msg);
+        if (st->cfg.shuffle_targets) {
+            snprintf(msg, sizeof(msg), "Address order: shuffled, seed %llu", st->cfg.shuffle_seed);
+            st->logger(msg);
+        }
+        if (sharded) {
+            snprintf(msg, sizeof(msg), "Shard %d of %d: %llu positions", st->cfg.shard_index, st->cfg.shard_count,
+                     (unsigned long long)st->order.positions);
+            st->logger(msg);
+        }
+    }
+    return 1;
+}
+
+int scan_session_start(ScanSession* s, unsigned long start_ip, unsigned long end_ip, const ScanConfig* cfg,
+                       ScanLogFn logger, ScanResultFn fn, void* user) {
+    return start_scan(s, start_ip, end_ip, cfg, logger, fn, user, NULL);
+}
+
+int scan_session_resume(ScanSession* s, const char* path, ScanLogFn logger, ScanResultFn fn, void* user) {
+    ScanCheckpoint cp;
+    if (!path || !checkpoint_load(path, &cp)) {
+        if (logger) logger("Cannot read checkpoint");
+        return 0;
+    }
+    int ok = start_scan(s, cp.start_ip, cp.end_ip, &cp.cfg, logger, fn, user, &cp);
+    checkpoint_free(&cp);
+    return ok;
+}
+
+int scan_session_progress(ScanSession* st, ScanCheckpoint* cp) {
+    if (!st || !cp || !st->initialized || !st->done_bits) return 0;
+    if (!checkpoint_init(cp, st->start_ip, st->end_ip, &st->cfg)) return 0;
+    // Hosts only move from unknown to alive to done, so copying 'alive'
+    // first means a host published meanwhile reads as done, not as pending.
+    for (size_t i = 0; i < cp->words; ++i) cp->alive[i] = atomic_load_explicit(&st->alive_bits[i], memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    for (size_t i = 0; i < cp->words; ++i) cp->done[i] = atomic_load_explicit(&st->done_bits[i], memory_order_acquire);
     return 1;
 }
 
-void parallel_scan_stop(void) {
-    if (g_state.num_threads <= 0) return;
-    g_state.cancel = 1;
-    WaitForMultipleObjects(g_state.num_threads, g_state.threads, TRUE, 5000);
-    for (int i = 0; i < g_state.num_threads; ++i) {
-        if (g_state.threads[i]) CloseHandle(g_state.threads[i]);
-        g_state.threads[i] = NULL;
+int scan_session_checkpoint(ScanSession* st, const char* path) {
+    ScanCheckpoint cp;
+    if (!path || !scan_session_progress(st, &cp)) return 0;
+    int ok = checkpoint_save(path, &cp);
+    checkpoint_free(&cp);
+    return ok;
+}
+
+void scan_session_stop(ScanSession* st) {
+    if (!st || !st->started) return;
+    atomic_store(&st->cancel, 1);
+    int expected = 0;
+    if (atomic_compare_exchange_strong(&st->finished, &expected, 1)) {
+        atomic_store(&st->end_ns, clock_monotonic_ns());
+        event_log_text(EVENT_LEVEL_INFO, "Scan stopped");
+    }
+    icmp_sweep_cancel(st->sweep);
+    arp_sweep_cancel(st->arp);
+    syn_scan_cancel(st->syn);
+    // Workers waiting for budget give up at once.
+    pacer_close(st->icmp_pacer);
+    pacer_close(st->tcp_pacer);
+    pacer_close(st->dns_pacer);
+    timing_window_close(st->tcp_window);
+    mutex_lock(&g_pool.life);
+    mutex_lock(&g_pool.lock);
+    for (int i = 0; i < g_pool.count; ++i) {
+        if (g_pool.sessions[i] != st) continue;
+        g_pool.sessions[i] = g_pool.sessions[--g_pool.count];
+        break;
     }
-    g_state.num_threads = 0;
+    mutex_unlock(&g_pool.lock);
+    wake_workers();
+    while (atomic_load(&st->users) > 0) thread_sleep_ms(1); // workers inside finish their task
+    st->started = 0;
+    icmp_sweep_destroy(st->sweep);
+    st->sweep = NULL;
+    arp_sweep_destroy(st->arp);
+    st->arp = NULL;
+    stop_syn(st);
+    // Fails the lookups still pending, which releases their hosts.
+    dns_resolver_destroy(st->dns);
+    st->dns = NULL;
+    free_pipeline(st);
+    if (g_pool.count == 0) pool_stop();
+    mutex_unlock(&g_pool.life);
     net_cleanup();
 }
 
+void scan_session_set_rates(ScanSession* st, const ScanConfig* cfg) {
+    if (!st || !cfg || !st->started) return;
+    st->cfg.icmp_rate_pps = cfg->icmp_rate_pps;
+    st->cfg.tcp_rate_pps = cfg->tcp_rate_pps;
+    st->cfg.dns_rate_pps = cfg->dns_rate_pps;
+    icmp_sweep_set_rate(st->sweep, cfg->icmp_rate_pps);
+    arp_sweep_set_rate(st->arp, cfg->icmp_rate_pps);
+    pacer_set_rate(st->icmp_pacer, cfg->icmp_rate_pps);
+    pacer_set_rate(st->tcp_pacer, cfg->tcp_rate_pps);
+    pacer_set_rate(st->dns_pacer, cfg->dns_rate_pps);
+    dns_resolver_set_rate(st->dns, cfg->dns_rate_pps);
+}
+
+int scan_session_is_running(const ScanSession* st) {
+    return st && st->started && atomic_load(&st->cancel) == 0 && atomic_load(&st->finished) == 0;
+}
+
+unsigned long long scan_session_poll(ScanSession* st, unsigned long long since_generation, DeviceList* out, size_t max_items) {
+    if (!st || !st->initialized) return 0;
+    ResultLog* log = &st->log;
+    size_t published = atomic_load_explicit(&log->published, memory_order_acquire);
+    if (since_generation >= published) return published;
+    size_t end = published;
+    if (max_items && end - (size_t)since_generation > max_items) end = (size_t)since_generation + max_items;
+    if (out) {
+        for (size_t i = (size_t)since_generation; i < end; ++i) {
+            device_list_push(out, &log->chunks[i / LOG_CHUNK][i % LOG_CHUNK]);
+        }
+    }
+    return end;
+}
+
+void scan_session_stats(ScanSession* st, ScanStats* out) {
+    memset(out, 0, sizeof(*out));
+    if (!st || !st->initialized) return;
+    MetricsSnapshot now;
+    metrics_snapshot(&now);
+    metrics_diff(&now, &st->metrics_base, &out->m);
+    unsigned long long end = atomic_load(&st->end_ns);
+    if (!end) end = clock_monotonic_ns();
+    out->elapsed_s = end > st->start_ns ? (double)(end - st->start_ns) / 1e9 : 0.0;
+    out->addresses = (unsigned long long)st->end_ip - st->start_ip + 1;
+    out->running = scan_session_is_running(st);
+    out->workers = out->running ? st->pool_workers : 0;
+    out->hosts_in_flight = atomic_load(&st->hosts_in_flight);
+    // Freed only by stop, on this thread.
+    out->tcp_window = st->tcp_window ? timing_window_size(st->tcp_window) : st->tcp_window_final;
+    unsigned long long next = atomic_load(&st->next_pos);
+    out->queued[STAGE_LIVENESS] = next < st->order.positions ? (long long)(st->order.positions - next) : 0;
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        out->active[stage] = atomic_load(&st->active[stage]);
+        out->limit[stage] = st->limit[stage];
+        // Queues live until the scan is reaped by stop, on this thread.
+        if (stage == STAGE_LIVENESS || !st->queues) continue;
+        for (int row = 0; row < st->num_queues; ++row)
+            out->queued[stage] += atomic_load_explicit(&queue_at(st, row, stage)->count, memory_order_relaxed);
+    }
+}
+
+// ---- Default session ------------------------------------------------------
+
+static ScanSession* default_session(void) {
+    if (!g_default) g_default = scan_session_create();
+    return g_default;
+}
+
+int parallel_scan_start(unsigned long start_ip_uint,
+                        unsigned long end_ip_uint,
+                        const ScanConfig* cfg,
+                        ScanLogFn logger) {
+    return parallel_scan_start_streaming(start_ip_uint, end_ip_uint, cfg, logger, NULL, NULL);
+}
+
+int parallel_scan_start_streaming(unsigned long start_ip_uint,
+                                  unsigned long end_ip_uint,
+                                  const ScanConfig* cfg,
+                                  ScanLogFn logger,
+                                  ScanResultFn fn,
+                                  void* user) {
+    return start_scan(default_session(), start_ip_uint, end_ip_uint, cfg, logger, fn, user, NULL);
+}
+
+int parallel_scan_resume(const char* path, ScanLogFn logger, ScanResultFn fn, void* user) {
+    return scan_session_resume(default_session(), path, logger, fn, user);
+}
+
+int parallel_scan_checkpoint(const char* path) { return scan_session_checkpoint(g_default, path); }
+
+int parallel_scan_progress(ScanCheckpoint* cp) { return scan_session_progress(g_default, cp); }
+
+void parallel_scan_stop(void) { scan_session_stop(g_default); }
+
+int parallel_scan_clear(void) {
+    scan_session_stop(g_default);
+    mutex_lock(&g_pool.life);
+    int idle = g_pool.count == 0;
+    if (idle) {
+        if (g_default) free_results(g_default);
+        dns_cache_clear();
+        string_arena_reset();
+    }
+    mutex_unlock(&g_pool.life);
+    return idle;
+}
+
+void parallel_scan_set_rates(const ScanConfig* cfg) { scan_session_set_rates(g_default, cfg); }
+
 void parallel_scan_snapshot(DeviceList* out) {
     if (!out) return;
-    EnterCriticalSection(&g_state.results_lock);
     device_list_clear(out);
-    for (size_t i = 0; i < g_state.results.count; ++i) {
-        device_list_push(out, &g_state.results.items[i]);
-    }
-    LeaveCriticalSection(&g_state.results_lock);
+    parallel_scan_poll(0, out, 0);
 }
 
-int parallel_scan_is_running(void) {
-    return (g_state.num_threads > 0) && (g_state.cancel == 0);
-}
\ No newline at end of file
+int parallel_scan_is_running(void) { return scan_session_is_running(g_default); }
+
+unsigned long long parallel_scan_poll(unsigned long long since_generation, DeviceList* out, size_t max_items) {
+    return scan_session_poll(g_default, since_generation, out, max_items);
+}
+
+void parallel_scan_stats(ScanStats* out) { scan_session_stats(g_default, out); }
+
+const char* parallel_scan_stage_name(int stage) {
+    static const char* const names[STAGE_COUNT] = { "liveness", "dns", "mac", "ports" };
+    return (stage >= 0 && stage < STAGE_COUNT) ? names[stage] : "unknown";
+}
+
+void parallel_scan_write_prometheus(FILE* f, const ScanStats* st) {
+    metrics_write_prometheus(f, &st->m);
+    fprintf(f, "# TYPE catnet_scan_running gauge\ncatnet_scan_running %d\n", st->running);
+    fprintf(f, "# TYPE catnet_scan_elapsed_seconds gauge\ncatnet_scan_elapsed_seconds %.3f\n", st->elapsed_s);
+    fprintf(f, "# TYPE catnet_scan_addresses gauge\ncatnet_scan_addresses %llu\n", st->addresses);
+    fprintf(f, "# TYPE catnet_scan_workers gauge\ncatnet_scan_workers %d\n", st->workers);
+    fprintf(f, "# TYPE catnet_scan_hosts_in_flight gauge\ncatnet_scan_hosts_in_flight %d\n", st->hosts_in_flight);
+    fprintf(f, "# TYPE catnet_scan_tcp_window gauge\ncatnet_scan_tcp_window %d\n", st->tcp_window);
+    fprintf(f, "# TYPE catnet_scan_stage_queued gauge\n");
+    for (int i = 0; i < STAGE_COUNT; ++i)
+        fprintf(f, "catnet_scan_stage_queued{stage=\"%s\"} %lld\n", parallel_scan_stage_name(i), st->queued[i]);
+    fprintf(f, "# TYPE catnet_scan_stage_active gauge\n");
+    for (int i = 0; i < STAGE_COUNT; ++i)
+        fprintf(f, "catnet_scan_stage_active{stage=\"%s\"} %d\n", parallel_scan_stage_name(i), st->active[i]);
+}
@@ -2,29 +2,136 @@
 #define PARALLEL_SCAN_H
 
 #include "app.h"
+#include "checkpoint.h"
+#include "metrics.h"
 #include "scan.h"
+#include <stdio.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 // Starts a parallel scan across [start_ip_uint, end_ip_uint] inclusive.
-// Returns 1 on success, 0 on failure.
+// Returns 1 on success, 0 on failure. 'logger' only receives messages raised
+// on the calling thread while starting; progress from the workers goes to
+// the event log (event_log.h), which the caller drains.
 int parallel_scan_start(unsigned long start_ip_uint,
                         unsigned long end_ip_uint,
                         const ScanConfig* cfg,
                         ScanLogFn logger);
 
+// Receives each finished host (alive or not). Called from worker threads,
+// one call at a time; 'info' is only valid during the call.
+typedef void (*ScanResultFn)(void* user, const DeviceInfo* info);
+
+// Same as parallel_scan_start, but finished hosts go to 'fn' instead of the
+// snapshot list, so memory does not grow with the range.
+int parallel_scan_start_streaming(unsigned long start_ip_uint,
+                                  unsigned long end_ip_uint,
+                                  const ScanConfig* cfg,
+                                  ScanLogFn logger,
+                                  ScanResultFn fn,
+                                  void* user);
+
+// Starts the scan saved in 'path' by parallel_scan_checkpoint, with its
+// range and configuration. Published addresses are skipped; hosts that were
+// in the pipeline go straight to the DNS, MAC and port stages. 'fn' as for
+// parallel_scan_start_streaming, or NULL for the snapshot list, which then
+// holds only the new results.
+int parallel_scan_resume(const char* path, ScanLogFn logger, ScanResultFn fn, void* user);
+
+// Saves the progress of the current or last scan to 'path' (checkpoint.h).
+// Callable while it runs; after parallel_scan_stop the file is exact.
+// Returns 0 if there is no scan, its range is larger than
+// CHECKPOINT_MAX_ADDRESSES or the file cannot be written.
+int parallel_scan_checkpoint(const char* path);
+// The same progress into 'cp' (checkpoint_init'ed here; checkpoint_free it),
+// for a caller that must flush its own output before saving: every address
+// marked done had its result handed to 'fn' before this returned.
+int parallel_scan_progress(ScanCheckpoint* cp);
+
 // Requests cancellation and waits for workers to finish.
 void parallel_scan_stop(void);
 
+// Stops and reaps the last scan, then frees its results, the DNS cache and
+// the string arena, so memory does not grow from one scan to the next.
+// Every name and port-list handle from earlier scans becomes invalid: the
+// caller must first drop its copies of their results (and drain the event
+// log). Returns 0, freeing nothing, while another session is running.
+int parallel_scan_clear(void);
+
+// Applies the packet rates of 'cfg' (icmp_rate_pps, tcp_rate_pps,
+// dns_rate_pps) to the running scan. Call from the thread that started it.
+void parallel_scan_set_rates(const ScanConfig* cfg);
+
 // Copies current results snapshot into 'out'.
 // 'out' must be initialized; its contents will be replaced.
 void parallel_scan_snapshot(DeviceList* out);
 
+// Results form an append-only log; the generation is the number of entries
+// published so far and restarts at 0 with each parallel_scan_start.
+// Appends the entries after 'since_generation' to 'out' (at most 'max_items',
+// 0 = all) and returns the generation to pass next time. Never blocks the
+// scan workers; an entry never changes once published. Call from the thread
+// that starts and stops scans. Always 0 in streaming mode.
+unsigned long long parallel_scan_poll(unsigned long long since_generation, DeviceList* out, size_t max_items);
+
 // Returns 1 if a scan is currently running.
 int parallel_scan_is_running(void);
 
+// Pipeline stages, in the order ScanStats reports them.
+enum { SCAN_STAGE_LIVENESS, SCAN_STAGE_DNS, SCAN_STAGE_MAC, SCAN_STAGE_PORTS, SCAN_STAGE_COUNT };
+
+typedef struct {
+    MetricsSnapshot m;             // counters and latencies since the scan started
+    double elapsed_s;              // until now, or until the last worker exited
+    unsigned long long addresses;  // size of the range
+    int running;
+    int workers;                   // worker threads still running
+    int hosts_in_flight;           // alive hosts not yet published
+    int tcp_window;                // connect probes allowed in flight; 0 = fixed timing
+    long long queued[SCAN_STAGE_COUNT]; // liveness: addresses not yet claimed
+    int active[SCAN_STAGE_COUNT];  // workers inside each stage
+    int limit[SCAN_STAGE_COUNT];
+} ScanStats;
+
+// Live figures for the current or last scan; all zero before the first one.
+// Never blocks the workers. Call from the thread that starts and stops scans.
+void parallel_scan_stats(ScanStats* out);
+// Prometheus text exposition of 'st': the metrics_write_prometheus series
+// plus catnet_scan_* gauges.
+void parallel_scan_write_prometheus(FILE* f, const ScanStats* st);
+const char* parallel_scan_stage_name(int stage); // "liveness", "dns", ...
+
+// ---- Sessions -------------------------------------------------------------
+// A session is one scan with its own range, configuration, pacers and
+// results. Sessions running at the same time share one pool of worker
+// threads, which takes turns between them; the pool starts with the first
+// running session and stops with the last. The parallel_scan_* functions
+// above drive a default session. Call a session's functions from one
+// thread; different sessions may be driven from different threads.
+// The counters in ScanStats.m are process-wide, so with several sessions
+// running each one's figures include the others' traffic.
+typedef struct ScanSession ScanSession;
+
+ScanSession* scan_session_create(void);
+// Stops the session if it runs and frees it with its results.
+void scan_session_destroy(ScanSession* s);
+
+// As parallel_scan_start_streaming and parallel_scan_resume. Returns 0 if
+// the session is running or 64 sessions already are.
+int scan_session_start(ScanSession* s, unsigned long start_ip, unsigned long end_ip, const ScanConfig* cfg,
+                       ScanLogFn logger, ScanResultFn fn, void* user);
+int scan_session_resume(ScanSession* s, const char* path, ScanLogFn logger, ScanResultFn fn, void* user);
+void scan_session_stop(ScanSession* s);
+int scan_session_is_running(const ScanSession* s);
+unsigned long long scan_session_poll(ScanSession* s, unsigned long long since_generation, DeviceList* out,
+                                     size_t max_items);
+void scan_session_set_rates(ScanSession* s, const ScanConfig* cfg);
+void scan_session_stats(ScanSession* s, ScanStats* out);
+int scan_session_checkpoint(ScanSession* s, const char* path);
+int scan_session_progress(ScanSession* s, ScanCheckpoint* cp);
+
 #ifdef __cplusplus
 }
 #endif
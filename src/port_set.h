@@ -0,0 +1,42 @@
+#ifndef PORT_SET_H
+#define PORT_SET_H
+
+// Compiled TCP port specification: "22,80,8000-8010", "1-65535", "all" or
+// "top-N" (the N most common ports, N up to port_top_table_size()), in any
+// combination. A set holds one bit per port for membership tests and the
+// ports in probe order: as listed, duplicates dropped, "top-N" most common
+// first.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PORT_SPEC_MAX 256 // bytes of a spec, NUL included (ScanConfig.ports)
+#define PORT_MAX 65535
+
+typedef struct {
+    uint64_t bits[(PORT_MAX + 1) / 64];
+    int* order;   // probe order
+    int count;
+} PortSet;
+
+// Returns 0, leaving 'ps' empty, if the spec is malformed, names no port or
+// memory runs out.
+int port_set_compile(PortSet* ps, const char* spec);
+void port_set_free(PortSet* ps);
+int port_set_has(const PortSet* ps, int port);
+
+// The built-in ranking: 'rank' 0 is the port most often found open; 0 for
+// ranks past the table.
+int port_top(int rank);
+int port_top_table_size(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PORT_SET_H
@@ -0,0 +1,160 @@
+#include "result_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Each node keeps its subtree size, so a display position is found by
+// skipping whole children. Inner nodes also keep the first row of each child
+// as its separator; rows are unique, so the order is total.
+#define RI_FANOUT 64
+
+typedef struct RiNode {
+    int leaf, n;
+    size_t size;              // rows in this subtree
+    uint32_t row[RI_FANOUT];  // leaf: the rows; inner: first row of each child
+    struct RiNode* kid[];     // inner nodes only
+} RiNode;
+
+struct ResultIndex {
+    const DeviceList* list;
+    ResultKey key;
+    RiNode* root;
+};
+
+int result_index_compare(const DeviceList* list, ResultKey key, uint32_t a, uint32_t b) {
+    const DeviceInfo* da = &list->items[a];
+    const DeviceInfo* db = &list->items[b];
+    int c = 0;
+    switch (key) {
+        case RESULT_KEY_STATUS: c = da->is_alive - db->is_alive; break;
+        case RESULT_KEY_HOSTNAME:
+            if (da->hostname != db->hostname) c = strcmp(device_hostname(da), device_hostname(db));
+            break;
+        case RESULT_KEY_IP: c = (da->ip < db->ip) ? -1 : (da->ip > db->ip); break;
+        case RESULT_KEY_PORTS: c = da->open_ports_count - db->open_ports_count; break;
+        case RESULT_KEY_MAC:
+            c = (da->has_mac != db->has_mac) ? (da->has_mac - db->has_mac) : memcmp(da->mac, db->mac, sizeof(da->mac));
+            break;
+        default: break;
+    }
+    if (c != 0) return c;
+    return (a < b) ? -1 : (a > b);
+}
+
+static RiNode* node_new(int leaf) {
+    size_t sz = sizeof(RiNode) + (leaf ? 0 : RI_FANOUT * sizeof(RiNode*));
+    RiNode* nd = (RiNode*)calloc(1, sz);
+    if (nd) nd->leaf = leaf;
+    return nd;
+}
+
+static void node_free(RiNode* nd) {
+    if (!nd) return;
+    if (!nd->leaf) { for (int i = 0; i < nd->n; ++i) node_free(nd->kid[i]); }
+    free(nd);
+}
+
+// Moves the upper half of a full node into a new sibling.
+static RiNode* node_split(RiNode* nd) {
+    RiNode* s = node_new(nd->leaf);
+    if (!s) return NULL;
+    int half = nd->n / 2;
+    s->n = nd->n - half;
+    memcpy(s->row, nd->row + half, (size_t)s->n * sizeof(uint32_t));
+    if (nd->leaf) {
+        s->size = (size_t)s->n;
+    } else {
+        memcpy(s->kid, nd->kid + half, (size_t)s->n * sizeof(RiNode*));
+        for (int i = 0; i < s->n; ++i) s->size += s->kid[i]->size;
+    }
+    nd->n = half;
+    nd->size -= s->size;
+    return s;
+}
+
+// Inserts 'row' below 'nd'. Returns 1 on success and sets '*split' when 'nd'
+// filled up and handed its upper half to a new sibling. A node that stayed
+// full because that allocation failed refuses further rows.
+static int node_insert(const ResultIndex* ix, RiNode* nd, uint32_t row, RiNode** split) {
+    *split = NULL;
+    if (nd->n == RI_FANOUT) return 0;
+    // First slot whose row sorts after 'row'.
+    int lo = 0, hi = nd->n;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (result_index_compare(ix->list, ix->key, nd->row[mid], row) > 0) hi = mid; else lo = mid + 1;
+    }
+    if (nd->leaf) {
+        memmove(nd->row + lo + 1, nd->row + lo, (size_t)(nd->n - lo) * sizeof(uint32_t));
+        nd->row[lo] = row;
+    } else {
+        int c = lo > 0 ? lo - 1 : 0;
+        RiNode* s;
+        if (!node_insert(ix, nd->kid[c], row, &s)) return 0;
+        nd->row[c] = nd->kid[c]->row[0];
+        if (s) {
+            memmove(nd->row + c + 2, nd->row + c + 1, (size_t)(nd->n - c - 1) * sizeof(uint32_t));
+            memmove(nd->kid + c + 2, nd->kid + c + 1, (size_t)(nd->n - c - 1) * sizeof(RiNode*));
+            nd->row[c + 1] = s->row[0];
+            nd->kid[c + 1] = s;
+        } else {
+            nd->size++;
+            return 1;
+        }
+    }
+    nd->n++;
+    nd->size++;
+    if (nd->n == RI_FANOUT) *split = node_split(nd);
+    return 1;
+}
+
+ResultIndex* result_index_create(const DeviceList* list, ResultKey key) {
+    ResultIndex* ix = (ResultIndex*)calloc(1, sizeof(ResultIndex));
+    if (!ix) return NULL;
+    ix->list = list;
+    ix->key = key;
+    return ix;
+}
+
+void result_index_destroy(ResultIndex* ix) {
+    if (!ix) return;
+    node_free(ix->root);
+    free(ix);
+}
+
+int result_index_insert(ResultIndex* ix, uint32_t row) {
+    if (!ix->root && !(ix->root = node_new(1))) return 0;
+    // A root that may split needs its new parent up front, so a failed
+    // allocation cannot strand the upper half.
+    RiNode* r = NULL;
+    if (ix->root->n == RI_FANOUT - 1 && !(r = node_new(0))) return 0;
+    RiNode* s;
+    if (!node_insert(ix, ix->root, row, &s)) { free(r); return 0; }
+    if (!s) free(r);
+    else {
+        r->n = 2;
+        r->row[0] = ix->root->row[0]; r->kid[0] = ix->root;
+        r->row[1] = s->row[0];        r->kid[1] = s;
+        r->size = ix->root->size + s->size;
+        ix->root = r;
+    }
+    return 1;
+}
+
+uint32_t result_index_at(const ResultIndex* ix, size_t pos) {
+    const RiNode* nd = ix->root;
+    while (!nd->leaf) {
+        int i = 0;
+        while (i < nd->n - 1 && pos >= nd->kid[i]->size) pos -= nd->kid[i++]->size;
+        nd = nd->kid[i];
+    }
+    return nd->row[pos];
+}
+
+size_t result_index_count(const ResultIndex* ix) {
+    return ix->root ? ix->root->size : 0;
+}
+
+void result_index_clear(ResultIndex* ix) {
+    node_free(ix->root);
+    ix->root = NULL;
+}
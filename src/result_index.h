@@ -0,0 +1,48 @@
+#ifndef RESULT_INDEX_H
+#define RESULT_INDEX_H
+
+// Sorted views over a DeviceList: a counted B+tree of row numbers ordered by
+// one column. Inserting a row and fetching the row at a display position are
+// both O(log n), and the records themselves never move.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include "app.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Same order as the GUI table columns.
+typedef enum {
+    RESULT_KEY_STATUS,
+    RESULT_KEY_HOSTNAME,
+    RESULT_KEY_IP,
+    RESULT_KEY_PORTS,
+    RESULT_KEY_MAC,
+    RESULT_KEY_COUNT
+} ResultKey;
+
+typedef struct ResultIndex ResultIndex;
+
+// Rows are positions in 'list', which may grow (and reallocate) between calls
+// but must not reorder. Equal keys keep arrival (row) order.
+ResultIndex* result_index_create(const DeviceList* list, ResultKey key);
+void result_index_destroy(ResultIndex* ix);
+
+// Returns 0 if out of memory; the row is then missing from the view.
+int result_index_insert(ResultIndex* ix, uint32_t row);
+// Row at ascending position 'pos' (< result_index_count).
+uint32_t result_index_at(const ResultIndex* ix, size_t pos);
+size_t result_index_count(const ResultIndex* ix);
+void result_index_clear(ResultIndex* ix);
+
+// <0, 0 or >0 as list->items[a] sorts before, with or after items[b].
+int result_index_compare(const DeviceList* list, ResultKey key, uint32_t a, uint32_t b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RESULT_INDEX_H
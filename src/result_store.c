@@ -0,0 +1,622 @@
+#include "result_store.h"
+#include "string_arena.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0601
+#endif
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ---- Writer ---------------------------------------------------------------
+
+// Producers copy records into 'pending'; the thread swaps it with 'batch',
+// rewrites the string handles and writes the batch in one call. Names are
+// deduplicated by arena handle, so each distinct name is stored once.
+// Until close, the table also goes to a "<path>.strings" journal, each
+// batch's strings flushed before its records, so a store cut off by a crash
+// still resolves every record that reached the file.
+#define WRITER_FLUSH_RECORDS 4096     // wake the thread at this many queued
+#define WRITER_MAX_PENDING (1u << 20) // producers wait beyond this many
+#define WRITER_IDLE_MS 200
+#define WRITER_MAX_STRINGS 0x7FFFFFFFu // offsets must fit below the mounted bit
+
+struct ResultWriter {
+    FILE* f;
+    FILE* journal;
+    char* journal_path;
+    Thread thread;
+    Mutex lock;
+    CondVar cv;       // queued work or closing, for the thread
+    CondVar room_cv;  // a batch was taken, for blocked producers
+    CondVar synced_cv; // a sync finished, for result_writer_sync
+    DeviceInfo* pending; // under lock
+    size_t pending_count, pending_cap;
+    int closing;         // under lock
+    uint64_t sync_requested, sync_done; // under lock
+    atomic_int failed;
+    ResultStoreHeader hdr; // range under lock; the rest is the thread's
+    // Write-behind thread only.
+    DeviceInfo* batch;
+    size_t batch_cap;
+    uint64_t written;
+    unsigned char* strings;
+    size_t strings_size, strings_cap;
+    size_t journaled; // table bytes already in the journal
+    uint32_t* name_keys; // arena handle -> table offset, open addressing
+    uint32_t* name_offs;
+    size_t names_cap, names_count;
+};
+
+static size_t name_index(uint32_t key, size_t cap) {
+    uint32_t h = key * 2654435761u;
+    return (h ^ (h >> 15)) & (cap - 1);
+}
+
+// Appends 'len' bytes to the table; 0 if it would not fit.
+static uint32_t strings_put(ResultWriter* w, const void* data, size_t len) {
+    if (w->strings_size + len > WRITER_MAX_STRINGS) return 0;
+    if (w->strings_size + len > w->strings_cap) {
+        size_t ncap = w->strings_cap;
+        while (ncap < w->strings_size + len) ncap *= 2;
+        unsigned char* nb = (unsigned char*)realloc(w->strings, ncap);
+        if (!nb) return 0;
+        w->strings = nb;
+        w->strings_cap = ncap;
+    }
+    uint32_t off = (uint32_t)w->strings_size;
+    memcpy(w->strings + off, data, len);
+    w->strings_size += len;
+    return off;
+}
+
+// Ends the table in a NUL (a port list may come last), so no name read from
+// a cut-off copy runs past it.
+static void strings_terminate(ResultWriter* w) {
+    unsigned char nul = 0;
+    if (w->strings[w->strings_size - 1] != 0 && !strings_put(w, &nul, 1)) w->strings[w->strings_size - 1] = 0;
+}
+
+// Appends the table's new bytes to the journal; 0 on a write error.
+static int journal_sync(ResultWriter* w) {
+    strings_terminate(w);
+    size_t n = w->strings_size - w->journaled;
+    if (n && (fwrite(w->strings + w->journaled, 1, n, w->journal) != n || fflush(w->journal) != 0)) return 0;
+    w->journaled = w->strings_size;
+    return 1;
+}
+
+static int names_grow(ResultWriter* w) {
+    size_t ncap = w->names_cap ? w->names_cap * 2 : 1024;
+    uint32_t* nk = (uint32_t*)calloc(ncap, sizeof(uint32_t));
+    uint32_t* no = (uint32_t*)calloc(ncap, sizeof(uint32_t));
+    if (!nk || !no) { free(nk); free(no); return 0; }
+    for (size_t i = 0; i < w->names_cap; ++i) {
+        if (!w->name_keys[i]) continue;
+        size_t k = name_index(w->name_keys[i], ncap);
+        while (nk[k]) k = (k + 1) & (ncap - 1);
+        nk[k] = w->name_keys[i];
+        no[k] = w->name_offs[i];
+    }
+    free(w->name_keys); free(w->name_offs);
+    w->name_keys = nk; w->name_offs = no;
+    w->names_cap = ncap;
+    return 1;
+}
+
+// Table offset of arena name 'h' (0 = unnamed, or the table is full).
+static uint32_t name_offset(ResultWriter* w, uint32_t h) {
+    if (!h) return 0;
+    if ((w->names_count + 1) * 10 > w->names_cap * 7 && !names_grow(w)) return 0;
+    size_t k = name_index(h, w->names_cap);
+    for (; w->name_keys[k]; k = (k + 1) & (w->names_cap - 1)) {
+        if (w->name_keys[k] == h) return w->name_offs[k];
+    }
+    const char* s = string_arena_get(h);
+    uint32_t off = s[0] ? strings_put(w, s, strlen(s) + 1) : 0;
+    if (!off) return 0;
+    w->name_keys[k] = h;
+    w->name_offs[k] = off;
+    w->names_count++;
+    return off;
+}
+
+static void convert_record(ResultWriter* w, DeviceInfo* di) {
+    uint32_t off = name_offset(w, di->hostname);
+    di->hostname = off ? (STRING_ARENA_MOUNTED | off) : 0;
+    off = name_offset(w, di->services);
+    di->services = off ? (STRING_ARENA_MOUNTED | off) : 0;
+    if (di->open_ports_count > DEVICE_INLINE_PORTS) {
+        size_t len = (size_t)(di->open_ports_count - DEVICE_INLINE_PORTS) * sizeof(uint16_t);
+        const void* more = string_arena_data(di->more_ports, len);
+        off = more ? strings_put(w, more, len) : 0;
+        if (!off) di->open_ports_count = DEVICE_INLINE_PORTS;
+        di->more_ports = off ? (STRING_ARENA_MOUNTED | off) : 0;
+    } else {
+        di->more_ports = 0;
+    }
+}
+
+// Pushes the store and the journal to the disk; 0 on an I/O error.
+static int file_sync(FILE* f) {
+    if (fflush(f) != 0) return 0;
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+static int file_truncate(FILE* f, uint64_t size) {
+    if (fflush(f) != 0) return 0;
+#ifdef _WIN32
+    return _chsize_s(_fileno(f), (long long)size) == 0;
+#else
+    return ftruncate(fileno(f), (off_t)size) == 0;
+#endif
+}
+
+static void writer_thread(void* arg) {
+    ResultWriter* w = (ResultWriter*)arg;
+    for (;;) {
+        mutex_lock(&w->lock);
+        while (w->pending_count == 0 && !w->closing && w->sync_requested == w->sync_done)
+            cond_timedwait(&w->cv, &w->lock, WRITER_IDLE_MS);
+        DeviceInfo* t = w->pending; w->pending = w->batch; w->batch = t;
+        size_t tc = w->pending_cap; w->pending_cap = w->batch_cap; w->batch_cap = tc;
+        size_t n = w->pending_count;
+        w->pending_count = 0;
+        int closing = w->closing;
+        // Everything appended before this request is in the batch or written.
+        uint64_t sync = w->sync_requested;
+        cond_broadcast(&w->room_cv);
+        mutex_unlock(&w->lock);
+        if (n && !atomic_load(&w->failed)) {
+            for (size_t i = 0; i < n; ++i) convert_record(w, &w->batch[i]);
+            if (!journal_sync(w) || fwrite(w->batch, sizeof(DeviceInfo), n, w->f) != n) atomic_store(&w->failed, 1);
+            else w->written += n;
+        }
+        if (sync != w->sync_done) {
+            if (!atomic_load(&w->failed) && (!file_sync(w->journal) || !file_sync(w->f))) atomic_store(&w->failed, 1);
+            mutex_lock(&w->lock);
+            w->sync_done = sync;
+            cond_broadcast(&w->synced_cv);
+            mutex_unlock(&w->lock);
+        }
+        if (closing && n == 0) break;
+    }
+}
+
+static void writer_free(ResultWriter* w) {
+    mutex_destroy(&w->lock);
+    cond_destroy(&w->cv);
+    cond_destroy(&w->room_cv);
+    cond_destroy(&w->synced_cv);
+    free(w->journal_path);
+    free(w->pending);
+    free(w->batch);
+    free(w->strings);
+    free(w->name_keys);
+    free(w->name_offs);
+    free(w);
+}
+
+// A writer with an empty table and no files yet.
+static ResultWriter* writer_new(const char* path, unsigned long start_ip, unsigned long end_ip) {
+    ResultWriter* w = (ResultWriter*)calloc(1, sizeof(ResultWriter));
+    if (!w) return NULL;
+    memcpy(w->hdr.magic, RESULT_STORE_MAGIC, sizeof(w->hdr.magic));
+    w->hdr.version = RESULT_STORE_VERSION;
+    w->hdr.record_size = (uint32_t)sizeof(DeviceInfo);
+    w->hdr.records_offset = sizeof(ResultStoreHeader);
+    w->hdr.start_ip = (uint32_t)start_ip;
+    w->hdr.end_ip = (uint32_t)end_ip;
+    w->hdr.created = (int64_t)time(NULL);
+    mutex_init(&w->lock);
+    cond_init(&w->cv);
+    cond_init(&w->room_cv);
+    cond_init(&w->synced_cv);
+    // Offset 0 of the table is the empty string, so a 0 offset means none.
+    w->strings = (unsigned char*)calloc(1, 65536);
+    w->strings_cap = 65536;
+    w->strings_size = 1;
+    size_t plen = strlen(path);
+    w->journal_path = (char*)malloc(plen + sizeof(".strings"));
+    if (!w->strings || !w->journal_path) { writer_free(w); return NULL; }
+    memcpy(w->journal_path, path, plen);
+    memcpy(w->journal_path + plen, ".strings", sizeof(".strings"));
+    return w;
+}
+
+// Opens a new journal holding the table so far and starts the thread, once
+// 'w->f' is positioned after the last record.
+static int writer_start(ResultWriter* w) {
+    setvbuf(w->f, NULL, _IOFBF, 1 << 20);
+    w->journal = fopen(w->journal_path, "wb");
+    if (!w->journal) return 0;
+    if (!journal_sync(w) || !thread_create(&w->thread, writer_thread, w)) {
+        fclose(w->journal);
+        w->journal = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+ResultWriter* result_writer_create(const char* path, unsigned long start_ip, unsigned long end_ip) {
+    ResultWriter* w = writer_new(path, start_ip, end_ip);
+    if (!w) return NULL;
+    w->f = fopen(path, "wb");
+    if (!w->f) { writer_free(w); return NULL; }
+    // Rewritten by close; until then readers count records from the file size.
+    if (fwrite(&w->hdr, sizeof(w->hdr), 1, w->f) != 1 || !writer_start(w)) {
+        fclose(w->f);
+        remove(path);
+        remove(w->journal_path);
+        writer_free(w);
+        return NULL;
+    }
+    return w;
+}
+
+// End of the table bytes the records refer to.
+static uint64_t strings_referenced(const DeviceInfo* r, size_t count) {
+    uint64_t end = 1;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t e;
+        if (r[i].hostname && (e = (uint64_t)(r[i].hostname & ~STRING_ARENA_MOUNTED) + 1) > end) end = e;
+        if (r[i].services && (e = (uint64_t)(r[i].services & ~STRING_ARENA_MOUNTED) + 1) > end) end = e;
+        if (r[i].more_ports && r[i].open_ports_count > DEVICE_INLINE_PORTS &&
+            (e = (uint64_t)(r[i].more_ports & ~STRING_ARENA_MOUNTED) +
+                 (uint64_t)(r[i].open_ports_count - DEVICE_INLINE_PORTS) * sizeof(uint16_t)) > end) end = e;
+    }
+    return end;
+}
+
+static const unsigned char* store_strings(const ResultStore* s);
+
+ResultWriter* result_writer_reopen(const char* path, unsigned long start_ip, unsigned long end_ip) {
+    FILE* probe = fopen(path, "rb");
+    if (!probe) return result_writer_create(path, start_ip, end_ip);
+    fclose(probe);
+    ResultStore* s = result_store_open(path);
+    if (!s) return NULL;
+    ResultWriter* w = writer_new(path, start_ip, end_ip);
+    const ResultStoreHeader* h = result_store_header(s);
+    // The records stay in place; the table, complete or from the journal,
+    // moves back into memory and is written again after the new records.
+    // Bytes a lost journal held are zeros, so records that used them read
+    // as unnamed instead of picking up the names stored next.
+    uint64_t need = strings_referenced(result_store_records(s), result_store_count(s));
+    int ok = w && h->records_offset == sizeof(ResultStoreHeader) && need <= WRITER_MAX_STRINGS;
+    if (ok && h->strings_size > 1) {
+        w->strings_size = 0;
+        strings_put(w, store_strings(s), (size_t)h->strings_size);
+        ok = w->strings_size == h->strings_size;
+    }
+    while (ok && w->strings_size < need) {
+        static const unsigned char zeros[4096];
+        size_t n = need - w->strings_size < sizeof(zeros) ? (size_t)(need - w->strings_size) : sizeof(zeros);
+        ok = strings_put(w, zeros, n) != 0;
+    }
+    if (ok) {
+        w->written = h->record_count;
+        w->hdr.created = h->created;
+        if (h->start_ip < w->hdr.start_ip) w->hdr.start_ip = h->start_ip;
+        if (h->end_ip > w->hdr.end_ip) w->hdr.end_ip = h->end_ip;
+    }
+    result_store_close(s);
+    if (!ok) { if (w) writer_free(w); return NULL; }
+    // Cut the old table (or a torn last record) and mark the store open
+    // again, so a crash from here on reads like any unfinished store.
+    w->f = fopen(path, "r+b");
+    ok = w->f && file_truncate(w->f, w->hdr.records_offset + w->written * sizeof(DeviceInfo)) &&
+         fseek(w->f, 0, SEEK_SET) == 0 && fwrite(&w->hdr, sizeof(w->hdr), 1, w->f) == 1 &&
+         fseek(w->f, 0, SEEK_END) == 0 && writer_start(w);
+    if (!ok) {
+        if (w->f) fclose(w->f);
+        writer_free(w);
+        return NULL;
+    }
+    return w;
+}
+
+void result_writer_extend_range(ResultWriter* w, unsigned long start_ip, unsigned long end_ip) {
+    if (!w) return;
+    mutex_lock(&w->lock);
+    if ((uint32_t)start_ip < w->hdr.start_ip) w->hdr.start_ip = (uint32_t)start_ip;
+    if ((uint32_t)end_ip > w->hdr.end_ip) w->hdr.end_ip = (uint32_t)end_ip;
+    mutex_unlock(&w->lock);
+}
+
+int result_writer_append(ResultWriter* w, const DeviceInfo* di) {
+    if (!w || atomic_load_explicit(&w->failed, memory_order_relaxed)) return 0;
+    mutex_lock(&w->lock);
+    while (w->pending_count >= WRITER_MAX_PENDING && !w->closing) cond_wait(&w->room_cv, &w->lock);
+    if (w->pending_count == w->pending_cap) {
+        size_t ncap = w->pending_cap ? w->pending_cap * 2 : WRITER_FLUSH_RECORDS;
+        DeviceInfo* nb = (DeviceInfo*)realloc(w->pending, ncap * sizeof(DeviceInfo));
+        if (!nb) { mutex_unlock(&w->lock); atomic_store(&w->failed, 1); return 0; }
+        w->pending = nb;
+        w->pending_cap = ncap;
+    }
+    w->pending[w->pending_count++] = *di;
+    if (w->pending_count == WRITER_FLUSH_RECORDS) cond_signal(&w->cv);
+    mutex_unlock(&w->lock);
+    return 1;
+}
+
+int result_writer_sync(ResultWriter* w) {
+    if (!w) return 0;
+    mutex_lock(&w->lock);
+    uint64_t ticket = ++w->sync_requested;
+    cond_signal(&w->cv);
+    while (w->sync_done < ticket) cond_wait(&w->synced_cv, &w->lock);
+    mutex_unlock(&w->lock);
+    return !atomic_load(&w->failed);
+}
+
+int result_writer_close(ResultWriter* w) {
+    if (!w) return 0;
+    mutex_lock(&w->lock);
+    w->closing = 1;
+    cond_signal(&w->cv);
+    mutex_unlock(&w->lock);
+    thread_join(&w->thread);
+    int ok = !atomic_load(&w->failed);
+    // The string table goes after the last record, then the final header.
+    strings_terminate(w);
+    w->hdr.record_count = w->written;
+    w->hdr.strings_offset = w->hdr.records_offset + w->written * sizeof(DeviceInfo);
+    w->hdr.strings_size = w->strings_size;
+    w->hdr.flags = RESULT_STORE_COMPLETE;
+    if (ok && fwrite(w->strings, 1, w->strings_size, w->f) != w->strings_size) ok = 0;
+    if (ok && (fflush(w->f) != 0 || fseek(w->f, 0, SEEK_SET) != 0 || fwrite(&w->hdr, sizeof(w->hdr), 1, w->f) != 1)) ok = 0;
+    if (fclose(w->f) != 0) ok = 0;
+    // A finished store carries its own table; a failed one keeps the journal.
+    fclose(w->journal);
+    if (ok) remove(w->journal_path);
+    writer_free(w);
+    return ok;
+}
+
+// ---- Reader ---------------------------------------------------------------
+
+typedef struct {
+    const unsigned char* base;
+    uint64_t size;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+} MappedFile;
+
+struct ResultStore {
+    MappedFile map;
+    MappedFile journal; // an unfinished store's "<path>.strings", if any
+    const unsigned char* strings; // in 'map' or 'journal'; NULL = none
+    ResultStoreHeader hdr; // record_count and strings_* checked against the size
+};
+
+static ResultStore* g_mounted; // store whose table the arena points at
+
+// Maps 'path' read-only if it holds at least 'min_size' bytes.
+static int map_file(MappedFile* s, const char* path, uint64_t min_size) {
+#ifdef _WIN32
+    s->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (s->file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(s->file, &sz) || (uint64_t)sz.QuadPart < min_size) { CloseHandle(s->file); return 0; }
+    s->mapping = CreateFileMappingA(s->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!s->mapping) { CloseHandle(s->file); return 0; }
+    s->base = (const unsigned char*)MapViewOfFile(s->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!s->base) { CloseHandle(s->mapping); CloseHandle(s->file); return 0; }
+    s->size = (uint64_t)sz.QuadPart;
+    return 1;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < min_size) { close(fd); return 0; }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file
+    if (p == MAP_FAILED) return 0;
+    s->base = (const unsigned char*)p;
+    s->size = (uint64_t)st.st_size;
+    return 1;
+#endif
+}
+
+static void unmap_file(MappedFile* s) {
+    if (!s->base) return;
+#ifdef _WIN32
+    UnmapViewOfFile(s->base);
+    CloseHandle(s->mapping);
+    CloseHandle(s->file);
+#else
+    munmap((void*)s->base, (size_t)s->size);
+#endif
+    s->base = NULL;
+}
+
+// Maps the journal an unfinished writer left next to 'path' as the table.
+// The writer may have been cut off mid-write; the table ends at the last NUL.
+static void open_journal(ResultStore* s, const char* path) {
+    size_t plen = strlen(path);
+    char* jpath = (char*)malloc(plen + sizeof(".strings"));
+    if (!jpath) return;
+    memcpy(jpath, path, plen);
+    memcpy(jpath + plen, ".strings", sizeof(".strings"));
+    int mapped = map_file(&s->journal, jpath, 1);
+    free(jpath);
+    if (!mapped) return;
+    uint64_t n = s->journal.size < WRITER_MAX_STRINGS ? s->journal.size : WRITER_MAX_STRINGS;
+    while (n && s->journal.base[n - 1] != 0) n--;
+    if (!n) { unmap_file(&s->journal); return; }
+    s->strings = s->journal.base;
+    s->hdr.strings_size = n;
+}
+
+ResultStore* result_store_open(const char* path) {
+    ResultStore* s = (ResultStore*)calloc(1, sizeof(ResultStore));
+    if (!s) return NULL;
+    if (!map_file(&s->map, path, sizeof(ResultStoreHeader))) { free(s); return NULL; }
+    const unsigned char* base = s->map.base;
+    uint64_t size = s->map.size;
+    ResultStoreHeader* h = &s->hdr;
+    memcpy(h, base, sizeof(*h));
+    int ok = memcmp(h->magic, RESULT_STORE_MAGIC, sizeof(h->magic)) == 0 && h->version == RESULT_STORE_VERSION &&
+             h->record_size == sizeof(DeviceInfo) && h->records_offset >= sizeof(ResultStoreHeader) &&
+             h->records_offset <= size && h->records_offset % sizeof(uint32_t) == 0;
+    if (ok && (h->flags & RESULT_STORE_COMPLETE)) {
+        // The table must fit in the file and end with a NUL, so no name
+        // read from it runs past the mapping.
+        ok = h->record_count <= (size - h->records_offset) / sizeof(DeviceInfo) &&
+             h->strings_offset >= h->records_offset + h->record_count * sizeof(DeviceInfo) &&
+             h->strings_offset <= size && h->strings_size <= size - h->strings_offset &&
+             h->strings_size <= WRITER_MAX_STRINGS &&
+             (h->strings_size == 0 || base[h->strings_offset + h->strings_size - 1] == 0);
+        if (h->strings_size) s->strings = base + h->strings_offset;
+    } else if (ok) {
+        h->record_count = (size - h->records_offset) / sizeof(DeviceInfo);
+        h->strings_offset = h->strings_size = 0;
+        open_journal(s, path);
+    }
+    if (!ok) { unmap_file(&s->map); free(s); return NULL; }
+    return s;
+}
+
+void result_store_close(ResultStore* s) {
+    if (!s) return;
+    if (g_mounted == s) { string_arena_mount(NULL, 0); g_mounted = NULL; }
+    unmap_file(&s->journal);
+    unmap_file(&s->map);
+    free(s);
+}
+
+const ResultStoreHeader* result_store_header(const ResultStore* s) { return &s->hdr; }
+static const unsigned char* store_strings(const ResultStore* s) { return s->strings; }
+size_t result_store_count(const ResultStore* s) { return s ? (size_t)s->hdr.record_count : 0; }
+
+const DeviceInfo* result_store_records(const ResultStore* s) {
+    return s ? (const DeviceInfo*)(s->map.base + s->hdr.records_offset) : NULL;
+}
+
+void result_store_mount(ResultStore* s) {
+    if (!s) return;
+    string_arena_mount(s->strings, (size_t)s->hdr.strings_size);
+    g_mounted = s;
+}
+
+// ---- Merge ----------------------------------------------------------------
+
+// Re-homes a store record's names in the process arena: the writer resolves
+// handles on its own thread, after the next input is mounted.
+static void unmount_record(DeviceInfo* di) {
+    const char* name = device_hostname(di);
+    di->hostname = name[0] ? string_arena_intern(name) : 0;
+    const char* services = device_services(di);
+    di->services = services[0] ? string_arena_intern(services) : 0;
+    if (di->open_ports_count > DEVICE_INLINE_PORTS) {
+        size_t len = (size_t)(di->open_ports_count - DEVICE_INLINE_PORTS) * sizeof(uint16_t);
+        const void* more = string_arena_data(di->more_ports, len);
+        di->more_ports = more ? string_arena_put(more, len) : 0;
+        if (!di->more_ports) di->open_ports_count = DEVICE_INLINE_PORTS;
+    } else {
+        di->more_ports = 0;
+    }
+}
+
+// One input record in the merge: ordered by address, alive before dead,
+// then by position across the inputs (input order, then record order).
+typedef struct {
+    uint64_t key; // ip << 1 | dead
+    uint64_t pos;
+} MergeRef;
+
+static int cmp_merge_ref(const void* a, const void* b) {
+    const MergeRef* x = (const MergeRef*)a;
+    const MergeRef* y = (const MergeRef*)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->pos < y->pos ? -1 : x->pos > y->pos;
+}
+
+// Passes 2 and 3 of a merge over 'total' input records. Memory follows the
+// record count, not the address span.
+static int merge_records(ResultStore** stores, int count, uint64_t total, ResultWriter* w, ResultMergeStats* st) {
+    MergeRef* refs = (MergeRef*)malloc(sizeof(MergeRef) * (size_t)total);
+    uint64_t* keep = (uint64_t*)calloc((size_t)((total + 63) / 64), sizeof(uint64_t));
+    int ok = refs && keep;
+    // Pass 2: sort the records by address; the first of each address is
+    // the one kept, so an alive record wins and then the earlier input.
+    uint64_t n = 0;
+    for (int i = 0; ok && i < count; ++i) {
+        const DeviceInfo* r = result_store_records(stores[i]);
+        for (size_t k = 0; k < result_store_count(stores[i]); ++k, ++n) {
+            refs[n].key = ((uint64_t)r[k].ip << 1) | (r[k].is_alive ? 0 : 1);
+            refs[n].pos = n;
+        }
+    }
+    if (ok) qsort(refs, (size_t)total, sizeof(MergeRef), cmp_merge_ref);
+    for (uint64_t k = 0; ok && k < total; ++k) {
+        if (k == 0 || (refs[k].key >> 1) != (refs[k - 1].key >> 1)) keep[refs[k].pos >> 6] |= 1ull << (refs[k].pos & 63);
+    }
+    free(refs);
+    // Pass 3: write the kept records in input order.
+    n = 0;
+    for (int i = 0; ok && i < count; ++i) {
+        result_store_mount(stores[i]);
+        const DeviceInfo* r = result_store_records(stores[i]);
+        for (size_t k = 0; ok && k < result_store_count(stores[i]); ++k, ++n) {
+            st->read++;
+            if (!((keep[n >> 6] >> (n & 63)) & 1)) {
+                st->duplicates++;
+                continue;
+            }
+            DeviceInfo di = r[k];
+            unmount_record(&di);
+            ok = result_writer_append(w, &di);
+            if (ok) st->written++;
+        }
+    }
+    free(keep);
+    return ok;
+}
+
+int result_store_merge(const char* out_path, const char* const* inputs, int count, ResultMergeStats* stats) {
+    ResultMergeStats st;
+    memset(&st, 0, sizeof(st));
+    st.bad_input = -1;
+    ResultStore** stores = (ResultStore**)calloc(count > 0 ? (size_t)count : 1, sizeof(ResultStore*));
+    int ok = stores != NULL;
+    // Pass 1: open everything, count the records and find the header range.
+    uint64_t total = 0;
+    unsigned long range_lo = 0xFFFFFFFFul, range_hi = 0;
+    for (int i = 0; ok && i < count; ++i) {
+        stores[i] = result_store_open(inputs[i]);
+        if (!stores[i]) { st.bad_input = i; ok = 0; break; }
+        const ResultStoreHeader* h = &stores[i]->hdr;
+        if (h->start_ip <= h->end_ip) {
+            if (h->start_ip < range_lo) range_lo = h->start_ip;
+            if (h->end_ip > range_hi) range_hi = h->end_ip;
+        }
+        total += result_store_count(stores[i]);
+    }
+    ResultWriter* w = ok ? result_writer_create(out_path, range_lo, range_hi) : NULL;
+    if (!w) ok = 0;
+    if (ok && total) ok = merge_records(stores, count, total, w, &st);
+    if (w && !result_writer_close(w)) ok = 0;
+    for (int i = 0; stores && i < count; ++i) result_store_close(stores[i]);
+    free(stores);
+    if (stats) *stats = st;
+    return ok;
+}
@@ -0,0 +1,100 @@
+#ifndef RESULT_STORE_H
+#define RESULT_STORE_H
+
+// Binary scan result files. A file is a header, the host records (DeviceInfo
+// exactly as in memory) and a string table for host names, service lists
+// and long port lists. A writer appends records from any thread while a
+// write-behind thread does the I/O; a reader maps the file and uses the
+// records in place, so opening costs the same for ten hosts or ten million.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include "app.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RESULT_STORE_MAGIC "CATNETR\0"
+#define RESULT_STORE_VERSION 2 // 2: DeviceInfo.services
+#define RESULT_STORE_COMPLETE 1u // header flag: counts and string table are final
+
+// Little-endian, at offset 0. Records follow at 'records_offset'; their
+// hostname, services and more_ports fields are STRING_ARENA_MOUNTED | offset into the
+// string table (0 = none), which starts with a NUL byte.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;     // sizeof(DeviceInfo)
+    uint64_t record_count;
+    uint64_t records_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint32_t start_ip, end_ip; // scanned range, host order
+    int64_t created;          // Unix time
+    uint32_t flags;
+    uint32_t reserved;
+} ResultStoreHeader;
+
+typedef struct ResultWriter ResultWriter;
+
+// Creates (truncates) 'path' and its "<path>.strings" journal and starts the
+// write-behind thread. NULL if either file cannot be created.
+ResultWriter* result_writer_create(const char* path, unsigned long start_ip, unsigned long end_ip);
+// Continues the store at 'path', e.g. one an interrupted scan left behind:
+// its records and names stay and new records go after them; the header
+// range is widened to [start_ip, end_ip]. Creates the store if 'path' does
+// not exist. NULL if it is not a result store or cannot be written.
+ResultWriter* result_writer_reopen(const char* path, unsigned long start_ip, unsigned long end_ip);
+// Widens the range recorded in the header.
+void result_writer_extend_range(ResultWriter* w, unsigned long start_ip, unsigned long end_ip);
+// Queues one record; any thread. Blocks only while the writer is far
+// behind. Returns 0 once a write has failed.
+int result_writer_append(ResultWriter* w, const DeviceInfo* di);
+// Waits until every record appended before the call is written, then
+// flushes the store and its journal to the disk (fsync). Returns 0 once a
+// write has failed.
+int result_writer_sync(ResultWriter* w);
+// Writes what is queued, the string table and the final header, removes
+// the journal, then frees the writer. Returns 0 if any write failed (the
+// journal is then kept).
+int result_writer_close(ResultWriter* w);
+
+typedef struct ResultStore ResultStore;
+
+// Maps 'path' read-only. A file whose writer did not finish (no
+// RESULT_STORE_COMPLETE) opens with the records written so far, and with
+// their names if the writer's journal is still next to it.
+// NULL if the file is missing or not a result store.
+ResultStore* result_store_open(const char* path);
+void result_store_close(ResultStore* s);
+
+const ResultStoreHeader* result_store_header(const ResultStore* s);
+size_t result_store_count(const ResultStore* s);
+// The records in place; read-only. Names and long port lists resolve
+// through the device_* helpers once the store is mounted.
+const DeviceInfo* result_store_records(const ResultStore* s);
+// Mounts the store's string table in the string arena (see
+// string_arena_mount); one store at a time. Closing it unmounts.
+void result_store_mount(ResultStore* s);
+
+typedef struct {
+    uint64_t read;       // input records
+    uint64_t written;
+    uint64_t duplicates; // records dropped for an address already written
+    int bad_input;       // index of an input that would not open, or -1
+} ResultMergeStats;
+
+// Writes the records of 'inputs' (e.g. the shards of one scan) to a new
+// store at 'out_path', one per address: an alive record wins over a dead
+// one, otherwise the earlier input wins. Records keep their input order;
+// the header range spans the inputs'. Mounts each input in turn and leaves
+// nothing mounted. Returns 0 if an input cannot be opened or writing fails.
+int result_store_merge(const char* out_path, const char* const* inputs, int count, ResultMergeStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RESULT_STORE_H
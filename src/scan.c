@@ -1,38 +1,211 @@
 #include "scan.h"
 #include "net.h"
+#include "service.h"
+#include "icmp_sweep.h"
+#include "syn_scan.h"
 #include "utils.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 static ScanLogFn g_logger = NULL;
 void scan_set_logger(ScanLogFn fn) { g_logger = fn; }
 
 void scan_config_init(ScanConfig* cfg) {
-    int ports[] = {22, 80, 443, 139, 445, 3389};
-    cfg->default_ports_count = (int)(sizeof(ports)/sizeof(ports[0]));
-    for (int i = 0; i < cfg->default_ports_count; ++i) cfg->default_ports[i] = ports[i];
+    safe_strcpy(cfg->ports, sizeof(cfg->ports), "22,80,443,139,445,3389");
     cfg->port_timeout_ms = 500;
+    cfg->ping_timeout_ms = 1000;
+    cfg->icmp_rate_pps = 2000;
+    cfg->probe_strategy = SCAN_PROBE_CONNECT;
+    cfg->tcp_rate_pps = 10000;
+    cfg->dns_rate_pps = 500;
+    cfg->dns_server[0] = '\0';
+    cfg->service_detect = 0;
+    cfg->service_wait_ms = SERVICE_DEFAULT_WAIT_MS;
+    cfg->adaptive_timing = 1;
+    cfg->min_rtt_timeout_ms = 100;
+    cfg->max_rtt_timeout_ms = 3000;
+    cfg->shuffle_targets = 1;
+    cfg->shuffle_seed = 0;
+    cfg->shard_index = 0;
+    cfg->shard_count = 1;
+}
+
+// 'ports' is cfg->ports compiled by the caller, once per scan; NULL skips
+// the port probes.
+static void identify_live_device_ex(DeviceInfo* info, const ScanConfig* cfg, const PortSet* ports) {
+    char ip[DEVICE_IP_STRLEN], name[256], mac[32];
+    device_ip_str(info, ip, sizeof(ip));
+    info->is_alive = 1;
+    if (g_logger) { char msg[128]; snprintf(msg, sizeof(msg), "DNS %s...", ip); g_logger(msg); }
+    if (net_reverse_dns(ip, name, sizeof(name))) device_set_hostname(info, name);
+    if (g_logger) { char msg[160]; snprintf(msg, sizeof(msg), "MAC %s...", ip); g_logger(msg); }
+    if (net_get_mac(ip, mac, sizeof(mac))) device_set_mac_str(info, mac);
+    if (ports) {
+        int* open = (int*)malloc(sizeof(int) * (size_t)ports->count);
+        const ServiceSignature** sigs = NULL;
+        int n = 0;
+        if (open && cfg->service_detect) sigs = (const ServiceSignature**)malloc(sizeof(*sigs) * (size_t)ports->count);
+        if (g_logger) { char msg[160]; snprintf(msg, sizeof(msg), "Ports %s...", ip); g_logger(msg); }
+        if (open) net_scan_services_paced(ip, ports->order, ports->count, cfg->port_timeout_ms, cfg->service_wait_ms,
+                                          NULL, NULL, open, sigs, &n);
+        if (!device_set_ports(info, open, n) && g_logger) g_logger("Out of memory storing open ports");
+        if (sigs) device_set_services(info, open, sigs, n);
+        free(sigs);
+        free(open);
+    }
+    if (g_logger) {
+        char msg[256];
+        device_mac_str(info, mac, sizeof(mac));
+        const char* host = device_hostname(info);
+        snprintf(msg, sizeof(msg), "Completed %s: %s, %s, %d ports", ip, (host[0]?host:"(unnamed)"), (mac[0]?mac:"MAC --"), info->open_ports_count);
+        g_logger(msg);
+    }
+}
+
+void identify_live_device(DeviceInfo* info, const ScanConfig* cfg) {
+    PortSet ports;
+    int have = port_set_compile(&ports, cfg->ports);
+    identify_live_device_ex(info, cfg, have ? &ports : NULL);
+    if (have) port_set_free(&ports);
+}
+
+static void identify_device_ex(DeviceInfo* info, const ScanConfig* cfg, const PortSet* ports) {
+    char ip[DEVICE_IP_STRLEN];
+    device_ip_str(info, ip, sizeof(ip));
+    if (g_logger) { char msg[128]; snprintf(msg, sizeof(msg), "Ping %s...", ip); g_logger(msg); }
+    if (net_ping_ipv4(ip)) {
+        identify_live_device_ex(info, cfg, ports);
+    } else {
+        info->is_alive = 0;
+        if (g_logger) { char msg[128]; snprintf(msg, sizeof(msg), "Ping failed %s", ip); g_logger(msg); }
+    }
 }
 
 void identify_device(DeviceInfo* info, const ScanConfig* cfg) {
-    if (g_logger) { char msg[128]; snprintf(msg, sizeof(msg), "Ping %s...", info->ip); g_logger(msg); }
-    info->is_alive = net_ping_ipv4(info->ip);
-    if (info->is_alive) {
-        if (g_logger) { char msg[128]; snprintf(msg, sizeof(msg), "DNS %s...", info->ip); g_logger(msg); }
-        net_reverse_dns(info->ip, info->hostname, sizeof(info->hostname));
-        if (g_logger) { char msg[160]; snprintf(msg, sizeof(msg), "MAC %s...", info->ip); g_logger(msg); }
-        net_get_mac(info->ip, info->mac, sizeof(info->mac));
-        info->open_ports_count = 0;
-        if (g_logger) { char msg[160]; snprintf(msg, sizeof(msg), "Ports %s...", info->ip); g_logger(msg); }
-        net_scan_ports(info->ip, cfg->default_ports, cfg->default_ports_count, cfg->port_timeout_ms, info->open_ports, &info->open_ports_count);
+    PortSet ports;
+    int have = port_set_compile(&ports, cfg->ports);
+    identify_device_ex(info, cfg, have ? &ports : NULL);
+    if (have) port_set_free(&ports);
+}
+
+typedef struct {
+    unsigned long start;
+    unsigned char* responded; // one bit per address
+    // Open ports as offset << 16 | port, in arrival order. Hosts get their
+    // ports in one go at the end, not one arena blob per port.
+    uint64_t* hits;
+    size_t nhits, cap;
+} SynCollect;
+
+// Runs on the SYN receive thread only; the scanning thread reads the
+// entries after syn_scan_wait().
+static void on_syn_result(void* user, unsigned long ip, int port, int open) {
+    SynCollect* sc = (SynCollect*)user;
+    unsigned long off = ip - sc->start;
+    sc->responded[off >> 3] |= (unsigned char)(1u << (off & 7)); // a SYN-ACK or RST proves the host is up
+    if (!open) return;
+    if (sc->nhits == sc->cap) {
+        size_t ncap = sc->cap ? sc->cap * 2 : 256;
+        uint64_t* n = (uint64_t*)realloc(sc->hits, sizeof(uint64_t) * ncap);
+        if (!n) return;
+        sc->hits = n;
+        sc->cap = ncap;
+    }
+    sc->hits[sc->nhits++] = ((uint64_t)off << 16) | (uint16_t)port;
+}
+
+static int cmp_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Stores the ports of the host at 'off' from the sorted hits, starting at
+// '*next' and leaving it at the next host's. 'ports' has room for PORT_MAX.
+static void apply_syn_hits(SynCollect* sc, size_t* next, uint64_t off, DeviceInfo* di, int* ports) {
+    size_t i = *next;
+    while (i < sc->nhits && sc->hits[i] >> 16 < off) ++i;
+    int n = 0;
+    for (; i < sc->nhits && sc->hits[i] >> 16 == off; ++i) {
+        int port = (int)(sc->hits[i] & 0xFFFFu);
+        if (n == 0 || ports[n - 1] != port) ports[n++] = port; // retransmitted SYN-ACKs
+    }
+    *next = i;
+    if (n && !device_set_ports(di, ports, n) && g_logger) g_logger("Out of memory storing open ports");
+}
+
+// SYN mode: ICMP sweep and SYN scan run concurrently over the whole range;
+// hosts answering either are identified without further port probes.
+// Memory is one bit per address plus the open ports found; each address's
+// entry is built only once the scan is over.
+// Returns 0 if the SYN engine is unavailable.
+static int scan_ip_range_syn(DeviceList* out, const ScanConfig* cfg, unsigned long start, unsigned long end) {
+    unsigned long count = end - start + 1;
+    SynCollect sc;
+    memset(&sc, 0, sizeof(sc));
+    sc.start = start;
+    sc.responded = (unsigned char*)calloc(count / 8 + 1, 1);
+    int* ports_buf = (int*)malloc(sizeof(int) * (PORT_MAX + 1));
+    PortSet ports;
+    SynScan* syn = NULL;
+    if (sc.responded && ports_buf && port_set_compile(&ports, cfg->ports)) {
+        syn = syn_scan_start(start, end, ports.order, ports.count, cfg->tcp_rate_pps, cfg->port_timeout_ms,
+                             on_syn_result, &sc);
+        port_set_free(&ports); // the SYN engine keeps its own copy
+    }
+    if (!syn) {
+        free(sc.responded);
+        free(ports_buf);
+        return 0;
+    }
+    IcmpSweep* sweep = icmp_sweep_start(start, end, cfg->icmp_rate_pps, cfg->ping_timeout_ms, NULL, NULL);
+    icmp_sweep_wait(sweep);
+    syn_scan_wait(syn);
+    syn_scan_destroy(syn);
+    if (sc.nhits) qsort(sc.hits, sc.nhits, sizeof(uint64_t), cmp_u64);
+    size_t next = 0;
+    for (unsigned long off = 0; off < count; ++off) {
+        DeviceInfo di; device_init(&di, start + off);
+        if ((sc.responded[off >> 3] >> (off & 7)) & 1 || icmp_sweep_is_alive(sweep, start + off)) {
+            apply_syn_hits(&sc, &next, off, &di, ports_buf);
+            identify_live_device_ex(&di, cfg, NULL);
+        }
+        device_list_push(out, &di);
+    }
+    icmp_sweep_destroy(sweep);
+    free(sc.hits);
+    free(sc.responded);
+    free(ports_buf);
+    return 1;
+}
+
+// Liveness for the whole range comes from one ICMP sweep when the platform
+// supports it; otherwise each host is pinged by identify_device.
+static void scan_ip_range(DeviceList* out, const ScanConfig* cfg, unsigned long start, unsigned long end) {
+    if (cfg->probe_strategy == SCAN_PROBE_SYN) {
+        if (scan_ip_range_syn(out, cfg, start, end)) return;
+        if (g_logger) g_logger("SYN scan unavailable (needs raw sockets); using connect probes");
+    }
+    PortSet compiled;
+    const PortSet* ports = port_set_compile(&compiled, cfg->ports) ? &compiled : NULL;
+    IcmpSweep* sweep = icmp_sweep_start(start, end, cfg->icmp_rate_pps, cfg->ping_timeout_ms, NULL, NULL);
+    if (sweep) {
+        icmp_sweep_wait(sweep);
         if (g_logger) {
-            char msg[256];
-            snprintf(msg, sizeof(msg), "Completed %s: %s, %s, %d ports", info->ip, (info->hostname[0]?info->hostname:"(unnamed)"), (info->mac[0]?info->mac:"MAC --"), info->open_ports_count);
+            char msg[128]; snprintf(msg, sizeof(msg), "ICMP sweep: %lu hosts alive", icmp_sweep_alive_count(sweep));
             g_logger(msg);
         }
-    } else {
-        if (g_logger) { char msg[128]; snprintf(msg, sizeof(msg), "Ping failed %s", info->ip); g_logger(msg); }
     }
+    for (unsigned long ip = start; ip <= end; ++ip) {
+        DeviceInfo di; device_init(&di, ip);
+        if (g_logger) { char msg[128], ipbuf[DEVICE_IP_STRLEN]; device_ip_str(&di, ipbuf, sizeof(ipbuf)); snprintf(msg, sizeof(msg), "Processing %s", ipbuf); g_logger(msg); }
+        if (!sweep) identify_device_ex(&di, cfg, ports);
+        else if (icmp_sweep_is_alive(sweep, ip)) identify_live_device_ex(&di, cfg, ports);
+        device_list_push(out, &di);
+        if (ip == 0xFFFFFFFFul) break;
+    }
+    icmp_sweep_destroy(sweep);
+    if (ports) port_set_free(&compiled);
 }
 
 int scan_subnet(DeviceList* out, const ScanConfig* cfg) {
@@ -41,13 +214,7 @@ int scan_subnet(DeviceList* out, const ScanConfig* cfg) {
         if (g_logger) g_logger("Error: Failed to get primary subnet.");
         return 0;
     }
-    for (unsigned long ip = sn.start_ip; ip <= sn.end_ip; ++ip) {
-        DeviceInfo di; memset(&di, 0, sizeof(di));
-        uint_to_ip(ip, di.ip, sizeof(di.ip));
-        if (g_logger) { char msg[128]; snprintf(msg, sizeof(msg), "Processing %s", di.ip); g_logger(msg); }
-        identify_device(&di, cfg);
-        device_list_push(out, &di);
-    }
+    scan_ip_range(out, cfg, sn.start_ip, sn.end_ip);
     return 1;
 }
 
@@ -65,12 +232,6 @@ int scan_range(DeviceList* out, const ScanConfig* cfg, const char* start_ip, con
         if (g_logger) g_logger("Error: End IP is smaller than start IP.");
         return 0;
     }
-    for (unsigned long ip = start; ip <= end; ++ip) {
-        DeviceInfo di; memset(&di, 0, sizeof(di));
-        uint_to_ip(ip, di.ip, sizeof(di.ip));
-        if (g_logger) { char msg[128]; snprintf(msg, sizeof(msg), "Processing %s", di.ip); g_logger(msg); }
-        identify_device(&di, cfg);
-        device_list_push(out, &di);
-    }
+    scan_ip_range(out, cfg, start, end);
     return 1;
 }
\ No newline at end of file
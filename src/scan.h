@@ -2,11 +2,47 @@
 #define SCAN_H
 
 #include "app.h"
+#include "port_set.h"
 
+// How TCP ports are probed.
+typedef enum {
+    SCAN_PROBE_CONNECT = 0, // full handshake per probe (all platforms)
+    SCAN_PROBE_SYN = 1      // stateless raw SYN scan (Linux, root/CAP_NET_RAW)
+} ScanProbeStrategy;
+
+// Checkpoints save this struct as is: bump CHECKPOINT_VERSION (checkpoint.c)
+// when changing it.
 typedef struct {
-    int default_ports[16];
-    int default_ports_count;
+    char ports[PORT_SPEC_MAX]; // TCP ports to probe, a port_set.h spec: "22,80,8000-8010,top-100"
     int port_timeout_ms;
+    int ping_timeout_ms;
+    int icmp_rate_pps;     // echo requests per second for range sweeps
+    int probe_strategy;    // ScanProbeStrategy
+    int tcp_rate_pps;      // TCP probes (SYNs or connects) per second
+    int dns_rate_pps;      // reverse DNS queries per second
+    char dns_server[48];   // "A.B.C.D[:port]" for PTR queries; "" = system resolver
+    // Service detection (connect probes only): each open port is read for a
+    // banner, probed if it stays silent, and matched against the service.h
+    // database; hits land in DeviceInfo.services.
+    int service_detect;    // 0 = ports only
+    int service_wait_ms;   // per read; see net_scan_services_paced
+    // Adaptive timing (parallel scan): once a host, its /24 or the network
+    // has answered, probe timeouts follow the measured RTT within
+    // [min_rtt_timeout_ms, max_rtt_timeout_ms] instead of the fixed values
+    // above, and connect probes in flight follow a congestion window.
+    int adaptive_timing;   // 0 = fixed timeouts
+    int min_rtt_timeout_ms;
+    int max_rtt_timeout_ms;
+    // Address order (parallel scan): shuffled visits the range in a
+    // pseudo-random permutation (target_order.h), so probes spread over all
+    // subnets instead of hitting one /24 at a time.
+    int shuffle_targets;   // 0 = ascending
+    unsigned long long shuffle_seed; // 0 = a new order each scan
+    // Shard mode (parallel scan): this process takes every shard_count-th
+    // position of the target order from shard_index, so N processes with
+    // the same range and seed split it with no overlap and no coordinator.
+    int shard_index;       // 0..shard_count-1
+    int shard_count;       // 0 or 1 = the whole range
 } ScanConfig;
 
 #ifdef __cplusplus
@@ -27,7 +63,11 @@ void scan_config_init(ScanConfig* cfg);
 int scan_subnet(DeviceList* out, const ScanConfig* cfg);
 // Returns 1 on success, 0 on failure
 int scan_range(DeviceList* out, const ScanConfig* cfg, const char* start_ip, const char* end_ip);
+// info->ip must be set (device_init); the other fields are filled in.
 void identify_device(DeviceInfo* info, const ScanConfig* cfg);
+// Same as identify_device for a host already known to be alive (e.g. from an
+// ICMP sweep): skips the ping and sets is_alive.
+void identify_live_device(DeviceInfo* info, const ScanConfig* cfg);
 #ifdef __cplusplus
 }
 #endif
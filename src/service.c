@@ -0,0 +1,348 @@
+#include "service.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---- Matcher --------------------------------------------------------------
+
+// States are numbered in trie order, root 0. 'next' is the complete DFA:
+// row s, column class c (bytes that occur in no pattern share class 0, and
+// letters share a class with their other case).
+struct ServiceMatcher {
+    const ServiceSignature* sigs;
+    int nclasses;
+    int nstates;
+    uint8_t cls[256];
+    int32_t* next;      // nstates * nclasses
+    int32_t* first_sig; // lowest signature ending at the state itself, -1 if none
+    int32_t* out_link;  // nearest proper suffix state with a signature, -1 if none
+    int32_t* sig_next;  // signatures ending at the same state, in table order
+    int32_t* sig_len;
+};
+
+static int fold(int b) { return (b >= 'A' && b <= 'Z') ? b + ('a' - 'A') : b; }
+
+static int sig_length(const ServiceSignature* s) { return s->len > 0 ? s->len : (int)strlen(s->pattern); }
+
+ServiceMatcher* service_matcher_create(const ServiceSignature* sigs, int count) {
+    if (!sigs || count <= 0) return NULL;
+    ServiceMatcher* m = (ServiceMatcher*)calloc(1, sizeof(ServiceMatcher));
+    if (!m) return NULL;
+    m->sigs = sigs;
+    // Alphabet: one class per distinct folded byte of any pattern.
+    size_t total = 0;
+    for (int i = 0; i < count; ++i) {
+        int len = sig_length(&sigs[i]);
+        if (len <= 0) { free(m); return NULL; }
+        total += (size_t)len;
+        for (int k = 0; k < len; ++k) {
+            int b = fold((unsigned char)sigs[i].pattern[k]);
+            if (!m->cls[b]) m->cls[b] = (uint8_t)++m->nclasses;
+        }
+    }
+    m->nclasses++; // class 0
+    for (int b = 'A'; b <= 'Z'; ++b) m->cls[b] = m->cls[fold(b)];
+
+    size_t maxstates = total + 1;
+    m->next = (int32_t*)malloc(sizeof(int32_t) * maxstates * (size_t)m->nclasses);
+    m->first_sig = (int32_t*)malloc(sizeof(int32_t) * maxstates);
+    m->out_link = (int32_t*)malloc(sizeof(int32_t) * maxstates);
+    m->sig_next = (int32_t*)malloc(sizeof(int32_t) * (size_t)count);
+    m->sig_len = (int32_t*)malloc(sizeof(int32_t) * (size_t)count);
+    int32_t* fail = (int32_t*)malloc(sizeof(int32_t) * maxstates);
+    int32_t* bfs = (int32_t*)malloc(sizeof(int32_t) * maxstates);
+    if (!m->next || !m->first_sig || !m->out_link || !m->sig_next || !m->sig_len || !fail || !bfs) {
+        free(fail); free(bfs);
+        service_matcher_destroy(m);
+        return NULL;
+    }
+
+    // Trie; -1 marks a missing edge until the failure pass fills it.
+    int32_t* next = m->next;
+    int nc = m->nclasses;
+    for (int c = 0; c < nc; ++c) next[c] = -1;
+    m->first_sig[0] = -1;
+    m->nstates = 1;
+    for (int i = 0; i < count; ++i) {
+        int len = sig_length(&sigs[i]);
+        m->sig_len[i] = len;
+        int s = 0;
+        for (int k = 0; k < len; ++k) {
+            int c = m->cls[(unsigned char)sigs[i].pattern[k]];
+            if (next[(size_t)s * nc + c] < 0) {
+                int t = m->nstates++;
+                for (int d = 0; d < nc; ++d) next[(size_t)t * nc + d] = -1;
+                m->first_sig[t] = -1;
+                next[(size_t)s * nc + c] = t;
+            }
+            s = next[(size_t)s * nc + c];
+        }
+        // Appended in table order, so each state's list stays sorted.
+        m->sig_next[i] = -1;
+        if (m->first_sig[s] < 0) { m->first_sig[s] = i; continue; }
+        int j = m->first_sig[s];
+        while (m->sig_next[j] >= 0) j = m->sig_next[j];
+        m->sig_next[j] = i;
+    }
+
+    // Breadth-first: failure links, output links and the missing edges,
+    // each taken from the failure state, which is shallower and done.
+    int head = 0, tail = 0;
+    fail[0] = 0;
+    m->out_link[0] = -1;
+    for (int c = 0; c < nc; ++c) {
+        int t = next[c];
+        if (t < 0) { next[c] = 0; continue; }
+        fail[t] = 0;
+        m->out_link[t] = -1;
+        bfs[tail++] = t;
+    }
+    while (head < tail) {
+        int s = bfs[head++];
+        for (int c = 0; c < nc; ++c) {
+            int t = next[(size_t)s * nc + c];
+            int f = next[(size_t)fail[s] * nc + c];
+            if (t < 0) { next[(size_t)s * nc + c] = f; continue; }
+            fail[t] = f;
+            m->out_link[t] = m->first_sig[f] >= 0 ? f : m->out_link[f];
+            bfs[tail++] = t;
+        }
+    }
+    free(fail);
+    free(bfs);
+    return m;
+}
+
+void service_matcher_destroy(ServiceMatcher* m) {
+    if (!m) return;
+    free(m->next);
+    free(m->first_sig);
+    free(m->out_link);
+    free(m->sig_next);
+    free(m->sig_len);
+    free(m);
+}
+
+int service_matcher_find(const ServiceMatcher* m, const unsigned char* data, size_t len) {
+    if (!m) return -1;
+    int best = -1;
+    int s = 0, nc = m->nclasses;
+    for (size_t pos = 0; pos < len; ++pos) {
+        s = m->next[(size_t)s * nc + m->cls[data[pos]]];
+        for (int o = m->first_sig[s] >= 0 ? s : m->out_link[s]; o >= 0; o = m->out_link[o]) {
+            for (int i = m->first_sig[o]; i >= 0; i = m->sig_next[i]) {
+                if (best >= 0 && i >= best) break; // later in the table than what we have
+                if (m->sigs[i].anchored && (size_t)m->sig_len[i] != pos + 1) continue;
+                best = i;
+                break;
+            }
+        }
+        if (best == 0) break;
+    }
+    return best;
+}
+
+// ---- Built-in database ----------------------------------------------------
+
+// First match in table order wins: products before the generic entries of
+// their service, longer prefixes before shorter ones.
+static const ServiceSignature k_signatures[] = {
+    // SSH
+    { "SSH-2.0-OpenSSH", 0, 1, "ssh", "OpenSSH" },
+    { "SSH-1.99-OpenSSH", 0, 1, "ssh", "OpenSSH" },
+    { "SSH-2.0-dropbear", 0, 1, "ssh", "Dropbear" },
+    { "SSH-2.0-libssh", 0, 1, "ssh", "libssh" },
+    { "SSH-2.0-Cisco", 0, 1, "ssh", "Cisco SSH" },
+    { "SSH-1.99-Cisco", 0, 1, "ssh", "Cisco SSH" },
+    { "SSH-2.0-ROSSSH", 0, 1, "ssh", "MikroTik RouterOS" },
+    { "SSH-2.0-RomSShell", 0, 1, "ssh", "Allegro RomSShell" },
+    { "SSH-2.0-mod_sftp", 0, 1, "ssh", "ProFTPD mod_sftp" },
+    { "SSH-2.0-AsyncSSH", 0, 1, "ssh", "AsyncSSH" },
+    { "SSH-2.0-paramiko", 0, 1, "ssh", "Paramiko" },
+    { "SSH-2.0-Go", 0, 1, "ssh", "Go SSH" },
+    { "SSH-2.0-HUAWEI", 0, 1, "ssh", "Huawei SSH" },
+    { "SSH-2.0-WeOnlyDo", 0, 1, "ssh", "WeOnlyDo" },
+    { "SSH-2.0-Sun_SSH", 0, 1, "ssh", "Sun SSH" },
+    { "SSH-2.0-SSHD", 0, 1, "ssh", "" },
+    { "SSH-", 0, 1, "ssh", "" },
+    // FTP
+    { "vsFTPd", 0, 0, "ftp", "vsftpd" },
+    { "ProFTPD", 0, 0, "ftp", "ProFTPD" },
+    { "Pure-FTPd", 0, 0, "ftp", "Pure-FTPd" },
+    { "FileZilla Server", 0, 0, "ftp", "FileZilla Server" },
+    { "Microsoft FTP Service", 0, 0, "ftp", "Microsoft IIS FTP" },
+    { "Serv-U FTP", 0, 0, "ftp", "Serv-U" },
+    { "220 MikroTik FTP", 0, 1, "ftp", "MikroTik RouterOS" },
+    { "FTP server (Version wu-", 0, 0, "ftp", "WU-FTPD" },
+    // Mail
+    { "+OK Dovecot", 0, 1, "pop3", "Dovecot" },
+    { "Dovecot", 0, 0, "imap", "Dovecot" },
+    { "Courier-IMAP", 0, 0, "imap", "Courier" },
+    { "Cyrus IMAP", 0, 0, "imap", "Cyrus" },
+    { "Microsoft Exchange POP3", 0, 0, "pop3", "Microsoft Exchange" },
+    { "Microsoft Exchange IMAP4", 0, 0, "imap", "Microsoft Exchange" },
+    { "Microsoft ESMTP MAIL Service", 0, 0, "smtp", "Microsoft Exchange" },
+    { "ESMTP Postfix", 0, 0, "smtp", "Postfix" },
+    { "ESMTP Exim", 0, 0, "smtp", "Exim" },
+    { "ESMTP Sendmail", 0, 0, "smtp", "Sendmail" },
+    { "ESMTP OpenSMTPD", 0, 0, "smtp", "OpenSMTPD" },
+    { "ESMTP Haraka", 0, 0, "smtp", "Haraka" },
+    { "ESMTP MailEnable", 0, 0, "smtp", "MailEnable" },
+    // HTTP servers and applications
+    { "Server: nginx", 0, 0, "http", "nginx" },
+    { "Server: openresty", 0, 0, "http", "OpenResty" },
+    { "Server: Tengine", 0, 0, "http", "Tengine" },
+    { "Server: Apache-Coyote", 0, 0, "http", "Apache Tomcat" },
+    { "Server: Apache", 0, 0, "http", "Apache httpd" },
+    { "Server: Microsoft-IIS", 0, 0, "http", "Microsoft IIS" },
+    { "Server: Microsoft-HTTPAPI", 0, 0, "http", "Microsoft HTTPAPI" },
+    { "Server: lighttpd", 0, 0, "http", "lighttpd" },
+    { "Server: LiteSpeed", 0, 0, "http", "LiteSpeed" },
+    { "Server: Caddy", 0, 0, "http", "Caddy" },
+    { "Server: Jetty", 0, 0, "http", "Jetty" },
+    { "Server: Kestrel", 0, 0, "http", "Kestrel" },
+    { "Server: gunicorn", 0, 0, "http", "Gunicorn" },
+    { "Server: uvicorn", 0, 0, "http", "Uvicorn" },
+    { "Server: Werkzeug", 0, 0, "http", "Werkzeug" },
+    { "Server: TornadoServer", 0, 0, "http", "Tornado" },
+    { "Server: CherryPy", 0, 0, "http", "CherryPy" },
+    { "Server: WSGIServer", 0, 0, "http", "Python WSGI" },
+    { "Server: SimpleHTTP", 0, 0, "http", "Python http.server" },
+    { "Server: BaseHTTP", 0, 0, "http", "Python http.server" },
+    { "Server: Cowboy", 0, 0, "http", "Cowboy" },
+    { "Server: envoy", 0, 0, "http", "Envoy" },
+    { "Server: cloudflare", 0, 0, "http", "Cloudflare" },
+    { "Server: AkamaiGHost", 0, 0, "http", "Akamai" },
+    { "Server: Docker", 0, 0, "http", "Docker API" },
+    { "Server: CouchDB", 0, 0, "http", "CouchDB" },
+    { "Server: Splunkd", 0, 0, "http", "Splunk" },
+    { "Server: MiniServ", 0, 0, "http", "Webmin" },
+    { "Server: Oracle-HTTP-Server", 0, 0, "http", "Oracle HTTP Server" },
+    { "Server: IBM_HTTP_Server", 0, 0, "http", "IBM HTTP Server" },
+    { "Server: Zope", 0, 0, "http", "Zope" },
+    { "Server: squid", 0, 0, "http-proxy", "Squid" },
+    { "Server: Boa", 0, 0, "http", "Boa" },
+    { "Server: GoAhead", 0, 0, "http", "GoAhead" },
+    { "Server: mini_httpd", 0, 0, "http", "mini_httpd" },
+    { "Server: micro_httpd", 0, 0, "http", "micro_httpd" },
+    { "Server: thttpd", 0, 0, "http", "thttpd" },
+    { "Server: Mongoose", 0, 0, "http", "Mongoose" },
+    { "Server: RomPager", 0, 0, "http", "Allegro RomPager" },
+    { "Server: Allegro-Software-RomPager", 0, 0, "http", "Allegro RomPager" },
+    { "Server: Virata-EmWeb", 0, 0, "http", "EmWeb" },
+    { "Server: Hikvision-Webs", 0, 0, "http", "Hikvision" },
+    { "Server: DNVRS-Webs", 0, 0, "http", "Hikvision" },
+    { "Server: App-webs", 0, 0, "http", "Hikvision" },
+    { "Server: HP HTTP Server", 0, 0, "http", "HP printer" },
+    { "Server: ZyXEL", 0, 0, "http", "ZyXEL" },
+    { "X-Jenkins:", 0, 0, "http", "Jenkins" },
+    { "X-Powered-By: Express", 0, 0, "http", "Express" },
+    { "You Know, for Search", 0, 0, "http", "Elasticsearch" },
+    { "It looks like you are trying to access MongoDB over HTTP", 0, 0, "mongodb", "MongoDB" },
+    // Databases and caches
+    { "MariaDB", 0, 0, "mysql", "MariaDB" },
+    { "mysql_native_password", 0, 0, "mysql", "MySQL" },
+    { "caching_sha2_password", 0, 0, "mysql", "MySQL" },
+    { "is not allowed to connect to this MySQL server", 0, 0, "mysql", "MySQL" },
+    { "unsupported frontend protocol", 0, 0, "postgresql", "PostgreSQL" },
+    { "invalid length of startup packet", 0, 0, "postgresql", "PostgreSQL" },
+    { "-DENIED Redis", 0, 1, "redis", "Redis" },
+    { "-NOAUTH", 0, 1, "redis", "" },
+    { "-ERR ", 0, 1, "redis", "" },
+    { "ERROR\r\n", 0, 1, "memcached", "" },
+    // Binary protocols (answers to service_probe)
+    { "\x03\x00\x00\x13\x0e\xd0", 6, 1, "rdp", "" },
+    { "\x03\x00\x00\x0b\x06\xd0", 6, 1, "rdp", "" },
+    { "\xffSMB", 4, 0, "smb", "" },
+    { "\xfeSMB", 4, 0, "smb", "" },
+    { "\x83\x00\x00\x01", 4, 1, "netbios-ssn", "" },
+    { "\x16\x03", 2, 1, "ssl", "" },
+    { "\x15\x03", 2, 1, "ssl", "" },
+    { "AMQP\x00", 5, 1, "amqp", "" },
+    { "JDWP-Handshake", 0, 1, "jdwp", "" },
+    // Other text protocols
+    { "RFB 00", 0, 1, "vnc", "" },
+    { "RTSP/1.0", 0, 1, "rtsp", "" },
+    { "SIP/2.0", 0, 1, "sip", "" },
+    { "<stream:stream", 0, 0, "xmpp", "" },
+    { "NOTICE AUTH", 0, 0, "irc", "" },
+    { "\xff\xfd", 2, 1, "telnet", "" },
+    { "\xff\xfb", 2, 1, "telnet", "" },
+    { "\xff\xfe", 2, 1, "telnet", "" },
+    { "\xff\xfc", 2, 1, "telnet", "" },
+    // Generic
+    { "HTTP/1.", 0, 1, "http", "" },
+    { "HTTP/2", 0, 1, "http", "" },
+    { "+OK", 0, 1, "pop3", "" },
+    { "* OK", 0, 1, "imap", "" },
+    { "ESMTP", 0, 0, "smtp", "" },
+    { " SMTP", 0, 0, "smtp", "" },
+    { "FTP", 0, 0, "ftp", "" },
+};
+
+static Mutex g_db_lock = MUTEX_INITIALIZER;
+static _Atomic(ServiceMatcher*) g_db;
+static int g_db_failed;
+
+const ServiceSignature* service_identify(const unsigned char* banner, size_t len) {
+    ServiceMatcher* m = atomic_load_explicit(&g_db, memory_order_acquire);
+    if (!m) {
+        mutex_lock(&g_db_lock);
+        m = atomic_load_explicit(&g_db, memory_order_relaxed);
+        if (!m && !g_db_failed) {
+            m = service_matcher_create(k_signatures, (int)(sizeof(k_signatures) / sizeof(k_signatures[0])));
+            if (m) atomic_store_explicit(&g_db, m, memory_order_release);
+            else g_db_failed = 1;
+        }
+        mutex_unlock(&g_db_lock);
+        if (!m) return NULL;
+    }
+    int i = service_matcher_find(m, banner, len);
+    return i >= 0 ? &k_signatures[i] : NULL;
+}
+
+// ---- Probes ---------------------------------------------------------------
+
+static const unsigned char k_http_probe[] = "GET / HTTP/1.0\r\n\r\n";
+
+// TLS 1.2 ClientHello with common suites and no extensions: a server
+// answers with a ServerHello or an alert, either of which names TLS.
+static const unsigned char k_tls_probe[] = {
+    0x16, 0x03, 0x01, 0x00, 0x37, 0x01, 0x00, 0x00, 0x33, 0x03, 0x03,
+    0x43, 0x41, 0x54, 0x4E, 0x45, 0x54, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+    0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+    0x00,                                                       // session id
+    0x00, 0x0C, 0xC0, 0x2F, 0xC0, 0x30, 0xC0, 0x2B, 0xC0, 0x2C, 0x00, 0x9C, 0x00, 0x2F,
+    0x01, 0x00,                                                 // null compression
+};
+
+// RDP: X.224 connection request asking for TLS or CredSSP.
+static const unsigned char k_rdp_probe[] = {
+    0x03, 0x00, 0x00, 0x13, 0x0E, 0xE0, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x08, 0x00, 0x03, 0x00, 0x00, 0x00,
+};
+
+// SMB: negotiate offering NT LM 0.12 and SMB 2; SMB 2+ servers answer in SMB 2.
+static const unsigned char k_smb_probe[] = {
+    0x00, 0x00, 0x00, 0x45,
+    0xFF, 'S', 'M', 'B', 0x72, 0x00, 0x00, 0x00, 0x00, 0x18, 0x53, 0xC8, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFE, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x22, 0x00,
+    0x02, 'N', 'T', ' ', 'L', 'M', ' ', '0', '.', '1', '2', 0x00,
+    0x02, 'S', 'M', 'B', ' ', '2', '.', '0', '0', '2', 0x00,
+    0x02, 'S', 'M', 'B', ' ', '2', '.', '?', '?', '?', 0x00,
+};
+
+static const int k_tls_ports[] = { 443, 465, 636, 853, 990, 992, 993, 994, 995, 2376, 3269, 4443, 5061, 5986, 6443, 8443, 9443 };
+
+const unsigned char* service_probe(int port, size_t* len) {
+    for (size_t i = 0; i < sizeof(k_tls_ports) / sizeof(k_tls_ports[0]); ++i) {
+        if (k_tls_ports[i] == port) { *len = sizeof(k_tls_probe); return k_tls_probe; }
+    }
+    if (port == 3389) { *len = sizeof(k_rdp_probe); return k_rdp_probe; }
+    if (port == 445) { *len = sizeof(k_smb_probe); return k_smb_probe; }
+    *len = sizeof(k_http_probe) - 1;
+    return k_http_probe;
+}
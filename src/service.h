@@ -0,0 +1,54 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+// Service identification from banners. Signatures are byte strings compared
+// without regard to ASCII case; a whole database compiles into one
+// Aho-Corasick automaton with every failure transition resolved ahead of
+// time, so matching is one table lookup per banner byte however many
+// signatures there are. The built-in database covers common TCP services
+// and the products behind them.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SERVICE_BANNER_MAX 512   // bytes read from a service
+#define SERVICE_DEFAULT_WAIT_MS 1000
+
+typedef struct ServiceSignature {
+    const char* pattern;
+    int len;                 // bytes of 'pattern'; 0 = strlen (patterns with NULs need it)
+    int anchored;            // must match at the start of the banner
+    const char* service;     // "ssh", "http", ...
+    const char* product;     // "OpenSSH", ...; "" when the signature only names the service
+} ServiceSignature;
+
+typedef struct ServiceMatcher ServiceMatcher;
+
+// Compiles 'count' signatures. The table must outlive the matcher. Returns
+// NULL when out of memory or for an empty pattern.
+ServiceMatcher* service_matcher_create(const ServiceSignature* sigs, int count);
+void service_matcher_destroy(ServiceMatcher* m);
+// Index of the first signature, in table order, that occurs in 'data'; -1
+// if none. One pass over 'data'.
+int service_matcher_find(const ServiceMatcher* m, const unsigned char* data, size_t len);
+
+// Matches against the built-in database (compiled on first use; any
+// thread). Returns the signature, or NULL if nothing matched or the
+// database could not be compiled.
+const ServiceSignature* service_identify(const unsigned char* banner, size_t len);
+
+// What to send to 'port' when the service stays silent after connecting:
+// a TLS ClientHello on TLS ports, an RDP or SMB negotiation on theirs, and
+// an HTTP request elsewhere, which most text protocols answer with an error
+// that still names them.
+const unsigned char* service_probe(int port, size_t* len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SERVICE_H
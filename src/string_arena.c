@@ -0,0 +1,172 @@
+#include "string_arena.h"
+#include "thread.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A handle is (chunk << 16 | offset) into 64 KiB chunks that never move
+// until a reset, so a reader only needs the chunk pointer. A blob of 64 KiB
+// or more gets a chunk of its own sized to fit, at offset 0. Writers (and
+// the interning table) are serialized by one lock; interning happens once
+// per resolved name, far off any per-packet path.
+#define ARENA_CHUNK 65536u
+#define ARENA_MAX_CHUNKS 32768u // the top handle bit marks mounted tables
+
+static _Atomic(unsigned char*) g_chunks[ARENA_MAX_CHUNKS];
+static Mutex g_lock = MUTEX_INITIALIZER;
+static uint32_t g_chunk_count; // all below under g_lock
+static uint32_t g_cur;         // the chunk small blobs are filling
+static uint32_t g_used;        // bytes used in it
+static size_t g_total;
+// Interning table: open addressing over handles, 0 = empty slot.
+static uint32_t* g_table;
+static size_t g_table_cap, g_table_count;
+// Mounted read-only table; published pointer first, size read after it.
+static _Atomic(const unsigned char*) g_mount;
+static atomic_size_t g_mount_size;
+
+static uint32_t hash_str(const char* s, size_t len) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; ++i) { h ^= (unsigned char)s[i]; h *= 16777619u; }
+    return h;
+}
+
+static unsigned char* chunk_ptr(uint32_t h) {
+    return atomic_load_explicit(&g_chunks[h >> 16], memory_order_acquire);
+}
+
+// Caller holds g_lock. Returns the new chunk's index, or ARENA_MAX_CHUNKS.
+static uint32_t chunk_add(size_t size) {
+    if (g_chunk_count == ARENA_MAX_CHUNKS) return ARENA_MAX_CHUNKS;
+    unsigned char* c = (unsigned char*)malloc(size);
+    if (!c) return ARENA_MAX_CHUNKS;
+    atomic_store_explicit(&g_chunks[g_chunk_count], c, memory_order_release);
+    return g_chunk_count++;
+}
+
+// Caller holds g_lock.
+static uint32_t arena_alloc(size_t len) {
+    if (len == 0) return 0;
+    if (g_chunk_count == 0) {
+        if (chunk_add(ARENA_CHUNK) == ARENA_MAX_CHUNKS) return 0;
+        g_cur = 0;
+        g_used = 1; // offset 0 of chunk 0 is handle 0
+    }
+    if (len >= ARENA_CHUNK) {
+        uint32_t c = chunk_add(len);
+        if (c == ARENA_MAX_CHUNKS) return 0;
+        g_total += len;
+        return c << 16;
+    }
+    if (g_used + len > ARENA_CHUNK) {
+        uint32_t c = chunk_add(ARENA_CHUNK);
+        if (c == ARENA_MAX_CHUNKS) return 0;
+        g_cur = c;
+        g_used = 0;
+    }
+    uint32_t h = (g_cur << 16) | g_used;
+    g_used += (uint32_t)len;
+    g_total += len;
+    return h;
+}
+
+// Caller holds g_lock.
+static int table_grow(void) {
+    size_t ncap = g_table_cap ? g_table_cap * 2 : 1024;
+    uint32_t* nt = (uint32_t*)calloc(ncap, sizeof(uint32_t));
+    if (!nt) return 0;
+    for (size_t i = 0; i < g_table_cap; ++i) {
+        uint32_t h = g_table[i];
+        if (!h) continue;
+        const char* s = (const char*)chunk_ptr(h) + (h & 0xFFFF);
+        size_t k = hash_str(s, strlen(s)) & (ncap - 1);
+        while (nt[k]) k = (k + 1) & (ncap - 1);
+        nt[k] = h;
+    }
+    free(g_table);
+    g_table = nt;
+    g_table_cap = ncap;
+    return 1;
+}
+
+uint32_t string_arena_intern(const char* s) {
+    if (!s || !*s) return 0;
+    size_t len = strlen(s);
+    uint32_t hash = hash_str(s, len);
+    uint32_t h = 0;
+    mutex_lock(&g_lock);
+    if ((g_table_count + 1) * 10 > g_table_cap * 7 && !table_grow()) { mutex_unlock(&g_lock); return 0; }
+    size_t k = hash & (g_table_cap - 1);
+    for (; g_table[k]; k = (k + 1) & (g_table_cap - 1)) {
+        if (strcmp(string_arena_get(g_table[k]), s) == 0) { h = g_table[k]; break; }
+    }
+    if (!h) {
+        h = arena_alloc(len + 1);
+        if (h) {
+            memcpy(chunk_ptr(h) + (h & 0xFFFF), s, len + 1);
+            g_table[k] = h;
+            g_table_count++;
+        }
+    }
+    mutex_unlock(&g_lock);
+    return h;
+}
+
+// NULL unless 'len' bytes at the handle's offset lie inside the table.
+static const unsigned char* mounted_ptr(uint32_t h, size_t len) {
+    const unsigned char* t = atomic_load_explicit(&g_mount, memory_order_acquire);
+    size_t off = h & ~STRING_ARENA_MOUNTED;
+    size_t size = atomic_load_explicit(&g_mount_size, memory_order_relaxed);
+    if (!t || off >= size || len > size - off) return NULL;
+    return t + off;
+}
+
+const char* string_arena_get(uint32_t h) {
+    if (!h) return "";
+    if (h & STRING_ARENA_MOUNTED) {
+        const unsigned char* p = mounted_ptr(h, 1);
+        return p ? (const char*)p : "";
+    }
+    return (const char*)chunk_ptr(h) + (h & 0xFFFF);
+}
+
+uint32_t string_arena_put(const void* data, size_t len) {
+    mutex_lock(&g_lock);
+    uint32_t h = arena_alloc(len);
+    if (h) memcpy(chunk_ptr(h) + (h & 0xFFFF), data, len);
+    mutex_unlock(&g_lock);
+    return h;
+}
+
+const void* string_arena_data(uint32_t h, size_t len) {
+    if (h & STRING_ARENA_MOUNTED) return mounted_ptr(h, len);
+    return h ? chunk_ptr(h) + (h & 0xFFFF) : NULL;
+}
+
+void string_arena_mount(const void* table, size_t size) {
+    atomic_store_explicit(&g_mount, NULL, memory_order_release);
+    if (!table) return;
+    atomic_store_explicit(&g_mount_size, size, memory_order_relaxed);
+    atomic_store_explicit(&g_mount, (const unsigned char*)table, memory_order_release);
+}
+
+void string_arena_reset(void) {
+    mutex_lock(&g_lock);
+    for (uint32_t i = 0; i < g_chunk_count; ++i) {
+        free(atomic_load_explicit(&g_chunks[i], memory_order_relaxed));
+        atomic_store_explicit(&g_chunks[i], NULL, memory_order_relaxed);
+    }
+    g_chunk_count = g_cur = g_used = 0;
+    g_total = 0;
+    free(g_table);
+    g_table = NULL;
+    g_table_cap = g_table_count = 0;
+    mutex_unlock(&g_lock);
+}
+
+size_t string_arena_size(void) {
+    mutex_lock(&g_lock);
+    size_t n = g_total;
+    mutex_unlock(&g_lock);
+    return n;
+}
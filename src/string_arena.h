@@ -0,0 +1,50 @@
+#ifndef STRING_ARENA_H
+#define STRING_ARENA_H
+
+// Process-wide append-only arena for host names and other blobs that
+// compact records refer to by a 32-bit handle. Handles stay valid until
+// string_arena_reset; reads never lock. Handle 0 means "none".
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns the handle of 's', storing it on first use (identical strings share
+// one handle). Returns 0 for NULL/"" or when the arena is full.
+uint32_t string_arena_intern(const char* s);
+// "" for handle 0.
+const char* string_arena_get(uint32_t h);
+
+// Stores 'len' raw bytes (not interned, not terminated; any size); 0 when
+// out of memory.
+uint32_t string_arena_put(const void* data, size_t len);
+// The 'len' bytes behind a handle from string_arena_put; may be unaligned.
+// NULL for handle 0, or when a mounted handle's bytes run past the table.
+const void* string_arena_data(uint32_t h, size_t len);
+
+// Handles with this bit set refer to byte offsets in a read-only table
+// mounted by string_arena_mount (a mapped result store) instead of the arena.
+#define STRING_ARENA_MOUNTED 0x80000000u
+
+// Makes 'table' (size bytes, ending in a NUL) the target of mounted handles;
+// NULL unmounts. One table at a time; they read as "" while none is mounted.
+// The caller keeps the table alive until it is unmounted.
+void string_arena_mount(const void* table, size_t size);
+
+// Frees everything stored, so a new scan starts from an empty arena. Every
+// handle issued so far becomes invalid (mounted handles are unaffected):
+// call it only when no thread holds or still uses one.
+void string_arena_reset(void);
+
+// Bytes used, for diagnostics.
+size_t string_arena_size(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STRING_ARENA_H
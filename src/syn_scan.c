@@ -0,0 +1,345 @@
+#include "syn_scan.h"
+
+#if defined(__linux__)
+
+#include "metrics.h"
+#include "pacer.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <linux/filter.h>
+
+struct SynScan {
+    int tx, rx;
+    uint32_t src_ip;       // host order
+    uint16_t src_port;
+    uint64_t k0, k1;       // cookie key
+    unsigned long start_ip;
+    unsigned long count;
+    TargetOrder order;     // host order within each port
+    SynSkipFn skip;
+    void* skip_user;
+    int* ports;
+    int ports_count;
+    Pacer* pacer;          // SYNs per second
+    int wait_ms;
+    SynResultFn fn;
+    void* user;
+    volatile int cancel;
+    volatile int done;
+    pthread_t tx_thread, rx_thread;
+    pthread_mutex_t lock;
+    pthread_cond_t done_cv;
+};
+
+static uint64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000ull);
+    ts.tv_nsec = (long)(ns % 1000000000ull);
+    nanosleep(&ts, NULL);
+}
+
+#define ROTL64(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+#define SIPROUND(v0, v1, v2, v3) do { \
+    v0 += v1; v1 = ROTL64(v1, 13); v1 ^= v0; v0 = ROTL64(v0, 32); \
+    v2 += v3; v3 = ROTL64(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = ROTL64(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = ROTL64(v1, 17); v1 ^= v2; v2 = ROTL64(v2, 32); \
+} while (0)
+
+// SipHash-2-4 over the two 64-bit words (dst ip, dst port | src port).
+static uint32_t syn_cookie(const SynScan* ss, uint32_t ip, uint16_t port) {
+    uint64_t m0 = ip, m1 = ((uint64_t)port << 16) | ss->src_port;
+    uint64_t v0 = ss->k0 ^ 0x736f6d6570736575ull, v1 = ss->k1 ^ 0x646f72616e646f6dull;
+    uint64_t v2 = ss->k0 ^ 0x6c7967656e657261ull, v3 = ss->k1 ^ 0x7465646279746573ull;
+    uint64_t b = (uint64_t)16 << 56;
+    v3 ^= m0; SIPROUND(v0, v1, v2, v3); SIPROUND(v0, v1, v2, v3); v0 ^= m0;
+    v3 ^= m1; SIPROUND(v0, v1, v2, v3); SIPROUND(v0, v1, v2, v3); v0 ^= m1;
+    v3 ^= b;  SIPROUND(v0, v1, v2, v3); SIPROUND(v0, v1, v2, v3); v0 ^= b;
+    v2 ^= 0xff;
+    SIPROUND(v0, v1, v2, v3); SIPROUND(v0, v1, v2, v3); SIPROUND(v0, v1, v2, v3); SIPROUND(v0, v1, v2, v3);
+    uint64_t h = v0 ^ v1 ^ v2 ^ v3;
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static uint16_t csum_fold(uint32_t sum) {
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+static uint32_t csum_add(uint32_t sum, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    while (len > 1) { sum += (uint32_t)((p[0] << 8) | p[1]); p += 2; len -= 2; }
+    if (len) sum += (uint32_t)(p[0] << 8);
+    return sum;
+}
+
+// IPv4 + TCP SYN with an MSS option, so probes look like ordinary SYNs.
+#define SYN_PKT_LEN (20 + 24)
+
+static void build_syn(const SynScan* ss, unsigned char* pkt, uint32_t dst, uint16_t dport) {
+    memset(pkt, 0, SYN_PKT_LEN);
+    struct iphdr* ip = (struct iphdr*)pkt;
+    ip->version = 4;
+    ip->ihl = 5;
+    ip->tot_len = htons(SYN_PKT_LEN);
+    ip->id = htons((uint16_t)(dst ^ dport));
+    ip->ttl = 64;
+    ip->protocol = IPPROTO_TCP;
+    ip->saddr = htonl(ss->src_ip);
+    ip->daddr = htonl(dst);
+    ip->check = htons(csum_fold(csum_add(0, pkt, 20)));
+
+    struct tcphdr* th = (struct tcphdr*)(pkt + 20);
+    th->source = htons(ss->src_port);
+    th->dest = htons(dport);
+    th->seq = htonl(syn_cookie(ss, dst, dport));
+    th->doff = 6;
+    th->syn = 1;
+    th->window = htons(1024);
+    unsigned char* opt = pkt + 40;
+    opt[0] = 2; opt[1] = 4; opt[2] = 0x05; opt[3] = 0xB4; // MSS 1460
+
+    unsigned char pseudo[12];
+    memcpy(pseudo, &ip->saddr, 4);
+    memcpy(pseudo + 4, &ip->daddr, 4);
+    pseudo[8] = 0; pseudo[9] = IPPROTO_TCP;
+    pseudo[10] = 0; pseudo[11] = 24;
+    uint32_t sum = csum_add(0, pseudo, sizeof(pseudo));
+    sum = csum_add(sum, th, 24);
+    th->check = htons(csum_fold(sum));
+}
+
+static void mark_done(SynScan* ss) {
+    pthread_mutex_lock(&ss->lock);
+    ss->done = 1;
+    pthread_cond_broadcast(&ss->done_cv);
+    pthread_mutex_unlock(&ss->lock);
+}
+
+static void* tx_proc(void* arg) {
+    SynScan* ss = (SynScan*)arg;
+    unsigned char pkt[SYN_PKT_LEN];
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+
+    // Port-major order: consecutive SYNs go to different hosts.
+    for (int p = 0; p < ss->ports_count && !ss->cancel; ++p) {
+        TargetCursor cur;
+        uint64_t off;
+        target_order_seek(&ss->order, 0, ss->order.positions, &cur);
+        while (!ss->cancel && target_order_next(&ss->order, &cur, &off)) {
+            if (ss->skip && ss->skip(ss->skip_user, ss->start_ip + (unsigned long)off)) continue;
+            if (!pacer_acquire(ss->pacer, 1)) break;
+            uint32_t dst = (uint32_t)(ss->start_ip + off);
+            build_syn(ss, pkt, dst, (uint16_t)ss->ports[p]);
+            sa.sin_addr.s_addr = htonl(dst);
+            ssize_t sent;
+            while ((sent = sendto(ss->tx, pkt, sizeof(pkt), 0, (struct sockaddr*)&sa, sizeof(sa))) < 0) {
+                if ((errno != ENOBUFS && errno != EAGAIN) || ss->cancel) break;
+                sleep_ns(100000);
+            }
+            if (sent >= 0) metrics_inc(METRIC_TCP_PROBES);
+        }
+    }
+
+    uint64_t until = mono_ns() + (uint64_t)ss->wait_ms * 1000000ull;
+    while (!ss->cancel) {
+        uint64_t now = mono_ns();
+        if (now >= until) break;
+        uint64_t left = until - now;
+        sleep_ns(left > 20000000ull ? 20000000ull : left);
+    }
+    mark_done(ss);
+    return NULL;
+}
+
+static void handle_segment(SynScan* ss, const unsigned char* buf, size_t len) {
+    if (len < 20) return;
+    const struct iphdr* ip = (const struct iphdr*)buf;
+    size_t ihl = (size_t)ip->ihl * 4;
+    if (ip->protocol != IPPROTO_TCP || len < ihl + 20) return;
+    const struct tcphdr* th = (const struct tcphdr*)(buf + ihl);
+    if (ntohs(th->dest) != ss->src_port || !th->ack) return;
+    uint32_t from = ntohl(ip->saddr);
+    if (from < ss->start_ip || from - ss->start_ip >= ss->count) return;
+    uint16_t sport = ntohs(th->source);
+    if (ntohl(th->ack_seq) != syn_cookie(ss, from, sport) + 1u) return;
+    // Stateless: no per-probe send time, so no RTT sample.
+    if (th->syn && !th->rst) { metrics_inc(METRIC_TCP_OPEN); if (ss->fn) ss->fn(ss->user, from, sport, 1); }
+    else if (th->rst) { metrics_inc(METRIC_TCP_CLOSED); if (ss->fn) ss->fn(ss->user, from, sport, 0); }
+}
+
+static void* rx_proc(void* arg) {
+    SynScan* ss = (SynScan*)arg;
+    unsigned char buf[2048];
+    while (!ss->done) {
+        struct pollfd pfd; pfd.fd = ss->rx; pfd.events = POLLIN; pfd.revents = 0;
+        if (poll(&pfd, 1, 50) <= 0) continue;
+        for (;;) {
+            ssize_t n = recv(ss->rx, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n <= 0) break;
+            handle_segment(ss, buf, (size_t)n);
+        }
+    }
+    return NULL;
+}
+
+// Source address the kernel would route 'dst' from.
+static int route_source(uint32_t dst, uint32_t* src) {
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s < 0) return 0;
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(9);
+    sa.sin_addr.s_addr = htonl(dst);
+    int ok = 0;
+    if (connect(s, (struct sockaddr*)&sa, sizeof(sa)) == 0) {
+        socklen_t sl = sizeof(sa);
+        if (getsockname(s, (struct sockaddr*)&sa, &sl) == 0) { *src = ntohl(sa.sin_addr.s_addr); ok = 1; }
+    }
+    close(s);
+    return ok;
+}
+
+// Kernel-side filter: only TCP segments addressed to our source port reach
+// the receive thread.
+static void attach_port_filter(int fd, uint16_t port) {
+    struct sock_filter code[] = {
+        { BPF_LDX | BPF_B | BPF_MSH, 0, 0, 0 },       // x = IP header length
+        { BPF_LD | BPF_H | BPF_IND, 0, 0, 2 },        // a = tcp dest port
+        { BPF_JMP | BPF_JEQ | BPF_K, 0, 1, port },
+        { BPF_RET | BPF_K, 0, 0, 0xFFFF },
+        { BPF_RET | BPF_K, 0, 0, 0 },
+    };
+    struct sock_fprog prog;
+    prog.len = (unsigned short)(sizeof(code) / sizeof(code[0]));
+    prog.filter = code;
+    setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+}
+
+SynScan* syn_scan_start(unsigned long start_ip, unsigned long end_ip, const int* ports, int ports_count,
+                        int rate_pps, int wait_ms, SynResultFn fn, void* user) {
+    return syn_scan_start_opts(start_ip, end_ip, ports, ports_count, rate_pps, wait_ms, fn, user, NULL);
+}
+
+SynScan* syn_scan_start_opts(unsigned long start_ip, unsigned long end_ip, const int* ports, int ports_count,
+                             int rate_pps, int wait_ms, SynResultFn fn, void* user, const SynScanOptions* opts) {
+    if (end_ip < start_ip || ports_count <= 0) return NULL;
+    uint32_t src = 0;
+    if (!route_source((uint32_t)start_ip, &src)) return NULL;
+
+    int tx = socket(AF_INET, SOCK_RAW | SOCK_CLOEXEC, IPPROTO_RAW);
+    if (tx < 0) return NULL;
+    int one = 1;
+    setsockopt(tx, IPPROTO_IP, IP_HDRINCL, &one, sizeof(one));
+    int rx = socket(AF_INET, SOCK_RAW | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (rx < 0) { close(tx); return NULL; }
+    int rcvbuf = 8 * 1024 * 1024;
+    setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    SynScan* ss = (SynScan*)calloc(1, sizeof(SynScan));
+    if (!ss) { close(tx); close(rx); return NULL; }
+    ss->ports = (int*)malloc(sizeof(int) * (size_t)ports_count);
+    ss->pacer = pacer_create(rate_pps, PACER_DEFAULT_BURST);
+    if (!ss->ports || !ss->pacer) { free(ss->ports); pacer_destroy(ss->pacer); free(ss); close(tx); close(rx); return NULL; }
+    memcpy(ss->ports, ports, sizeof(int) * (size_t)ports_count);
+
+    uint64_t seed = mono_ns() ^ ((uint64_t)getpid() << 40) ^ (uint64_t)(uintptr_t)ss;
+    seed ^= seed >> 33; seed *= 0xff51afd7ed558ccdull; seed ^= seed >> 33;
+    ss->k0 = seed;
+    ss->k1 = seed * 0xc4ceb9fe1a85ec53ull ^ 0x9e3779b97f4a7c15ull;
+    ss->src_port = (uint16_t)(40000 + (seed >> 48) % 20000);
+    ss->tx = tx;
+    ss->rx = rx;
+    ss->src_ip = src;
+    ss->start_ip = start_ip;
+    ss->count = end_ip - start_ip + 1;
+    if (opts && opts->order) ss->order = *opts->order;
+    else target_order_init_sequential(&ss->order, ss->count);
+    if (opts) { ss->skip = opts->skip; ss->skip_user = opts->skip_user; }
+    ss->ports_count = ports_count;
+    ss->wait_ms = wait_ms > 0 ? wait_ms : 1000;
+    ss->fn = fn;
+    ss->user = user;
+    attach_port_filter(rx, ss->src_port);
+    pthread_mutex_init(&ss->lock, NULL);
+    pthread_cond_init(&ss->done_cv, NULL);
+
+    if (pthread_create(&ss->rx_thread, NULL, rx_proc, ss) != 0) {
+        pthread_mutex_destroy(&ss->lock); pthread_cond_destroy(&ss->done_cv);
+        pacer_destroy(ss->pacer); free(ss->ports); free(ss); close(tx); close(rx);
+        return NULL;
+    }
+    if (pthread_create(&ss->tx_thread, NULL, tx_proc, ss) != 0) {
+        mark_done(ss);
+        pthread_join(ss->rx_thread, NULL);
+        pthread_mutex_destroy(&ss->lock); pthread_cond_destroy(&ss->done_cv);
+        pacer_destroy(ss->pacer); free(ss->ports); free(ss); close(tx); close(rx);
+        return NULL;
+    }
+    return ss;
+}
+
+void syn_scan_wait(SynScan* ss) {
+    if (!ss) return;
+    pthread_mutex_lock(&ss->lock);
+    while (!ss->done) pthread_cond_wait(&ss->done_cv, &ss->lock);
+    pthread_mutex_unlock(&ss->lock);
+}
+
+int syn_scan_done(const SynScan* ss) { return ss ? ss->done : 1; }
+
+void syn_scan_cancel(SynScan* ss) { if (ss) { ss->cancel = 1; pacer_close(ss->pacer); } }
+
+void syn_scan_destroy(SynScan* ss) {
+    if (!ss) return;
+    syn_scan_cancel(ss);
+    pthread_join(ss->tx_thread, NULL);
+    pthread_join(ss->rx_thread, NULL);
+    pthread_mutex_destroy(&ss->lock);
+    pthread_cond_destroy(&ss->done_cv);
+    close(ss->tx);
+    close(ss->rx);
+    pacer_destroy(ss->pacer);
+    free(ss->ports);
+    free(ss);
+}
+
+#else // !__linux__
+
+// Raw TCP sockets are not usable on Windows; callers keep connect probes.
+SynScan* syn_scan_start(unsigned long start_ip, unsigned long end_ip, const int* ports, int ports_count,
+                        int rate_pps, int wait_ms, SynResultFn fn, void* user) {
+    (void)start_ip; (void)end_ip; (void)ports; (void)ports_count; (void)rate_pps; (void)wait_ms; (void)fn; (void)user;
+    return 0;
+}
+SynScan* syn_scan_start_opts(unsigned long start_ip, unsigned long end_ip, const int* ports, int ports_count,
+                             int rate_pps, int wait_ms, SynResultFn fn, void* user, const SynScanOptions* opts) {
+    (void)opts;
+    return syn_scan_start(start_ip, end_ip, ports, ports_count, rate_pps, wait_ms, fn, user);
+}
+void syn_scan_wait(SynScan* ss) { (void)ss; }
+int syn_scan_done(const SynScan* ss) { (void)ss; return 1; }
+void syn_scan_cancel(SynScan* ss) { (void)ss; }
+void syn_scan_destroy(SynScan* ss) { (void)ss; }
+
+#endif
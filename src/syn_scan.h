@@ -0,0 +1,52 @@
+#ifndef SYN_SCAN_H
+#define SYN_SCAN_H
+
+// Stateless raw-socket SYN scanner. The transmit thread encodes a keyed hash
+// of (ip, port) in each SYN's sequence number; the receive thread accepts a
+// SYN-ACK or RST only if its ACK number matches that hash + 1. No per-probe
+// state is kept, so memory does not grow with range x ports.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include "target_order.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SynScan SynScan;
+
+// Called from the receive thread. 'open' is 1 for SYN-ACK, 0 for RST.
+// Retransmitted SYN-ACKs can report the same (ip, port) more than once.
+typedef void (*SynResultFn)(void* user, unsigned long ip, int port, int open);
+
+// Sends one SYN per (ip, port) of [start_ip, end_ip] x ports at 'rate_pps'
+// and keeps listening 'wait_ms' after the last one. Requires raw socket
+// privileges (root or CAP_NET_RAW); returns NULL otherwise or where
+// unsupported, and callers fall back to connect probes.
+SynScan* syn_scan_start(unsigned long start_ip, unsigned long end_ip, const int* ports, int ports_count,
+                        int rate_pps, int wait_ms, SynResultFn fn, void* user);
+
+// Called from the send thread before each SYN; nonzero skips the address
+// for that port.
+typedef int (*SynSkipFn)(void* user, unsigned long ip);
+
+typedef struct {
+    const TargetOrder* order; // host order within each port; NULL = ascending
+    SynSkipFn skip;           // NULL = probe every address
+    void* skip_user;
+} SynScanOptions;
+
+// As syn_scan_start with the options above; 'opts' is copied.
+SynScan* syn_scan_start_opts(unsigned long start_ip, unsigned long end_ip, const int* ports, int ports_count,
+                             int rate_pps, int wait_ms, SynResultFn fn, void* user, const SynScanOptions* opts);
+
+void syn_scan_wait(SynScan* ss);
+int syn_scan_done(const SynScan* ss);
+void syn_scan_cancel(SynScan* ss);
+void syn_scan_destroy(SynScan* ss);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SYN_SCAN_H
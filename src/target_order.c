@@ -0,0 +1,116 @@
+#include "target_order.h"
+
+// Operands are below p <= 2^32 + 15, so products need up to 66 bits.
+static uint64_t mulmod(uint64_t a, uint64_t b, uint64_t p) {
+#if defined(__SIZEOF_INT128__)
+    return (uint64_t)(((unsigned __int128)a * b) % p);
+#else
+    // a < 2^33 and b split at bit 16: every partial product fits in 64 bits.
+    uint64_t t = (a * (b >> 16)) % p;
+    t = (t << 16) % p;
+    return (t + a * (b & 0xFFFFu)) % p;
+#endif
+}
+
+static uint64_t powmod(uint64_t b, uint64_t e, uint64_t p) {
+    uint64_t r = 1 % p;
+    b %= p;
+    while (e) {
+        if (e & 1) r = mulmod(r, b, p);
+        b = mulmod(b, b, p);
+        e >>= 1;
+    }
+    return r;
+}
+
+static int is_prime(uint64_t x) {
+    if (x < 2) return 0;
+    if (x % 2 == 0) return x == 2;
+    for (uint64_t d = 3; d * d <= x; d += 2) {
+        if (x % d == 0) return 0;
+    }
+    return 1;
+}
+
+static uint64_t splitmix64(uint64_t* s) {
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void target_order_init_sequential(TargetOrder* o, uint64_t n) {
+    o->n = n;
+    o->prime = 0;
+    o->step = 1;
+    o->first = 0;
+    o->positions = n;
+}
+
+void target_order_init_shuffled(TargetOrder* o, uint64_t n, uint64_t seed) {
+    if (n < 2) { target_order_init_sequential(o, n); return; }
+    uint64_t p = n + 1;
+    while (!is_prime(p)) p++;
+    // Distinct prime factors of the group order p - 1.
+    uint64_t factors[16];
+    int nf = 0;
+    uint64_t m = p - 1;
+    for (uint64_t d = 2; d * d <= m; ++d) {
+        if (m % d) continue;
+        factors[nf++] = d;
+        while (m % d == 0) m /= d;
+    }
+    if (m > 1) factors[nf++] = m;
+    // A random primitive root: g^((p-1)/q) != 1 for every factor q.
+    uint64_t s = seed;
+    uint64_t g = 1;
+    if (p > 2) {
+        for (;;) {
+            g = 2 + splitmix64(&s) % (p - 2);
+            int ok = 1;
+            for (int i = 0; i < nf && ok; ++i) ok = powmod(g, (p - 1) / factors[i], p) != 1;
+            if (ok) break;
+        }
+    }
+    o->n = n;
+    o->prime = p;
+    o->step = g;
+    o->first = 1 + splitmix64(&s) % (p - 1);
+    o->positions = p - 1;
+}
+
+void target_order_shard(TargetOrder* o, uint64_t index, uint64_t count) {
+    if (count <= 1) return;
+    if (index >= o->positions) { o->positions = 0; return; }
+    if (o->prime) {
+        o->first = mulmod(o->first, powmod(o->step, index, o->prime), o->prime);
+        o->step = powmod(o->step, count, o->prime);
+    } else {
+        o->first += index * o->step;
+        o->step *= count;
+    }
+    o->positions = (o->positions - index + count - 1) / count;
+}
+
+void target_order_seek(const TargetOrder* o, uint64_t pos, uint64_t count, TargetCursor* c) {
+    if (pos >= o->positions) { c->x = 0; c->left = 0; return; }
+    if (count > o->positions - pos) count = o->positions - pos;
+    c->left = count;
+    if (o->prime) c->x = mulmod(o->first, powmod(o->step, pos, o->prime), o->prime);
+    else c->x = o->first + pos * o->step;
+}
+
+int target_order_next(const TargetOrder* o, TargetCursor* c, uint64_t* offset) {
+    while (c->left) {
+        c->left--;
+        uint64_t e = c->x;
+        if (o->prime) {
+            c->x = mulmod(c->x, o->step, o->prime);
+            e -= 1; // elements are 1..p-1
+        } else {
+            c->x += o->step;
+        }
+        if (e < o->n) { *offset = e; return 1; }
+    }
+    return 0;
+}
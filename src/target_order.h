@@ -0,0 +1,51 @@
+#ifndef TARGET_ORDER_H
+#define TARGET_ORDER_H
+
+// Visit order for the addresses of a range. The shuffled order walks the
+// multiplicative group of integers modulo a prime p just above the range
+// size: position k is first * gen^k mod p, and since gen is a primitive
+// root the walk meets every element 1..p-1 exactly once. Elements beyond
+// the range are skipped. The whole state is a few integers, any position
+// can be reached directly, and shard i of N is the same walk with
+// first * gen^i and step gen^N.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint64_t n;         // addresses in the range
+    uint64_t prime;     // 0 = ascending order
+    uint64_t step;      // multiplier (shuffled) or stride (ascending)
+    uint64_t first;     // group element or offset at position 0
+    uint64_t positions; // length of the walk; a few more than 'n' when shuffled
+} TargetOrder;
+
+// Ascending offsets 0..n-1.
+void target_order_init_sequential(TargetOrder* o, uint64_t n);
+// A shuffled order of 0..n-1 (n <= 2^32) chosen by 'seed'; the same seed
+// gives the same order.
+void target_order_init_shuffled(TargetOrder* o, uint64_t n, uint64_t seed);
+// Restricts 'o' to every 'count'-th position starting at 'index'. The
+// shards of one order are disjoint and together cover it.
+void target_order_shard(TargetOrder* o, uint64_t index, uint64_t count);
+
+// Walks positions [pos, pos + count) of an order.
+typedef struct {
+    uint64_t x;    // current element
+    uint64_t left; // positions not yet visited
+} TargetCursor;
+
+void target_order_seek(const TargetOrder* o, uint64_t pos, uint64_t count, TargetCursor* c);
+// Stores the next offset in the range and returns 1, or returns 0 once the
+// positions are used up. Positions that fall outside the range are passed over.
+int target_order_next(const TargetOrder* o, TargetCursor* c, uint64_t* offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TARGET_ORDER_H
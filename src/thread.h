@@ -0,0 +1,76 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+// Portable threads, mutexes, condition variables and a monotonic clock.
+// Backends: thread_win32.c (Win32) and thread_posix.c (pthreads).
+// Atomics use C11 <stdatomic.h> directly.
+// On Windows this header stays free of SDK includes (see utils.h): the
+// SRWLOCK and CONDITION_VARIABLE behind Mutex/CondVar are pointer-sized.
+
+#ifdef _WIN32
+typedef struct { void* handle; } Thread;
+typedef struct { void* srw; } Mutex;
+typedef struct { void* cv; } CondVar;
+#define MUTEX_INITIALIZER { 0 } // SRWLOCK_INIT
+typedef unsigned long ThreadKey; // FLS index
+#else
+#include <pthread.h>
+typedef struct { pthread_t handle; int valid; } Thread;
+typedef struct { pthread_mutex_t m; } Mutex;
+typedef struct { pthread_cond_t c; } CondVar;
+#define MUTEX_INITIALIZER { PTHREAD_MUTEX_INITIALIZER }
+typedef pthread_key_t ThreadKey;
+#endif
+
+// Storage class for per-thread fast-path pointers.
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*ThreadFn)(void* arg);
+
+// Returns 1 on success, 0 on failure.
+int thread_create(Thread* t, ThreadFn fn, void* arg);
+void thread_join(Thread* t);
+
+// Static mutexes may use MUTEX_INITIALIZER instead of mutex_init.
+void mutex_init(Mutex* m);
+void mutex_destroy(Mutex* m);
+void mutex_lock(Mutex* m);
+void mutex_unlock(Mutex* m);
+
+void cond_init(CondVar* c);
+void cond_destroy(CondVar* c);
+void cond_wait(CondVar* c, Mutex* m);
+// Returns 0 on timeout, 1 if woken (spurious wakeups are possible).
+int cond_timedwait(CondVar* c, Mutex* m, int timeout_ms);
+void cond_signal(CondVar* c);
+void cond_broadcast(CondVar* c);
+
+// Per-thread values with an exit hook: 'on_exit' runs with the thread's
+// non-NULL value when that thread ends (any thread, not just thread_create's).
+// Returns 1 on success, 0 on failure.
+typedef void (*ThreadExitFn)(void* value);
+int thread_key_create(ThreadKey* key, ThreadExitFn on_exit);
+void thread_key_set(ThreadKey key, void* value);
+
+unsigned long long clock_monotonic_ms(void);
+unsigned long long clock_monotonic_ns(void);
+// Sleep at least the given time (Win32 rounds up to whole milliseconds).
+void thread_sleep_ms(int ms);
+void thread_sleep_ns(unsigned long long ns);
+
+// CPUs this process may run on (affinity mask), at least 1.
+int cpu_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // THREAD_H
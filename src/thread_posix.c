@@ -0,0 +1,115 @@
+// pthreads implementation of thread.h. The Windows build uses thread_win32.c.
+#ifndef _WIN32
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // sched_getaffinity, CPU_COUNT
+#endif
+#include "thread.h"
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+typedef struct {
+    ThreadFn fn;
+    void* arg;
+} ThreadStart;
+
+static void* thread_trampoline(void* p) {
+    ThreadStart ts = *(ThreadStart*)p;
+    free(p);
+    ts.fn(ts.arg);
+    return NULL;
+}
+
+int thread_create(Thread* t, ThreadFn fn, void* arg) {
+    ThreadStart* ts = (ThreadStart*)malloc(sizeof(ThreadStart));
+    if (!ts) return 0;
+    ts->fn = fn;
+    ts->arg = arg;
+    if (pthread_create(&t->handle, NULL, thread_trampoline, ts) != 0) {
+        free(ts);
+        t->valid = 0;
+        return 0;
+    }
+    t->valid = 1;
+    return 1;
+}
+
+void thread_join(Thread* t) {
+    if (!t->valid) return;
+    pthread_join(t->handle, NULL);
+    t->valid = 0;
+}
+
+void mutex_init(Mutex* m) { pthread_mutex_init(&m->m, NULL); }
+void mutex_destroy(Mutex* m) { pthread_mutex_destroy(&m->m); }
+void mutex_lock(Mutex* m) { pthread_mutex_lock(&m->m); }
+void mutex_unlock(Mutex* m) { pthread_mutex_unlock(&m->m); }
+
+// Timed waits use CLOCK_MONOTONIC so wall-clock jumps do not stretch them.
+void cond_init(CondVar* c) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&c->c, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+void cond_destroy(CondVar* c) { pthread_cond_destroy(&c->c); }
+void cond_wait(CondVar* c, Mutex* m) { pthread_cond_wait(&c->c, &m->m); }
+
+int cond_timedwait(CondVar* c, Mutex* m, int timeout_ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+    return pthread_cond_timedwait(&c->c, &m->m, &ts) != ETIMEDOUT;
+}
+
+void cond_signal(CondVar* c) { pthread_cond_signal(&c->c); }
+void cond_broadcast(CondVar* c) { pthread_cond_broadcast(&c->c); }
+
+int thread_key_create(ThreadKey* key, ThreadExitFn on_exit) { return pthread_key_create(key, on_exit) == 0; }
+void thread_key_set(ThreadKey key, void* value) { pthread_setspecific(key, value); }
+
+unsigned long long clock_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+unsigned long long clock_monotonic_ms(void) {
+    return clock_monotonic_ns() / 1000000ull;
+}
+
+void thread_sleep_ns(unsigned long long ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000ull);
+    ts.tv_nsec = (long)(ns % 1000000000ull);
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) { }
+}
+
+void thread_sleep_ms(int ms) {
+    if (ms > 0) thread_sleep_ns((unsigned long long)ms * 1000000ull);
+}
+
+int cpu_count(void) {
+#ifdef __linux__
+    // Honors taskset/cgroup cpusets, unlike the online CPU count.
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        int n = CPU_COUNT(&set);
+        if (n > 0) return n;
+    }
+#endif
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+#endif // !_WIN32
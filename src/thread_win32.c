@@ -0,0 +1,107 @@
+// Win32 implementation of thread.h. Other platforms use thread_posix.c.
+#ifdef _WIN32
+
+#include "thread.h"
+#include <stdlib.h>
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
+#include <windows.h>
+
+typedef char srwlock_fits_mutex[(sizeof(SRWLOCK) == sizeof(void*)) ? 1 : -1];
+typedef char condvar_fits_condvar[(sizeof(CONDITION_VARIABLE) == sizeof(void*)) ? 1 : -1];
+
+typedef struct {
+    ThreadFn fn;
+    void* arg;
+} ThreadStart;
+
+static DWORD WINAPI thread_trampoline(LPVOID p) {
+    ThreadStart ts = *(ThreadStart*)p;
+    free(p);
+    ts.fn(ts.arg);
+    return 0;
+}
+
+int thread_create(Thread* t, ThreadFn fn, void* arg) {
+    ThreadStart* ts = (ThreadStart*)malloc(sizeof(ThreadStart));
+    if (!ts) return 0;
+    ts->fn = fn;
+    ts->arg = arg;
+    t->handle = CreateThread(NULL, 0, thread_trampoline, ts, 0, NULL);
+    if (!t->handle) { free(ts); return 0; }
+    return 1;
+}
+
+void thread_join(Thread* t) {
+    if (!t->handle) return;
+    WaitForSingleObject((HANDLE)t->handle, INFINITE);
+    CloseHandle((HANDLE)t->handle);
+    t->handle = NULL;
+}
+
+void mutex_init(Mutex* m) { InitializeSRWLock((PSRWLOCK)&m->srw); }
+void mutex_destroy(Mutex* m) { (void)m; } // SRW locks need no cleanup
+void mutex_lock(Mutex* m) { AcquireSRWLockExclusive((PSRWLOCK)&m->srw); }
+void mutex_unlock(Mutex* m) { ReleaseSRWLockExclusive((PSRWLOCK)&m->srw); }
+
+void cond_init(CondVar* c) { InitializeConditionVariable((PCONDITION_VARIABLE)&c->cv); }
+void cond_destroy(CondVar* c) { (void)c; }
+
+void cond_wait(CondVar* c, Mutex* m) {
+    SleepConditionVariableSRW((PCONDITION_VARIABLE)&c->cv, (PSRWLOCK)&m->srw, INFINITE, 0);
+}
+
+int cond_timedwait(CondVar* c, Mutex* m, int timeout_ms) {
+    if (SleepConditionVariableSRW((PCONDITION_VARIABLE)&c->cv, (PSRWLOCK)&m->srw, (DWORD)timeout_ms, 0)) return 1;
+    return GetLastError() != ERROR_TIMEOUT;
+}
+
+void cond_signal(CondVar* c) { WakeConditionVariable((PCONDITION_VARIABLE)&c->cv); }
+void cond_broadcast(CondVar* c) { WakeAllConditionVariable((PCONDITION_VARIABLE)&c->cv); }
+
+// Fiber-local storage: its callback also runs when a thread exits. The build
+// targets amd64 only, where WINAPI and the C calling convention are the same.
+int thread_key_create(ThreadKey* key, ThreadExitFn on_exit) {
+    DWORD k = FlsAlloc((PFLS_CALLBACK_FUNCTION)on_exit);
+    if (k == FLS_OUT_OF_INDEXES) return 0;
+    *key = k;
+    return 1;
+}
+void thread_key_set(ThreadKey key, void* value) { FlsSetValue((DWORD)key, value); }
+
+unsigned long long clock_monotonic_ns(void) {
+    static LARGE_INTEGER freq; // written once; same value from every thread
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    unsigned long long sec = (unsigned long long)(now.QuadPart / freq.QuadPart);
+    unsigned long long rem = (unsigned long long)(now.QuadPart % freq.QuadPart);
+    return sec * 1000000000ull + rem * 1000000000ull / (unsigned long long)freq.QuadPart;
+}
+
+unsigned long long clock_monotonic_ms(void) {
+    return (unsigned long long)GetTickCount64();
+}
+
+void thread_sleep_ms(int ms) {
+    if (ms > 0) Sleep((DWORD)ms);
+}
+
+// Sleep() has millisecond granularity: round up rather than spin.
+void thread_sleep_ns(unsigned long long ns) {
+    if (ns > 0) Sleep((DWORD)((ns + 999999ull) / 1000000ull));
+}
+
+int cpu_count(void) {
+    DWORD_PTR proc = 0, sys = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &proc, &sys) && proc) {
+        int n = 0;
+        for (; proc; proc &= proc - 1) n++;
+        return n;
+    }
+    SYSTEM_INFO si; GetSystemInfo(&si);
+    return si.dwNumberOfProcessors > 0 ? (int)si.dwNumberOfProcessors : 1;
+}
+
+#endif // _WIN32
@@ -0,0 +1,230 @@
+#include "timer_wheel.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define WHEEL_BITS 8
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 4
+#define FIRING_BUCKET (WHEEL_LEVELS * WHEEL_SLOTS) // timers of the tick being fired
+#define FREE_BUCKET 0xFFFFu
+#define NIL 0xFFFFFFFFu
+
+typedef struct {
+    uint64_t data;
+    uint32_t expires; // tick, modulo 2^32: the levels only look at 32 bits
+    uint32_t next, prev;
+    uint16_t gen;     // bumped on reuse, so a stale id cancels nothing
+    uint16_t bucket;  // level * WHEEL_SLOTS + slot, FIRING_BUCKET or FREE_BUCKET
+} TimerNode;
+
+struct TimerWheel {
+    int tick_ms;
+    unsigned long long origin_ms;
+    uint64_t tick; // next tick to fire; everything before it has fired
+    TimerFn fn;
+    void* user;
+    TimerNode* nodes;
+    uint32_t cap;
+    uint32_t free_head;
+    size_t pending;
+    uint32_t heads[FIRING_BUCKET + 1];
+    uint64_t occupied[WHEEL_LEVELS][WHEEL_SLOTS / 64]; // non-empty slots
+};
+
+static uint64_t tick_at(const TimerWheel* w, unsigned long long now_ms) {
+    return now_ms > w->origin_ms ? (now_ms - w->origin_ms) / (unsigned)w->tick_ms : 0;
+}
+
+// First non-empty level-0 slot at or after 'from', WHEEL_SLOTS if none.
+static int next_occupied(const TimerWheel* w, int from) {
+    for (int k = from >> 6; k < WHEEL_SLOTS / 64; ++k) {
+        uint64_t bits = w->occupied[0][k];
+        if (k == from >> 6) bits &= ~0ull << (from & 63);
+        for (int b = 0; bits; ++b, bits >>= 1) {
+            if (bits & 1) return k * 64 + b;
+        }
+    }
+    return WHEEL_SLOTS;
+}
+
+// Files node 'i' by the distance from the current tick to its expiry.
+static void link_node(TimerWheel* w, uint32_t i) {
+    TimerNode* n = &w->nodes[i];
+    uint32_t delta = n->expires - (uint32_t)w->tick;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= 1u << (WHEEL_BITS * (level + 1))) level++;
+    int slot = (int)(n->expires >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+    uint32_t b = (uint32_t)(level * WHEEL_SLOTS + slot);
+    n->bucket = (uint16_t)b;
+    n->prev = NIL;
+    n->next = w->heads[b];
+    if (n->next != NIL) w->nodes[n->next].prev = i;
+    w->heads[b] = i;
+    w->occupied[level][slot >> 6] |= 1ull << (slot & 63);
+}
+
+static void unlink_node(TimerWheel* w, uint32_t i) {
+    TimerNode* n = &w->nodes[i];
+    if (n->prev != NIL) w->nodes[n->prev].next = n->next; else w->heads[n->bucket] = n->next;
+    if (n->next != NIL) w->nodes[n->next].prev = n->prev;
+    if (n->bucket < FIRING_BUCKET && w->heads[n->bucket] == NIL) {
+        int level = n->bucket / WHEEL_SLOTS, slot = n->bucket % WHEEL_SLOTS;
+        w->occupied[level][slot >> 6] &= ~(1ull << (slot & 63));
+    }
+}
+
+static void free_node(TimerWheel* w, uint32_t i) {
+    TimerNode* n = &w->nodes[i];
+    n->bucket = FREE_BUCKET;
+    n->gen++;
+    n->next = w->free_head;
+    w->free_head = i;
+    w->pending--;
+}
+
+static int grow(TimerWheel* w, uint32_t ncap) {
+    if (ncap <= w->cap || ncap == NIL) return 0;
+    TimerNode* nn = (TimerNode*)realloc(w->nodes, sizeof(TimerNode) * (size_t)ncap);
+    if (!nn) return 0;
+    for (uint32_t i = w->cap; i < ncap; ++i) {
+        nn[i].bucket = FREE_BUCKET;
+        nn[i].gen = 0;
+        nn[i].next = i + 1 < ncap ? i + 1 : w->free_head;
+    }
+    w->free_head = w->cap;
+    w->nodes = nn;
+    w->cap = ncap;
+    return 1;
+}
+
+// Moves every timer of bucket 'b' to where it belongs from the current tick.
+static void relink_bucket(TimerWheel* w, uint32_t b) {
+    uint32_t i = w->heads[b];
+    w->heads[b] = NIL;
+    w->occupied[b / WHEEL_SLOTS][(b % WHEEL_SLOTS) >> 6] &= ~(1ull << (b % 64));
+    while (i != NIL) {
+        uint32_t next = w->nodes[i].next;
+        link_node(w, i);
+        i = next;
+    }
+}
+
+TimerWheel* timer_wheel_create(int tick_ms, unsigned long long now_ms, TimerFn fn, void* user) {
+    TimerWheel* w = (TimerWheel*)calloc(1, sizeof(TimerWheel));
+    if (!w) return NULL;
+    w->tick_ms = tick_ms > 0 ? tick_ms : 1;
+    w->origin_ms = now_ms;
+    w->fn = fn;
+    w->user = user;
+    w->free_head = NIL;
+    for (int b = 0; b <= FIRING_BUCKET; ++b) w->heads[b] = NIL;
+    return w;
+}
+
+void timer_wheel_destroy(TimerWheel* w) {
+    if (!w) return;
+    free(w->nodes);
+    free(w);
+}
+
+TimerId timer_wheel_add(TimerWheel* w, unsigned long long now_ms, int delay_ms, uint64_t data) {
+    if (!w || (w->free_head == NIL && !grow(w, w->cap ? w->cap * 2 : 1024))) return 0;
+    // Never early: the tick that starts at or after the due time.
+    unsigned long long due = now_ms + (unsigned long long)(delay_ms > 0 ? delay_ms : 0);
+    uint64_t expires = due > w->origin_ms ? (due - w->origin_ms + (unsigned)w->tick_ms - 1) / (unsigned)w->tick_ms : 0;
+    if (expires < w->tick) expires = w->tick; // due already: the next advance fires it
+    if (expires - w->tick > 0xFFFFFFFFull) expires = w->tick + 0xFFFFFFFFull;
+    uint32_t i = w->free_head;
+    TimerNode* n = &w->nodes[i];
+    w->free_head = n->next;
+    n->data = data;
+    n->expires = (uint32_t)expires;
+    link_node(w, i);
+    w->pending++;
+    return ((uint64_t)n->gen << 32) | ((uint64_t)i + 1);
+}
+
+int timer_wheel_cancel(TimerWheel* w, TimerId id) {
+    if (!w || !id) return 0;
+    uint32_t i = (uint32_t)id - 1;
+    if (i >= w->cap) return 0;
+    TimerNode* n = &w->nodes[i];
+    if (n->bucket == FREE_BUCKET || n->gen != (uint16_t)(id >> 32)) return 0;
+    unlink_node(w, i);
+    free_node(w, i);
+    return 1;
+}
+
+size_t timer_wheel_advance(TimerWheel* w, unsigned long long now_ms) {
+    if (!w) return 0;
+    uint64_t target = tick_at(w, now_ms);
+    size_t fired = 0;
+    while (w->tick <= target) {
+        if (w->pending == 0) { w->tick = target + 1; break; }
+        uint64_t t = w->tick;
+        int slot = (int)(t & (WHEEL_SLOTS - 1));
+        // Entering a new block of 256 ticks: bring the timers of the
+        // matching slot one level down, and so on up while slots wrap.
+        for (int level = 1; level < WHEEL_LEVELS && ((t >> (WHEEL_BITS * (level - 1))) & (WHEEL_SLOTS - 1)) == 0; ++level) {
+            uint32_t b = (uint32_t)(level * WHEEL_SLOTS) + (uint32_t)((t >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+            if (w->heads[b] != NIL) relink_bucket(w, b);
+        }
+        if (w->heads[slot] == NIL) {
+            // Jump to the next busy slot of this block, or to its end.
+            uint64_t next = (t & ~(uint64_t)(WHEEL_SLOTS - 1)) + (uint64_t)next_occupied(w, slot);
+            w->tick = next < target + 1 ? next : target + 1;
+            continue;
+        }
+        // Detach the slot first so callbacks can add timers for this tick
+        // (they land in the next one) or cancel ones still to fire.
+        w->heads[FIRING_BUCKET] = w->heads[slot];
+        w->heads[slot] = NIL;
+        w->occupied[0][slot >> 6] &= ~(1ull << (slot & 63));
+        for (uint32_t i = w->heads[FIRING_BUCKET]; i != NIL; i = w->nodes[i].next) w->nodes[i].bucket = FIRING_BUCKET;
+        w->tick = t + 1;
+        while (w->heads[FIRING_BUCKET] != NIL) {
+            uint32_t i = w->heads[FIRING_BUCKET];
+            uint64_t data = w->nodes[i].data;
+            unlink_node(w, i);
+            free_node(w, i);
+            fired++;
+            if (w->fn) w->fn(w->user, data);
+        }
+    }
+    return fired;
+}
+
+int timer_wheel_next_ms(const TimerWheel* w, unsigned long long now_ms, int cap_ms) {
+    if (!w || w->pending == 0) return cap_ms;
+    int slot = (int)(w->tick & (WHEEL_SLOTS - 1));
+    // Past the end of the block only a cascade is certain; at its start
+    // one is still due.
+    uint64_t due = w->tick;
+    if (slot != 0) due = (w->tick & ~(uint64_t)(WHEEL_SLOTS - 1)) + (uint64_t)next_occupied(w, slot);
+    unsigned long long due_ms = w->origin_ms + due * (unsigned)w->tick_ms;
+    if (due_ms <= now_ms) return 0;
+    return due_ms - now_ms < (unsigned long long)cap_ms ? (int)(due_ms - now_ms) : cap_ms;
+}
+
+size_t timer_wheel_pending(const TimerWheel* w) { return w ? w->pending : 0; }
+
+int timer_wheel_reserve(TimerWheel* w, size_t count) {
+    if (!w) return 0;
+    if (count <= w->cap - w->pending) return 1;
+    if (count >= NIL - w->pending) return 0;
+    return grow(w, (uint32_t)(w->pending + count));
+}
+
+void retry_policy_init(RetryPolicy* p, int tries, int timeout_ms, int backoff_pct, int max_timeout_ms) {
+    p->tries = tries > 0 ? tries : 1;
+    p->timeout_ms = timeout_ms > 0 ? timeout_ms : 1;
+    p->backoff_pct = backoff_pct > 0 ? backoff_pct : 100;
+    p->max_timeout_ms = max_timeout_ms > 0 ? max_timeout_ms : 0;
+}
+
+int retry_policy_timeout_ms(const RetryPolicy* p, int attempt) {
+    long long ms = p->timeout_ms;
+    long long cap = p->max_timeout_ms > 0 ? p->max_timeout_ms : 0x7FFFFFFF;
+    for (int k = 0; k < attempt && ms < cap; ++k) ms = ms * p->backoff_pct / 100;
+    return (int)(ms < cap ? ms : cap);
+}
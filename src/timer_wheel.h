@@ -0,0 +1,75 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+// Hierarchical timing wheel for probe deadlines: four levels of 256 slots,
+// each level's slot spanning 256 slots of the level below. Adding and
+// cancelling a timer is O(1); advancing the clock fires a whole slot at a
+// time and moves a higher slot down a level once per 256 ticks, so the cost
+// does not grow with the number of pending timers. Timers live in one
+// growable array linked by index (24 bytes each), so ten million pending
+// probes take about 240 MB and no allocation per timer.
+// A wheel belongs to one event loop and is not thread-safe.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TimerWheel TimerWheel;
+
+// 0 is never a valid timer. An id stays valid until its timer fires or is
+// cancelled.
+typedef uint64_t TimerId;
+
+// Called for each expired timer with the value it was added with. It may
+// add and cancel timers, including other timers due in the same tick, but
+// not advance the wheel.
+typedef void (*TimerFn)(void* user, uint64_t data);
+
+// 'tick_ms' is the resolution (>= 1); 'now_ms' is the caller's clock
+// (clock_monotonic_ms) at creation. Returns NULL when out of memory.
+TimerWheel* timer_wheel_create(int tick_ms, unsigned long long now_ms, TimerFn fn, void* user);
+// Drops pending timers without firing them.
+void timer_wheel_destroy(TimerWheel* w);
+
+// Fires 'data' once 'delay_ms' has passed (rounded up to whole ticks; at
+// most about 2^32 ticks). Returns 0 when out of memory.
+TimerId timer_wheel_add(TimerWheel* w, unsigned long long now_ms, int delay_ms, uint64_t data);
+// Returns 1 if the timer was pending.
+int timer_wheel_cancel(TimerWheel* w, TimerId id);
+
+// Fires every timer due by 'now_ms', oldest tick first. Returns how many fired.
+size_t timer_wheel_advance(TimerWheel* w, unsigned long long now_ms);
+
+// Milliseconds until the next advance can fire something, at most 'cap_ms';
+// exact for timers due within 256 ticks, otherwise a lower bound.
+int timer_wheel_next_ms(const TimerWheel* w, unsigned long long now_ms, int cap_ms);
+
+size_t timer_wheel_pending(const TimerWheel* w);
+// Makes room for 'count' pending timers up front, so adds up to that many
+// cannot fail. Returns 0 when out of memory.
+int timer_wheel_reserve(TimerWheel* w, size_t count);
+
+// Retransmission schedule for one probe type: up to 'tries' sends, waiting
+// 'timeout_ms' after the first and 'backoff_pct' percent of the previous
+// wait after each later one (100 = constant, 200 = doubling), capped at
+// 'max_timeout_ms' (0 = no cap).
+typedef struct {
+    int tries;
+    int timeout_ms;
+    int backoff_pct;
+    int max_timeout_ms;
+} RetryPolicy;
+
+void retry_policy_init(RetryPolicy* p, int tries, int timeout_ms, int backoff_pct, int max_timeout_ms);
+// Wait after send number 'attempt' (0 = the first).
+int retry_policy_timeout_ms(const RetryPolicy* p, int attempt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMER_WHEEL_H
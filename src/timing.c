@@ -0,0 +1,214 @@
+#include "timing.h"
+#include "thread.h"
+#include <stdlib.h>
+
+// ---- RTT estimates --------------------------------------------------------
+
+// Estimates in microseconds, updated as in RFC 6298: the first sample sets
+// srtt = R and rttvar = R / 2, later ones move srtt by 1/8 and rttvar by 1/4.
+typedef struct {
+    uint32_t key;     // host address, or address >> 8 for a /24
+    uint32_t samples; // 0 = empty slot
+    uint32_t srtt_us;
+    uint32_t rttvar_us;
+} RttEntry;
+
+typedef struct {
+    RttEntry* items; // open addressing, power-of-two capacity
+    size_t cap, count;
+} RttTable;
+
+#define TIMING_MAX_ENTRIES (1u << 20) // per table; beyond it new keys are not tracked
+
+static Mutex g_lock = MUTEX_INITIALIZER;
+static RttTable g_hosts, g_subnets; // under g_lock
+static RttEntry g_all;
+
+static size_t rtt_index(uint32_t key, size_t cap) {
+    uint32_t h = key;
+    h ^= h >> 16; h *= 0x45d9f3bu; h ^= h >> 16;
+    return h & (cap - 1);
+}
+
+// Caller holds g_lock.
+static int table_grow(RttTable* t) {
+    size_t ncap = t->cap ? t->cap * 2 : 1024;
+    RttEntry* nt = (RttEntry*)calloc(ncap, sizeof(RttEntry));
+    if (!nt) return 0;
+    for (size_t i = 0; i < t->cap; ++i) {
+        if (!t->items[i].samples) continue;
+        size_t k = rtt_index(t->items[i].key, ncap);
+        while (nt[k].samples) k = (k + 1) & (ncap - 1);
+        nt[k] = t->items[i];
+    }
+    free(t->items);
+    t->items = nt;
+    t->cap = ncap;
+    return 1;
+}
+
+// Caller holds g_lock. NULL if absent and 'add' is 0, or if the table is full.
+static RttEntry* table_find(RttTable* t, uint32_t key, int add) {
+    if (t->cap) {
+        size_t k = rtt_index(key, t->cap);
+        for (; t->items[k].samples; k = (k + 1) & (t->cap - 1)) {
+            if (t->items[k].key == key) return &t->items[k];
+        }
+    }
+    if (!add) return NULL;
+    if ((t->count + 1) * 10 > t->cap * 7 && (t->cap >= TIMING_MAX_ENTRIES || !table_grow(t))) return NULL;
+    size_t k = rtt_index(key, t->cap);
+    while (t->items[k].samples) k = (k + 1) & (t->cap - 1);
+    t->items[k].key = key;
+    t->count++;
+    return &t->items[k]; // samples is still 0: the caller's update fills it in
+}
+
+static void rtt_update(RttEntry* e, uint32_t r) {
+    if (!e) return;
+    if (e->samples == 0) {
+        e->srtt_us = r;
+        e->rttvar_us = r / 2;
+    } else {
+        uint32_t diff = e->srtt_us > r ? e->srtt_us - r : r - e->srtt_us;
+        e->rttvar_us = e->rttvar_us - e->rttvar_us / 4 + diff / 4;
+        e->srtt_us = e->srtt_us - e->srtt_us / 8 + r / 8;
+    }
+    if (e->samples < UINT32_MAX) e->samples++;
+}
+
+void timing_observe(unsigned long ip, uint32_t rtt_us) {
+    mutex_lock(&g_lock);
+    rtt_update(table_find(&g_hosts, (uint32_t)ip, 1), rtt_us);
+    rtt_update(table_find(&g_subnets, (uint32_t)ip >> 8, 1), rtt_us);
+    rtt_update(&g_all, rtt_us);
+    mutex_unlock(&g_lock);
+}
+
+int timing_timeout_ms(unsigned long ip, int fallback_ms, int min_ms, int max_ms) {
+    RttEntry e = { 0, 0, 0, 0 };
+    mutex_lock(&g_lock);
+    const RttEntry* p = table_find(&g_hosts, (uint32_t)ip, 0);
+    if (!p) p = table_find(&g_subnets, (uint32_t)ip >> 8, 0);
+    if (!p && g_all.samples) p = &g_all;
+    if (p) e = *p;
+    mutex_unlock(&g_lock);
+    if (!e.samples) return fallback_ms;
+    unsigned long long us = (unsigned long long)e.srtt_us + 4ull * e.rttvar_us;
+    unsigned long long ms = (us + 999) / 1000;
+    if (ms < (unsigned long long)min_ms) return min_ms;
+    if (ms > (unsigned long long)max_ms) return max_ms;
+    return (int)ms;
+}
+
+int timing_responsive(unsigned long ip) {
+    mutex_lock(&g_lock);
+    int found = table_find(&g_hosts, (uint32_t)ip, 0) != NULL;
+    mutex_unlock(&g_lock);
+    return found;
+}
+
+void timing_clear(void) {
+    mutex_lock(&g_lock);
+    free(g_hosts.items);
+    free(g_subnets.items);
+    g_hosts.items = g_subnets.items = NULL;
+    g_hosts.cap = g_hosts.count = g_subnets.cap = g_subnets.count = 0;
+    g_all.samples = 0;
+    mutex_unlock(&g_lock);
+}
+
+// ---- Congestion window ----------------------------------------------------
+
+// Slow start until the first loss (one slot per reply), then additive
+// increase (one slot per window's worth of replies). Sizes are in 1/256
+// probe units so the increase needs no floating point.
+struct TimingWindow {
+    Mutex lock;
+    CondVar cv;
+    unsigned cwnd;     // 1/256 probes
+    unsigned ssthresh; // 1/256 probes
+    unsigned min, max; // 1/256 probes
+    int inflight;
+    uint32_t next_seq;
+    uint32_t recover_seq; // losses of probes sent before this do not cut again
+    int closed;
+};
+
+#define WIN_ONE 256u
+
+TimingWindow* timing_window_create(int initial, int min, int max) {
+    if (min < 1) min = 1;
+    if (max < min) max = min;
+    if (initial < min) initial = min;
+    if (initial > max) initial = max;
+    TimingWindow* w = (TimingWindow*)calloc(1, sizeof(TimingWindow));
+    if (!w) return NULL;
+    mutex_init(&w->lock);
+    cond_init(&w->cv);
+    w->cwnd = (unsigned)initial * WIN_ONE;
+    w->min = (unsigned)min * WIN_ONE;
+    w->max = (unsigned)max * WIN_ONE;
+    w->ssthresh = w->max;
+    return w;
+}
+
+void timing_window_destroy(TimingWindow* w) {
+    if (!w) return;
+    mutex_destroy(&w->lock);
+    cond_destroy(&w->cv);
+    free(w);
+}
+
+int timing_window_acquire(TimingWindow* w, int wait_ms, uint32_t* seq) {
+    if (!w) { if (seq) *seq = 0; return 1; }
+    int r = 0;
+    mutex_lock(&w->lock);
+    for (;;) {
+        if (w->closed) { r = -1; break; }
+        if ((unsigned)w->inflight < w->cwnd / WIN_ONE) {
+            w->inflight++;
+            if (seq) *seq = w->next_seq;
+            w->next_seq++;
+            r = 1;
+            break;
+        }
+        if (wait_ms <= 0 || !cond_timedwait(&w->cv, &w->lock, wait_ms)) break;
+    }
+    mutex_unlock(&w->lock);
+    return r;
+}
+
+void timing_window_release(TimingWindow* w, uint32_t seq, TimingOutcome outcome) {
+    if (!w) return;
+    mutex_lock(&w->lock);
+    w->inflight--;
+    if (outcome == TIMING_REPLY) {
+        unsigned step = w->cwnd < w->ssthresh ? WIN_ONE : (WIN_ONE * WIN_ONE) / w->cwnd;
+        w->cwnd = w->cwnd + (step ? step : 1);
+        if (w->cwnd > w->max) w->cwnd = w->max;
+    } else if (outcome == TIMING_LOSS && (int32_t)(seq - w->recover_seq) >= 0) {
+        w->ssthresh = w->cwnd / 2 > w->min ? w->cwnd / 2 : w->min;
+        w->cwnd = w->ssthresh;
+        w->recover_seq = w->next_seq;
+    }
+    cond_broadcast(&w->cv); // a grown window may admit more than one waiter
+    mutex_unlock(&w->lock);
+}
+
+void timing_window_close(TimingWindow* w) {
+    if (!w) return;
+    mutex_lock(&w->lock);
+    w->closed = 1;
+    cond_broadcast(&w->cv);
+    mutex_unlock(&w->lock);
+}
+
+int timing_window_size(const TimingWindow* w) {
+    if (!w) return 0;
+    TimingWindow* mw = (TimingWindow*)w;
+    mutex_lock(&mw->lock);
+    int n = (int)(mw->cwnd / WIN_ONE);
+    mutex_unlock(&mw->lock);
+    return n;
+}
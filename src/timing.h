@@ -0,0 +1,60 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+// Adaptive probe timing. Replies feed process-wide round-trip estimates per
+// host, per /24 and overall (smoothed RTT and variance, as in RFC 6298);
+// probe timeouts are derived from the most specific estimate available. A
+// congestion window bounds the probes in flight and reacts to loss the way
+// TCP does: it grows with each reply and halves when a host that is known
+// to answer stops answering.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Records one round trip to 'ip' (host order). Any thread.
+void timing_observe(unsigned long ip, uint32_t rtt_us);
+
+// Timeout for the next probe to 'ip': srtt + 4 * rttvar of the host, else
+// of its /24, else of everything seen, clamped to [min_ms, max_ms].
+// 'fallback_ms' (unclamped) when nothing has been measured yet.
+int timing_timeout_ms(unsigned long ip, int fallback_ms, int min_ms, int max_ms);
+
+// 1 once 'ip' has answered some probe, so silence from it means loss
+// rather than a filtered port or a dead address.
+int timing_responsive(unsigned long ip);
+
+// Forgets every estimate.
+void timing_clear(void);
+
+typedef struct TimingWindow TimingWindow;
+
+typedef enum {
+    TIMING_REPLY,   // answered: grows the window
+    TIMING_LOSS,    // a responsive host timed out: halves it
+    TIMING_NEUTRAL  // timed out, but may be filtered or dead: no change
+} TimingOutcome;
+
+// Window in probes, between 'min' and 'max', starting at 'initial'.
+TimingWindow* timing_window_create(int initial, int min, int max);
+void timing_window_destroy(TimingWindow* w);
+
+// Takes a slot, waiting up to 'wait_ms' for one (0 = do not wait). Returns
+// 1 with '*seq' set for the release, 0 if the window stayed full, -1 once
+// the window is closed. A NULL window always succeeds.
+int timing_window_acquire(TimingWindow* w, int wait_ms, uint32_t* seq);
+// Returns the slot. Only the first loss among probes sent before the last
+// cut shrinks the window again, so one burst of drops halves it once.
+void timing_window_release(TimingWindow* w, uint32_t seq, TimingOutcome outcome);
+// Wakes waiters; later acquires return -1.
+void timing_window_close(TimingWindow* w);
+int timing_window_size(const TimingWindow* w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMING_H
@@ -0,0 +1,473 @@
+#include "udp_engine.h"
+#include <string.h>
+
+// ---- Payloads -------------------------------------------------------------
+
+// DNS: standard query for the root's NS records.
+static const unsigned char k_dns[] = {
+    0x12, 0x34, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x02, 0x00, 0x01,
+};
+// NTP: version 4 client request.
+static const unsigned char k_ntp[48] = { 0xE3, 0x00, 0x04, 0xFA, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01 };
+// NetBIOS name service: node status request for "*".
+static const unsigned char k_nbstat[] = {
+    0x80, 0xF0, 0x00, 0x10, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20,
+    'C', 'K', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A',
+    'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A', 'A',
+    0x00, 0x00, 0x21, 0x00, 0x01,
+};
+// SNMPv1 GetRequest for sysDescr.0 with community "public".
+static const unsigned char k_snmp[] = {
+    0x30, 0x29, 0x02, 0x01, 0x00, 0x04, 0x06, 'p', 'u', 'b', 'l', 'i', 'c',
+    0xA0, 0x1C, 0x02, 0x04, 0x43, 0x41, 0x54, 0x4E, 0x02, 0x01, 0x00, 0x02, 0x01, 0x00,
+    0x30, 0x0E, 0x30, 0x0C, 0x06, 0x08, 0x2B, 0x06, 0x01, 0x02, 0x01, 0x01, 0x01, 0x00, 0x05, 0x00,
+};
+// SSDP: unicast M-SEARCH for every device and service.
+static const unsigned char k_ssdp[] =
+    "M-SEARCH * HTTP/1.1\r\nHOST: 239.255.255.250:1900\r\nMAN: \"ssdp:discover\"\r\nMX: 1\r\nST: ssdp:all\r\n\r\n";
+// mDNS: service enumeration (_services._dns-sd._udp.local PTR), unicast
+// response requested.
+static const unsigned char k_mdns[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x09, '_', 's', 'e', 'r', 'v', 'i', 'c', 'e', 's',
+    0x07, '_', 'd', 'n', 's', '-', 's', 'd',
+    0x04, '_', 'u', 'd', 'p',
+    0x05, 'l', 'o', 'c', 'a', 'l', 0x00,
+    0x00, 0x0C, 0x80, 0x01,
+};
+// SQL Server browser: enumerate instances.
+static const unsigned char k_mssql[] = { 0x02 };
+// TFTP: read request for a file that should not exist.
+static const unsigned char k_tftp[] = { 0x00, 0x01, 'c', 'a', 't', 'n', 'e', 't', 0x00, 'o', 'c', 't', 'e', 't', 0x00 };
+
+typedef struct {
+    int port;
+    const unsigned char* data;
+    size_t len;
+} UdpPayload;
+
+static const UdpPayload k_payloads[] = {
+    { 53, k_dns, sizeof(k_dns) },
+    { 69, k_tftp, sizeof(k_tftp) },
+    { 123, k_ntp, sizeof(k_ntp) },
+    { 137, k_nbstat, sizeof(k_nbstat) },
+    { 161, k_snmp, sizeof(k_snmp) },
+    { 1434, k_mssql, sizeof(k_mssql) },
+    { 1900, k_ssdp, sizeof(k_ssdp) - 1 },
+    { 5353, k_mdns, sizeof(k_mdns) },
+};
+
+const unsigned char* udp_payload(int port, size_t* len) {
+    for (size_t i = 0; i < sizeof(k_payloads) / sizeof(k_payloads[0]); ++i) {
+        if (k_payloads[i].port == port) { *len = k_payloads[i].len; return k_payloads[i].data; }
+    }
+    *len = 0;
+    return (const unsigned char*)"";
+}
+
+const char* udp_state_name(int state) {
+    switch (state) {
+    case UDP_OPEN: return "open";
+    case UDP_CLOSED: return "closed";
+    case UDP_FILTERED: return "filtered";
+    case UDP_OPEN_FILTERED: return "open|filtered";
+    default: return "unknown";
+    }
+}
+
+#if defined(__linux__)
+
+#include "metrics.h"
+#include "thread.h"
+#include "timing.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <arpa/inet.h>
+#include <linux/errqueue.h>
+
+#define UDP_SOCKETS 4 // spreads answers over several receive queues
+#define UDP_BATCH 64  // datagrams per sendmmsg / recvmmsg
+
+enum { SLOT_FREE, SLOT_QUEUED, SLOT_SENT, SLOT_DONE };
+
+typedef struct {
+    int state;        // SLOT_*
+    unsigned int gen; // bumped on each send so stale timers are ignored
+    unsigned long ip;
+    int port;
+    int tries;        // datagrams sent for this probe
+    int result;       // UdpPortState, once SLOT_DONE
+    TimerId timer;
+    uint64_t sent_ns; // latest send, for the RTT histogram
+    UdpResultFn fn;
+    void* user;
+    int next;         // free list / done list
+    int hnext;        // (ip, port) hash chain while queued or sent
+    int qprev, qnext; // send queue while queued
+} UdpSlot;
+
+struct UdpEngine {
+    int epfd;
+    int socks[UDP_SOCKETS];
+    int next_sock;
+    int window;
+    int inflight;
+    UdpSlot* slots;
+    int free_head;
+    int done_head;      // answered or given up, callbacks not yet run
+    int* buckets;       // (ip, port) -> first slot of the chain
+    unsigned int bucket_mask;
+    int sq_head, sq_tail; // datagrams waiting to be sent, oldest first
+    int sq_count;
+    int blocked;        // the send queue waits for pacer tokens or buffer room
+    int credit;         // pacer tokens taken for datagrams that could not go yet
+    TimerWheel* wheel;  // answer deadlines
+    RetryPolicy retry;
+    Pacer* pacer;
+};
+
+static unsigned int bucket_of(const UdpEngine* ue, unsigned long ip, int port) {
+    uint32_t h = (uint32_t)ip * 0x9E3779B1u ^ (uint32_t)port * 0x85EBCA6Bu;
+    h ^= h >> 15;
+    return h & ue->bucket_mask;
+}
+
+static void hash_insert(UdpEngine* ue, int i) {
+    unsigned int b = bucket_of(ue, ue->slots[i].ip, ue->slots[i].port);
+    ue->slots[i].hnext = ue->buckets[b];
+    ue->buckets[b] = i;
+}
+
+static void hash_remove(UdpEngine* ue, int i) {
+    int* p = &ue->buckets[bucket_of(ue, ue->slots[i].ip, ue->slots[i].port)];
+    while (*p >= 0 && *p != i) p = &ue->slots[*p].hnext;
+    if (*p == i) *p = ue->slots[i].hnext;
+}
+
+// Oldest probe to (ip, port) that is still waiting, -1 if none.
+static int hash_find(const UdpEngine* ue, unsigned long ip, int port) {
+    int found = -1;
+    for (int i = ue->buckets[bucket_of(ue, ip, port)]; i >= 0; i = ue->slots[i].hnext) {
+        if (ue->slots[i].ip == ip && ue->slots[i].port == port && ue->slots[i].tries > 0) found = i;
+    }
+    return found;
+}
+
+static void queue_push(UdpEngine* ue, int i) {
+    UdpSlot* s = &ue->slots[i];
+    s->state = SLOT_QUEUED;
+    s->qnext = -1;
+    s->qprev = ue->sq_tail;
+    if (ue->sq_tail >= 0) ue->slots[ue->sq_tail].qnext = i; else ue->sq_head = i;
+    ue->sq_tail = i;
+    ue->sq_count++;
+}
+
+static void queue_remove(UdpEngine* ue, int i) {
+    UdpSlot* s = &ue->slots[i];
+    if (s->qprev >= 0) ue->slots[s->qprev].qnext = s->qnext; else ue->sq_head = s->qnext;
+    if (s->qnext >= 0) ue->slots[s->qnext].qprev = s->qprev; else ue->sq_tail = s->qprev;
+    ue->sq_count--;
+}
+
+// Settles slot 'i'; its callback runs from dispatch(), outside the I/O
+// loops, since callbacks may submit and poll again.
+static void complete(UdpEngine* ue, int i, int result) {
+    UdpSlot* s = &ue->slots[i];
+    if (s->state == SLOT_QUEUED) queue_remove(ue, i);
+    hash_remove(ue, i);
+    timer_wheel_cancel(ue->wheel, s->timer);
+    s->timer = 0;
+    s->state = SLOT_DONE;
+    s->result = result;
+    s->next = ue->done_head;
+    ue->done_head = i;
+}
+
+static int dispatch(UdpEngine* ue) {
+    int done = 0;
+    while (ue->done_head >= 0) {
+        int i = ue->done_head;
+        UdpSlot* s = &ue->slots[i];
+        ue->done_head = s->next;
+        UdpResultFn fn = s->fn; void* user = s->user;
+        unsigned long ip = s->ip; int port = s->port, result = s->result;
+        s->state = SLOT_FREE;
+        s->next = ue->free_head;
+        ue->free_head = i;
+        ue->inflight--;
+        done++;
+        if (fn) fn(user, ip, port, result);
+    }
+    return done;
+}
+
+// Wheel callback: send again or give up.
+static void on_deadline(void* user, uint64_t data) {
+    UdpEngine* ue = (UdpEngine*)user;
+    int i = (int)(data & 0xFFFFFFFFu);
+    UdpSlot* s = &ue->slots[i];
+    if (s->state != SLOT_SENT || s->gen != (unsigned int)(data >> 32)) return;
+    s->timer = 0;
+    if (s->tries < ue->retry.tries) { queue_push(ue, i); return; }
+    metrics_inc(METRIC_UDP_TIMEOUTS);
+    complete(ue, i, UDP_OPEN_FILTERED);
+}
+
+static void mark_sent(UdpEngine* ue, int i) {
+    UdpSlot* s = &ue->slots[i];
+    queue_remove(ue, i);
+    metrics_inc(METRIC_UDP_PROBES);
+    if (s->tries > 0) metrics_inc(METRIC_UDP_RETRIES);
+    s->state = SLOT_SENT;
+    s->gen++;
+    s->tries++;
+    s->sent_ns = clock_monotonic_ns();
+    uint64_t key = ((uint64_t)s->gen << 32) | (unsigned int)i;
+    s->timer = timer_wheel_add(ue->wheel, clock_monotonic_ms(), retry_policy_timeout_ms(&ue->retry, s->tries - 1), key);
+    if (!s->timer) complete(ue, i, UDP_OPEN_FILTERED);
+}
+
+// Sends queued datagrams in batches, as the pacer and socket buffers allow.
+static void flush_sends(UdpEngine* ue) {
+    ue->blocked = 0;
+    while (ue->sq_count > 0) {
+        struct mmsghdr msgs[UDP_BATCH];
+        struct iovec iov[UDP_BATCH];
+        struct sockaddr_in to[UDP_BATCH];
+        int idx[UDP_BATCH];
+        int n = 0;
+        for (int i = ue->sq_head; i >= 0 && n < UDP_BATCH; i = ue->slots[i].qnext) {
+            if (ue->credit > 0) ue->credit--;
+            else if (!pacer_try_acquire(ue->pacer, 1)) { ue->blocked = 1; break; }
+            UdpSlot* s = &ue->slots[i];
+            size_t len;
+            const unsigned char* data = udp_payload(s->port, &len);
+            memset(&to[n], 0, sizeof(to[n]));
+            to[n].sin_family = AF_INET;
+            to[n].sin_port = htons((unsigned short)s->port);
+            to[n].sin_addr.s_addr = htonl((uint32_t)s->ip);
+            iov[n].iov_base = (void*)data;
+            iov[n].iov_len = len;
+            memset(&msgs[n], 0, sizeof(msgs[n]));
+            msgs[n].msg_hdr.msg_name = &to[n];
+            msgs[n].msg_hdr.msg_namelen = sizeof(to[n]);
+            msgs[n].msg_hdr.msg_iov = &iov[n];
+            msgs[n].msg_hdr.msg_iovlen = 1;
+            idx[n++] = i;
+        }
+        if (n == 0) break;
+        int fd = ue->socks[ue->next_sock];
+        ue->next_sock = (ue->next_sock + 1) % UDP_SOCKETS;
+        int sent = sendmmsg(fd, msgs, (unsigned int)n, 0);
+        // Each ICMP error that arrives fails the next send once (the
+        // socket's pending error; the error queue still has the details),
+        // so send again before blaming the first datagram.
+        for (int k = 0; k < 3 && sent < 0 && errno != EAGAIN && errno != ENOBUFS; ++k) sent = sendmmsg(fd, msgs, (unsigned int)n, 0);
+        if (sent < 0 && errno != EAGAIN && errno != ENOBUFS) sent = 1; // a local error: treated as lost, the timeout retries it
+        if (sent < 0) sent = 0;
+        for (int k = 0; k < sent; ++k) mark_sent(ue, idx[k]);
+        ue->credit += n - sent; // the rest keep their tokens
+        if (sent == 0) { ue->blocked = 1; break; } // out of buffer room
+    }
+}
+
+static void on_answer(UdpEngine* ue, unsigned long ip, int port, int result) {
+    int i = hash_find(ue, ip, port);
+    if (i < 0) return; // late, duplicate or unsolicited
+    UdpSlot* s = &ue->slots[i];
+    uint64_t rtt_us = (clock_monotonic_ns() - s->sent_ns) / 1000;
+    metrics_record_us(METRIC_LAT_UDP, rtt_us);
+    metrics_inc(result == UDP_OPEN ? METRIC_UDP_OPEN : METRIC_UDP_CLOSED);
+    timing_observe(ip, (uint32_t)rtt_us);
+    complete(ue, i, result);
+}
+
+static void read_datagrams(UdpEngine* ue, int fd) {
+    struct mmsghdr msgs[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+    struct sockaddr_in from[UDP_BATCH];
+    unsigned char buf[UDP_BATCH][64]; // only the source matters; the rest is truncated
+    for (int round = 0; round < 64; ++round) {
+        for (int k = 0; k < UDP_BATCH; ++k) {
+            iov[k].iov_base = buf[k];
+            iov[k].iov_len = sizeof(buf[k]);
+            memset(&msgs[k], 0, sizeof(msgs[k]));
+            msgs[k].msg_hdr.msg_name = &from[k];
+            msgs[k].msg_hdr.msg_namelen = sizeof(from[k]);
+            msgs[k].msg_hdr.msg_iov = &iov[k];
+            msgs[k].msg_hdr.msg_iovlen = 1;
+        }
+        int n = recvmmsg(fd, msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            continue; // a pending ICMP error reported once; its queue entry is read below
+        }
+        for (int k = 0; k < n; ++k) {
+            if (msgs[k].msg_hdr.msg_namelen < sizeof(struct sockaddr_in) || from[k].sin_family != AF_INET) continue;
+            on_answer(ue, (unsigned long)ntohl(from[k].sin_addr.s_addr), ntohs(from[k].sin_port), UDP_OPEN);
+        }
+        if (n < UDP_BATCH) return;
+    }
+}
+
+// ICMP errors for datagrams this socket sent (IP_RECVERR): msg_name is the
+// original destination, the control message says what came back.
+static void read_errors(UdpEngine* ue, int fd) {
+    for (int round = 0; round < 4096; ++round) {
+        struct sockaddr_in dst;
+        unsigned char data[64];
+        char control[512];
+        struct iovec iov;
+        iov.iov_base = data;
+        iov.iov_len = sizeof(data);
+        struct msghdr mh;
+        memset(&mh, 0, sizeof(mh));
+        mh.msg_name = &dst;
+        mh.msg_namelen = sizeof(dst);
+        mh.msg_iov = &iov;
+        mh.msg_iovlen = 1;
+        mh.msg_control = control;
+        mh.msg_controllen = sizeof(control);
+        if (recvmsg(fd, &mh, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) return;
+        if (mh.msg_namelen < sizeof(dst) || dst.sin_family != AF_INET) continue;
+        for (struct cmsghdr* c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c)) {
+            if (c->cmsg_level != IPPROTO_IP || c->cmsg_type != IP_RECVERR) continue;
+            const struct sock_extended_err* ee = (const struct sock_extended_err*)CMSG_DATA(c);
+            if (ee->ee_origin != SO_EE_ORIGIN_ICMP || ee->ee_type != ICMP_DEST_UNREACH) break;
+            int result;
+            switch (ee->ee_code) {
+            case ICMP_PORT_UNREACH: result = UDP_CLOSED; break;
+            case ICMP_NET_UNREACH: case ICMP_HOST_UNREACH: case ICMP_PROT_UNREACH:
+            case ICMP_NET_ANO: case ICMP_HOST_ANO: case ICMP_PKT_FILTERED: result = UDP_FILTERED; break;
+            default: result = -1; break;
+            }
+            if (result >= 0) on_answer(ue, (unsigned long)ntohl(dst.sin_addr.s_addr), ntohs(dst.sin_port), result);
+            break;
+        }
+    }
+}
+
+UdpEngine* udp_engine_create(int window, int timeout_ms) {
+    if (window < 1) window = 1;
+    UdpEngine* ue = (UdpEngine*)calloc(1, sizeof(UdpEngine));
+    if (!ue) return NULL;
+    for (int k = 0; k < UDP_SOCKETS; ++k) ue->socks[k] = -1;
+    unsigned int nb = 16;
+    while (nb < (unsigned int)window * 2 && nb < (1u << 30)) nb <<= 1;
+    ue->epfd = epoll_create1(EPOLL_CLOEXEC);
+    ue->slots = (UdpSlot*)calloc((size_t)window, sizeof(UdpSlot));
+    ue->buckets = (int*)malloc(sizeof(int) * nb);
+    ue->wheel = timer_wheel_create(1, clock_monotonic_ms(), on_deadline, ue);
+    int ok = ue->epfd >= 0 && ue->slots && ue->buckets && ue->wheel && timer_wheel_reserve(ue->wheel, (size_t)window);
+    for (int k = 0; k < UDP_SOCKETS && ok; ++k) {
+        int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+        ue->socks[k] = fd;
+        int on = 1, rcvbuf = 1024 * 1024;
+        ok = fd >= 0 && setsockopt(fd, IPPROTO_IP, IP_RECVERR, &on, sizeof(on)) == 0;
+        if (!ok) break;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN; // EPOLLERR (error queue) is always reported
+        ev.data.u32 = (uint32_t)k;
+        ok = epoll_ctl(ue->epfd, EPOLL_CTL_ADD, fd, &ev) == 0;
+    }
+    if (!ok) {
+        ue->window = 0;
+        udp_engine_destroy(ue);
+        return NULL;
+    }
+    ue->window = window;
+    ue->bucket_mask = nb - 1;
+    for (unsigned int b = 0; b < nb; ++b) ue->buckets[b] = -1;
+    retry_policy_init(&ue->retry, UDP_DEFAULT_TRIES, timeout_ms, 100, 0);
+    ue->done_head = ue->sq_head = ue->sq_tail = -1;
+    for (int i = 0; i < window; ++i) ue->slots[i].next = (i + 1 < window) ? i + 1 : -1;
+    ue->free_head = 0;
+    return ue;
+}
+
+void udp_engine_destroy(UdpEngine* ue) {
+    if (!ue) return;
+    for (int k = 0; k < UDP_SOCKETS; ++k) { if (ue->socks[k] >= 0) close(ue->socks[k]); }
+    if (ue->epfd >= 0) close(ue->epfd);
+    timer_wheel_destroy(ue->wheel);
+    free(ue->slots);
+    free(ue->buckets);
+    free(ue);
+}
+
+void udp_engine_set_pacer(UdpEngine* ue, Pacer* pacer) { if (ue) ue->pacer = pacer; }
+
+void udp_engine_set_retry(UdpEngine* ue, const RetryPolicy* policy) {
+    if (ue && policy) retry_policy_init(&ue->retry, policy->tries, policy->timeout_ms, policy->backoff_pct, policy->max_timeout_ms);
+}
+
+int udp_engine_submit(UdpEngine* ue, unsigned long ip, int port, UdpResultFn fn, void* user) {
+    if (!ue || port < 1 || port > 65535) return 0;
+    while (ue->free_head < 0) udp_engine_poll(ue, ue->retry.timeout_ms);
+    int i = ue->free_head;
+    UdpSlot* s = &ue->slots[i];
+    ue->free_head = s->next;
+    s->ip = ip;
+    s->port = port;
+    s->fn = fn;
+    s->user = user;
+    s->tries = 0;
+    s->timer = 0;
+    ue->inflight++;
+    hash_insert(ue, i);
+    queue_push(ue, i);
+    if (ue->sq_count >= UDP_BATCH && !ue->blocked) flush_sends(ue);
+    return 1;
+}
+
+int udp_engine_poll(UdpEngine* ue, int wait_ms) {
+    if (!ue || ue->inflight == 0) return 0;
+    flush_sends(ue);
+    wait_ms = timer_wheel_next_ms(ue->wheel, clock_monotonic_ms(), wait_ms < 0 ? 0x7FFFFFFF : wait_ms);
+    if (ue->blocked && wait_ms > 1) wait_ms = 1;
+    if (ue->done_head >= 0) wait_ms = 0; // settled by a send
+
+    struct epoll_event events[UDP_SOCKETS];
+    int n = epoll_wait(ue->epfd, events, UDP_SOCKETS, wait_ms);
+    for (int k = 0; k < n; ++k) {
+        int fd = ue->socks[events[k].data.u32];
+        if (events[k].events & EPOLLERR) read_errors(ue, fd);
+        if (events[k].events & EPOLLIN) read_datagrams(ue, fd);
+    }
+    timer_wheel_advance(ue->wheel, clock_monotonic_ms());
+    flush_sends(ue); // retries that just came due
+    return dispatch(ue);
+}
+
+void udp_engine_drain(UdpEngine* ue) {
+    while (ue && ue->inflight > 0) udp_engine_poll(ue, -1);
+}
+
+int udp_engine_inflight(const UdpEngine* ue) { return ue ? ue->inflight : 0; }
+
+#else // !__linux__
+
+// No asynchronous backend yet: ICMP errors on unconnected sockets need
+// IP_RECVERR.
+UdpEngine* udp_engine_create(int window, int timeout_ms) { (void)window; (void)timeout_ms; return 0; }
+void udp_engine_destroy(UdpEngine* ue) { (void)ue; }
+int udp_engine_submit(UdpEngine* ue, unsigned long ip, int port, UdpResultFn fn, void* user) {
+    (void)ue; (void)ip; (void)port; (void)fn; (void)user; return 0;
+}
+int udp_engine_poll(UdpEngine* ue, int wait_ms) { (void)ue; (void)wait_ms; return 0; }
+void udp_engine_drain(UdpEngine* ue) { (void)ue; }
+void udp_engine_set_pacer(UdpEngine* ue, Pacer* pacer) { (void)ue; (void)pacer; }
+void udp_engine_set_retry(UdpEngine* ue, const RetryPolicy* policy) { (void)ue; (void)policy; }
+int udp_engine_inflight(const UdpEngine* ue) { (void)ue; return 0; }
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef UDP_ENGINE_H
+#define UDP_ENGINE_H
+
+// Asynchronous UDP probe engine: a few unconnected sockets send batches of
+// protocol-specific payloads and match answers and ICMP errors back to the
+// (ip, port) they were sent to, so a probe holds a table slot rather than a
+// socket. Runs on the caller's thread like conn_engine.
+// Keep this header free of platform SDK includes (see utils.h).
+
+#include <stddef.h>
+#include "pacer.h"
+#include "timer_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct UdpEngine UdpEngine;
+
+typedef enum {
+    UDP_OPEN = 0,        // a datagram came back from the port
+    UDP_CLOSED = 1,      // ICMP port unreachable
+    UDP_FILTERED = 2,    // another ICMP unreachable (host, protocol, prohibited)
+    UDP_OPEN_FILTERED = 3 // no answer after every try
+} UdpPortState;
+
+#define UDP_DEFAULT_TRIES 2
+
+// 'ip' is a host-order IPv4 address; 'state' a UdpPortState.
+typedef void (*UdpResultFn)(void* user, unsigned long ip, int port, int state);
+
+// Keeps up to 'window' probes in flight, each sent up to UDP_DEFAULT_TRIES
+// times 'timeout_ms' apart. Returns NULL when no asynchronous backend
+// exists on this platform (Linux only for now: it reads ICMP errors through
+// IP_RECVERR).
+UdpEngine* udp_engine_create(int window, int timeout_ms);
+void udp_engine_destroy(UdpEngine* ue);
+
+// Queues one probe; datagrams leave in batches from the event loop. If the
+// window is full, drives the event loop until a slot frees up. Callbacks
+// may submit further probes. Returns 1 on success, 0 on failure.
+int udp_engine_submit(UdpEngine* ue, unsigned long ip, int port, UdpResultFn fn, void* user);
+
+// Sends what is queued, waits up to 'wait_ms' for answers and dispatches
+// them. Returns the number of probes completed.
+int udp_engine_poll(UdpEngine* ue, int wait_ms);
+
+// Runs the event loop until no probe is in flight.
+void udp_engine_drain(UdpEngine* ue);
+
+// Every datagram, retries included, takes one token of 'pacer' (NULL =
+// unpaced); sends wait in the queue while it is empty. The loop checks it
+// about once a millisecond, so its burst should cover a few milliseconds.
+void udp_engine_set_pacer(UdpEngine* ue, Pacer* pacer);
+void udp_engine_set_retry(UdpEngine* ue, const RetryPolicy* policy);
+
+int udp_engine_inflight(const UdpEngine* ue);
+
+// Built-in probe payload for 'port' (DNS, NTP, NetBIOS, SNMP, SSDP, mDNS,
+// ...); ports without one get an empty datagram ('*len' = 0).
+const unsigned char* udp_payload(int port, size_t* len);
+
+const char* udp_state_name(int state); // "open", "closed", "filtered", "open|filtered"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UDP_ENGINE_H
@@ -4,13 +4,18 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#ifdef _WIN32
 #ifndef _WIN32_WINNT
 #define _WIN32_WINNT 0x0600
 #endif
 #include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#endif
 
 int ip_to_uint(const char* ip, unsigned long* out) {
-    unsigned long a = inet_addr(ip);
+    unsigned long a = (unsigned long)inet_addr(ip);
     if (a == INADDR_NONE && strcmp(ip, "255.255.255.255") != 0) {
         return 0;
     }
@@ -18,12 +23,44 @@ int ip_to_uint(const char* ip, unsigned long* out) {
     return 1;
 }
 
+// Formats by hand: inet_ntoa uses a static buffer, and scan workers call this
+// concurrently.
 void uint_to_ip(unsigned long ip, char* buf, size_t buflen) {
-    struct in_addr addr;
-    addr.S_un.S_addr = htonl(ip);
-    const char* s = inet_ntoa(addr);
-    if (s) safe_strcpy(buf, buflen, s);
-    else if (buflen > 0) buf[0] = '\0';
+    if (!buf || buflen == 0) return;
+    snprintf(buf, buflen, "%lu.%lu.%lu.%lu", (ip >> 24) & 0xFF, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF);
+}
+
+int parse_ip_range(const char* spec, unsigned long* start, unsigned long* end) {
+    char left[64];
+    if (!spec || !start || !end) return 0;
+    const char* sep = strpbrk(spec, "/-");
+    size_t len = sep ? (size_t)(sep - spec) : strlen(spec);
+    if (len == 0 || len >= sizeof(left)) return 0;
+    memcpy(left, spec, len); left[len] = '\0';
+    unsigned long s = 0, e = 0;
+    if (!ip_to_uint(left, &s)) return 0;
+    if (!sep) {
+        e = s;
+    } else if (*sep == '/') {
+        char* stop = NULL;
+        long prefix = strtol(sep + 1, &stop, 10);
+        if (stop == sep + 1 || *stop || prefix < 0 || prefix > 32) return 0;
+        unsigned long mask = prefix ? (0xFFFFFFFFul << (32 - prefix)) & 0xFFFFFFFFul : 0;
+        s &= mask;
+        e = s | (~mask & 0xFFFFFFFFul);
+    } else if (strchr(sep + 1, '.')) {
+        if (!ip_to_uint(sep + 1, &e)) return 0;
+    } else {
+        // "A.B.C.D-E": only the last octet given
+        char* stop = NULL;
+        long last = strtol(sep + 1, &stop, 10);
+        if (stop == sep + 1 || *stop || last < 0 || last > 255) return 0;
+        e = (s & 0xFFFFFF00ul) | (unsigned long)last;
+    }
+    if (e < s) return 0;
+    *start = s;
+    *end = e;
+    return 1;
 }
 
 void trim_newline(char* s) {
@@ -4,11 +4,16 @@
 // Keep this header free of Windows SDK includes to avoid symbol conflicts
 // (e.g., CloseWindow from windows.h vs raylib CloseWindow).
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 int ip_to_uint(const char* ip, unsigned long* out);
 void uint_to_ip(unsigned long ip, char* buf, size_t buflen);
+// Parses "A.B.C.D", "A.B.C.D-E", "A.B.C.D-E.F.G.H" or "A.B.C.D/nn" into an
+// inclusive host-order range. Returns 1 on success, 0 on failure.
+int parse_ip_range(const char* spec, unsigned long* start, unsigned long* end);
 void trim_newline(char* s);
 void safe_strcpy(char* dst, size_t dstsz, const char* src);
 #ifdef __cplusplus
@@ -0,0 +1,17 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+// Checks for the tests/test_*.c programs (built by build.sh): a failed
+// CHECK reports its line and the test goes on; main returns CHECK_RESULT().
+
+#include <stdio.h>
+
+static int g_check_failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); g_check_failures++; } \
+} while (0)
+
+#define CHECK_RESULT() (g_check_failures ? (fprintf(stderr, "%d check(s) failed\n", g_check_failures), 1) : 0)
+
+#endif // TESTS_CHECK_H
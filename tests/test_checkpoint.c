@@ -0,0 +1,65 @@
+// Checkpoints: save and load give back the range, config and bitmaps, and
+// damaged files are refused.
+#include "check.h"
+#include "checkpoint.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int main(void) {
+    char path[256];
+    const char* dir = getenv("TMPDIR");
+    snprintf(path, sizeof(path), "%s/catnet_test_checkpoint_%d", dir && dir[0] ? dir : "/tmp", (int)getpid());
+
+    CHECK(checkpoint_words(10, 10) == 1);
+    CHECK(checkpoint_words(0, 63) == 1 && checkpoint_words(0, 64) == 2);
+    CHECK(checkpoint_words(0, (unsigned long)CHECKPOINT_MAX_ADDRESSES) == 0); // one address too many
+
+    ScanConfig cfg;
+    scan_config_init(&cfg);
+    snprintf(cfg.ports, sizeof(cfg.ports), "top-50,8080");
+    cfg.shuffle_seed = 0x1234567890ull;
+    cfg.shard_index = 2;
+    cfg.shard_count = 5;
+
+    ScanCheckpoint cp;
+    unsigned long start = 0x0A000000ul, end = 0x0A0003E7ul; // 1000 addresses
+    CHECK(checkpoint_init(&cp, start, end, &cfg));
+    CHECK(cp.words == 16 && checkpoint_count(cp.done, cp.words) == 0);
+    for (unsigned long off = 0; off < 1000; off += 3) cp.done[off / 64] |= 1ull << (off % 64);
+    for (unsigned long off = 0; off < 1000; off += 7) cp.alive[off / 64] |= 1ull << (off % 64);
+    CHECK(checkpoint_count(cp.done, cp.words) == 334);
+    CHECK(checkpoint_save(path, &cp));
+
+    ScanCheckpoint back;
+    CHECK(checkpoint_load(path, &back));
+    CHECK(back.start_ip == start && back.end_ip == end && back.words == cp.words);
+    CHECK(!strcmp(back.cfg.ports, "top-50,8080") && back.cfg.shuffle_seed == 0x1234567890ull);
+    CHECK(back.cfg.shard_index == 2 && back.cfg.shard_count == 5);
+    if (back.words == cp.words) {
+        CHECK(!memcmp(back.done, cp.done, cp.words * sizeof(uint64_t)));
+        CHECK(!memcmp(back.alive, cp.alive, cp.words * sizeof(uint64_t)));
+    }
+    checkpoint_free(&back);
+
+    // A cut-off file is refused, not half loaded.
+    FILE* f = fopen(path, "r+b");
+    CHECK(f != NULL);
+    if (f) {
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fclose(f);
+        CHECK(truncate(path, size - 8) == 0);
+        CHECK(!checkpoint_load(path, &back));
+        CHECK(back.done == NULL && back.alive == NULL);
+    }
+    // So is another file type.
+    f = fopen(path, "wb");
+    if (f) { fputs("not a checkpoint at all, just some text", f); fclose(f); }
+    CHECK(!checkpoint_load(path, &back));
+    remove(path);
+    CHECK(!checkpoint_load(path, &back)); // missing
+
+    checkpoint_free(&cp);
+    return CHECK_RESULT();
+}
@@ -0,0 +1,60 @@
+// Port spec compilation: order, duplicates, ranges, top-N and bad specs.
+#include "check.h"
+#include "port_set.h"
+
+int main(void) {
+    PortSet ps;
+
+    CHECK(port_set_compile(&ps, "80, 22,8000-8002,22,80"));
+    CHECK(ps.count == 5);
+    if (ps.count == 5) {
+        CHECK(ps.order[0] == 80 && ps.order[1] == 22);
+        CHECK(ps.order[2] == 8000 && ps.order[3] == 8001 && ps.order[4] == 8002);
+    }
+    CHECK(port_set_has(&ps, 8001) && !port_set_has(&ps, 8003) && !port_set_has(&ps, 443));
+    CHECK(!port_set_has(&ps, -1) && !port_set_has(&ps, PORT_MAX + 1));
+    port_set_free(&ps);
+
+    CHECK(port_set_compile(&ps, "all"));
+    CHECK(ps.count == PORT_MAX && ps.order[0] == 1 && ps.order[PORT_MAX - 1] == PORT_MAX);
+    CHECK(!port_set_has(&ps, 0));
+    port_set_free(&ps);
+
+    // top-N: most common first, and a listed port keeps its first position.
+    CHECK(port_set_compile(&ps, "top-10,1"));
+    CHECK(ps.count == 11 || (ps.count == 10 && port_set_has(&ps, 1)));
+    for (int i = 0; i < 10 && i < ps.count; ++i) CHECK(ps.order[i] == port_top(i));
+    port_set_free(&ps);
+    CHECK(port_top(port_top_table_size()) == 0);
+
+    // top-1000: the whole table, each port once, in rank order.
+    CHECK(port_top_table_size() == 1000);
+    CHECK(port_set_compile(&ps, "top-1000") && ps.count == 1000);
+    int ranked = 1;
+    for (int i = 0; i < ps.count; ++i) {
+        if (ps.order[i] != port_top(i)) ranked = 0;
+    }
+    CHECK(ranked);
+    port_set_free(&ps);
+    CHECK(port_set_compile(&ps, "1-1024,3389,top-1000") && ps.order[1024] == 3389);
+    CHECK(port_set_has(&ps, 65389) && ps.order[0] == 1);
+    port_set_free(&ps);
+
+    int n = port_top_table_size();
+    char spec[32];
+    snprintf(spec, sizeof(spec), "top-%d", n);
+    CHECK(port_set_compile(&ps, spec) && ps.count == n);
+    port_set_free(&ps);
+    snprintf(spec, sizeof(spec), "top-%d", n + 1);
+    CHECK(!port_set_compile(&ps, spec)); // past the ranked table
+
+    CHECK(!port_set_compile(&ps, ""));
+    CHECK(!port_set_compile(&ps, "0"));
+    CHECK(!port_set_compile(&ps, "65536"));
+    CHECK(!port_set_compile(&ps, "90-80"));
+    CHECK(!port_set_compile(&ps, "22;80"));
+    CHECK(!port_set_compile(&ps, "top-0"));
+    CHECK(ps.count == 0 && ps.order == NULL);
+
+    return CHECK_RESULT();
+}
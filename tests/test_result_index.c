@@ -0,0 +1,67 @@
+// Result index: the B+tree view stays sorted, with ties in row order, as
+// rows arrive and the list grows.
+#include "check.h"
+#include "result_index.h"
+#include <stdlib.h>
+
+#define ROWS 20000 // enough for several tree levels at fanout 64
+
+// Checks that the view lists every row once, ascending by its key.
+static void check_sorted(const DeviceList* list, const ResultIndex* ix, ResultKey key, size_t rows) {
+    CHECK(result_index_count(ix) == rows);
+    unsigned char* seen = (unsigned char*)calloc(rows, 1);
+    int ordered = 1, once = 1;
+    for (size_t pos = 0; pos < result_index_count(ix); ++pos) {
+        uint32_t row = result_index_at(ix, pos);
+        if (row >= rows || seen[row]) { once = 0; continue; }
+        seen[row] = 1;
+        if (pos && result_index_compare(list, key, result_index_at(ix, pos - 1), row) >= 0) ordered = 0;
+    }
+    CHECK(ordered && once);
+    free(seen);
+}
+
+int main(void) {
+    DeviceList list;
+    device_list_init(&list);
+    ResultIndex* by_ip = result_index_create(&list, RESULT_KEY_IP);
+    ResultIndex* by_name = result_index_create(&list, RESULT_KEY_HOSTNAME);
+    ResultIndex* by_ports = result_index_create(&list, RESULT_KEY_PORTS);
+    CHECK(by_ip && by_name && by_ports);
+    if (!by_ip || !by_name || !by_ports) return CHECK_RESULT();
+
+    uint32_t seed = 1;
+    for (uint32_t row = 0; row < ROWS; ++row) {
+        seed = seed * 1103515245u + 12345u;
+        DeviceInfo di;
+        device_init(&di, 0x0A000000ul + (seed >> 16) % 5000); // repeats: ties by row
+        di.is_alive = 1;
+        char name[32];
+        snprintf(name, sizeof(name), "host-%u", (seed >> 8) % 997);
+        if (row % 3) device_set_hostname(&di, name);
+        int ports[3] = { 22, 80, 443 };
+        device_set_ports(&di, ports, (int)(row % 4));
+        device_list_push(&list, &di);
+        CHECK(result_index_insert(by_ip, row));
+        CHECK(result_index_insert(by_name, row));
+        CHECK(result_index_insert(by_ports, row));
+        if (row == 100) check_sorted(&list, by_ip, RESULT_KEY_IP, row + 1);
+    }
+    check_sorted(&list, by_ip, RESULT_KEY_IP, ROWS);
+    check_sorted(&list, by_name, RESULT_KEY_HOSTNAME, ROWS);
+    check_sorted(&list, by_ports, RESULT_KEY_PORTS, ROWS);
+
+    // Unnamed hosts ("") sort first; equal keys keep arrival order.
+    CHECK(device_hostname(&list.items[result_index_at(by_name, 0)])[0] == '\0');
+    CHECK(result_index_at(by_ports, 0) == 0 && result_index_at(by_ports, 1) == 4);
+
+    result_index_clear(by_ip);
+    CHECK(result_index_count(by_ip) == 0);
+    CHECK(result_index_insert(by_ip, 7) && result_index_count(by_ip) == 1 && result_index_at(by_ip, 0) == 7);
+
+    result_index_destroy(by_ip);
+    result_index_destroy(by_name);
+    result_index_destroy(by_ports);
+    device_list_clear(&list);
+    return CHECK_RESULT();
+}
@@ -0,0 +1,181 @@
+// Result store: records written from memory come back through the mapped
+// file with their names, services and long port lists, also from a store
+// whose writer never closed it; merging keeps one record per address.
+#include "check.h"
+#include "result_store.h"
+#include "service.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define HOSTS 500
+
+static char g_dir[200];
+
+static void tmp_path(char* buf, size_t len, const char* name) {
+    snprintf(buf, len, "%s/catnet_test_%d_%s", g_dir, (int)getpid(), name);
+}
+
+static void remove_store(const char* path) {
+    char journal[300];
+    snprintf(journal, sizeof(journal), "%s.strings", path);
+    remove(path);
+    remove(journal);
+}
+
+// Host 'i' of the test range: every third one named, every fifth one with
+// more ports than fit inline.
+static void make_host(DeviceInfo* di, int i) {
+    device_init(di, 0xC0A80000ul + (unsigned long)i);
+    di->is_alive = (i % 2) == 0;
+    if (i % 3 == 0) {
+        char name[64];
+        snprintf(name, sizeof(name), "host-%d.example", i);
+        device_set_hostname(di, name);
+    }
+    int ports[40];
+    int n = (i % 5 == 0) ? 40 : i % 4;
+    for (int k = 0; k < n; ++k) ports[k] = 1000 + i + k;
+    device_set_ports(di, ports, n);
+    if (i % 7 == 0 && n > 0) {
+        static const ServiceSignature ssh = { "SSH-", 0, 1, "ssh", "OpenSSH" };
+        const ServiceSignature* sigs[40] = { &ssh };
+        device_set_services(di, ports, sigs, n);
+    }
+}
+
+// Compares a mapped record with host 'i' as make_host builds it.
+static int host_matches(const DeviceInfo* di, int i) {
+    DeviceInfo want;
+    make_host(&want, i);
+    if (di->ip != want.ip || di->is_alive != want.is_alive) return 0;
+    if (strcmp(device_hostname(di), device_hostname(&want)) != 0) return 0;
+    if (strcmp(device_services(di), device_services(&want)) != 0) return 0;
+    if (di->open_ports_count != want.open_ports_count) return 0;
+    for (int k = 0; k < want.open_ports_count; ++k) {
+        if (device_port(di, k) != device_port(&want, k)) return 0;
+    }
+    return 1;
+}
+
+static int write_hosts(const char* path, int from, int to) {
+    ResultWriter* w = result_writer_create(path, 0xC0A80000ul, 0xC0A8FFFFul);
+    if (!w) return 0;
+    for (int i = from; i < to; ++i) {
+        DeviceInfo di;
+        make_host(&di, i);
+        result_writer_append(w, &di);
+    }
+    return result_writer_close(w);
+}
+
+// Checks that 'path' holds hosts [from, to) in order.
+static void check_store(const char* path, int from, int to, int complete) {
+    ResultStore* s = result_store_open(path);
+    CHECK(s != NULL);
+    if (!s) return;
+    const ResultStoreHeader* h = result_store_header(s);
+    CHECK(((h->flags & RESULT_STORE_COMPLETE) != 0) == complete);
+    CHECK(result_store_count(s) == (size_t)(to - from));
+    result_store_mount(s);
+    const DeviceInfo* recs = result_store_records(s);
+    int good = 1;
+    for (size_t k = 0; k < result_store_count(s); ++k) {
+        if (!host_matches(&recs[k], from + (int)k)) good = 0;
+    }
+    CHECK(good);
+    result_store_close(s);
+}
+
+int main(void) {
+    const char* dir = getenv("TMPDIR");
+    snprintf(g_dir, sizeof(g_dir), "%s", dir && dir[0] ? dir : "/tmp");
+    char path[256];
+    tmp_path(path, sizeof(path), "store.bin");
+
+    CHECK(write_hosts(path, 0, HOSTS));
+    check_store(path, 0, HOSTS, 1);
+    char journal[300];
+    snprintf(journal, sizeof(journal), "%s.strings", path);
+    CHECK(access(journal, F_OK) != 0); // removed by close
+
+    // A writer that dies after a sync leaves a store that opens with every
+    // synced record and its names (from the journal).
+    pid_t pid = fork();
+    if (pid == 0) {
+        ResultWriter* w = result_writer_create(path, 0xC0A80000ul, 0xC0A8FFFFul);
+        for (int i = 0; w && i < 200; ++i) {
+            DeviceInfo di;
+            make_host(&di, i);
+            result_writer_append(w, &di);
+        }
+        _exit(w && result_writer_sync(w) ? 0 : 1);
+    }
+    int status = 1;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    check_store(path, 0, 200, 0);
+
+    // Reopening continues it; closing makes it complete.
+    ResultWriter* w = result_writer_reopen(path, 0xC0A80000ul, 0xC0A8FFFFul);
+    CHECK(w != NULL);
+    for (int i = 200; w && i < 300; ++i) {
+        DeviceInfo di;
+        make_host(&di, i);
+        result_writer_append(w, &di);
+    }
+    CHECK(w && result_writer_close(w));
+    check_store(path, 0, 300, 1);
+
+    // Merge: shards a (0..299) and b (250..499) overlap on 250..299, where
+    // b's records are alive and named "b". Odd hosts are dead in a, so b's
+    // record wins; even ones are alive in both, so a's (the earlier) does.
+    char pa[256], pb[256], out[256];
+    tmp_path(pa, sizeof(pa), "a.bin");
+    tmp_path(pb, sizeof(pb), "b.bin");
+    tmp_path(out, sizeof(out), "merged.bin");
+    CHECK(write_hosts(pa, 0, 300));
+    ResultWriter* wb = result_writer_create(pb, 0xC0A80000ul, 0xC0A8FFFFul);
+    for (int i = 250; wb && i < 500; ++i) {
+        DeviceInfo di;
+        make_host(&di, i);
+        if (i < 300) { di.is_alive = 1; device_set_hostname(&di, "b"); }
+        result_writer_append(wb, &di);
+    }
+    CHECK(wb && result_writer_close(wb));
+    const char* inputs[] = { pa, pb };
+    ResultMergeStats st;
+    CHECK(result_store_merge(out, inputs, 2, &st));
+    CHECK(st.read == 550 && st.written == 500 && st.duplicates == 50 && st.bad_input == -1);
+    ResultStore* m = result_store_open(out);
+    CHECK(m && result_store_count(m) == 500);
+    if (m && result_store_count(m) == 500) {
+        result_store_mount(m);
+        const DeviceInfo* recs = result_store_records(m);
+        unsigned char seen[500] = { 0 };
+        int good = 1;
+        for (int k = 0; k < 500; ++k) {
+            int i = (int)(recs[k].ip - 0xC0A80000ul);
+            if (i < 0 || i >= 500 || seen[i]) { good = 0; continue; }
+            seen[i] = 1;
+            if (i >= 250 && i < 300 && i % 2) good &= recs[k].is_alive && !strcmp(device_hostname(&recs[k]), "b");
+            else good &= host_matches(&recs[k], i);
+        }
+        CHECK(good);
+    }
+    result_store_close(m);
+    const char* missing[] = { pa, "/nonexistent/catnet.bin" };
+    CHECK(!result_store_merge(out, missing, 2, &st) && st.bad_input == 1);
+    remove_store(pa);
+    remove_store(pb);
+    remove_store(out);
+
+    FILE* f = fopen(path, "wb");
+    if (f) { fputs("not a store", f); fclose(f); }
+    CHECK(result_store_open(path) == NULL);
+    remove_store(path);
+    CHECK(result_store_open(path) == NULL);
+
+    return CHECK_RESULT();
+}
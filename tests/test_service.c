@@ -0,0 +1,56 @@
+// Service matcher: Aho-Corasick over a custom table and the built-in one.
+#include "check.h"
+#include "service.h"
+#include <string.h>
+
+static int find(const ServiceMatcher* m, const char* s) {
+    return service_matcher_find(m, (const unsigned char*)s, strlen(s));
+}
+
+int main(void) {
+    // Overlapping patterns that need failure links: "he" inside "she",
+    // "hers" sharing a prefix with "he".
+    static const ServiceSignature sigs[] = {
+        { "hers", 0, 0, "a", "" },
+        { "she", 0, 0, "b", "" },
+        { "he", 0, 0, "c", "" },
+        { "QUIT", 0, 1, "d", "" },
+        { "x\0y", 3, 0, "e", "" },
+    };
+    ServiceMatcher* m = service_matcher_create(sigs, 5);
+    CHECK(m != NULL);
+    if (!m) return CHECK_RESULT();
+    CHECK(find(m, "ushers") == 0);        // all of hers, she, he occur: table order wins
+    CHECK(find(m, "ushe") == 1);
+    CHECK(find(m, "the") == 2);
+    CHECK(find(m, "ahhhe") == 2);         // failure link back into "h"
+    CHECK(find(m, "nothing") == -1);
+    CHECK(find(m, "") == -1);
+    CHECK(find(m, "quit now") == 3);      // ASCII case is ignored
+    CHECK(find(m, "please quit") == -1);  // anchored: only at the start
+    CHECK(find(m, "SHE") == 1);
+    CHECK(service_matcher_find(m, (const unsigned char*)"ax\0yb", 5) == 4); // NULs in patterns
+    CHECK(service_matcher_find(m, (const unsigned char*)"ax\0zb", 5) == -1);
+    service_matcher_destroy(m);
+
+    static const ServiceSignature empty[] = { { "", 0, 0, "z", "" } };
+    CHECK(service_matcher_create(empty, 1) == NULL);
+
+    // Built-in database.
+    const char* ssh = "SSH-2.0-OpenSSH_9.6p1 Ubuntu-3\r\n";
+    const ServiceSignature* sig = service_identify((const unsigned char*)ssh, strlen(ssh));
+    CHECK(sig && !strcmp(sig->service, "ssh") && !strcmp(sig->product, "OpenSSH"));
+    const char* ftp = "220 (vsFTPd 3.0.5)\r\n";
+    sig = service_identify((const unsigned char*)ftp, strlen(ftp));
+    CHECK(sig && !strcmp(sig->service, "ftp") && !strcmp(sig->product, "vsftpd"));
+    CHECK(service_identify((const unsigned char*)"\x01\x02\x03", 3) == NULL);
+    CHECK(service_identify(NULL, 0) == NULL);
+
+    size_t len = 0;
+    const unsigned char* probe = service_probe(80, &len);
+    CHECK(probe && len > 4 && !memcmp(probe, "GET ", 4));
+    probe = service_probe(443, &len);
+    CHECK(probe && len > 5 && probe[0] == 0x16); // TLS handshake record
+
+    return CHECK_RESULT();
+}
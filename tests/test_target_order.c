@@ -0,0 +1,94 @@
+// Target order: every walk visits each offset of the range exactly once,
+// and the shards of an order split it with no overlap.
+#include "check.h"
+#include "target_order.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Walks 'o' in batches of 'batch' positions, counting visits per offset.
+// Returns the number of offsets visited.
+static uint64_t walk(const TargetOrder* o, uint64_t batch, unsigned char* seen, uint64_t n) {
+    uint64_t visited = 0;
+    for (uint64_t pos = 0; pos < o->positions; pos += batch) {
+        TargetCursor cur;
+        uint64_t off;
+        target_order_seek(o, pos, batch, &cur);
+        while (target_order_next(o, &cur, &off)) {
+            CHECK(off < n);
+            if (off < n && seen[off] < 255) seen[off]++;
+            visited++;
+        }
+    }
+    return visited;
+}
+
+static int all_once(const unsigned char* seen, uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+        if (seen[i] != 1) return 0;
+    }
+    return 1;
+}
+
+int main(void) {
+    const uint64_t sizes[] = { 1, 2, 3, 254, 1000, 65536, 100003 };
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+        uint64_t n = sizes[k];
+        unsigned char* seen = (unsigned char*)calloc(n, 1);
+        TargetOrder o;
+
+        target_order_init_sequential(&o, n);
+        CHECK(walk(&o, 64, seen, n) == n && all_once(seen, n));
+        memset(seen, 0, n);
+
+        // A permutation: every offset once, whatever the batch size.
+        target_order_init_shuffled(&o, n, 12345 + k);
+        CHECK(walk(&o, 64, seen, n) == n && all_once(seen, n));
+        memset(seen, 0, n);
+        CHECK(walk(&o, 7, seen, n) == n && all_once(seen, n));
+        free(seen);
+    }
+
+    // Shards are disjoint and together cover the range, shuffled or not.
+    const uint64_t shard_counts[] = { 1, 2, 3, 7, 16 };
+    for (size_t k = 0; k < sizeof(shard_counts) / sizeof(shard_counts[0]); ++k) {
+        uint64_t n = 10007, count = shard_counts[k];
+        unsigned char* seen = (unsigned char*)calloc(n, 1);
+        for (int shuffled = 0; shuffled < 2; ++shuffled) {
+            uint64_t total = 0;
+            for (uint64_t i = 0; i < count; ++i) {
+                TargetOrder o;
+                if (shuffled) target_order_init_shuffled(&o, n, 99);
+                else target_order_init_sequential(&o, n);
+                target_order_shard(&o, i, count);
+                total += walk(&o, 64, seen, n);
+            }
+            CHECK(total == n && all_once(seen, n));
+            memset(seen, 0, n);
+        }
+        free(seen);
+    }
+
+    // Same seed, same order; another seed, another order.
+    TargetOrder a, b, c;
+    target_order_init_shuffled(&a, 5000, 42);
+    target_order_init_shuffled(&b, 5000, 42);
+    target_order_init_shuffled(&c, 5000, 43);
+    TargetCursor ca, cb, cc;
+    target_order_seek(&a, 0, a.positions, &ca);
+    target_order_seek(&b, 0, b.positions, &cb);
+    target_order_seek(&c, 0, c.positions, &cc);
+    int same = 1, differs = 0, ascending = 1;
+    uint64_t x, y, z, prev = 0;
+    for (int i = 0; i < 100; ++i) {
+        target_order_next(&a, &ca, &x);
+        target_order_next(&b, &cb, &y);
+        target_order_next(&c, &cc, &z);
+        if (x != y) same = 0;
+        if (x != z) differs = 1;
+        if (i && x < prev) ascending = 0;
+        prev = x;
+    }
+    CHECK(same && differs && !ascending);
+
+    return CHECK_RESULT();
+}
@@ -0,0 +1,96 @@
+// Timer wheel: firing times, cancel, cascading from the upper levels, and
+// the retry schedule.
+#include "check.h"
+#include "timer_wheel.h"
+
+#define MAX_FIRED 64
+
+typedef struct {
+    uint64_t data[MAX_FIRED];
+    unsigned long long at[MAX_FIRED]; // clock of the advance that fired it
+    int count;
+    unsigned long long now;
+} Fired;
+
+static void on_fire(void* user, uint64_t data) {
+    Fired* f = (Fired*)user;
+    if (f->count < MAX_FIRED) {
+        f->data[f->count] = data;
+        f->at[f->count] = f->now;
+    }
+    f->count++;
+}
+
+// Advances one millisecond at a time up to 'until'.
+static void run_to(TimerWheel* w, Fired* f, unsigned long long until) {
+    while (f->now < until) {
+        f->now++;
+        timer_wheel_advance(w, f->now);
+    }
+}
+
+int main(void) {
+    Fired f = { { 0 }, { 0 }, 0, 1000 };
+    TimerWheel* w = timer_wheel_create(1, f.now, on_fire, &f);
+    CHECK(w != NULL);
+    if (!w) return CHECK_RESULT();
+
+    // Due times within the first level, not before.
+    TimerId a = timer_wheel_add(w, f.now, 10, 1);
+    TimerId b = timer_wheel_add(w, f.now, 5, 2);
+    TimerId c = timer_wheel_add(w, f.now, 20, 3);
+    CHECK(a && b && c && timer_wheel_pending(w) == 3);
+    CHECK(timer_wheel_next_ms(w, f.now, 1000) <= 5);
+    run_to(w, &f, 1004);
+    CHECK(f.count == 0);
+    run_to(w, &f, 1010);
+    CHECK(f.count == 2 && f.data[0] == 2 && f.at[0] == 1005 && f.data[1] == 1 && f.at[1] == 1010);
+
+    // Cancel: a pending timer never fires; a fired one is no longer pending.
+    CHECK(timer_wheel_cancel(w, c) == 1);
+    CHECK(timer_wheel_cancel(w, c) == 0);
+    CHECK(timer_wheel_cancel(w, a) == 0);
+    run_to(w, &f, 1100);
+    CHECK(f.count == 2 && timer_wheel_pending(w) == 0);
+
+    // Cascade: delays past level 0 (256 ticks) and level 1 (65536 ticks)
+    // move down and fire on time.
+    f.count = 0;
+    timer_wheel_add(w, f.now, 300, 10);
+    timer_wheel_add(w, f.now, 70000, 11);
+    TimerId gone = timer_wheel_add(w, f.now, 1000, 12);
+    unsigned long long start = f.now;
+    run_to(w, &f, start + 500);
+    CHECK(timer_wheel_cancel(w, gone) == 1);
+    CHECK(f.count == 1 && f.data[0] == 10 && f.at[0] == start + 300);
+    run_to(w, &f, start + 69999);
+    CHECK(f.count == 1);
+    run_to(w, &f, start + 70000);
+    CHECK(f.count == 2 && f.data[1] == 11 && f.at[1] == start + 70000);
+
+    // A big jump of the clock fires everything due, oldest first.
+    f.count = 0;
+    timer_wheel_add(w, f.now, 40000, 21);
+    timer_wheel_add(w, f.now, 3, 20);
+    f.now += 50000;
+    CHECK(timer_wheel_advance(w, f.now) == 2);
+    CHECK(f.count == 2 && f.data[0] == 20 && f.data[1] == 21);
+
+    CHECK(timer_wheel_reserve(w, 10000));
+    for (int i = 0; i < 10000; ++i) CHECK(timer_wheel_add(w, f.now, 1 + i % 600, 100));
+    CHECK(timer_wheel_pending(w) == 10000);
+    f.count = 0;
+    run_to(w, &f, f.now + 600);
+    CHECK(f.count == 10000 && timer_wheel_pending(w) == 0);
+    timer_wheel_destroy(w);
+
+    RetryPolicy p;
+    retry_policy_init(&p, 4, 100, 200, 300);
+    CHECK(retry_policy_timeout_ms(&p, 0) == 100);
+    CHECK(retry_policy_timeout_ms(&p, 1) == 200);
+    CHECK(retry_policy_timeout_ms(&p, 2) == 300); // capped
+    retry_policy_init(&p, 2, 250, 100, 0);
+    CHECK(retry_policy_timeout_ms(&p, 5) == 250);
+
+    return CHECK_RESULT();
+}